@@ -294,7 +294,11 @@ gAllTests = [ TestCase('TestBuffer', [], True)
              ,TestCase('TestDviDiscovery', ['-l'], True)
              ,TestCase('TestDviDeviceList', ['-l'], True)
              ,TestCase('TestDvInvocation', ['-l'], True)
+             ,TestCase('TestDvInvocation', ['-l', '-k'], True)
+             ,TestCase('TestDvInvocation', ['-l', '-a'], True)
+             ,TestCase('TestDvInvocation', ['-l', '-k', '-a'], True)
              ,TestCase('TestDvSubscription', ['-l'], True)
+             ,TestCase('TestDvResources', ['-l'], True)
              ,TestCase('TestDvDeviceStd', ['-l'], True)
              ,TestCase('TestDvDeviceC', [], True)
              ,TestCase('TestCpDeviceDv', [], True)
@@ -626,6 +626,14 @@ $(objdir)TestDvSubscription.$(objext) : OpenHome/Net/Device/Tests/TestDvSubscrip
 $(objdir)TestDvSubscriptionMain.$(objext) : OpenHome/Net/Device/Tests/TestDvSubscriptionMain.cpp $(headers)
 	$(compiler)TestDvSubscriptionMain.$(objext) -c $(cflags) $(includes) OpenHome/Net/Device/Tests/TestDvSubscriptionMain.cpp
 
+TestDvResources: $(objdir)TestDvResources.$(exeext) 
+$(objdir)TestDvResources.$(exeext) :  ohNetCore $(objdir)TestDvResources.$(objext) $(objdir)TestDvResourcesMain.$(objext) $(libprefix)TestFramework.$(libext)
+	$(link) $(linkoutput)$(objdir)TestDvResources.$(exeext) $(objdir)TestDvResourcesMain.$(objext) $(objdir)TestDvResources.$(objext) $(objdir)$(libprefix)TestFramework.$(libext) $(objdir)$(libprefix)ohNetCore.$(libext)
+$(objdir)TestDvResources.$(objext) : OpenHome/Net/Device/Tests/TestDvResources.cpp $(headers)
+	$(compiler)TestDvResources.$(objext) -c $(cflags) $(includes) OpenHome/Net/Device/Tests/TestDvResources.cpp
+$(objdir)TestDvResourcesMain.$(objext) : OpenHome/Net/Device/Tests/TestDvResourcesMain.cpp $(headers)
+	$(compiler)TestDvResourcesMain.$(objext) -c $(cflags) $(includes) OpenHome/Net/Device/Tests/TestDvResourcesMain.cpp
+
 TestDvTestBasic: $(objdir)TestDvTestBasic.$(exeext) 
 $(objdir)TestDvTestBasic.$(exeext) :  ohNetCore $(objdir)TestDvTestBasic.$(objext) $(objdir)TestBasicDvCore.$(objext) $(objdir)DvOpenhomeOrgTestBasic1.$(objext) $(libprefix)TestFramework.$(libext)
 	$(link) $(linkoutput)$(objdir)TestDvTestBasic.$(exeext) $(objdir)TestDvTestBasic.$(objext) $(objdir)TestBasicDvCore.$(objext) $(objdir)DvOpenhomeOrgTestBasic1.$(objext) $(objdir)$(libprefix)TestFramework.$(libext) $(objdir)$(libprefix)ohNetCore.$(libext)
@@ -744,6 +752,7 @@ tests_core = \
 	$(objdir)TestDviDeviceList.$(objext) \
 	$(objdir)TestDvInvocation.$(objext) \
 	$(objdir)TestDvSubscription.$(objext) \
+	$(objdir)TestDvResources.$(objext) \
 	$(objdir)TestBasicDvCore.$(objext) \
 	$(objdir)DvOpenhomeOrgTestBasic1.$(objext) \
 	$(objdir)TestException.$(objext) \
@@ -752,7 +761,7 @@ tests_core = \
 TestsCore: $(tests_core)
 	$(ar)ohNetTestsCore.$(libext) $(tests_core)
 
-TestsNative: TestBuffer TestThread TestFifo TestFile TestQueue TestTextUtils TestMulticast TestNetwork TestEcho TestTimer TestSsdpMListen TestSsdpUListen TestDeviceList TestDeviceListStd TestDeviceListC TestInvocation TestInvocationStd TestSubscription TestProxyC TestDviDiscovery TestDviDeviceList TestDvInvocation TestDvSubscription TestDvTestBasic TestAdapterChange TestDeviceFinder TestDvDeviceStd TestDvDeviceC TestCpDeviceDv TestCpDeviceDvStd TestCpDeviceDvC TestShell
+TestsNative: TestBuffer TestThread TestFifo TestFile TestQueue TestTextUtils TestMulticast TestNetwork TestEcho TestTimer TestSsdpMListen TestSsdpUListen TestDeviceList TestDeviceListStd TestDeviceListC TestInvocation TestInvocationStd TestSubscription TestProxyC TestDviDiscovery TestDviDeviceList TestDvInvocation TestDvSubscription TestDvResources TestDvTestBasic TestAdapterChange TestDeviceFinder TestDvDeviceStd TestDvDeviceC TestCpDeviceDv TestCpDeviceDvStd TestCpDeviceDvC TestShell
 
 TestsCs: TestProxyCs TestDvDeviceCs TestCpDeviceDvCs TestPerformanceDv TestPerformanceCp TestPerformanceDvCs TestPerformanceCpCs
 
@@ -3,8 +3,50 @@
 #include <OpenHome/Buffer.h>
 #include <OpenHome/Private/Stream.h>
 
+#include <string.h>
+
 using namespace OpenHome;
 
+// Classification of each byte value when (un)escaping xml
+static const TByte kXmlPlain = 0;
+static const TByte kXmlSpecial = 1; // needs to be escaped
+static const TByte kXmlUtf8Lead = 2; // first byte of a multi-byte utf8 character
+
+static const TByte kXmlClass[256] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 1, 0, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, // " & '
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0, // < >
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, // utf8 lead bytes
+        2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+        2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+        2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+};
+
+typedef struct
+{
+    const TChar* iName; // includes trailing ';'
+    TUint iBytes;
+    TByte iValue;
+} XmlEntity;
+
+static const XmlEntity kXmlEntities[] = {
+    { "lt;",   3, '<'  },
+    { "gt;",   3, '>'  },
+    { "amp;",  4, '&'  },
+    { "apos;", 5, '\'' },
+    { "quot;", 5, '\"' }
+};
+static const TUint kNumXmlEntities = sizeof(kXmlEntities) / sizeof(kXmlEntities[0]);
+
 void Converter::ToXmlEscaped(IWriter& aWriter, TByte aValue)
 {
     switch (aValue) {
@@ -49,23 +91,36 @@ TBool Converter::IsMultiByteChar(TByte aChar, TUint& aBytes)
 
 void Converter::ToXmlEscaped(IWriter& aWriter, const Brx& aValue)
 {
-    TUint utf8CharBytesRemaining = 0;
-    for(TUint i = 0; i < aValue.Bytes(); ++i) {
-        TByte ch = aValue[i];
-        if (utf8CharBytesRemaining == 0) {
-            TUint bytes;
-            if (IsMultiByteChar(ch, bytes)) {
-                utf8CharBytesRemaining = bytes;
-            }
+    // Write runs of bytes which don't need escaping in single calls to aWriter.
+    // Bytes within multi-byte utf8 characters are never escaped.
+    const TByte* ptr = aValue.Ptr();
+    const TUint bytes = aValue.Bytes();
+    TUint start = 0;
+    TUint i = 0;
+    while (i < bytes) {
+        const TByte cls = kXmlClass[ptr[i]];
+        if (cls == kXmlPlain) {
+            i++;
         }
-        if (utf8CharBytesRemaining > 0) {
-            utf8CharBytesRemaining--;
-            aWriter.Write(ch);
+        else if (cls == kXmlUtf8Lead) {
+            TUint charBytes;
+            (void)IsMultiByteChar(ptr[i], charBytes);
+            i += charBytes;
         }
         else {
-            ToXmlEscaped(aWriter, aValue[i]);
+            if (i > start) {
+                aWriter.Write(Brn(ptr + start, i - start));
+            }
+            ToXmlEscaped(aWriter, ptr[i]);
+            start = ++i;
         }
     }
+    if (i > bytes) { // value ends part way through a multi-byte character
+        i = bytes;
+    }
+    if (i > start) {
+        aWriter.Write(Brn(ptr + start, i - start));
+    }
 }
 
 static const TByte kBase64[64] = {
@@ -98,183 +153,165 @@ static const TByte kDecode64[256] = {
         0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
 };
 
+TUint Converter::Base64EncodedBytes(TUint aBytes)
+{
+    return ((aBytes + 2) / 3) * 4;
+}
+
 void Converter::ToBase64(IWriter& aWriter, const Brx& aValue)
 {
-    TUint b = 0;
-    TByte block[3];
-    
-    for(TUint i = 0; i < aValue.Bytes(); ++i) {
-        
-        block[b++] = aValue[i];
-        
-        if (b >= 3) {
-            TByte index0 = block[0] >> 2;
-            TByte index1 = (block[0] & 0x03) << 4 | block[1] >> 4;
-            TByte index2 = (block[1] & 0x0f) << 2 | block[2] >> 6;
-            TByte index3 = (block[2] & 0x3f);
-            
-            aWriter.Write(kBase64[index0]);
-            aWriter.Write(kBase64[index1]);
-            aWriter.Write(kBase64[index2]);
-            aWriter.Write(kBase64[index3]);
-            
-            b = 0;
+    // encode 3 bytes at a time into a local buffer, passing it to aWriter whenever it fills
+    TByte encoded[kBase64BlockBytes];
+    TUint j = 0;
+    const TByte* ptr = aValue.Ptr();
+    TUint remaining = aValue.Bytes();
+    while (remaining >= 3) {
+        const TUint block = (ptr[0] << 16) | (ptr[1] << 8) | ptr[2];
+        encoded[j++] = kBase64[block >> 18];
+        encoded[j++] = kBase64[(block >> 12) & 0x3f];
+        encoded[j++] = kBase64[(block >> 6) & 0x3f];
+        encoded[j++] = kBase64[block & 0x3f];
+        ptr += 3;
+        remaining -= 3;
+        if (j == kBase64BlockBytes) {
+            aWriter.Write(Brn(encoded, j));
+            j = 0;
         }
     }
-    
-    if (b == 1) {
-        TByte index0 = block[0] >> 2;
-        TByte index1 = (block[0] & 0x03) << 4;
-        aWriter.Write(kBase64[index0]);
-        aWriter.Write(kBase64[index1]);
-        aWriter.Write('=');
-        aWriter.Write('=');
+    // kBase64BlockBytes is a multiple of 4 so there is always space for the final block here
+    if (remaining == 1) {
+        encoded[j++] = kBase64[ptr[0] >> 2];
+        encoded[j++] = kBase64[(ptr[0] & 0x03) << 4];
+        encoded[j++] = '=';
+        encoded[j++] = '=';
+    }
+    else if (remaining == 2) {
+        encoded[j++] = kBase64[ptr[0] >> 2];
+        encoded[j++] = kBase64[(ptr[0] & 0x03) << 4 | ptr[1] >> 4];
+        encoded[j++] = kBase64[(ptr[1] & 0x0f) << 2];
+        encoded[j++] = '=';
     }
-    else if (b == 2) {
-        TByte index0 = block[0] >> 2;
-        TByte index1 = (block[0] & 0x03) << 4 | block[1] >> 4;
-        TByte index2 = (block[1] & 0x0f) << 2;
-        aWriter.Write(kBase64[index0]);
-        aWriter.Write(kBase64[index1]);
-        aWriter.Write(kBase64[index2]);
-        aWriter.Write('=');
+    if (j > 0) {
+        aWriter.Write(Brn(encoded, j));
     }
 }
 
 void Converter::FromBase64(Bwx& aValue)
 {
-    TUint bytes = aValue.Bytes();
+    TByte* ptr = const_cast<TByte*>(aValue.Ptr());
+    const TUint bytes = aValue.Bytes();
 
     TUint j = 0;
     TUint b = 0;
     TByte block[4];
 
-    for (TUint i = 0; i < bytes; i++) {
-        
-        TByte d = kDecode64[aValue[i]];
+    TUint i = 0;
+    while (i < bytes) {
+        if (b == 0) {
+            // fast path for the common case of 4 consecutive valid characters
+            while (i + 4 <= bytes) {
+                const TByte d0 = kDecode64[ptr[i]];
+                const TByte d1 = kDecode64[ptr[i+1]];
+                const TByte d2 = kDecode64[ptr[i+2]];
+                const TByte d3 = kDecode64[ptr[i+3]];
+                if ((d0 | d1 | d2 | d3) & 0x80) {
+                    break;
+                }
+                ptr[j++] = (TByte)(d0 << 2 | d1 >> 4);
+                ptr[j++] = (TByte)(d1 << 4 | d2 >> 2);
+                ptr[j++] = (TByte)(d2 << 6 | d3);
+                i += 4;
+            }
+            if (i == bytes) {
+                break;
+            }
+        }
+
+        // slow path; skips whitespace, padding and any other invalid characters
+        TByte d = kDecode64[ptr[i++]];
         if (d > 64) {
             continue;
         }
         block[b++] = d;
         if (b >= 4) {
-            aValue[j++] = block[0] << 2 | block[1] >> 4;
-            aValue[j++] = block[1] << 4 | block[2] >> 2;
-            aValue[j++] = block[2] << 6 | block[3];
+            ptr[j++] = block[0] << 2 | block[1] >> 4;
+            ptr[j++] = block[1] << 4 | block[2] >> 2;
+            ptr[j++] = block[2] << 6 | block[3];
             b = 0;
         }
     }
     
     if (b > 1) {
-        aValue[j++] = block[0] << 2 | block[1] >> 4;
+        ptr[j++] = block[0] << 2 | block[1] >> 4;
     }
     if (b > 2) {
-        aValue[j++] = block[1] << 4 | block[2] >> 2;
+        ptr[j++] = block[1] << 4 | block[2] >> 2;
     }
     
     aValue.SetBytes(j);
 }
 
+TUint Converter::FromXmlEntity(const TByte* aPtr, TUint aBytes, TBool& aDecoded, TByte& aValue)
+{
+    TUint longestMatch = 0;
+    for (TUint i=0; i<kNumXmlEntities; i++) {
+        const XmlEntity& entity = kXmlEntities[i];
+        const TUint max = (entity.iBytes < aBytes? entity.iBytes : aBytes);
+        TUint matched = 0;
+        while (matched < max && aPtr[matched] == (TByte)entity.iName[matched]) {
+            matched++;
+        }
+        if (matched == entity.iBytes) {
+            aDecoded = true;
+            aValue = entity.iValue;
+            return matched;
+        }
+        if (matched > longestMatch) {
+            longestMatch = matched;
+        }
+    }
+    // unrecognised; discard the partial reference up to and including the first unexpected byte
+    aDecoded = false;
+    return (longestMatch < aBytes? longestMatch + 1 : aBytes);
+}
+
 void Converter::FromXmlEscaped(Bwx& aValue)
 {
+    TByte* ptr = const_cast<TByte*>(aValue.Ptr());
+    const TUint bytes = aValue.Bytes();
+    TUint i = 0;
     TUint j = 0;
-    TUint bytes = aValue.Bytes();
-    TUint utf8CharBytesRemaining = 0;
-
-    for (TUint i = 0; i < bytes; i++) {
-        TByte ch = aValue[i];
-        if (utf8CharBytesRemaining == 0) {
-            TUint bytes;
-            if (IsMultiByteChar(ch, bytes)) {
-                utf8CharBytesRemaining = bytes;
+    for (;;) {
+        // find the next entity reference, skipping over multi-byte utf8 characters
+        const TUint start = i;
+        while (i < bytes && ptr[i] != '&') {
+            if (kXmlClass[ptr[i]] == kXmlUtf8Lead) {
+                TUint charBytes;
+                (void)IsMultiByteChar(ptr[i], charBytes);
+                i += charBytes;
+            }
+            else {
+                i++;
             }
         }
-        if (utf8CharBytesRemaining > 0) {
-            utf8CharBytesRemaining--;
-            aValue[j++] = aValue[i];
-            continue;
+        if (i > bytes) {
+            i = bytes;
         }
-
-        if (aValue[i] != '&') {
-            aValue[j++] = aValue[i];
-            continue;
+        // move the run before it down over any space freed by earlier references
+        const TUint runBytes = i - start;
+        if (runBytes > 0 && j != start) {
+            (void)memmove(ptr + j, ptr + start, runBytes);
         }
-        if (++i < bytes) {
-            if (aValue[i] == 'l') {
-                if (++i < bytes) {
-                    if (aValue[i] == 't') {
-                        if (++i < bytes) {
-                            if (aValue[i] == ';') {
-                                aValue[j++] = '<';
-                                continue;
-                            }
-                        }
-                    }
-                }
-            }
-            else if (aValue[i] == 'g') {
-                if (++i < bytes) {
-                    if (aValue[i] == 't') {
-                        if (++i < bytes) {
-                            if (aValue[i] == ';') {
-                                aValue[j++] = '>';
-                                continue;
-                            }
-                        }
-                    }
-                }
-            }
-            else if (aValue[i] == 'a') {
-                if (++i < bytes) {
-                    if (aValue[i] == 'm') {
-                        if (++i < bytes) {
-                            if (aValue[i] == 'p') {
-                                if (++i < bytes) {
-                                    if (aValue[i] == ';') {
-                                        aValue[j++] = '&';
-                                        continue;
-                                    }
-                                }
-                            }
-                        }
-                    }
-                    else if (aValue[i] == 'p') {
-                        if (++i < bytes) {
-                            if (aValue[i] == 'o') {
-                                if (++i < bytes) {
-                                    if (aValue[i] == 's') {
-                                        if (++i < bytes) {
-                                            if (aValue[i] == ';') {
-                                                aValue[j++] = '\'';
-                                                continue;
-                                            }
-                                        }
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
-            }
-            else if (aValue[i] == 'q') {
-                if (++i < bytes) {
-                    if (aValue[i] == 'u') {
-                        if (++i < bytes) {
-                            if (aValue[i] == 'o') {
-                                if (++i < bytes) {
-                                    if (aValue[i] == 't') {
-                                        if (++i < bytes) {
-                                            if (aValue[i] == ';') {
-                                                aValue[j++] = '\"';
-                                                continue;
-                                            }
-                                        }
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
-            }
+        j += runBytes;
+        if (i == bytes) {
+            break;
+        }
+        i++; // skip '&'
+        TBool decoded;
+        TByte value = 0;
+        i += FromXmlEntity(ptr + i, bytes - i, decoded, value);
+        if (decoded) {
+            ptr[j++] = value;
         }
     }
     aValue.SetBytes(j);
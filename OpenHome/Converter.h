@@ -14,14 +14,17 @@ class Converter
 {
 public:
     static void ToBase64(IWriter& aWriter, const Brx& aValue);
+    static TUint Base64EncodedBytes(TUint aBytes); // length of the output from ToBase64
     static void ToXmlEscaped(IWriter& aWriter, const Brx& aValue);
     static void FromBase64(Bwx& aValue); // Converts in place
     static void FromXmlEscaped(Bwx& aValue); // Converts in place
     static TUint32 BeUint32At(const Brx& aBuf, TUint aIndex);
     static TUint16 BeUint16At(const Brx& aBuf, TUint aIndex);
 private:
+    static const TUint kBase64BlockBytes = 1024; // multiple of 4
     static void ToXmlEscaped(IWriter& aWriter, TByte aValue);
     static TBool IsMultiByteChar(TByte aChar, TUint& aBytes);
+    static TUint FromXmlEntity(const TByte* aPtr, TUint aBytes, TBool& aDecoded, TByte& aValue);
 };
 
 } // namespace OpenHome
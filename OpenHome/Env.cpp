@@ -41,6 +41,7 @@ Environment::Environment(FunctorMsg& aLogOutput)
     , iInitParams(NULL)
     , iTimerManager(NULL)
     , iNetworkAdapterList(NULL)
+    , iSsdpDispatcher(NULL)
     , iSequenceNumber(0)
     , iCpStack(NULL)
     , iDvStack(NULL)
@@ -52,6 +53,7 @@ Environment::Environment(InitialisationParams* aInitParams)
     : iOsContext(NULL)
     , iInitParams(aInitParams)
     , iNetworkAdapterList(NULL)
+    , iSsdpDispatcher(NULL)
     , iSequenceNumber(0)
     , iCpStack(NULL)
     , iDvStack(NULL)
@@ -69,8 +71,11 @@ Environment::Environment(InitialisationParams* aInitParams)
 #else
     SetRandomSeed((TUint)(time(NULL) % UINT32_MAX));
 #endif // PLATFORM_MACOSX_GNU
-    iTimerManager = new OpenHome::TimerManager(*this);
+    iTimerManager = new OpenHome::TimerManager(*this, iInitParams->NumTimerThreads());
     iNetworkAdapterList = new OpenHome::NetworkAdapterList(*this, 0);
+    if (iInitParams->NumSsdpThreads() > 0) {
+        iSsdpDispatcher = new Net::SsdpDispatcher(iInitParams->NumSsdpThreads());
+    }
     Functor& subnetListChangeListener = iInitParams->SubnetListChangedListener();
     if (subnetListChangeListener) {
         iNetworkAdapterList->AddSubnetListChangeListener(subnetListChangeListener, false);
@@ -109,6 +114,7 @@ Environment::~Environment()
     delete iCpStack;
     delete iDvStack;
     delete iNetworkAdapterList;
+    delete iSsdpDispatcher;
     if (iObjectMap.size() != 0) {
         Log::Print("ERROR: destroying stack before some owned objects\n");
         Log::Print("...leaked objects are\n");
@@ -156,6 +162,11 @@ NetworkAdapterList& Environment::NetworkAdapterList()
     return *iNetworkAdapterList;
 }
 
+Net::SsdpDispatcher* Environment::SsdpDispatcher()
+{
+    return iSsdpDispatcher;
+}
+
 Net::SsdpListenerMulticast& Environment::MulticastListenerClaim(TIpAddress aInterface)
 {
     AutoMutex a(*iPrivateLock);
@@ -55,6 +55,7 @@ public:
     OsContext* OsCtx();
     Log& Logger();
     OpenHome::NetworkAdapterList& NetworkAdapterList();
+    Net::SsdpDispatcher* SsdpDispatcher(); // NULL if multicast listeners handle their own messages
     Net::SsdpListenerMulticast& MulticastListenerClaim(TIpAddress aInterface);
     void MulticastListenerRelease(TIpAddress aInterface);
     void AddResumeObserver(IResumeObserver& aObserver);
@@ -95,6 +96,7 @@ private:
     OpenHome::TimerManager* iTimerManager;
     OpenHome::Mutex* iPublicLock;
     OpenHome::NetworkAdapterList* iNetworkAdapterList;
+    Net::SsdpDispatcher* iSsdpDispatcher;
     typedef std::vector<MListener*> MulticastListeners;
     MulticastListeners iMulticastListeners;
     std::vector<IResumeObserver*> iResumeObservers;
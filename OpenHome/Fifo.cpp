@@ -1,19 +1,25 @@
 #include <OpenHome/Private/Fifo.h>
+#include <OpenHome/OsWrapper.h>
+#include <OpenHome/Net/Private/Globals.h>
+#include <OpenHome/Private/Env.h>
 
 using namespace OpenHome;
 
 // FifoBase
 
-FifoBase::FifoBase(TUint aSlots)
+FifoBase::FifoBase(TUint aSlots, EFifoSignalling aSignalling)
     : iSlots(aSlots)
     , iSlotsUsed(0)
     , iMutexWrite("FIMW")
     , iMutexRead("FIMR")
     , iSemaRead("FISR", 0)
-    , iSemaWrite("FISW", aSlots)
+    , iSemaWrite("FISW", (aSignalling == EFifoSignalAlways? aSlots : 0))
     , iReadIndex(0)
     , iWriteIndex(0)
     , iInterrupted(false)
+    , iSignalling(aSignalling)
+    , iReadersWaiting(0)
+    , iWritersWaiting(0)
 {
     ASSERT(iSlots > 0);
 }
@@ -36,16 +42,73 @@ TUint FifoBase::SlotsUsed() const
 
 void FifoBase::ReadInterrupt(TBool aInterrupt)
 {
+    if (iSignalling == EFifoSignalOnDemand) {
+        AutoMutex a(iMutexWrite);
+        iInterrupted = aInterrupt;
+        if (aInterrupt && iReadersWaiting > 0) {
+            iSemaRead.Signal();
+        }
+        return;
+    }
     iInterrupted = aInterrupt;
     if (aInterrupt) {
         iSemaRead.Signal();
     }
 }
 
-TUint FifoBase::WriteOpen(TUint aTimeoutMs)
+TUint FifoBase::ParkStart(TUint aTimeoutMs) const
+{
+    if (aTimeoutMs == Semaphore::kWaitForever) {
+        return 0;
+    }
+    return Os::TimeInMs(gEnv->OsCtx());
+}
+
+void FifoBase::Park(Semaphore& aSem, TUint& aWaiters, TUint aTimeoutMs, TUint aStartMs)
 {
-    iSemaWrite.Wait(aTimeoutMs);
+    /* Wakers signal aSem whenever aWaiters is non-zero so a parked thread may occasionally
+       be woken more than once.  Callers re-check their condition after each call so surplus
+       signals only result in an extra pass round their loop.  Each pass waits only for what
+       remains of the caller's timeout, measured from aStartMs. */
+    TUint timeoutMs = aTimeoutMs;
+    if (aTimeoutMs != Semaphore::kWaitForever) {
+        const TUint elapsed = Os::TimeInMs(gEnv->OsCtx()) - aStartMs;
+        if (elapsed >= aTimeoutMs) {
+            iMutexWrite.Signal();
+            THROW(Timeout);
+        }
+        timeoutMs = aTimeoutMs - elapsed;
+    }
+    aWaiters++;
+    iMutexWrite.Signal();
+    try {
+        aSem.Wait(timeoutMs);
+    }
+    catch (Timeout&) {
+        iMutexWrite.Wait();
+        aWaiters--;
+        iMutexWrite.Signal();
+        throw;
+    }
     iMutexWrite.Wait();
+    aWaiters--;
+}
+
+TUint FifoBase::WriteOpen(TUint aTimeoutMs)
+{
+    if (iSignalling == EFifoSignalOnDemand) {
+        iMutexWrite.Wait();
+        if (iSlotsUsed == iSlots) {
+            const TUint start = ParkStart(aTimeoutMs);
+            do {
+                Park(iSemaWrite, iWritersWaiting, aTimeoutMs, start);
+            } while (iSlotsUsed == iSlots);
+        }
+    }
+    else {
+        iSemaWrite.Wait(aTimeoutMs);
+        iMutexWrite.Wait();
+    }
     TUint index = iWriteIndex++;
     if(iWriteIndex == Slots()) {
         iWriteIndex = 0;
@@ -56,31 +119,74 @@ TUint FifoBase::WriteOpen(TUint aTimeoutMs)
 void FifoBase::WriteClose()
 {
     iSlotsUsed++;
+    if (iSignalling == EFifoSignalOnDemand) {
+        if (iReadersWaiting > 0) {
+            iSemaRead.Signal();
+        }
+        iMutexWrite.Signal();
+        return;
+    }
     iMutexWrite.Signal();
     iSemaRead.Signal();
 }
 
 TUint FifoBase::ReadOpen(TUint aTimeoutMs)
 {
+    if (iSignalling == EFifoSignalOnDemand) {
+        // iMutexWrite is held until ReadClose()
+        iMutexWrite.Wait();
+        TUint start = 0;
+        TBool parked = false;
+        for (;;) {
+            if (iInterrupted) {
+                iInterrupted = false;
+                iMutexWrite.Signal();
+                THROW(FifoReadError);
+            }
+            if (iSlotsUsed > 0) {
+                break;
+            }
+            if (!parked) {
+                start = ParkStart(aTimeoutMs);
+                parked = true;
+            }
+            Park(iSemaRead, iReadersWaiting, aTimeoutMs, start);
+        }
+        TUint index = iReadIndex++;
+        if (iReadIndex == Slots()) {
+            iReadIndex = 0;
+        }
+        return index;
+    }
     iSemaRead.Wait(aTimeoutMs);
     if (iInterrupted) {
     	iInterrupted = false;
         THROW(FifoReadError);
     }
+    // iMutexRead is held until ReadClose() so that, with several readers, the entry
+    // can't be overwritten by a writer lapping the fifo before we've copied it
     iMutexRead.Wait();
     TUint index = iReadIndex++;
     if(iReadIndex == Slots()) {
         iReadIndex = 0;
     }
-    iMutexRead.Signal();
     return (index);
 }
 
 void FifoBase::ReadClose()
 {
+    if (iSignalling == EFifoSignalOnDemand) {
+        iSlotsUsed--;
+        if (iWritersWaiting > 0) {
+            iSemaWrite.Signal();
+        }
+        iMutexWrite.Signal();
+        return;
+    }
     iMutexWrite.Wait();
     iSlotsUsed--;
     iMutexWrite.Signal();
+    iMutexRead.Signal();
     iSemaWrite.Signal();
 }
 
@@ -13,6 +13,17 @@ namespace OpenHome {
 //
 // Writer threads are blocked while the fifo is full
 // Reader threads are blocked while the fifo is empty
+//
+// EFifoSignalAlways (the default) signals a semaphore on every read and write.
+// EFifoSignalOnDemand guards the fifo with a single mutex and only uses semaphores to
+// park and wake threads which are actually blocked.  This avoids most of the locking
+// (and resulting context switches) for heavily used fifos which are rarely full or empty.
+
+enum EFifoSignalling
+{
+    EFifoSignalAlways
+   ,EFifoSignalOnDemand
+};
 
 class FifoBase : public INonCopyable
 {
@@ -22,12 +33,15 @@ public:
     TUint SlotsUsed() const;
     void ReadInterrupt(TBool aInterrupt=true);
 protected:
-    FifoBase(TUint aSlots);
+    FifoBase(TUint aSlots, EFifoSignalling aSignalling = EFifoSignalAlways);
     TUint WriteOpen(TUint aTimeoutMs);// return index of entry to write
     void WriteClose();                // complete the write
     TUint ReadOpen(TUint aTimeoutMs); // return index of entry to read
     void ReadClose();                 // complete the read
     TUint DoPeek();                   // return index of entry without removing it
+private:
+    TUint ParkStart(TUint aTimeoutMs) const;
+    void Park(Semaphore& aSem, TUint& aWaiters, TUint aTimeoutMs, TUint aStartMs); // called with iMutexWrite held
 protected:
     const TUint iSlots;
     TUint iSlotsUsed;                 // protected by iMutexWrite
@@ -38,12 +52,15 @@ protected:
     TUint iReadIndex;
     TUint iWriteIndex;
     TBool iInterrupted;
+    const EFifoSignalling iSignalling;
+    TUint iReadersWaiting;            // EFifoSignalOnDemand only; protected by iMutexWrite
+    TUint iWritersWaiting;            // EFifoSignalOnDemand only; protected by iMutexWrite
 };
 
 template <class T> class Fifo : public FifoBase
 {
 public:
-    inline Fifo(TUint aSlots) : FifoBase(aSlots) { iBuf = new T[aSlots]; }
+    inline Fifo(TUint aSlots, EFifoSignalling aSignalling = EFifoSignalAlways) : FifoBase(aSlots, aSignalling) { iBuf = new T[aSlots]; }
     inline ~Fifo() { delete [] iBuf; }
     void Write(T aEntry);
     void Write(T aEntry, TUint aTimeoutMs);
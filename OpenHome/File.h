@@ -24,6 +24,7 @@ typedef enum {
 typedef enum {
     eFileReadOnly,
     eFileReadWrite,
+    eFileReadWriteTruncate, // as eFileReadWrite but any existing content is discarded
 } FileMode;
 
 class IFile 
@@ -56,6 +57,7 @@ public: // from IFile
     TUint32 Bytes() const;
 private:
     FILE* iFilePtr;
+    FileMode iFileMode;
 };
 
 class FileBrx : public IFile
@@ -5,12 +5,23 @@ using namespace OpenHome;
 
 FileAnsii::FileAnsii(const TChar* aFilename, FileMode aFileMode)
     : iFilePtr(NULL)
+    , iFileMode(aFileMode)
 {
     switch (aFileMode)
     {
         case eFileReadOnly:
             iFilePtr = fopen(aFilename, "rb");
             break;
+        case eFileReadWrite:
+            // open an existing file without truncating it, creating it if it doesn't exist
+            iFilePtr = fopen(aFilename, "r+b");
+            if (iFilePtr == NULL) {
+                iFilePtr = fopen(aFilename, "w+b");
+            }
+            break;
+        case eFileReadWriteTruncate:
+            iFilePtr = fopen(aFilename, "w+b");
+            break;
         default:
             iFilePtr = NULL;
             break;
@@ -43,9 +54,15 @@ void FileAnsii::Write(const Brx& aBuffer)
     Write(aBuffer, aBuffer.Bytes());
 }
 
-void FileAnsii::Write(const Brx& /*aBuffer*/, TUint32 /*aBytes*/)
+void FileAnsii::Write(const Brx& aBuffer, TUint32 aBytes)
 {
-    THROW(FileWriteError);
+    ASSERT(aBytes <= aBuffer.Bytes());
+    if (iFileMode == eFileReadOnly) {
+        THROW(FileWriteError);
+    }
+    if (fwrite(aBuffer.Ptr(), 1, aBytes, iFilePtr) != aBytes) {
+        THROW(FileWriteError);
+    }
 }
 
 void FileAnsii::Seek(TInt32 aBytes, SeekWhence aWhence)
@@ -263,12 +263,21 @@ const HttpStatus HttpStatus::kHttpVersionNotSupported = HttpStatusMaker(505, Brn
 
 ReaderHttpHeader::ReaderHttpHeader(Environment& aEnv)
     : iEnv(aEnv)
+    , iHeader(0)
+    , iIndexEntries(0)
+    , iMaxIndexEntries(0)
 {
 }
 
+ReaderHttpHeader::~ReaderHttpHeader()
+{
+    ClearIndex();
+}
+
 void ReaderHttpHeader::AddHeader(IHttpHeader& aHeader)
 {
     iHeaders.push_back(&aHeader);
+    ClearIndex(); // aHeader may recognise a field previously indexed as unrecognised
 }
 
 IHttpHeader& ReaderHttpHeader::Header() const
@@ -287,16 +296,98 @@ void ReaderHttpHeader::ResetHeaders()
 }
 
 void ReaderHttpHeader::ProcessHeader(const Brx& aField, const Brx& aValue)
+{
+    /* IHttpHeader only lets us ask whether a field is recognised so we can't index
+       headers by name when they're added.  Instead, remember which header (if any)
+       recognised each field the first time we see it, allowing later requests to
+       find their header with a single lookup. */
+    IHttpHeader* header = 0;
+    if (aField.Bytes() > kMaxIndexedFieldBytes) {
+        header = FindHeader(aField);
+    }
+    else {
+        if (iIndex.size() == 0) {
+            CreateIndex();
+        }
+        const TUint mask = (TUint)iIndex.size() - 1;
+        const TUint hash = Hash(aField);
+        TUint slot = hash & mask;
+        for (;;) {
+            IndexEntry* entry = iIndex[slot];
+            if (entry == 0) {
+                header = FindHeader(aField);
+                if (iIndexEntries < iMaxIndexEntries) {
+                    iIndex[slot] = new IndexEntry(hash, aField, header);
+                    iIndexEntries++;
+                }
+                break;
+            }
+            if (entry->iHash == hash && Ascii::CaseInsensitiveEquals(entry->iField, aField)) {
+                header = entry->iHeader;
+                break;
+            }
+            slot = (slot + 1) & mask;
+        }
+    }
+    if (header != 0) {
+        iHeader = header;
+        header->Process(aValue);
+    }
+}
+
+TUint ReaderHttpHeader::Hash(const Brx& aField)
+{
+    // FNV-1a, ignoring case
+    TUint hash = 2166136261u;
+    const TUint bytes = aField.Bytes();
+    for (TUint i = 0; i < bytes; i++) {
+        hash ^= (TByte)Ascii::ToLowerCase(aField[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+IHttpHeader* ReaderHttpHeader::FindHeader(const Brx& aField) const
 {
     TUint count = (TUint)iHeaders.size();
     for (TUint i = 0; i < count; i++) {
         IHttpHeader* header = iHeaders[i];
         if (header->Recognise(aField)) {
-            iHeader = header;
-            header->Process(aValue);        
-            return;
+            return header;
         }
-    } 
+    }
+    return 0;
+}
+
+void ReaderHttpHeader::CreateIndex()
+{
+    // room for a field per header plus a few others, keeping the table no more than 3/4 full
+    iMaxIndexEntries = (TUint)iHeaders.size() + kMaxUnrecognisedFields;
+    TUint slots = 8;
+    while (slots * 3 < iMaxIndexEntries * 4) {
+        slots *= 2;
+    }
+    iIndex.assign(slots, (IndexEntry*)0);
+}
+
+void ReaderHttpHeader::ClearIndex()
+{
+    const TUint slots = (TUint)iIndex.size();
+    for (TUint i = 0; i < slots; i++) {
+        delete iIndex[i];
+    }
+    iIndex.clear();
+    iIndexEntries = 0;
+}
+
+
+// ReaderHttpHeader::IndexEntry
+
+ReaderHttpHeader::IndexEntry::IndexEntry(TUint aHash, const Brx& aField, IHttpHeader* aHeader)
+    : iHash(aHash)
+    , iField(aField)
+    , iHeader(aHeader)
+{
 }
 
 
@@ -616,6 +707,12 @@ void WriterHttpHeader::WriteFlush()
     iWriter.Flush();
 }
 
+void WriterHttpHeader::WriteHeaderEnd()
+{
+    LOG(kHttp, "Http Write Header   ");
+    iWriter.WriteNewline();
+}
+
 void WriterHttpHeader::WriteHeader(const Brx& aField, const Brx& aValue)
 {
     LOG(kHttp, "Http Write Header   ");
@@ -911,6 +1008,154 @@ void HttpHeaderExpect::Process(const Brx& aValue)
 }
 
 
+// HttpHeaderIfNoneMatch
+
+TBool HttpHeaderIfNoneMatch::Matches(const Brx& aETag) const
+{
+    if (!Received() || aETag.Bytes() == 0) {
+        return false;
+    }
+    Brn etag = Opaque(aETag);
+    Parser parser(iValue);
+    while (!parser.Finished()) {
+        Brn item = Ascii::Trim(parser.Next(','));
+        if (item == Brn("*") || Opaque(item) == etag) {
+            return true;
+        }
+    }
+    return false;
+}
+
+TBool HttpHeaderIfNoneMatch::Recognise(const Brx& aHeader)
+{
+    return (Ascii::CaseInsensitiveEquals(aHeader, Http::kHeaderIfNoneMatch));
+}
+
+void HttpHeaderIfNoneMatch::Process(const Brx& aValue)
+{
+    if (aValue.Bytes() > iValue.MaxBytes()) {
+        return; // too long to store; treat as absent so the full resource is sent
+    }
+    iValue.Replace(aValue);
+    SetReceived();
+}
+
+Brn HttpHeaderIfNoneMatch::Opaque(const Brx& aETag)
+{
+    if (aETag.Bytes() >= 2 && aETag[0] == 'W' && aETag[1] == '/') {
+        return aETag.Split(2);
+    }
+    return Brn(aETag);
+}
+
+
+// HttpHeaderETag
+
+const Brx& HttpHeaderETag::ETag() const
+{
+    return iETag;
+}
+
+TBool HttpHeaderETag::Recognise(const Brx& aHeader)
+{
+    return (Ascii::CaseInsensitiveEquals(aHeader, Http::kHeaderETag));
+}
+
+void HttpHeaderETag::Process(const Brx& aValue)
+{
+    if (aValue.Bytes() > iETag.MaxBytes()) {
+        return; // too long to store; treat as absent
+    }
+    iETag.Replace(aValue);
+    SetReceived();
+}
+
+
+// HttpHeaderLastModified
+
+const Brx& HttpHeaderLastModified::LastModified() const
+{
+    return iLastModified;
+}
+
+TBool HttpHeaderLastModified::Recognise(const Brx& aHeader)
+{
+    return (Ascii::CaseInsensitiveEquals(aHeader, Http::kHeaderLastModified));
+}
+
+void HttpHeaderLastModified::Process(const Brx& aValue)
+{
+    if (aValue.Bytes() > iLastModified.MaxBytes()) {
+        return; // not a valid HTTP-date; treat as absent
+    }
+    iLastModified.Replace(aValue);
+    SetReceived();
+}
+
+
+// HttpHeaderRange
+
+TBool HttpHeaderRange::Resolve(TUint aTotalBytes, TUint& aOffset, TUint& aBytes) const
+{
+    if (!Received()) {
+        return false;
+    }
+    aOffset = 0;
+    aBytes = 0;
+    if (iSuffix) {
+        if (iLast > 0) {
+            aBytes = (iLast < aTotalBytes? iLast : aTotalBytes);
+            aOffset = aTotalBytes - aBytes;
+        }
+    }
+    else if (iFirst < aTotalBytes) {
+        aOffset = iFirst;
+        TUint last = ((iOpenEnd || iLast >= aTotalBytes)? aTotalBytes-1 : iLast);
+        aBytes = last - iFirst + 1;
+    }
+    return true;
+}
+
+TBool HttpHeaderRange::Recognise(const Brx& aHeader)
+{
+    return (Ascii::CaseInsensitiveEquals(aHeader, Http::kHeaderRange));
+}
+
+void HttpHeaderRange::Process(const Brx& aValue)
+{
+    Brn value = Ascii::Trim(aValue);
+    if (value.Bytes() <= Http::kRangeBytes.Bytes() || value.Split(0, Http::kRangeBytes.Bytes()) != Http::kRangeBytes) {
+        return;
+    }
+    Brn spec = Ascii::Trim(value.Split(Http::kRangeBytes.Bytes()));
+    if (Ascii::Contains(spec, ',')) {
+        return; // multiple ranges aren't supported; ignoring the header results in the full entity being sent
+    }
+    if (!Ascii::Contains(spec, '-')) {
+        return;
+    }
+    Parser parser(spec);
+    Brn first = Ascii::Trim(parser.Next('-'));
+    Brn last = Ascii::Trim(parser.Remaining());
+    iSuffix = (first.Bytes() == 0);
+    iOpenEnd = (last.Bytes() == 0);
+    if (iSuffix && iOpenEnd) {
+        return;
+    }
+    try {
+        iFirst = (iSuffix? 0 : Ascii::Uint(first));
+        iLast = (iOpenEnd? 0 : Ascii::Uint(last));
+    }
+    catch (AsciiError&) {
+        return;
+    }
+    if (!iSuffix && !iOpenEnd && iLast < iFirst) {
+        return; // syntactically invalid; ignore it
+    }
+    SetReceived();
+}
+
+
 // HttpHeaderAccessControlRequestMethod
 
 const Brx& HttpHeaderAccessControlRequestMethod::Method() const
@@ -946,6 +1191,38 @@ ReaderHttpChunked::ReaderHttpChunked(IReader& aReader)
 }
 
 void ReaderHttpChunked::Read()
+{
+    for (;;) {
+        TUint chunkSize = ReadChunkSize();
+        if (chunkSize == 0) {
+            break;
+        }
+        iEntity.Grow(iEntity.Bytes() + chunkSize);
+        while (chunkSize > 0) {
+            TUint bytes = (chunkSize<4096? chunkSize : 4096);
+            iEntity.Append(iReader.Read(bytes));
+            chunkSize -= bytes;
+        }
+    }
+}
+
+void ReaderHttpChunked::Read(IWriter& aWriter)
+{
+    for (;;) {
+        TUint chunkSize = ReadChunkSize();
+        if (chunkSize == 0) {
+            break;
+        }
+        while (chunkSize > 0) {
+            TUint bytes = (chunkSize<4096? chunkSize : 4096);
+            aWriter.Write(iReader.Read(bytes));
+            chunkSize -= bytes;
+        }
+    }
+    aWriter.WriteFlush();
+}
+
+TUint ReaderHttpChunked::ReadChunkSize()
 {
     for (;;) {
         Brn chunkSizeBuf = iReader.ReadUntil(Ascii::kLf);
@@ -954,22 +1231,12 @@ void ReaderHttpChunked::Read()
         if (trimmed.Bytes() == 0) {
             continue;
         }
-        TUint chunkSize;
         try {
-            chunkSize = Ascii::UintHex(trimmed);
+            return Ascii::UintHex(trimmed);
         }
         catch (AsciiError&) {
             THROW(ReaderError);
         }
-        if (chunkSize == 0) {
-            break;
-        }
-        iEntity.Grow(iEntity.Bytes() + chunkSize);
-        while (chunkSize > 0) {
-            TUint bytes = (chunkSize<4096? chunkSize : 4096);
-            iEntity.Append(iReader.Read(bytes));
-            chunkSize -= bytes;
-        }
     }
 }
 
@@ -986,6 +1253,12 @@ WriterHttpChunked::WriterHttpChunked(IWriter& aWriter)
 {
 }
 
+WriterHttpChunked::WriterHttpChunked(IWriterGather& aWriter)
+    : iBuffer(aWriter)
+    , iChunked(false)
+{
+}
+
 void WriterHttpChunked::SetChunked(TBool aValue)
 {
     iChunked = aValue;
@@ -1007,18 +1280,44 @@ void WriterHttpChunked::Write(TByte aValue)
 void WriterHttpChunked::Write(const Brx& aBuffer)
 {
     if (iChunked) {
-        Bws<16> count;
-        Ascii::AppendHexTrim(count, aBuffer.Bytes());
-        iBuffer.Write(count);
-        iBuffer.Write(Http::kHeaderTerminator);
-        iBuffer.Write(aBuffer);
-        iBuffer.Write(Http::kHeaderTerminator);
+        const Brx* buffers[] = { &aBuffer };
+        WriteGather(buffers, 1);
     }
     else {
         iBuffer.Write(aBuffer);
     }
 }
 
+void WriterHttpChunked::WriteGather(const Brx** aBuffers, TUint aCount)
+{
+    if (!iChunked) {
+        iBuffer.WriteGather(aBuffers, aCount);
+        return;
+    }
+    if (aCount + 3 > kMaxGatherBuffers) {
+        for (TUint i = 0; i < aCount; i++) {
+            Write(*aBuffers[i]);
+        }
+        return;
+    }
+    // write all buffers as a single chunk, framing them without copying
+    TUint bytes = 0;
+    for (TUint i = 0; i < aCount; i++) {
+        bytes += aBuffers[i]->Bytes();
+    }
+    Bws<16> count;
+    Ascii::AppendHexTrim(count, bytes);
+    count.Append(Http::kHeaderTerminator);
+    const Brx* buffers[kMaxGatherBuffers];
+    TUint index = 0;
+    buffers[index++] = &count;
+    for (TUint i = 0; i < aCount; i++) {
+        buffers[index++] = aBuffers[i];
+    }
+    buffers[index++] = &Http::kHeaderTerminator;
+    iBuffer.WriteGather(buffers, index);
+}
+
 void WriterHttpChunked::WriteFlush()
 {
     if (iChunked) {
@@ -230,18 +230,39 @@ class Environment;
 
 class ReaderHttpHeader : protected INonCopyable
 {
+    static const TUint kMaxUnrecognisedFields = 16; // index room for fields no header recognises
+    static const TUint kMaxIndexedFieldBytes = 32;  // longer fields are matched by searching iHeaders
 public:
     IHttpHeader& Header() const;
     void AddHeader(IHttpHeader& aHeader);
 protected:
     ReaderHttpHeader(Environment& aEnv);
+    ~ReaderHttpHeader();
     void ResetHeaders();
     void ProcessHeader(const Brx& aField, const Brx& aValue);
 protected:
     Environment& iEnv;
+private:
+    class IndexEntry : private INonCopyable
+    {
+    public:
+        IndexEntry(TUint aHash, const Brx& aField, IHttpHeader* aHeader);
+    public:
+        TUint iHash;
+        Brh iField;
+        IHttpHeader* iHeader; // 0 if no header recognises iField
+    };
+private:
+    static TUint Hash(const Brx& aField);
+    IHttpHeader* FindHeader(const Brx& aField) const;
+    void CreateIndex();
+    void ClearIndex();
 private:
     IHttpHeader* iHeader;
     std::vector<IHttpHeader*> iHeaders;
+    std::vector<IndexEntry*> iIndex; // power of 2 slots (0 if unused); empty until a header is processed
+    TUint iIndexEntries;
+    TUint iMaxIndexEntries;
 };
 
 class Timer;
@@ -331,6 +352,7 @@ public:
     virtual void WriteHeader(const Brx& aField, const Brx& aValue);
     virtual void WriteHeaderBase64(const Brx& aField, const Brx& aValue);
     virtual IWriterAscii& WriteHeaderField(const Brx& aField); // returns a stream for writing the value
+    void WriteHeaderEnd(); // as WriteFlush() but leaves the header buffered, to be sent along with the body
 protected:
     WriterHttpHeader(IWriter& aWriter);
 protected:
@@ -440,6 +462,63 @@ private:
     TBool iContinue;
 };
 
+class HttpHeaderIfNoneMatch : public HttpHeader
+{
+public:
+    TBool Matches(const Brx& aETag) const; // uses weak comparison, as required for If-None-Match
+private:
+    TBool Recognise(const Brx& aHeader);
+    void Process(const Brx& aValue);
+    static Brn Opaque(const Brx& aETag);
+private:
+    static const TUint kMaxValueBytes = 256;
+    Bws<kMaxValueBytes> iValue;
+};
+
+class HttpHeaderETag : public HttpHeader
+{
+public:
+    const Brx& ETag() const;
+private:
+    TBool Recognise(const Brx& aHeader);
+    void Process(const Brx& aValue);
+private:
+    static const TUint kMaxValueBytes = 256;
+    Bws<kMaxValueBytes> iETag;
+};
+
+class HttpHeaderLastModified : public HttpHeader
+{
+public:
+    const Brx& LastModified() const; // HTTP-date, suitable for use in If-Modified-Since
+private:
+    TBool Recognise(const Brx& aHeader);
+    void Process(const Brx& aValue);
+private:
+    static const TUint kMaxValueBytes = 64;
+    Bws<kMaxValueBytes> iLastModified;
+};
+
+class HttpHeaderRange : public HttpHeader
+{
+public:
+    /**
+     * Returns false if the header was absent or couldn't be interpreted (including requests
+     * for more than one range); the whole entity should be sent.  Otherwise aOffset and aBytes
+     * are set to the requested range of an entity of aTotalBytes.  aBytes is 0 if the range
+     * can't be satisfied.
+     */
+    TBool Resolve(TUint aTotalBytes, TUint& aOffset, TUint& aBytes) const;
+private:
+    TBool Recognise(const Brx& aHeader);
+    void Process(const Brx& aValue);
+private:
+    TBool iSuffix;   // "bytes=-N" - the last iLast bytes
+    TBool iOpenEnd;  // "bytes=N-"
+    TUint iFirst;
+    TUint iLast;
+};
+
 class HttpHeaderAccessControlRequestMethod : public HttpHeader
 {
 public:
@@ -463,23 +542,28 @@ class ReaderHttpChunked
 public:
     ReaderHttpChunked(IReader& aReader); // IReader must allow reads at least 4k
     void Read();
+    void Read(IWriter& aWriter); // passes the dechunked entity to aWriter rather than buffering it
     void TransferTo(Bwh& aBuf);
 private:
     ReaderHttpChunked& operator=(const ReaderHttpChunked&);
+    TUint ReadChunkSize();
 private:
     IReader& iReader;
     Bwh iEntity;
 };
 
-class WriterHttpChunked : public IWriter
+class WriterHttpChunked : public IWriterGather
 {
     static const TUint kMaxBufferBytes = 6000;
+    static const TUint kMaxGatherBuffers = 8;
 public:
     WriterHttpChunked(IWriter& aWriter);
+    WriterHttpChunked(IWriterGather& aWriter);
     void SetChunked(TBool aValue);
     virtual void Write(TByte aValue);
     virtual void Write(const Brx& aBuffer);
     virtual void WriteFlush();
+    virtual void WriteGather(const Brx** aBuffers, TUint aCount);
 private:
     Sws<kMaxBufferBytes> iBuffer;
     TBool iChunked;
@@ -86,6 +86,28 @@ DllExport void STDCALL DvProviderPropertiesLock(DvProviderC aProvider);
  */
 DllExport void STDCALL DvProviderPropertiesUnlock(DvProviderC aProvider);
 
+/**
+ * Set the minimum interval between notifications of changes to a provider's properties.
+ *
+ * Changes made within aIntervalMs of the previous notification are coalesced and
+ * published together once the interval has elapsed.
+ *
+ * @param[in] aProvider     Handle to a provider
+ * @param[in] aIntervalMs   Minimum interval between notifications.  0 publishes changes immediately.
+ */
+DllExport void STDCALL DvProviderSetEventModerationMs(DvProviderC aProvider, uint32_t aIntervalMs);
+
+/**
+ * Set the minimum interval between notifications of changes to a single property.
+ *
+ * Overrides the interval set by DvProviderSetEventModerationMs() for aPropertyName only.
+ *
+ * @param[in] aProvider      Handle to a provider
+ * @param[in] aPropertyName  Name of a property previously added to aProvider
+ * @param[in] aIntervalMs    Minimum interval between notifications.  0 publishes changes immediately.
+ */
+DllExport void STDCALL DvProviderSetPropertyEventModerationMs(DvProviderC aProvider, const char* aPropertyName, uint32_t aIntervalMs);
+
 /**
  * Add a property (passing ownership) to a provider
  *
@@ -62,6 +62,16 @@ void STDCALL DvProviderPropertiesUnlock(DvProviderC aProvider)
     ProviderFromHandle(aProvider)->PropertiesUnlock();
 }
 
+void STDCALL DvProviderSetEventModerationMs(DvProviderC aProvider, uint32_t aIntervalMs)
+{
+    ProviderFromHandle(aProvider)->SetEventModerationMs(aIntervalMs);
+}
+
+void STDCALL DvProviderSetPropertyEventModerationMs(DvProviderC aProvider, const char* aPropertyName, uint32_t aIntervalMs)
+{
+    ProviderFromHandle(aProvider)->SetEventModerationMs(aPropertyName, aIntervalMs);
+}
+
 void STDCALL DvProviderAddProperty(DvProviderC aProvider, ServiceProperty aProperty)
 {
     OpenHome::Net::Property* prop = reinterpret_cast<OpenHome::Net::Property*>(aProperty);
@@ -446,6 +446,124 @@ DllExport void STDCALL OhNetInitParamsSetDvWebSocketPort(OhNetHandleInitParams a
  */
 DllExport void STDCALL OhNetInitParamsSetDvEnableBonjour(OhNetHandleInitParams aParams);
 
+/**
+ * Use event driven (readiness based) tcp servers for the device stack's UPnP
+ * server and the control point stack's UPnP event server.
+ * Server threads then form a worker pool which is only used for connections with
+ * data available, allowing many more clients than threads.
+ * Ignored on platforms which don't support this.
+ *
+ * @param[in] aParams          Initialisation params
+ */
+DllExport void STDCALL OhNetInitParamsSetEventDrivenTcpServers(OhNetHandleInitParams aParams);
+
+/**
+ * Allow the device stack's UPnP server to keep connections open between requests.
+ *
+ * @param[in] aParams          Initialisation params
+ * @param[in] aIdleTimeoutMs   Time an idle connection is kept open for.  0 disables persistent connections.
+ * @param[in] aMaxRequests     Maximum number of requests served by a single connection
+ */
+DllExport void STDCALL OhNetInitParamsSetDvKeepAlive(OhNetHandleInitParams aParams, uint32_t aIdleTimeoutMs, uint32_t aMaxRequests);
+
+/**
+ * Allow the control point stack to reuse connections for action invocations on the same device.
+ *
+ * @param[in] aParams            Initialisation params
+ * @param[in] aMaxIdlePerDevice  Maximum number of idle connections retained per device.  0 disables connection reuse.
+ * @param[in] aIdleTimeoutMs     Time an idle connection is retained for
+ */
+DllExport void STDCALL OhNetInitParamsSetCpConnectionPool(OhNetHandleInitParams aParams, uint32_t aMaxIdlePerDevice, uint32_t aIdleTimeoutMs);
+
+/**
+ * Allow the device stack to reuse a connection to an event subscriber for later notifications.
+ *
+ * @param[in] aParams          Initialisation params
+ * @param[in] aIdleTimeoutMs   Time an idle connection is kept open for.  0 disables connection reuse.
+ */
+DllExport void STDCALL OhNetInitParamsSetDvEventKeepAlive(OhNetHandleInitParams aParams, uint32_t aIdleTimeoutMs);
+
+/**
+ * Set the default moderation interval for property updates published by device services.
+ *
+ * Updates made within this interval of the previous notification are coalesced into a
+ * single notification.  Individual providers can override this using DvProviderSetEventModerationMs().
+ *
+ * @param[in] aParams          Initialisation params
+ * @param[in] aIntervalMs      Minimum interval between notifications.  0 publishes each update immediately.
+ */
+DllExport void STDCALL OhNetInitParamsSetDvEventModeration(OhNetHandleInitParams aParams, uint32_t aIntervalMs);
+
+/**
+ * Set the number of threads which run timer callbacks.
+ *
+ * A given timer's callbacks never run concurrently, whatever the number of threads.
+ *
+ * @param[in] aParams          Initialisation params
+ * @param[in] aNumThreads      Number of threads.  0 (the default) runs all callbacks on the timer manager's own thread.
+ */
+DllExport void STDCALL OhNetInitParamsSetNumTimerThreads(OhNetHandleInitParams aParams, uint32_t aNumThreads);
+
+/**
+ * Set the maximum number of bytes of device resources to be cached in memory.
+ *
+ * A resource manager can provide a gzip compressed copy of any resource at [uri].gz;
+ * this will be served to clients which accept gzip encoding.
+ *
+ * @param[in] aParams          Initialisation params
+ * @param[in] aBytes           Size of the cache.  0 (the default) disables caching.
+ */
+DllExport void STDCALL OhNetInitParamsSetDvResourceCacheBytes(OhNetHandleInitParams aParams, uint32_t aBytes);
+
+/**
+ * Set the number of threads which pass received SSDP multicast messages on to the control and device stacks.
+ *
+ * Messages about a given device are handled in order, whatever the number of threads.
+ *
+ * @param[in] aParams          Initialisation params
+ * @param[in] aNumThreads      Number of threads.  0 (the default) handles messages on each interface's listener thread.
+ */
+DllExport void STDCALL OhNetInitParamsSetNumSsdpThreads(OhNetHandleInitParams aParams, uint32_t aNumThreads);
+
+/**
+ * Set a directory in which control points keep copies of the device descriptions they fetch.
+ *
+ * Devices whose description is cached are reported as soon as they are discovered.
+ * Their description is re-fetched in the background.
+ *
+ * @param[in] aParams          Initialisation params
+ * @param[in] aDir             Existing, writable, directory.  NULL or "" (the default) disables caching.
+ */
+DllExport void STDCALL OhNetInitParamsSetCpDeviceXmlCacheDir(OhNetHandleInitParams aParams, const char* aDir);
+
+/**
+ * Set the sizes of buffers used by the device stack's UPnP server.
+ *
+ * @param[in] aParams              Initialisation params
+ * @param[in] aMaxRequestBytes     Maximum size of a request's headers plus body.  Defaults to 65536.
+ * @param[in] aResponseBufferBytes Size of each server thread's response buffer.  Defaults to 4096.
+ * @param[in] aNotifyBufferBytes   Size of the buffer each event notification is written through.
+ *                                 Defaults to 12288.
+ */
+DllExport void STDCALL OhNetInitParamsSetDvServerBuffers(OhNetHandleInitParams aParams, uint32_t aMaxRequestBytes, uint32_t aResponseBufferBytes, uint32_t aNotifyBufferBytes);
+
+/**
+ * Set the size of the read buffer for each of the control point stack's event sessions.
+ *
+ * @param[in] aParams          Initialisation params
+ * @param[in] aBytes           Size in bytes.  Defaults to 16384.
+ */
+DllExport void STDCALL OhNetInitParamsSetCpEventSessionReadBufferBytes(OhNetHandleInitParams aParams, uint32_t aBytes);
+
+/**
+ * Start device server and control point event session read buffers small, growing each
+ * as larger requests are received, up to the sizes set by OhNetInitParamsSetDvServerBuffers()
+ * and OhNetInitParamsSetCpEventSessionReadBufferBytes().
+ *
+ * @param[in] aParams          Initialisation params
+ */
+DllExport void STDCALL OhNetInitParamsSetAdaptiveSessionBuffers(OhNetHandleInitParams aParams);
+
 /**
  * Query the tcp connection timeout
  *
@@ -609,6 +727,148 @@ DllExport uint32_t STDCALL OhNetInitParamsDvWebSocketPort(OhNetHandleInitParams
  */
 DllExport uint32_t STDCALL OhNetInitParamsDvIsBonjourEnabled(OhNetHandleInitParams aParams);
 
+/**
+ * Query whether event driven tcp servers are requested
+ *
+ * @param[in] aParams          Initialisation params
+ *
+ * @return  1 if event driven tcp servers are requested; 0 otherwise
+ */
+DllExport uint32_t STDCALL OhNetInitParamsUseEventDrivenTcpServers(OhNetHandleInitParams aParams);
+
+/**
+ * Query the idle timeout for persistent connections to the device stack's UPnP server
+ *
+ * @param[in] aParams          Initialisation params
+ *
+ * @return  idle timeout in milliseconds; 0 if persistent connections are disabled
+ */
+DllExport uint32_t STDCALL OhNetInitParamsDvKeepAliveIdleTimeoutMs(OhNetHandleInitParams aParams);
+
+/**
+ * Query the maximum number of requests served by a persistent connection
+ *
+ * @param[in] aParams          Initialisation params
+ */
+DllExport uint32_t STDCALL OhNetInitParamsDvKeepAliveMaxRequests(OhNetHandleInitParams aParams);
+
+/**
+ * Query the maximum number of idle connections the control point stack retains per device
+ *
+ * @param[in] aParams          Initialisation params
+ *
+ * @return  maximum idle connections per device; 0 if connection reuse is disabled
+ */
+DllExport uint32_t STDCALL OhNetInitParamsCpConnectionPoolMaxPerDevice(OhNetHandleInitParams aParams);
+
+/**
+ * Query the time an idle control point connection is retained for
+ *
+ * @param[in] aParams          Initialisation params
+ *
+ * @return  idle timeout in milliseconds
+ */
+DllExport uint32_t STDCALL OhNetInitParamsCpConnectionPoolIdleTimeoutMs(OhNetHandleInitParams aParams);
+
+/**
+ * Query the idle timeout for connections to event subscribers
+ *
+ * @param[in] aParams          Initialisation params
+ *
+ * @return  idle timeout in milliseconds; 0 if connection reuse is disabled
+ */
+DllExport uint32_t STDCALL OhNetInitParamsDvEventKeepAliveIdleTimeoutMs(OhNetHandleInitParams aParams);
+
+/**
+ * Query the default moderation interval for property updates published by device services
+ *
+ * @param[in] aParams          Initialisation params
+ *
+ * @return  moderation interval in milliseconds; 0 if updates are published immediately
+ */
+DllExport uint32_t STDCALL OhNetInitParamsDvEventModerationMs(OhNetHandleInitParams aParams);
+
+/**
+ * Query the number of threads which run timer callbacks
+ *
+ * @param[in] aParams          Initialisation params
+ *
+ * @return  number of threads; 0 if callbacks run on the timer manager's own thread
+ */
+DllExport uint32_t STDCALL OhNetInitParamsNumTimerThreads(OhNetHandleInitParams aParams);
+
+/**
+ * Query the maximum number of bytes of device resources cached in memory
+ *
+ * @param[in] aParams          Initialisation params
+ *
+ * @return  size of the cache in bytes; 0 if caching is disabled
+ */
+DllExport uint32_t STDCALL OhNetInitParamsDvResourceCacheBytes(OhNetHandleInitParams aParams);
+
+/**
+ * Query the number of threads which pass received SSDP multicast messages on to the control and device stacks
+ *
+ * @param[in] aParams          Initialisation params
+ *
+ * @return  number of threads; 0 if messages are handled on each interface's listener thread
+ */
+DllExport uint32_t STDCALL OhNetInitParamsNumSsdpThreads(OhNetHandleInitParams aParams);
+
+/**
+ * Query the directory in which control points keep copies of device descriptions
+ *
+ * @param[in] aParams          Initialisation params
+ *
+ * @return  nul-terminated directory name; "" if caching is disabled.  Owned by aParams.
+ */
+DllExport const char* STDCALL OhNetInitParamsCpDeviceXmlCacheDir(OhNetHandleInitParams aParams);
+
+/**
+ * Query the maximum size of a request to the device stack's UPnP server
+ *
+ * @param[in] aParams          Initialisation params
+ *
+ * @return  size in bytes
+ */
+DllExport uint32_t STDCALL OhNetInitParamsDvMaxRequestBytes(OhNetHandleInitParams aParams);
+
+/**
+ * Query the size of each device server thread's response buffer
+ *
+ * @param[in] aParams          Initialisation params
+ *
+ * @return  size in bytes
+ */
+DllExport uint32_t STDCALL OhNetInitParamsDvResponseBufferBytes(OhNetHandleInitParams aParams);
+
+/**
+ * Query the size of the buffer event notifications are written through
+ *
+ * @param[in] aParams          Initialisation params
+ *
+ * @return  size in bytes
+ */
+DllExport uint32_t STDCALL OhNetInitParamsDvNotifyBufferBytes(OhNetHandleInitParams aParams);
+
+/**
+ * Query the size of the read buffer for each control point event session
+ *
+ * @param[in] aParams          Initialisation params
+ *
+ * @return  size in bytes
+ */
+DllExport uint32_t STDCALL OhNetInitParamsCpEventSessionReadBufferBytes(OhNetHandleInitParams aParams);
+
+/**
+ * Query whether session read buffers grow and shrink with the requests they receive
+ *
+ * @param[in] aParams          Initialisation params
+ *
+ * @return  1 if adaptive buffers are requested; 0 otherwise
+ */
+DllExport uint32_t STDCALL OhNetInitParamsUseAdaptiveSessionBuffers(OhNetHandleInitParams aParams);
+
 /* @} */
 
 /**
@@ -250,6 +250,78 @@ void STDCALL OhNetInitParamsSetDvEnableBonjour(OhNetHandleInitParams aParams)
     ip->SetDvEnableBonjour();
 }
 
+void STDCALL OhNetInitParamsSetEventDrivenTcpServers(OhNetHandleInitParams aParams)
+{
+    InitialisationParams* ip = reinterpret_cast<InitialisationParams*>(aParams);
+    ip->SetEventDrivenTcpServers();
+}
+
+void STDCALL OhNetInitParamsSetDvKeepAlive(OhNetHandleInitParams aParams, uint32_t aIdleTimeoutMs, uint32_t aMaxRequests)
+{
+    InitialisationParams* ip = reinterpret_cast<InitialisationParams*>(aParams);
+    ip->SetDvKeepAlive(aIdleTimeoutMs, aMaxRequests);
+}
+
+void STDCALL OhNetInitParamsSetCpConnectionPool(OhNetHandleInitParams aParams, uint32_t aMaxIdlePerDevice, uint32_t aIdleTimeoutMs)
+{
+    InitialisationParams* ip = reinterpret_cast<InitialisationParams*>(aParams);
+    ip->SetCpConnectionPool(aMaxIdlePerDevice, aIdleTimeoutMs);
+}
+
+void STDCALL OhNetInitParamsSetDvEventKeepAlive(OhNetHandleInitParams aParams, uint32_t aIdleTimeoutMs)
+{
+    InitialisationParams* ip = reinterpret_cast<InitialisationParams*>(aParams);
+    ip->SetDvEventKeepAlive(aIdleTimeoutMs);
+}
+
+void STDCALL OhNetInitParamsSetDvEventModeration(OhNetHandleInitParams aParams, uint32_t aIntervalMs)
+{
+    InitialisationParams* ip = reinterpret_cast<InitialisationParams*>(aParams);
+    ip->SetDvEventModeration(aIntervalMs);
+}
+
+void STDCALL OhNetInitParamsSetNumTimerThreads(OhNetHandleInitParams aParams, uint32_t aNumThreads)
+{
+    InitialisationParams* ip = reinterpret_cast<InitialisationParams*>(aParams);
+    ip->SetNumTimerThreads(aNumThreads);
+}
+
+void STDCALL OhNetInitParamsSetDvResourceCacheBytes(OhNetHandleInitParams aParams, uint32_t aBytes)
+{
+    InitialisationParams* ip = reinterpret_cast<InitialisationParams*>(aParams);
+    ip->SetDvResourceCacheBytes(aBytes);
+}
+
+void STDCALL OhNetInitParamsSetNumSsdpThreads(OhNetHandleInitParams aParams, uint32_t aNumThreads)
+{
+    InitialisationParams* ip = reinterpret_cast<InitialisationParams*>(aParams);
+    ip->SetNumSsdpThreads(aNumThreads);
+}
+
+void STDCALL OhNetInitParamsSetCpDeviceXmlCacheDir(OhNetHandleInitParams aParams, const char* aDir)
+{
+    InitialisationParams* ip = reinterpret_cast<InitialisationParams*>(aParams);
+    ip->SetCpDeviceXmlCacheDir(aDir);
+}
+
+void STDCALL OhNetInitParamsSetDvServerBuffers(OhNetHandleInitParams aParams, uint32_t aMaxRequestBytes, uint32_t aResponseBufferBytes, uint32_t aNotifyBufferBytes)
+{
+    InitialisationParams* ip = reinterpret_cast<InitialisationParams*>(aParams);
+    ip->SetDvServerBuffers(aMaxRequestBytes, aResponseBufferBytes, aNotifyBufferBytes);
+}
+
+void STDCALL OhNetInitParamsSetCpEventSessionReadBufferBytes(OhNetHandleInitParams aParams, uint32_t aBytes)
+{
+    InitialisationParams* ip = reinterpret_cast<InitialisationParams*>(aParams);
+    ip->SetCpEventSessionReadBufferBytes(aBytes);
+}
+
+void STDCALL OhNetInitParamsSetAdaptiveSessionBuffers(OhNetHandleInitParams aParams)
+{
+    InitialisationParams* ip = reinterpret_cast<InitialisationParams*>(aParams);
+    ip->SetAdaptiveSessionBuffers();
+}
+
 uint32_t STDCALL OhNetInitParamsTcpConnectTimeoutMs(OhNetHandleInitParams aParams)
 {
     InitialisationParams* ip = reinterpret_cast<InitialisationParams*>(aParams);
@@ -358,6 +430,102 @@ uint32_t STDCALL OhNetInitParamsDvIsBonjourEnabled(OhNetHandleInitParams aParams
     return (ip->DvIsBonjourEnabled()? 1 : 0);
 }
 
+uint32_t STDCALL OhNetInitParamsUseEventDrivenTcpServers(OhNetHandleInitParams aParams)
+{
+    InitialisationParams* ip = reinterpret_cast<InitialisationParams*>(aParams);
+    return (ip->UseEventDrivenTcpServers()? 1 : 0);
+}
+
+uint32_t STDCALL OhNetInitParamsDvKeepAliveIdleTimeoutMs(OhNetHandleInitParams aParams)
+{
+    InitialisationParams* ip = reinterpret_cast<InitialisationParams*>(aParams);
+    return ip->DvKeepAliveIdleTimeoutMs();
+}
+
+uint32_t STDCALL OhNetInitParamsDvKeepAliveMaxRequests(OhNetHandleInitParams aParams)
+{
+    InitialisationParams* ip = reinterpret_cast<InitialisationParams*>(aParams);
+    return ip->DvKeepAliveMaxRequests();
+}
+
+uint32_t STDCALL OhNetInitParamsCpConnectionPoolMaxPerDevice(OhNetHandleInitParams aParams)
+{
+    InitialisationParams* ip = reinterpret_cast<InitialisationParams*>(aParams);
+    return ip->CpConnectionPoolMaxPerDevice();
+}
+
+uint32_t STDCALL OhNetInitParamsCpConnectionPoolIdleTimeoutMs(OhNetHandleInitParams aParams)
+{
+    InitialisationParams* ip = reinterpret_cast<InitialisationParams*>(aParams);
+    return ip->CpConnectionPoolIdleTimeoutMs();
+}
+
+uint32_t STDCALL OhNetInitParamsDvEventKeepAliveIdleTimeoutMs(OhNetHandleInitParams aParams)
+{
+    InitialisationParams* ip = reinterpret_cast<InitialisationParams*>(aParams);
+    return ip->DvEventKeepAliveIdleTimeoutMs();
+}
+
+uint32_t STDCALL OhNetInitParamsDvEventModerationMs(OhNetHandleInitParams aParams)
+{
+    InitialisationParams* ip = reinterpret_cast<InitialisationParams*>(aParams);
+    return ip->DvEventModerationMs();
+}
+
+uint32_t STDCALL OhNetInitParamsNumTimerThreads(OhNetHandleInitParams aParams)
+{
+    InitialisationParams* ip = reinterpret_cast<InitialisationParams*>(aParams);
+    return ip->NumTimerThreads();
+}
+
+uint32_t STDCALL OhNetInitParamsDvResourceCacheBytes(OhNetHandleInitParams aParams)
+{
+    InitialisationParams* ip = reinterpret_cast<InitialisationParams*>(aParams);
+    return ip->DvResourceCacheBytes();
+}
+
+uint32_t STDCALL OhNetInitParamsNumSsdpThreads(OhNetHandleInitParams aParams)
+{
+    InitialisationParams* ip = reinterpret_cast<InitialisationParams*>(aParams);
+    return ip->NumSsdpThreads();
+}
+
+const char* STDCALL OhNetInitParamsCpDeviceXmlCacheDir(OhNetHandleInitParams aParams)
+{
+    InitialisationParams* ip = reinterpret_cast<InitialisationParams*>(aParams);
+    return (const char*)ip->CpDeviceXmlCacheDir().Ptr();
+}
+
+uint32_t STDCALL OhNetInitParamsDvMaxRequestBytes(OhNetHandleInitParams aParams)
+{
+    InitialisationParams* ip = reinterpret_cast<InitialisationParams*>(aParams);
+    return ip->DvMaxRequestBytes();
+}
+
+uint32_t STDCALL OhNetInitParamsDvResponseBufferBytes(OhNetHandleInitParams aParams)
+{
+    InitialisationParams* ip = reinterpret_cast<InitialisationParams*>(aParams);
+    return ip->DvResponseBufferBytes();
+}
+
+uint32_t STDCALL OhNetInitParamsDvNotifyBufferBytes(OhNetHandleInitParams aParams)
+{
+    InitialisationParams* ip = reinterpret_cast<InitialisationParams*>(aParams);
+    return ip->DvNotifyBufferBytes();
+}
+
+uint32_t STDCALL OhNetInitParamsCpEventSessionReadBufferBytes(OhNetHandleInitParams aParams)
+{
+    InitialisationParams* ip = reinterpret_cast<InitialisationParams*>(aParams);
+    return ip->CpEventSessionReadBufferBytes();
+}
+
+uint32_t STDCALL OhNetInitParamsUseAdaptiveSessionBuffers(OhNetHandleInitParams aParams)
+{
+    InitialisationParams* ip = reinterpret_cast<InitialisationParams*>(aParams);
+    return (ip->UseAdaptiveSessionBuffers()? 1 : 0);
+}
+
 TIpAddress STDCALL OhNetNetworkAdapterAddress(OhNetHandleNetworkAdapter aNif)
 {
     NetworkAdapter* nif = reinterpret_cast<NetworkAdapter*>(aNif);
@@ -706,9 +706,9 @@ InvocationManager::InvocationManager(CpStack& aCpStack)
     : Thread("INVM")
     , iCpStack(aCpStack)
     , iLock("INVM")
-    , iFreeInvocations(aCpStack.Env().InitParams().NumInvocations())
-    , iWaitingInvocations(aCpStack.Env().InitParams().NumInvocations())
-    , iFreeInvokers(aCpStack.Env().InitParams().NumActionInvokerThreads())
+    , iFreeInvocations(aCpStack.Env().InitParams().NumInvocations(), EFifoSignalOnDemand)
+    , iWaitingInvocations(aCpStack.Env().InitParams().NumInvocations(), EFifoSignalOnDemand)
+    , iFreeInvokers(aCpStack.Env().InitParams().NumActionInvokerThreads(), EFifoSignalOnDemand)
 {
     TUint i;
     TChar thName[5] = "IN  ";
@@ -4,6 +4,8 @@
 #include <OpenHome/Net/Private/XmlFetcher.h>
 #include <OpenHome/Net/Private/CpiSubscription.h>
 #include <OpenHome/Net/Private/CpiDevice.h>
+#include <OpenHome/Net/Private/CpiDeviceUpnp.h>
+#include <OpenHome/Private/Network.h>
 #include <OpenHome/Private/Printer.h>
 
 using namespace OpenHome;
@@ -15,18 +17,23 @@ CpStack::CpStack(OpenHome::Environment& aStack)
     : iEnv(aStack)
 {
     iEnv.SetCpStack(this);
+    iInvocationConnectionPool = new SocketTcpClientPool(iEnv, iEnv.InitParams().CpConnectionPoolMaxPerDevice(),
+                                                        iEnv.InitParams().CpConnectionPoolIdleTimeoutMs());
     iInvocationManager = new OpenHome::Net::InvocationManager(*this);
     iXmlFetchManager = new OpenHome::Net::XmlFetchManager(*this);
     iSubscriptionManager = new CpiSubscriptionManager(*this);
     iDeviceListUpdater = new CpiDeviceListUpdater();
+    iDeviceRegistryUpnp = new CpiDeviceRegistryUpnp(*this);
 }
 
 CpStack::~CpStack()
 {
     delete iDeviceListUpdater;
     delete iSubscriptionManager;
-    delete iXmlFetchManager;
+    delete iXmlFetchManager; // completes any outstanding fetches for iDeviceRegistryUpnp
+    delete iDeviceRegistryUpnp;
     delete iInvocationManager;
+    delete iInvocationConnectionPool;
 }
 
 InvocationManager& CpStack::InvocationManager()
@@ -48,3 +55,13 @@ CpiDeviceListUpdater& CpStack::DeviceListUpdater()
 {
     return *iDeviceListUpdater;
 }
+
+SocketTcpClientPool& CpStack::InvocationConnectionPool()
+{
+    return *iInvocationConnectionPool;
+}
+
+CpiDeviceRegistryUpnp& CpStack::DeviceRegistryUpnp()
+{
+    return *iDeviceRegistryUpnp;
+}
@@ -14,12 +14,16 @@
 #include <vector>
 
 namespace OpenHome {
+
+class SocketTcpClientPool;
+
 namespace Net {
 
 class InvocationManager;
 class XmlFetchManager;
 class CpiSubscriptionManager;
 class CpiDeviceListUpdater;
+class CpiDeviceRegistryUpnp;
 
 class CpStack : public IStack, private INonCopyable
 {
@@ -30,6 +34,8 @@ public:
     OpenHome::Net::XmlFetchManager& XmlFetchManager();
     CpiSubscriptionManager& SubscriptionManager();
     CpiDeviceListUpdater& DeviceListUpdater();
+    SocketTcpClientPool& InvocationConnectionPool();
+    CpiDeviceRegistryUpnp& DeviceRegistryUpnp();
 private:
     ~CpStack();
 private:
@@ -38,6 +44,8 @@ private:
     OpenHome::Net::XmlFetchManager* iXmlFetchManager;
     CpiSubscriptionManager* iSubscriptionManager;
     CpiDeviceListUpdater* iDeviceListUpdater;
+    SocketTcpClientPool* iInvocationConnectionPool;
+    CpiDeviceRegistryUpnp* iDeviceRegistryUpnp;
 };
 
 } // namespace Net
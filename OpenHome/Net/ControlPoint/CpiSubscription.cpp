@@ -452,7 +452,7 @@ CpiSubscriptionManager::CpiSubscriptionManager(CpStack& aCpStack)
     : Thread("SBSM")
     , iCpStack(aCpStack)
     , iLock("SBSL")
-    , iFree(aCpStack.Env().InitParams().NumSubscriberThreads())
+    , iFree(aCpStack.Env().InitParams().NumSubscriberThreads(), EFifoSignalOnDemand)
     , iWaiter("SBSS", 0)
     , iWaiters(0)
     , iShutdownSem("SBMS", 0)
@@ -3,12 +3,18 @@
 #include <OpenHome/Net/Core/DvStack.h>
 #include <OpenHome/Net/Core/DvOpenhomeOrgTestBasic1.h>
 #include <OpenHome/Net/Core/CpOpenhomeOrgTestBasic1.h>
+#include <OpenHome/Net/Core/CpDeviceUpnp.h>
+#include <OpenHome/Net/Core/FunctorCpDevice.h>
 #include <OpenHome/Private/Ascii.h>
 #include <OpenHome/Private/Env.h>
 #include <OpenHome/Net/Private/DviStack.h>
+#include <OpenHome/Net/Private/CpiStack.h>
+#include <OpenHome/Net/Private/CpiDeviceUpnp.h>
 #include <OpenHome/Private/NetworkAdapterList.h>
+#include <OpenHome/Private/File.h>
 
 #include <vector>
+#include <cstdio>
 
 using namespace OpenHome;
 using namespace OpenHome::Net;
@@ -51,6 +57,53 @@ private:
     ProviderTestBasic* iTestBasic;
 };
 
+class DeviceFinder
+{
+public:
+    DeviceFinder();
+    void Wait();
+    const Brx& Location() const;
+    void Added(CpDevice& aDevice);
+    void Removed(CpDevice& aDevice);
+private:
+    Semaphore iSem;
+    Brh iLocation;
+};
+
+class XmlFetchResult
+{
+public:
+    XmlFetchResult();
+    void Fetch(CpStack& aCpStack, const Brx& aLocation, const Brx& aETag);
+    TBool Error() const;
+    TBool NotModified() const;
+    const Brx& Xml() const;
+    const Brx& ETag() const;
+private:
+    void Completed(IAsync& aAsync);
+private:
+    Semaphore iSem;
+    TBool iError;
+    TBool iNotModified;
+    Brh iXml;
+    Brh iETag;
+};
+
+class XmlObserver : public ICpiDeviceXmlObserver
+{
+public:
+    XmlObserver();
+    TBool Available() const;
+    CpiDeviceXmlUpnp* Xml() const;
+    CpiDeviceXmlUpnp* Wait();
+private:
+    void DeviceXmlAvailable(CpiDeviceXmlUpnp* aXml);
+private:
+    Semaphore iSem;
+    TBool iAvailable;
+    CpiDeviceXmlUpnp* iXml;
+};
+
 } // namespace OpenHome
 } // namespace TestCpDeviceDv
 using namespace OpenHome::TestCpDeviceDv;
@@ -246,6 +299,116 @@ DvDevice& DeviceBasic::Device()
 }
 
 
+
+DeviceFinder::DeviceFinder()
+    : iSem("DFND", 0)
+{
+}
+
+void DeviceFinder::Wait()
+{
+    iSem.Wait(10 * 1000);
+}
+
+const Brx& DeviceFinder::Location() const
+{
+    return iLocation;
+}
+
+void DeviceFinder::Added(CpDevice& aDevice)
+{
+    ASSERT(aDevice.GetAttribute("Upnp.Location", iLocation));
+    iSem.Signal();
+}
+
+void DeviceFinder::Removed(CpDevice& /*aDevice*/)
+{
+}
+
+
+XmlFetchResult::XmlFetchResult()
+    : iSem("XFRS", 0)
+    , iError(false)
+    , iNotModified(false)
+{
+}
+
+void XmlFetchResult::Fetch(CpStack& aCpStack, const Brx& aLocation, const Brx& aETag)
+{
+    XmlFetchManager& xmlFetchManager = aCpStack.XmlFetchManager();
+    XmlFetch* fetch = xmlFetchManager.Fetch();
+    FunctorAsync functor = MakeFunctorAsync(*this, &XmlFetchResult::Completed);
+    fetch->Set(new Uri(aLocation), functor);
+    fetch->SetValidators(aETag, Brx::Empty());
+    xmlFetchManager.Fetch(fetch);
+    iSem.Wait(10 * 1000);
+}
+
+TBool XmlFetchResult::Error() const
+{
+    return iError;
+}
+
+TBool XmlFetchResult::NotModified() const
+{
+    return iNotModified;
+}
+
+const Brx& XmlFetchResult::Xml() const
+{
+    return iXml;
+}
+
+const Brx& XmlFetchResult::ETag() const
+{
+    return iETag;
+}
+
+void XmlFetchResult::Completed(IAsync& aAsync)
+{
+    try {
+        iNotModified = XmlFetch::NotModified(aAsync);
+        XmlFetch::Xml(aAsync).TransferTo(iXml);
+        iETag.Set(XmlFetch::ETag(aAsync));
+    }
+    catch (XmlFetchError&) {
+        iError = true;
+    }
+    iSem.Signal();
+}
+
+
+XmlObserver::XmlObserver()
+    : iSem("XMLO", 0)
+    , iAvailable(false)
+    , iXml(NULL)
+{
+}
+
+TBool XmlObserver::Available() const
+{
+    return iAvailable;
+}
+
+CpiDeviceXmlUpnp* XmlObserver::Xml() const
+{
+    return iXml;
+}
+
+CpiDeviceXmlUpnp* XmlObserver::Wait()
+{
+    iSem.Wait(10 * 1000);
+    return iXml;
+}
+
+void XmlObserver::DeviceXmlAvailable(CpiDeviceXmlUpnp* aXml)
+{
+    iXml = aXml;
+    iAvailable = true;
+    iSem.Signal();
+}
+
+
 static void TestInvocation(CpDevice& aDevice)
 {
     static const TUint kTestIterations = 10;
@@ -408,6 +571,214 @@ static void TestSubscription(CpDevice& aDevice)
     delete proxy; // automatically unsubscribes
 }
 
+static TUint CachedFileBytes(CpiDeviceXmlCacheUpnp& aCache, const Brx& aLocation)
+{
+    Brhz name;
+    aCache.GetFileName(aLocation, name);
+    IFile* file = IFile::Open(name.CString(), eFileReadOnly);
+    TUint bytes = file->Bytes();
+    delete file;
+    return bytes;
+}
+
+static void RemoveCachedFile(CpiDeviceXmlCacheUpnp& aCache, const Brx& aLocation)
+{
+    Brhz name;
+    aCache.GetFileName(aLocation, name);
+    (void)remove(name.CString());
+}
+
+static void TestConditionalFetch(CpStack& aCpStack, const Brx& aLocation)
+{
+    Print("    Conditional fetches...\n");
+    XmlFetchResult full;
+    full.Fetch(aCpStack, aLocation, Brx::Empty());
+    ASSERT(!full.Error());
+    ASSERT(!full.NotModified());
+    ASSERT(full.Xml().Bytes() > 0);
+    ASSERT(full.ETag().Bytes() > 0);
+
+    XmlFetchResult current;
+    current.Fetch(aCpStack, aLocation, full.ETag());
+    ASSERT(!current.Error());
+    ASSERT(current.NotModified());
+    ASSERT(current.Xml().Bytes() == 0);
+    ASSERT(current.ETag() == full.ETag());
+
+    XmlFetchResult changed;
+    changed.Fetch(aCpStack, aLocation, Brn("\"stale\""));
+    ASSERT(!changed.Error());
+    ASSERT(!changed.NotModified());
+    ASSERT(changed.Xml() == full.Xml());
+    ASSERT(changed.ETag() == full.ETag());
+}
+
+static void TestRevalidation(CpStack& aCpStack, const Brx& aLocation, const Brx& aXml)
+{
+    Print("    Cached copy revalidated...\n");
+    CpiDeviceXmlCacheUpnp cache(aCpStack.Env().InitParams().CpDeviceXmlCacheDir());
+    CpiDeviceRegistryUpnp& registry = aCpStack.DeviceRegistryUpnp();
+    // all references to aLocation have been released so the registry will use an out of date cached copy
+    Bwh stale(aXml.Bytes() + 32);
+    stale.Append(aXml);
+    stale.Append("<!-- stale -->");
+    cache.Write(aLocation, stale, Brn("\"stale\""), Brx::Empty());
+    XmlObserver obs;
+    registry.Fetch(aLocation, obs);
+    ASSERT(obs.Available());
+    ASSERT(obs.Xml()->Xml() == stale);
+    // the server doesn't recognise the cached ETag so the re-fetch replaces the cached copy
+    Brh xml;
+    Brh etag;
+    Brh lastModified;
+    for (TUint i=0; i<100; i++) {
+        ASSERT(cache.Read(aLocation, xml, etag, lastModified));
+        if (xml == aXml) {
+            break;
+        }
+        Thread::Sleep(50);
+    }
+    ASSERT(xml == aXml);
+    ASSERT(etag != Brn("\"stale\""));
+    registry.Release(*obs.Xml());
+}
+
+static void TestDeviceXmlCache(CpStack& aCpStack, const Brx& aXml)
+{
+    Print("    Cached on disk...\n");
+    // nothing listens on port 1 so the registry's background re-fetch fails, leaving the cached copy in use
+    const Brn location("http://127.0.0.1:1/TestCpDeviceDv/device.xml");
+    CpiDeviceXmlCacheUpnp cache(aCpStack.Env().InitParams().CpDeviceXmlCacheDir());
+    RemoveCachedFile(cache, location);
+    Brh xml;
+    Brh etag;
+    Brh lastModified;
+    ASSERT(!cache.Read(location, xml, etag, lastModified));
+
+    Bwh padded(aXml.Bytes() + 1024);
+    padded.Append(aXml);
+    while (padded.Bytes() < padded.MaxBytes()) {
+        padded.Append(' ');
+    }
+    cache.Write(location, padded, Brn("\"1\""), Brn("Thu, 01 Jan 1970 00:00:00 GMT"));
+    ASSERT(cache.Read(location, xml, etag, lastModified));
+    ASSERT(xml == padded);
+    ASSERT(etag == Brn("\"1\""));
+    ASSERT(lastModified == Brn("Thu, 01 Jan 1970 00:00:00 GMT"));
+    ASSERT(!cache.Read(Brn("http://127.0.0.1:1/TestCpDeviceDv/other.xml"), xml, etag, lastModified));
+
+    // a shorter description without validators replaces the previous file's content entirely
+    cache.Write(location, aXml, Brx::Empty(), Brx::Empty());
+    ASSERT(cache.Read(location, xml, etag, lastModified));
+    ASSERT(xml == aXml);
+    ASSERT(etag.Bytes() == 0);
+    ASSERT(lastModified.Bytes() == 0);
+    Bws<Ascii::kMaxUintStringBytes> len;
+    (void)Ascii::AppendDec(len, aXml.Bytes());
+    const TUint headerBytes = 3 * 2 + (TUint)strlen("Version") + 1 + (TUint)strlen("Location") + location.Bytes()
+                                    + (TUint)strlen("Content-Length") + len.Bytes() + 3 * 1;
+    ASSERT(CachedFileBytes(cache, location) == headerBytes + aXml.Bytes());
+
+    // files with a missing or different format version are ignored
+    Brhz name;
+    cache.GetFileName(location, name);
+    IFile* file = IFile::Open(name.CString(), eFileReadWriteTruncate);
+    Bwh content(1024 + aXml.Bytes());
+    content.Append("Location: ");
+    content.Append(location);
+    content.Append("\nContent-Length: ");
+    content.Append(len);
+    content.Append("\n");
+    content.Append(aXml);
+    file->Write(content);
+    delete file;
+    ASSERT(!cache.Read(location, xml, etag, lastModified));
+    file = IFile::Open(name.CString(), eFileReadWriteTruncate);
+    file->Write(Brn("Version: 999\n"));
+    file->Write(content);
+    delete file;
+    ASSERT(!cache.Read(location, xml, etag, lastModified));
+    cache.Write(location, aXml, Brx::Empty(), Brx::Empty());
+
+    // the registry hands out the cached copy before Fetch() returns
+    CpiDeviceRegistryUpnp& registry = aCpStack.DeviceRegistryUpnp();
+    XmlObserver obs;
+    registry.Fetch(location, obs);
+    ASSERT(obs.Available());
+    ASSERT(obs.Xml() != NULL);
+    ASSERT(obs.Xml()->Xml() == aXml);
+    registry.Release(*obs.Xml());
+    RemoveCachedFile(cache, location);
+}
+
+static void TestDeviceXmlRegistry(CpStack& aCpStack, DvStack& aDvStack)
+{
+    Print("  Device xml registry\n");
+    Bwh udn("registry");
+    RandomiseUdn(aDvStack.Env(), udn);
+    DvDeviceStandard* device = new DvDeviceStandard(aDvStack, udn);
+    device->SetAttribute("Upnp.Domain", "openhome.org");
+    device->SetAttribute("Upnp.Type", "Test");
+    device->SetAttribute("Upnp.Version", "1");
+    device->SetAttribute("Upnp.FriendlyName", "ohNetTestDevice");
+    device->SetAttribute("Upnp.Manufacturer", "None");
+    device->SetAttribute("Upnp.ModelName", "ohNet test device");
+    device->SetEnabled();
+    DeviceFinder finder;
+    FunctorCpDevice added = MakeFunctorCpDevice(finder, &DeviceFinder::Added);
+    FunctorCpDevice removed = MakeFunctorCpDevice(finder, &DeviceFinder::Removed);
+    CpDeviceListUpnpUuid* list = new CpDeviceListUpnpUuid(aCpStack, udn, added, removed);
+    finder.Wait();
+    const Brx& location = finder.Location();
+    CpiDeviceRegistryUpnp& registry = aCpStack.DeviceRegistryUpnp();
+
+    Print("    Shared while in use...\n");
+    // the list's device holds the description so it is handed out before Fetch() returns
+    XmlObserver obs1;
+    XmlObserver obs2;
+    registry.Fetch(location, obs1);
+    ASSERT(obs1.Available());
+    ASSERT(obs1.Xml() != NULL);
+    registry.Fetch(location, obs2);
+    ASSERT(obs2.Available());
+    ASSERT(obs2.Xml() == obs1.Xml());
+
+    Print("    Fetched again after Invalidate()...\n");
+    registry.Invalidate();
+    XmlObserver obs3;
+    registry.Fetch(location, obs3);
+    CpiDeviceXmlUpnp* xml = obs3.Wait();
+    ASSERT(xml != NULL);
+    ASSERT(xml != obs1.Xml());
+    ASSERT(xml->Xml() == obs1.Xml()->Xml()); // existing users keep their (still valid) copy
+    XmlObserver obs4;
+    registry.Fetch(location, obs4);
+    ASSERT(obs4.Available());
+    ASSERT(obs4.Xml() == xml);
+
+    Print("    Fetched again after a refresh...\n");
+    list->Refresh();
+    XmlObserver obs5;
+    registry.Fetch(location, obs5);
+    ASSERT(obs5.Wait() != NULL);
+    ASSERT(obs5.Xml() != xml);
+
+    TestConditionalFetch(aCpStack, location);
+    Brh deviceXml(obs5.Xml()->Xml());
+    TestDeviceXmlCache(aCpStack, deviceXml);
+
+    registry.Release(*obs1.Xml());
+    registry.Release(*obs2.Xml());
+    registry.Release(*obs3.Xml());
+    registry.Release(*obs4.Xml());
+    registry.Release(*obs5.Xml());
+    delete list;
+    TestRevalidation(aCpStack, location, deviceXml);
+    delete device;
+    CpiDeviceXmlCacheUpnp cache(aCpStack.Env().InitParams().CpDeviceXmlCacheDir());
+    RemoveCachedFile(cache, location);
+}
+
 void TestCpDeviceDv(CpStack& aCpStack, DvStack& aDvStack)
 {
     Print("TestCpDeviceDv - starting\n");
@@ -418,6 +789,7 @@ void TestCpDeviceDv(CpStack& aCpStack, DvStack& aDvStack)
     TestSubscription(*cpDevice);
     cpDevice->RemoveRef();
     delete device;
+    TestDeviceXmlRegistry(aCpStack, aDvStack);
 
     Print("TestCpDeviceDv - completed\n");
 }
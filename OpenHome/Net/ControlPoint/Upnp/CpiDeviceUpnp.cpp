@@ -17,6 +17,7 @@
 #include <OpenHome/Net/Private/DeviceXml.h>
 #include <OpenHome/Net/Private/CpiSubscription.h>
 #include <OpenHome/Private/NetworkAdapterList.h>
+#include <OpenHome/Private/File.h>
 
 #include <string.h>
 
@@ -24,13 +25,520 @@ using namespace OpenHome;
 using namespace OpenHome::Net;
 
 
+// CpiDeviceXmlUpnp
+
+CpiDeviceXmlUpnp::CpiDeviceXmlUpnp(CpiDeviceRegistryUpnp& aRegistry, const Brx& aLocation, TUint aGeneration)
+    : iRegistry(aRegistry)
+    , iLocation(aLocation)
+    , iDocument(NULL)
+    , iGeneration(aGeneration)
+    , iRefCount(0)
+    , iFetching(true)
+    , iInterrupted(false)
+    , iRevalidating(false)
+    , iXmlFetch(NULL)
+{
+}
+
+CpiDeviceXmlUpnp::~CpiDeviceXmlUpnp()
+{
+    delete iDocument;
+}
+
+const Brx& CpiDeviceXmlUpnp::Location() const
+{
+    return iLocation;
+}
+
+const Brx& CpiDeviceXmlUpnp::Xml() const
+{
+    return iXml;
+}
+
+DeviceXmlDocument& CpiDeviceXmlUpnp::Document()
+{
+    return *iDocument;
+}
+
+void CpiDeviceXmlUpnp::XmlFetchCompleted(IAsync& aAsync)
+{
+    iRegistry.XmlFetchCompleted(*this, aAsync);
+    // Don't add code here, the registry may have just deleted this object
+}
+
+
+// CpiDeviceXmlCacheUpnp
+
+const TChar* CpiDeviceXmlCacheUpnp::kFilePrefix = "ohNetDeviceXml-";
+const TChar* CpiDeviceXmlCacheUpnp::kFileSuffix = ".cache";
+const TChar* CpiDeviceXmlCacheUpnp::kFieldVersion = "Version";
+
+CpiDeviceXmlCacheUpnp::CpiDeviceXmlCacheUpnp(const Brx& aDir)
+    : iDir(aDir)
+    , iLock("CDXC")
+{
+}
+
+TBool CpiDeviceXmlCacheUpnp::Read(const Brx& aLocation, Brh& aXml, Brh& aETag, Brh& aLastModified)
+{
+    Brhz name;
+    GetFileName(aLocation, name);
+    AutoMutex a(iLock);
+    IFile* file;
+    try {
+        file = IFile::Open(name.CString(), eFileReadOnly);
+    }
+    catch (FileOpenError&) {
+        return false;
+    }
+    Bwh buf(file->Bytes());
+    file->Read(buf);
+    delete file;
+    Brn location;
+    Brn etag;
+    Brn lastModified;
+    try {
+        Parser parser(buf);
+        Parser version(parser.Next('\n'));
+        if (!Ascii::CaseInsensitiveEquals(version.Next(':'), Brn(kFieldVersion)) ||
+            Ascii::Uint(Ascii::Trim(version.Remaining())) != kVersion) {
+            LOG(kDevice, "Ignoring cached xml in ");
+            LOG(kDevice, name);
+            LOG(kDevice, " - unsupported format\n");
+            return false;
+        }
+        while (!parser.Finished()) {
+            Parser line(parser.Next('\n'));
+            Brn field = line.Next(':');
+            Brn value = Ascii::Trim(line.Remaining());
+            if (Ascii::CaseInsensitiveEquals(field, Http::kHeaderLocation)) {
+                location.Set(value);
+            }
+            else if (Ascii::CaseInsensitiveEquals(field, Http::kHeaderETag)) {
+                etag.Set(value);
+            }
+            else if (Ascii::CaseInsensitiveEquals(field, Http::kHeaderLastModified)) {
+                lastModified.Set(value);
+            }
+            else if (Ascii::CaseInsensitiveEquals(field, Http::kHeaderContentLength)) {
+                // always the last field; the xml follows immediately
+                TUint bytes = Ascii::Uint(value);
+                Brn xml = parser.Remaining();
+                if (location != aLocation || bytes > xml.Bytes()) {
+                    return false;
+                }
+                aXml.Set(xml.Ptr(), bytes);
+                aETag.Set(etag);
+                aLastModified.Set(lastModified);
+                return true;
+            }
+        }
+    }
+    catch (AsciiError&) {
+    }
+    return false;
+}
+
+void CpiDeviceXmlCacheUpnp::Write(const Brx& aLocation, const Brx& aXml, const Brx& aETag, const Brx& aLastModified)
+{
+    Brhz name;
+    GetFileName(aLocation, name);
+    AutoMutex a(iLock);
+    IFile* file = NULL;
+    try {
+        file = IFile::Open(name.CString(), eFileReadWriteTruncate);
+        Bws<Ascii::kMaxUintStringBytes> version;
+        (void)Ascii::AppendDec(version, kVersion);
+        WriteField(*file, Brn(kFieldVersion), version);
+        WriteField(*file, Http::kHeaderLocation, aLocation);
+        if (aETag.Bytes() > 0) {
+            WriteField(*file, Http::kHeaderETag, aETag);
+        }
+        if (aLastModified.Bytes() > 0) {
+            WriteField(*file, Http::kHeaderLastModified, aLastModified);
+        }
+        Bws<Ascii::kMaxUintStringBytes> bytes;
+        (void)Ascii::AppendDec(bytes, aXml.Bytes());
+        WriteField(*file, Http::kHeaderContentLength, bytes);
+        file->Write(aXml);
+    }
+    catch (FileOpenError&) {
+        LOG2(kDevice, kError, "Unable to cache xml from ");
+        LOG2(kDevice, kError, aLocation);
+        LOG2(kDevice, kError, " in ");
+        LOG2(kDevice, kError, name);
+        LOG2(kDevice, kError, "\n");
+    }
+    catch (FileWriteError&) {
+        LOG2(kDevice, kError, "Error writing ");
+        LOG2(kDevice, kError, name);
+        LOG2(kDevice, kError, "\n");
+    }
+    delete file;
+}
+
+void CpiDeviceXmlCacheUpnp::WriteField(IFile& aFile, const Brx& aField, const Brx& aValue)
+{
+    aFile.Write(aField);
+    aFile.Write(Http::kHeaderSeparator);
+    aFile.Write(aValue);
+    aFile.Write(Brn("\n"));
+}
+
+void CpiDeviceXmlCacheUpnp::GetFileName(const Brx& aLocation, Brhz& aName) const
+{
+    // FNV-1a; collisions are detected by Read()
+    TUint hash = 2166136261u;
+    for (TUint i=0; i<aLocation.Bytes(); i++) {
+        hash ^= aLocation[i];
+        hash *= 16777619u;
+    }
+    const Brn prefix(kFilePrefix);
+    const Brn suffix(kFileSuffix);
+    Bwh name(iDir.Bytes() + 1 + prefix.Bytes() + Ascii::kMaxUintHexStringBytes + suffix.Bytes());
+    name.Append(iDir);
+    if (iDir.Bytes() > 0 && iDir[iDir.Bytes()-1] != '/' && iDir[iDir.Bytes()-1] != '\\') {
+        name.Append('/');
+    }
+    name.Append(prefix);
+    (void)Ascii::AppendHex(name, hash);
+    name.Append(suffix);
+    aName.Set(name);
+}
+
+
+// CpiDeviceRegistryUpnp
+
+CpiDeviceRegistryUpnp::CpiDeviceRegistryUpnp(CpStack& aCpStack)
+    : iCpStack(aCpStack)
+    , iLock("CDRU")
+    , iGeneration(0)
+    , iCache(NULL)
+{
+    const Brx& cacheDir = aCpStack.Env().InitParams().CpDeviceXmlCacheDir();
+    if (cacheDir.Bytes() > 0) {
+        iCache = new CpiDeviceXmlCacheUpnp(cacheDir);
+    }
+}
+
+CpiDeviceRegistryUpnp::~CpiDeviceRegistryUpnp()
+{
+    // Fetches can't still be in progress - XmlFetchManager completes all of them before
+    // we're deleted.  Only revalidated descriptions nobody has asked for yet should be
+    // left; any other entries belong to devices the client has leaked so are left alone.
+    Map::iterator it = iMap.begin();
+    while (it != iMap.end()) {
+        if (it->second->iRefCount == 0) {
+            delete it->second;
+        }
+        it++;
+    }
+    delete iCache;
+}
+
+void CpiDeviceRegistryUpnp::Fetch(const Brx& aLocation, ICpiDeviceXmlObserver& aObserver)
+{
+    TBool readCache = (iCache != NULL);
+    CpiDeviceXmlUpnp* cached = NULL;
+    iLock.Wait();
+    for (;;) {
+        CpiDeviceXmlUpnp* shared = NULL;
+        TBool stale = false;
+        if (ShareLocked(aLocation, aObserver, shared, stale)) {
+            iLock.Signal();
+            delete cached;
+            if (shared != NULL) {
+                aObserver.DeviceXmlAvailable(shared);
+            }
+            return;
+        }
+        if (stale) {
+            // don't offer the cached copy in place of a stale description; it's no newer
+            delete cached;
+            cached = NULL;
+            break;
+        }
+        if (!readCache) {
+            break;
+        }
+        // Look for a copy on disk without holding iLock; reading it could take a while.
+        // Loop round afterwards in case another device asked for aLocation meanwhile.
+        const TUint generation = iGeneration;
+        iLock.Signal();
+        cached = LoadCached(aLocation, generation);
+        readCache = false;
+        iLock.Wait();
+    }
+    if (cached != NULL) {
+        cached->iRefCount++;
+        Brn key(cached->iLocation);
+        iMap.insert(std::pair<Brn,CpiDeviceXmlUpnp*>(key, cached));
+        iLock.Signal();
+        aObserver.DeviceXmlAvailable(cached);
+        // check the cached copy is still current, using a conditional GET where possible
+        CpiDeviceXmlUpnp* revalidate = new CpiDeviceXmlUpnp(*this, aLocation, cached->iGeneration);
+        revalidate->iRevalidating = true;
+        revalidate->iETag.Set(cached->iETag);
+        revalidate->iLastModified.Set(cached->iLastModified);
+        StartFetch(*revalidate);
+        return;
+    }
+    CpiDeviceXmlUpnp* xml = new CpiDeviceXmlUpnp(*this, aLocation, iGeneration);
+    xml->iObservers.push_back(&aObserver);
+    Brn key(xml->iLocation);
+    iMap.insert(std::pair<Brn,CpiDeviceXmlUpnp*>(key, xml));
+    iLock.Signal();
+    StartFetch(*xml);
+}
+
+TBool CpiDeviceRegistryUpnp::ShareLocked(const Brx& aLocation, ICpiDeviceXmlObserver& aObserver, CpiDeviceXmlUpnp*& aShared, TBool& aStale)
+{
+    Brn location(aLocation);
+    Map::iterator it = iMap.find(location);
+    if (it == iMap.end()) {
+        return false;
+    }
+    CpiDeviceXmlUpnp* xml = it->second;
+    if (xml->iFetching) {
+        xml->iObservers.push_back(&aObserver);
+        return true;
+    }
+    if (xml->iGeneration == iGeneration) {
+        xml->iRefCount++;
+        aShared = xml;
+        return true;
+    }
+    // fetched before the last Invalidate().  Leave it with the devices already
+    // using it (if any) and fetch it again.
+    iMap.erase(it);
+    if (xml->iRefCount == 0) {
+        delete xml;
+    }
+    aStale = true;
+    return false;
+}
+
+CpiDeviceXmlUpnp* CpiDeviceRegistryUpnp::LoadCached(const Brx& aLocation, TUint aGeneration)
+{
+    CpiDeviceXmlUpnp* xml = new CpiDeviceXmlUpnp(*this, aLocation, aGeneration);
+    if (!iCache->Read(aLocation, xml->iXml, xml->iETag, xml->iLastModified)) {
+        delete xml;
+        return NULL;
+    }
+    try {
+        xml->iDocument = new DeviceXmlDocument(xml->iXml);
+    }
+    catch (XmlError&) {
+        delete xml;
+        return NULL;
+    }
+    xml->iFetching = false;
+    return xml;
+}
+
+void CpiDeviceRegistryUpnp::StartFetch(CpiDeviceXmlUpnp& aXml)
+{
+    XmlFetchManager& xmlFetchManager = iCpStack.XmlFetchManager();
+    XmlFetch* fetch = xmlFetchManager.Fetch();
+    Uri* uri = new Uri(aXml.iLocation);
+    FunctorAsync functor = MakeFunctorAsync(aXml, &CpiDeviceXmlUpnp::XmlFetchCompleted);
+    fetch->Set(uri, functor);
+    fetch->SetValidators(aXml.iETag, aXml.iLastModified); // only set when revalidating
+
+    iLock.Wait();
+    aXml.iXmlFetch = fetch;
+    if (aXml.iInterrupted) {
+        fetch->Interrupt();
+    }
+    iLock.Signal();
+    xmlFetchManager.Fetch(fetch);
+}
+
+TBool CpiDeviceRegistryUpnp::Cancel(const Brx& aLocation, ICpiDeviceXmlObserver& aObserver)
+{
+    AutoMutex a(iLock);
+    Brn location(aLocation);
+    Map::iterator it = iMap.find(location);
+    if (it == iMap.end()) {
+        return false;
+    }
+    CpiDeviceXmlUpnp* xml = it->second;
+    if (!xml->iFetching) {
+        return false;
+    }
+    std::vector<ICpiDeviceXmlObserver*>& observers = xml->iObservers;
+    for (TUint i=0; i<(TUint)observers.size(); i++) {
+        if (observers[i] == &aObserver) {
+            observers.erase(observers.begin() + i);
+            if (observers.size() == 0) {
+                // nobody wants this any more.  Forget it now so that any later request
+                // for the same location isn't handed the result of an interrupted fetch.
+                // It'll be deleted when its fetch completes.
+                iMap.erase(it);
+                xml->iInterrupted = true;
+                if (xml->iXmlFetch != NULL) {
+                    xml->iXmlFetch->Interrupt();
+                }
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+void CpiDeviceRegistryUpnp::Release(CpiDeviceXmlUpnp& aXml)
+{
+    CpiDeviceXmlUpnp* replacement = NULL;
+    iLock.Wait();
+    ASSERT(aXml.iRefCount > 0);
+    TBool dead = (--aXml.iRefCount == 0);
+    if (dead) {
+        Brn location(aXml.iLocation);
+        Map::iterator it = iMap.find(location);
+        if (it != iMap.end()) {
+            if (it->second == &aXml) {
+                iMap.erase(it);
+            }
+            else if (it->second->iRefCount == 0 && !it->second->iFetching) {
+                // aXml was replaced by a revalidated copy which no device has used.  Forget
+                // that too, as we would have done had it been used; otherwise it'd be kept
+                // until the stack is destroyed.
+                replacement = it->second;
+                iMap.erase(it);
+            }
+        }
+    }
+    iLock.Signal();
+    if (dead) {
+        delete &aXml;
+    }
+    delete replacement;
+}
+
+void CpiDeviceRegistryUpnp::Invalidate()
+{
+    AutoMutex a(iLock);
+    iGeneration++;
+}
+
+void CpiDeviceRegistryUpnp::XmlFetchCompleted(CpiDeviceXmlUpnp& aXml, IAsync& aAsync)
+{
+    TBool err = false;
+    TBool notModified = false;
+    try {
+        notModified = XmlFetch::NotModified(aAsync);
+        XmlFetch::Xml(aAsync).TransferTo(aXml.iXml);
+        aXml.iETag.Set(XmlFetch::ETag(aAsync));
+        aXml.iLastModified.Set(XmlFetch::LastModified(aAsync));
+    }
+    catch (XmlFetchError&) {
+        err = true;
+        LOG2(kDevice, kError, "Error fetching xml from ");
+        LOG2(kDevice, kError, aXml.iLocation);
+        LOG2(kDevice, kError, "\n");
+    }
+    if (!err && !notModified) {
+        try {
+            aXml.iDocument = new DeviceXmlDocument(aXml.iXml);
+        }
+        catch (XmlError&) {
+            err = true;
+            LOG2(kDevice, kError, "Error within xml from ");
+            LOG2(kDevice, kError, aXml.iLocation);
+            LOG2(kDevice, kError, ".  Xml is ");
+            LOG2(kDevice, kError, aXml.iXml);
+            LOG2(kDevice, kError, "\n");
+        }
+    }
+
+    if (aXml.iRevalidating) {
+        RevalidateCompleted(aXml, err, notModified);
+        return;
+    }
+    ASSERT(!notModified); // only revalidation requests are conditional
+    if (!err && iCache != NULL) {
+        iCache->Write(aXml.iLocation, aXml.iXml, aXml.iETag, aXml.iLastModified);
+    }
+
+    iLock.Wait();
+    aXml.iFetching = false;
+    aXml.iXmlFetch = NULL;
+    std::vector<ICpiDeviceXmlObserver*> observers(aXml.iObservers);
+    aXml.iObservers.clear();
+    TBool dead = (err || observers.size() == 0);
+    if (dead) {
+        // failed fetches aren't remembered; the next alive will retry
+        RemoveLocked(aXml);
+    }
+    else {
+        aXml.iRefCount += (TUint)observers.size();
+    }
+    iLock.Signal();
+
+    CpiDeviceXmlUpnp* xml = (err? NULL : &aXml);
+    for (TUint i=0; i<(TUint)observers.size(); i++) {
+        observers[i]->DeviceXmlAvailable(xml);
+    }
+    if (dead) {
+        delete &aXml;
+    }
+}
+
+void CpiDeviceRegistryUpnp::RevalidateCompleted(CpiDeviceXmlUpnp& aXml, TBool aError, TBool aNotModified)
+{
+    if (aError || aNotModified) {
+        // If there was an error, keep the cached copy; the device may just be
+        // unreachable at the moment.
+        delete &aXml;
+        return;
+    }
+    iLock.Wait();
+    aXml.iFetching = false;
+    aXml.iXmlFetch = NULL;
+    aXml.iRevalidating = false;
+    Brn location(aXml.iLocation);
+    Map::iterator it = iMap.find(location);
+    TBool changed = (it == iMap.end() || it->second->iFetching || it->second->iXml != aXml.iXml);
+    TBool replace = (changed && it != iMap.end() && !it->second->iFetching);
+    TBool write = (changed || it->second->iETag != aXml.iETag || it->second->iLastModified != aXml.iLastModified);
+    if (replace) {
+        // Devices already using the stale description keep it (and release it as normal).
+        // Devices discovered from now on use the fresh copy.
+        iMap.erase(it);
+        Brn key(aXml.iLocation);
+        iMap.insert(std::pair<Brn,CpiDeviceXmlUpnp*>(key, &aXml));
+    }
+    iLock.Signal();
+    if (replace) {
+        LOG(kDevice, "Cached xml from ");
+        LOG(kDevice, aXml.iLocation);
+        LOG(kDevice, " has changed\n");
+    }
+    if (write) {
+        iCache->Write(aXml.iLocation, aXml.iXml, aXml.iETag, aXml.iLastModified);
+    }
+    if (!replace) {
+        delete &aXml;
+    }
+}
+
+void CpiDeviceRegistryUpnp::RemoveLocked(CpiDeviceXmlUpnp& aXml)
+{
+    Brn location(aXml.iLocation);
+    Map::iterator it = iMap.find(location);
+    if (it != iMap.end() && it->second == &aXml) { // may already have been forgotten by Cancel()
+        iMap.erase(it);
+    }
+}
+
+
 // CpiDeviceUpnp
 
 CpiDeviceUpnp::CpiDeviceUpnp(CpStack& aCpStack, const Brx& aUdn, const Brx& aLocation, TUint aMaxAgeSecs, IDeviceRemover& aDeviceList, CpiDeviceListUpnp& aList)
     : iLock("CDUP")
     , iLocation(aLocation)
-    , iXmlFetch(NULL)
-    , iDeviceXmlDocument(NULL)
+    , iFetching(false)
+    , iXml(NULL)
     , iDeviceXml(NULL)
     , iExpiryTime(0)
     , iDeviceList(aDeviceList)
@@ -74,24 +582,25 @@ void CpiDeviceUpnp::UpdateMaxAge(TUint aSeconds)
 
 void CpiDeviceUpnp::FetchXml()
 {
-    AutoMutex a(iLock);
-    XmlFetchManager& xmlFetchManager = iDevice->GetCpStack().XmlFetchManager();
-    iXmlFetch = xmlFetchManager.Fetch();
-    Uri* uri = new Uri(iLocation);
+    iLock.Wait();
+    iFetching = true;
+    iLock.Signal();
     iDevice->AddRef();
-    FunctorAsync functor = MakeFunctorAsync(*this, &CpiDeviceUpnp::XmlFetchCompleted);
-    iXmlFetch->Set(uri, functor);
-    xmlFetchManager.Fetch(iXmlFetch);
+    // description may already be available (from another list or a sibling device),
+    // in which case DeviceXmlAvailable() is called before this returns
+    iDevice->GetCpStack().DeviceRegistryUpnp().Fetch(iLocation, *this);
 }
 
 void CpiDeviceUpnp::InterruptXmlFetch()
 {
-    AutoMutex a(iLock);
-    if (iXmlFetch != NULL) {
-        iXmlFetch->Interrupt();
-        iXmlFetch = NULL;
-    }
+    iLock.Wait();
     iList = NULL;
+    TBool fetching = iFetching;
+    iLock.Signal();
+    if (fetching && iDevice->GetCpStack().DeviceRegistryUpnp().Cancel(iLocation, *this)) {
+        // we won't now be notified by the registry so complete the fetch here
+        DeviceXmlAvailable(NULL);
+    }
 }
 
 TBool CpiDeviceUpnp::GetAttribute(const char* aKey, Brh& aValue) const
@@ -107,15 +616,18 @@ TBool CpiDeviceUpnp::GetAttribute(const char* aKey, Brh& aValue) const
             aValue.Set(iLocation);
             return (true);
         }
+        if (iXml == NULL) {
+            return (false);
+        }
         if (property == Brn("DeviceXml")) {
-            aValue.Set(iXml);
+            aValue.Set(iXml->Xml());
             return (true);
         }
 
         const DeviceXml* device = iDeviceXml;
         
         if (parser.Next('.') == Brn("Root")) {
-            device = &iDeviceXmlDocument->Root();
+            device = &iXml->Document().Root();
             property.Set(parser.Remaining());
         }
         
@@ -195,8 +707,13 @@ void CpiDeviceUpnp::Release()
 
 CpiDeviceUpnp::~CpiDeviceUpnp()
 {
-    delete iDeviceXmlDocument;
+    if (iControlEndpoint.Port() != 0) {
+        iDevice->GetCpStack().InvocationConnectionPool().Evict(iControlEndpoint);
+    }
     delete iDeviceXml;
+    if (iXml != NULL) {
+        iDevice->GetCpStack().DeviceRegistryUpnp().Release(*iXml);
+    }
     delete iTimer;
     delete iInvocable;
 }
@@ -209,7 +726,10 @@ void CpiDeviceUpnp::TimerExpired()
 
 void CpiDeviceUpnp::GetServiceUri(Uri& aUri, const TChar* aType, const ServiceType& aServiceType)
 {
-    Brn root = XmlParserBasic::Find("root", iXml);
+    if (iXml == NULL) {
+        THROW(XmlError);
+    }
+    Brn root = XmlParserBasic::Find("root", iXml->Xml());
     Brn device = XmlParserBasic::Find("device", root);
     Brn udn = XmlParserBasic::Find("UDN", device);
     if (!CpiDeviceUpnp::UdnMatches(udn, Udn())) {
@@ -264,29 +784,16 @@ TBool CpiDeviceUpnp::UdnMatches(const Brx& aFound, const Brx& aTarget)
     return (udn == aTarget);
 }
 
-void CpiDeviceUpnp::XmlFetchCompleted(IAsync& aAsync)
+void CpiDeviceUpnp::DeviceXmlAvailable(CpiDeviceXmlUpnp* aXml)
 {
     iLock.Wait();
-    iXmlFetch = NULL;
+    iFetching = false;
     iLock.Signal();
-    TBool err = iRemoved;
+    TBool err = iRemoved || (aXml == NULL);
+    iXml = aXml; // released in our destructor
     if (!err) {
         try {
-            XmlFetch::Xml(aAsync).TransferTo(iXml);
-        }
-        catch (XmlFetchError&) {
-            err = true;
-            LOG2(kDevice, kError, "Error fetching xml for ");
-            LOG2(kDevice, kError, Udn());
-            LOG2(kDevice, kError, " from ");
-            LOG2(kDevice, kError, iLocation);
-            LOG2(kDevice, kError, "\n");
-        }
-    }
-    if (!err) {
-        try {
-            iDeviceXmlDocument = new DeviceXmlDocument(iXml);
-            iDeviceXml = new DeviceXml(iDeviceXmlDocument->Find(Udn()));
+            iDeviceXml = new DeviceXml(iXml->Document().Find(Udn()));
         }
         catch (XmlError&) {
             err = true;
@@ -294,8 +801,6 @@ void CpiDeviceUpnp::XmlFetchCompleted(IAsync& aAsync)
             LOG2(kDevice, kError, Udn());
             LOG2(kDevice, kError, " from ");
             LOG2(kDevice, kError, iLocation);
-            LOG2(kDevice, kError, ".  Xml is ");
-            LOG2(kDevice, kError, iXml);
             LOG2(kDevice, kError, "\n");
         }
     }
@@ -324,6 +829,10 @@ void CpiDeviceUpnp::Invocable::InvokeAction(Invocation& aInvocation)
     try {
         Uri uri;
         iDevice.GetServiceUri(uri, "controlURL", aInvocation.ServiceType());
+        Endpoint endpoint(uri.Port(), uri.Host());
+        iDevice.iLock.Wait();
+        iDevice.iControlEndpoint.Replace(endpoint);
+        iDevice.iLock.Signal();
         InvocationUpnp invoker(iDevice.Device().GetCpStack(), aInvocation);
         invoker.Invoke(uri);
     }
@@ -459,6 +968,7 @@ void CpiDeviceListUpnp::Refresh()
     if (StartRefresh()) {
         return;
     }
+    iCpStack.DeviceRegistryUpnp().Invalidate();
     Start();
     TUint delayMs = iCpStack.Env().InitParams().MsearchTimeSecs() * 1000;
     delayMs += 100; /* allow slightly longer to cope with devices which send
@@ -477,6 +987,9 @@ void CpiDeviceListUpnp::Refresh()
 
 TBool CpiDeviceListUpnp::IsDeviceReady(CpiDevice& aDevice)
 {
+    // A shared description completes the fetch - calling XmlFetchCompleted() - before
+    // FetchXml() returns.  That's safe; CpiDeviceList::Add() doesn't hold iLock while
+    // calling us and holds its own reference to aDevice throughout.
     reinterpret_cast<CpiDeviceUpnp*>(aDevice.OwnerData())->FetchXml();
     return false;
 }
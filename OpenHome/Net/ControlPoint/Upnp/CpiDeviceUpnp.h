@@ -19,11 +19,155 @@
 #include <OpenHome/Net/Private/XmlFetcher.h>
 #include <OpenHome/Private/Env.h>
 
+#include <vector>
+#include <map>
+
 namespace OpenHome {
+class IFile;
 namespace Net {
 
 class CpiDeviceListUpnp;
 class CpStack;
+class CpiDeviceXmlUpnp;
+class CpiDeviceRegistryUpnp;
+
+/**
+ * Notified when a description requested from CpiDeviceRegistryUpnp is available
+ */
+class ICpiDeviceXmlObserver
+{
+public:
+    /**
+     * aXml is NULL if the description couldn't be fetched or parsed.  Otherwise, the
+     * observer owns a reference which must be released via CpiDeviceRegistryUpnp::Release().
+     */
+    virtual void DeviceXmlAvailable(CpiDeviceXmlUpnp* aXml) = 0;
+    virtual ~ICpiDeviceXmlObserver() {}
+};
+
+/**
+ * Description document fetched from a single location.
+ *
+ * Shared by every CpiDeviceUpnp (in any device list) described there - i.e. by all
+ * lists which include a root device and by all of its embedded devices.
+ * Immutable once fetched.
+ */
+class CpiDeviceXmlUpnp : private INonCopyable
+{
+    friend class CpiDeviceRegistryUpnp;
+public:
+    const Brx& Location() const;
+    const Brx& Xml() const;
+    DeviceXmlDocument& Document();
+private:
+    CpiDeviceXmlUpnp(CpiDeviceRegistryUpnp& aRegistry, const Brx& aLocation, TUint aGeneration);
+    ~CpiDeviceXmlUpnp();
+    void XmlFetchCompleted(IAsync& aAsync);
+private:
+    CpiDeviceRegistryUpnp& iRegistry;
+    Brhz iLocation;
+    Brh iXml;
+    Brh iETag;
+    Brh iLastModified;
+    DeviceXmlDocument* iDocument;
+    TUint iGeneration; // registry generation this was (re)fetched in
+    TUint iRefCount;
+    TBool iFetching;
+    TBool iInterrupted;
+    TBool iRevalidating; // re-fetching a description loaded from CpiDeviceXmlCacheUpnp
+    XmlFetch* iXmlFetch;
+    std::vector<ICpiDeviceXmlObserver*> iObservers;
+};
+
+/**
+ * Copies of device descriptions, persisted to a directory so that they survive restarts.
+ *
+ * Each description is stored in a file named from a hash of its location.
+ * Files start with http-style header lines: Version (files in any other format are
+ * ignored), Location (to detect hash collisions), any ETag and Last-Modified validators,
+ * then Content-Length (to detect truncated writes).  The xml immediately follows.
+ */
+class CpiDeviceXmlCacheUpnp : private INonCopyable
+{
+public:
+    CpiDeviceXmlCacheUpnp(const Brx& aDir);
+    /**
+     * Returns false if no (valid) copy of the description at aLocation is available.
+     * aETag and aLastModified are empty if the device didn't supply them.
+     */
+    TBool Read(const Brx& aLocation, Brh& aXml, Brh& aETag, Brh& aLastModified);
+    void Write(const Brx& aLocation, const Brx& aXml, const Brx& aETag, const Brx& aLastModified);
+    /**
+     * Name (including directory) of the file holding any copy of the description at aLocation.
+     */
+    void GetFileName(const Brx& aLocation, Brhz& aName) const;
+private:
+    static void WriteField(IFile& aFile, const Brx& aField, const Brx& aValue);
+private:
+    static const TUint kVersion = 1; // increment whenever the file format changes
+    static const TChar* kFilePrefix;
+    static const TChar* kFileSuffix;
+    static const TChar* kFieldVersion;
+    Brhz iDir;
+    Mutex iLock;
+};
+
+/**
+ * Stack-wide registry of device descriptions, keyed by location.
+ *
+ * Each description is fetched and parsed once, however many device lists include
+ * the devices it describes.  It is forgotten once no device refers to it so a later
+ * alive (or a refresh) after all devices have been removed will fetch it again.
+ * Descriptions fetched before the most recent call to Invalidate() aren't shared with
+ * devices discovered after it; these fetch the description again.
+ *
+ * If a CpiDeviceXmlCacheUpnp is in use, a description missing from the registry is
+ * first looked for there.  A cached description is made available immediately then
+ * re-fetched; a changed description replaces the cached one and is used for devices
+ * discovered subsequently.
+ */
+class CpiDeviceRegistryUpnp : private INonCopyable
+{
+    friend class CpiDeviceXmlUpnp;
+public:
+    CpiDeviceRegistryUpnp(CpStack& aCpStack);
+    ~CpiDeviceRegistryUpnp();
+    /**
+     * Request the description at aLocation.
+     * aObserver will be called exactly once, possibly before this returns, unless it
+     * is subsequently passed to a successful call to Cancel().
+     */
+    void Fetch(const Brx& aLocation, ICpiDeviceXmlObserver& aObserver);
+    /**
+     * Returns true if aObserver was waiting for a fetch of aLocation (and so won't now
+     * be called).  The fetch is interrupted if no other observers are waiting for it.
+     */
+    TBool Cancel(const Brx& aLocation, ICpiDeviceXmlObserver& aObserver);
+    void Release(CpiDeviceXmlUpnp& aXml);
+    /**
+     * Stop handing out descriptions which have already been fetched.
+     * Devices already using them are unaffected.  Called when a device list is refreshed
+     * so that a device whose description changed without its location changing is
+     * re-described to lists which discover it from then on.
+     */
+    void Invalidate();
+private:
+    // true if aObserver joined a fetch in progress or was given (via aShared) a current description
+    TBool ShareLocked(const Brx& aLocation, ICpiDeviceXmlObserver& aObserver, CpiDeviceXmlUpnp*& aShared, TBool& aStale);
+    CpiDeviceXmlUpnp* LoadCached(const Brx& aLocation, TUint aGeneration);
+    void StartFetch(CpiDeviceXmlUpnp& aXml);
+    void XmlFetchCompleted(CpiDeviceXmlUpnp& aXml, IAsync& aAsync);
+    void RevalidateCompleted(CpiDeviceXmlUpnp& aXml, TBool aError, TBool aNotModified);
+    void RemoveLocked(CpiDeviceXmlUpnp& aXml);
+private:
+    typedef std::map<Brn,CpiDeviceXmlUpnp*,BufferCmp> Map;
+    CpStack& iCpStack;
+    Mutex iLock;
+    Map iMap;
+    TUint iGeneration;
+    CpiDeviceXmlCacheUpnp* iCache; // NULL unless InitialisationParams::SetCpDeviceXmlCacheDir() was used
+};
+
 /**
  * UPnP-specific device
  *
@@ -31,7 +175,7 @@ class CpStack;
  * notification.  Uses a timer to remove itself from ots owning list if no
  * subsequent alive message is received within a specified maxage.
  */
-class CpiDeviceUpnp : private ICpiProtocol, private ICpiDeviceObserver
+class CpiDeviceUpnp : private ICpiProtocol, private ICpiDeviceObserver, private ICpiDeviceXmlObserver
 {
 public:
     CpiDeviceUpnp(CpStack& aCpStack, const Brx& aUdn, const Brx& aLocation, TUint aMaxAgeSecs, IDeviceRemover& aDeviceList, CpiDeviceListUpnp& aList);
@@ -58,11 +202,12 @@ private: // ICpiProtocol
     void NotifyRemovedBeforeReady();
 private: // ICpiDeviceObserver
     void Release();
+private: // ICpiDeviceXmlObserver
+    void DeviceXmlAvailable(CpiDeviceXmlUpnp* aXml);
 private:
     ~CpiDeviceUpnp();
     void TimerExpired();
     void GetServiceUri(Uri& aUri, const TChar* aType, const ServiceType& aServiceType);
-    void XmlFetchCompleted(IAsync& aAsync);
     static TBool UdnMatches(const Brx& aFound, const Brx& aTarget);
 private:
     class Invocable : public IInvocable, private INonCopyable
@@ -77,9 +222,8 @@ private:
     CpiDevice* iDevice;
     Mutex iLock;
     Brhz iLocation;
-    XmlFetch* iXmlFetch;
-    Brh iXml;
-    DeviceXmlDocument* iDeviceXmlDocument;
+    TBool iFetching;
+    CpiDeviceXmlUpnp* iXml;
     DeviceXml* iDeviceXml;
     Timer* iTimer;
     TUint iExpiryTime;
@@ -88,6 +232,7 @@ private:
     Invocable* iInvocable;
     Semaphore iSemReady;
     TBool iRemoved;
+    Endpoint iControlEndpoint; // key for pooled invocation connections; port 0 until first invocation
     friend class Invocable;
 };
 
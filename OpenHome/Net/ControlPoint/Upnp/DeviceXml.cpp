@@ -2,6 +2,7 @@
 #include <OpenHome/Private/Debug.h>
 #include <OpenHome/Net/Private/XmlParser.h>
 #include <OpenHome/Private/Parser.h>
+#include <OpenHome/Private/Ascii.h>
 #include <OpenHome/Net/Private/Error.h>
 #include <OpenHome/Private/Converter.h>
 #include <OpenHome/Private/Env.h>
@@ -13,9 +14,20 @@ using namespace OpenHome::Net;
 
 DeviceXmlDocument::DeviceXmlDocument(const Brx& aXml)
     : iXml(aXml)
+    , iRoot(NULL)
+    , iInRoot(false)
+    , iContentStart(0)
+    , iDeviceFound(false)
 {
-    Brn root = XmlParserBasic::Find("root", iXml);
-    iRoot = new DeviceXml(XmlParserBasic::Find("device", root));
+    XmlParserSax parser(*this);
+    iParser = &parser;
+    parser.Parse(iXml);
+    parser.End();
+    iParser = NULL;
+    if (!iDeviceFound) {
+        THROW(XmlError);
+    }
+    iRoot = new DeviceXml(iDevice);
 }
 
 DeviceXmlDocument::~DeviceXmlDocument()
@@ -38,20 +50,49 @@ const DeviceXml& DeviceXmlDocument::Root() const
     return (*iRoot);
 }
 
+void DeviceXmlDocument::XmlElementStart(const Brx& aName, const Brx& /*aAttributes*/)
+{
+    const TUint depth = iParser->Depth();
+    if (depth == 1) {
+        iInRoot = Ascii::CaseInsensitiveEquals(aName, Brn("root"));
+    }
+    else if (depth == 2 && iInRoot && !iDeviceFound && Ascii::CaseInsensitiveEquals(aName, Brn("device"))) {
+        iContentStart = iParser->TagEndOffset();
+    }
+}
+
+void DeviceXmlDocument::XmlElementEnd(const Brx& aName, const Brx& /*aValue*/)
+{
+    if (iParser->Depth() == 2 && iInRoot && !iDeviceFound && Ascii::CaseInsensitiveEquals(aName, Brn("device"))) {
+        iDevice.Set(iXml.Ptr() + iContentStart, iParser->TagOffset() - iContentStart);
+        iDeviceFound = true;
+    }
+}
+
 // DeviceXml
 
 DeviceXml::DeviceXml(const Brx& aXml)
     : iXml(aXml)
+    , iUdnFound(false)
+    , iFriendlyNameFound(false)
+    , iPresentationUrlFound(false)
+    , iElement(eOther)
+    , iContentStart(0)
 {
-    Brn udn = XmlParserBasic::Find("UDN", iXml);
-    
-    Parser parser(udn);
-    
-    if (parser.Next(':') != Brn("uuid")) {
+    XmlParserSax parser(*this);
+    iParser = &parser;
+    parser.Parse(iXml);
+    parser.End();
+    iParser = NULL;
+
+    if (!iUdnFound) {
         THROW(XmlError);
     }
-    
-    iUdn.Set(parser.Remaining());
+    Parser udnParser(iUdn);
+    if (udnParser.Next(':') != Brn("uuid")) {
+        THROW(XmlError);
+    }
+    iUdn.Set(udnParser.Remaining());
 }
     
 Brn DeviceXml::Find(const Brx& aUdn)
@@ -60,33 +101,84 @@ Brn DeviceXml::Find(const Brx& aUdn)
         return (iXml);
     }
 
-    Brn deviceList = XmlParserBasic::Find("deviceList", iXml);
-
-    for (;;) {
-        Brn xml = XmlParserBasic::Find("device", deviceList, deviceList);
-
-        DeviceXml device(xml);
-
+    for (TUint i=0; i<(TUint)iDevices.size(); i++) {
+        DeviceXml device(iDevices[i]);
         try {
             return (device.Find(aUdn));
         }
         catch (XmlError&) {
         }
     }
+    THROW(XmlError);
 }
 
 void DeviceXml::GetFriendlyName(Brh& aValue) const
 {
-    Bwh friendlyName(XmlParserBasic::Find("friendlyName", iXml));
-    Converter::FromXmlEscaped(friendlyName);
-    friendlyName.TransferTo(aValue);
+    GetUnescaped(iFriendlyName, iFriendlyNameFound, aValue);
 }
 
 void DeviceXml::GetPresentationUrl(Brh& aValue) const
 {
-    Bwh friendlyName(XmlParserBasic::Find("PresentationURL", iXml));
-    Converter::FromXmlEscaped(friendlyName);
-    friendlyName.TransferTo(aValue);
+    GetUnescaped(iPresentationUrl, iPresentationUrlFound, aValue);
+}
+
+void DeviceXml::GetUnescaped(const Brx& aValue, TBool aFound, Brh& aUnescaped)
+{
+    if (!aFound) {
+        THROW(XmlError);
+    }
+    Bwh value(aValue);
+    Converter::FromXmlEscaped(value);
+    value.TransferTo(aUnescaped);
+}
+
+Brn DeviceXml::Content() const
+{
+    return Brn(iXml.Ptr() + iContentStart, iParser->TagOffset() - iContentStart);
+}
+
+void DeviceXml::XmlElementStart(const Brx& aName, const Brx& /*aAttributes*/)
+{
+    const TUint depth = iParser->Depth();
+    if (depth == 1) {
+        if (Ascii::CaseInsensitiveEquals(aName, Brn("serviceList"))) {
+            iElement = eServiceList;
+        }
+        else if (Ascii::CaseInsensitiveEquals(aName, Brn("deviceList"))) {
+            iElement = eDeviceList;
+        }
+        else {
+            iElement = eOther;
+        }
+    }
+    // values are taken from the document rather than the parser so they remain valid after parsing
+    iContentStart = iParser->TagEndOffset();
+}
+
+void DeviceXml::XmlElementEnd(const Brx& aName, const Brx& /*aValue*/)
+{
+    const TUint depth = iParser->Depth();
+    if (depth == 1) {
+        if (!iUdnFound && Ascii::CaseInsensitiveEquals(aName, Brn("UDN"))) {
+            iUdn.Set(Content());
+            iUdnFound = true;
+        }
+        else if (!iFriendlyNameFound && Ascii::CaseInsensitiveEquals(aName, Brn("friendlyName"))) {
+            iFriendlyName.Set(Content());
+            iFriendlyNameFound = true;
+        }
+        else if (!iPresentationUrlFound && Ascii::CaseInsensitiveEquals(aName, Brn("PresentationURL"))) {
+            iPresentationUrl.Set(Content());
+            iPresentationUrlFound = true;
+        }
+        iElement = eOther;
+    }
+    else if (depth == 3 && iElement == eServiceList && Ascii::CaseInsensitiveEquals(aName, Brn("serviceType"))) {
+        iServiceTypes.push_back(Content());
+    }
+    else if (depth == 2 && iElement == eDeviceList && Ascii::CaseInsensitiveEquals(aName, Brn("device"))) {
+        iDevices.push_back(Content());
+    }
 }
 
 Brn DeviceXml::ServiceVersion(const Brx& aServiceType) const
@@ -122,13 +214,8 @@ Brn DeviceXml::ServiceVersion(const Brx& aServiceType) const
     
     Ssdp::CanonicalDomainToUpnp(domain, upnpDomain);
     
-    Brn serviceList = XmlParserBasic::Find("serviceList", iXml);
-    
-    for (;;) {
-        Brn service = XmlParserBasic::Find("service", serviceList, serviceList);
-        Brn type = XmlParserBasic::Find("serviceType", service);
-
-        Parser parser(type);
+    for (TUint i=0; i<(TUint)iServiceTypes.size(); i++) {
+        Parser parser(iServiceTypes[i]);
         
         if (parser.Next(':') == Brn("urn")) {
             if (parser.Next(':') == upnpDomain) {
@@ -140,4 +227,5 @@ Brn DeviceXml::ServiceVersion(const Brx& aServiceType) const
             }
         }
     }
+    THROW(XmlError);
 }
@@ -7,11 +7,17 @@
 
 #include <OpenHome/OhNetTypes.h>
 #include <OpenHome/Buffer.h>
+#include <OpenHome/Net/Private/XmlParser.h>
+
+#include <vector>
 
 namespace OpenHome {
 namespace Net {
 
-class DeviceXml
+/**
+ * Indexes the xml for a single device (the content of its <device> element) in one pass
+ */
+class DeviceXml : private IXmlSaxHandler
 {
 public:
     DeviceXml(const Brx& aXml);
@@ -19,12 +25,35 @@ public:
     void GetFriendlyName(Brh& aValue) const;
     void GetPresentationUrl(Brh& aValue) const;
     Brn ServiceVersion(const Brx& aService) const; // e.g "upnp.org.ContentDirectory"
+private: // IXmlSaxHandler
+    void XmlElementStart(const Brx& aName, const Brx& aAttributes);
+    void XmlElementEnd(const Brx& aName, const Brx& aValue);
+private:
+    static void GetUnescaped(const Brx& aValue, TBool aFound, Brh& aUnescaped);
+    Brn Content() const;
+private:
+    enum EElement
+    {
+        eOther
+       ,eServiceList
+       ,eDeviceList
+    };
 private:
     Brn iXml;
     Brn iUdn;
+    Brn iFriendlyName;
+    Brn iPresentationUrl;
+    TBool iUdnFound;
+    TBool iFriendlyNameFound;
+    TBool iPresentationUrlFound;
+    std::vector<Brn> iServiceTypes;
+    std::vector<Brn> iDevices;
+    XmlParserSax* iParser;
+    EElement iElement;
+    TUint iContentStart;
 };
 
-class DeviceXmlDocument
+class DeviceXmlDocument : private IXmlSaxHandler
 {
 public:
     DeviceXmlDocument(const Brx& aXml);
@@ -32,9 +61,17 @@ public:
     Brn Find(const Brx& aUdn);
     const Brx& Xml() const;
     const DeviceXml& Root() const;
+private: // IXmlSaxHandler
+    void XmlElementStart(const Brx& aName, const Brx& aAttributes);
+    void XmlElementEnd(const Brx& aName, const Brx& aValue);
 private:
     Brn iXml;
     DeviceXml* iRoot;
+    XmlParserSax* iParser;
+    TBool iInRoot;
+    TUint iContentStart;
+    Brn iDevice;
+    TBool iDeviceFound;
 };
 
 } // namespace Net
@@ -24,8 +24,17 @@ const Brn EventSessionUpnp::kExpectedNts("upnp:propchange");
 EventSessionUpnp::EventSessionUpnp(CpStack& aCpStack)
     : iCpStack(aCpStack)
     , iShutdownSem("EVSD", 1)
+    , iXmlParser(*this)
+    , iEventProcessor(NULL)
 {
-    iReadBuffer = new Srs<kMaxReadBytes>(*this);
+    iMaxReadBytes = aCpStack.Env().InitParams().CpEventSessionReadBufferBytes();
+    iAdaptiveBuffers = aCpStack.Env().InitParams().UseAdaptiveSessionBuffers();
+    iReadBufferInitialBytes = iMaxReadBytes;
+    if (iAdaptiveBuffers && iReadBufferInitialBytes > kAdaptiveReadBytes) {
+        iReadBufferInitialBytes = kAdaptiveReadBytes;
+    }
+    iNotificationsSinceGrown = 0;
+    iReadBuffer = new Srd(iReadBufferInitialBytes, *this);
     iReaderRequest = new ReaderHttpRequest(aCpStack.Env(), *iReadBuffer);
 
     iReaderRequest->AddMethod(kMethodNotify);
@@ -121,12 +130,25 @@ void EventSessionUpnp::Run()
         Sws<128> writerBuffer(*this);
         WriterHttpResponse response(writerBuffer);
         response.WriteStatus(*iErrorStatus, Http::eHttp11);
+        Http::WriteHeaderConnectionClose(response);
         response.WriteFlush();
 
         // read entity
         if (subscription != NULL) {
             Bwh entity;
-            if (iHeaderTransferEncoding.IsChunked()) {
+            Brn entityRef;
+            const TUint contentLength = iHeaderContentLength.ContentLength();
+            if (!iHeaderTransferEncoding.IsChunked() && contentLength > 0 && contentLength <= iMaxReadBytes) {
+                // the common case; process the entity in place in the read buffer
+                if (contentLength > iReadBuffer->MaxBytes()) {
+                    iReadBuffer->Resize(iMaxReadBytes);
+                }
+                if (contentLength > iReadBufferInitialBytes) {
+                    iNotificationsSinceGrown = 0;
+                }
+                entityRef.Set(iReadBuffer->Read(contentLength));
+            }
+            else if (iHeaderTransferEncoding.IsChunked()) {
                 ReaderHttpChunked dechunker(*iReadBuffer);
                 dechunker.Read();
                 dechunker.TransferTo(entity);
@@ -135,7 +157,7 @@ void EventSessionUpnp::Run()
                 TUint length = iHeaderContentLength.ContentLength();
                 if (length == 0) {
                     // no Content-Length header, so read until remote socket closed
-                    Bwh buffer(kMaxReadBytes);
+                    Bwh buffer(iReadBuffer->MaxBytes());
                     buffer.Append(iReadBuffer->Snaffle());
                     for (;;) {
                         entity.Grow(entity.Bytes() + buffer.Bytes());
@@ -152,18 +174,22 @@ void EventSessionUpnp::Run()
                 } else {
                     entity.Grow(length);
                     while (length > 0) {
-                        TUint readBytes = (length<kMaxReadBytes? length : kMaxReadBytes);
+                        const TUint maxBytes = iReadBuffer->MaxBytes();
+                        TUint readBytes = (length<maxBytes? length : maxBytes);
                         entity.Append(iReadBuffer->Read(readBytes));
                         length -= readBytes;
                     }
                 }
             }
+            if (entityRef.Bytes() == 0) {
+                entityRef.Set(entity);
+            }
 
             // process entity
             LOG(kEvent, "EventSessionUpnp::Run, sid - ");
             LOG(kEvent, iHeaderSid.Sid());
             LOG(kEvent, " seq - %u\n", iHeaderSeq.Seq());
-            ProcessNotification(*subscription, entity);
+            ProcessNotification(*subscription, entityRef);
         }
     }
     catch(HttpError) {
@@ -185,62 +211,55 @@ void EventSessionUpnp::Run()
         subscription->Unlock();
         subscription->RemoveRef();
     }    
+    // each notification arrives on its own connection so any unread data can be discarded
+    iReaderRequest->Flush();
+    if (iAdaptiveBuffers && ++iNotificationsSinceGrown >= kAdaptiveShrinkNotifications) {
+        iNotificationsSinceGrown = 0;
+        iReadBuffer->Resize(iReadBufferInitialBytes);
+    }
 }
 
 void EventSessionUpnp::ProcessNotification(IEventProcessor& aEventProcessor, const Brx& aEntity)
 {
     aEventProcessor.EventUpdateStart();
-    OutputProcessorUpnp outputProcessor;
-    Brn propertySet = XmlParserBasic::Find("propertyset", aEntity);
-    Brn prop;
-    Brn remaining;
+    iEventProcessor = &aEventProcessor;
+    iXmlParser.Reset();
     try {
-        for (;;) {
-            prop.Set(XmlParserBasic::Find("property", propertySet, remaining));
-            prop.Set(Ascii::Trim(prop));
-            if (prop.Bytes() < 8 || prop[0] != '<' || prop[1] == '/') {
-                THROW(XmlError);
-            }
-            Parser parser(prop);
-            (void)parser.Next('<');
-            Brn tagNameFull = parser.Next('>');
-            Brn tagName = tagNameFull;
-            TUint bytes = tagNameFull.Bytes();
-            TUint i;
-            for (i = 0; i < bytes; i++) {
-                if (Ascii::IsWhitespace(tagNameFull[i])) {
-                    break;
-                }
-            }
-            if (i < bytes)
-            {
-                tagName.Set(tagNameFull.Split(0, i));
-            }
-            Brn val = parser.Next('<');
-            Brn closingTag = parser.Next('/');
-            closingTag.Set(parser.Next('>'));
-            if (tagName != closingTag) {
-                THROW(XmlError);
-            }
+        iXmlParser.Parse(aEntity);
+        iXmlParser.End();
+    }
+    catch(XmlError&) {}
+    iEventProcessor = NULL;
+    aEventProcessor.EventUpdateEnd();
+}
 
-            try {
-                aEventProcessor.EventUpdate(tagName, val, outputProcessor);
-            }
-            catch(AsciiError&) {
-                THROW(XmlError);
-            }
+void EventSessionUpnp::XmlElementStart(const Brx& aName, const Brx& /*aAttributes*/)
+{
+    const TUint depth = iXmlParser.Depth();
+    if ((depth == 1 && !Ascii::CaseInsensitiveEquals(aName, Brn("propertyset"))) ||
+        (depth == 2 && !Ascii::CaseInsensitiveEquals(aName, Brn("property")))) {
+        THROW(XmlError);
+    }
+}
 
-            propertySet.Set(remaining);
+void EventSessionUpnp::XmlElementEnd(const Brx& aName, const Brx& aValue)
+{
+    if (iXmlParser.Depth() == 3) {
+        OutputProcessorUpnp outputProcessor;
+        try {
+            iEventProcessor->EventUpdate(aName, aValue, outputProcessor);
+        }
+        catch(AsciiError&) {
+            THROW(XmlError);
         }
     }
-    catch(XmlError&) {}
-    aEventProcessor.EventUpdateEnd();
 }
 
 // EventServerUpnp
 
 EventServerUpnp::EventServerUpnp(CpStack& aCpStack, TIpAddress aInterface)
-    : iTcpServer(aCpStack.Env(), "EVNT", aCpStack.Env().InitParams().CpUpnpEventServerPort(), aInterface)
+    : iTcpServer(aCpStack.Env(), "EVNT", aCpStack.Env().InitParams().CpUpnpEventServerPort(), aInterface,
+                 kPriorityHigh, Thread::kDefaultStackBytes, 128, aCpStack.Env().InitParams().UseEventDrivenTcpServers())
 {
     TChar name[5] = "ESS ";
     const TUint numThread = aCpStack.Env().InitParams().NumEventSessionThreads();
@@ -6,6 +6,7 @@
 #include <OpenHome/Private/Http.h>
 #include <OpenHome/Net/Private/ProtocolUpnp.h>
 #include <OpenHome/Net/Private/Subscription.h>
+#include <OpenHome/Net/Private/XmlParser.h>
 
 namespace OpenHome {
 namespace Net {
@@ -13,7 +14,7 @@ namespace Net {
 class Subscription;
 class CpStack;
 
-class EventSessionUpnp : public SocketTcpSession
+class EventSessionUpnp : public SocketTcpSession, private IXmlSaxHandler
 {
 public:
     EventSessionUpnp(CpStack& aCpStack);
@@ -23,15 +24,23 @@ private:
     void LogError(CpiSubscription* aSubscription, const TChar* aErr);
     virtual void Run();
     void ProcessNotification(IEventProcessor& aEventProcessor, const Brx& aEntity);
+private: // IXmlSaxHandler
+    void XmlElementStart(const Brx& aName, const Brx& aAttributes);
+    void XmlElementEnd(const Brx& aName, const Brx& aValue);
 private:
-    static const TUint kMaxReadBytes = 16 * 1024;
+    static const TUint kAdaptiveReadBytes = 8 * 1024; // initial read buffer size when InitParams().UseAdaptiveSessionBuffers()
+    static const TUint kAdaptiveShrinkNotifications = 16; // release a grown read buffer after this many notifications that didn't need it
     static const TUint kReadTimeoutMs = 5 * 1000;
     static const Brn kMethodNotify;
     static const Brn kExpectedNt;
     static const Brn kExpectedNts;
 private:
     CpStack& iCpStack;
-    Srs<kMaxReadBytes>* iReadBuffer;
+    TUint iMaxReadBytes;
+    TUint iReadBufferInitialBytes;
+    TBool iAdaptiveBuffers;
+    TUint iNotificationsSinceGrown;
+    Srd* iReadBuffer;
     ReaderHttpRequest* iReaderRequest;
     HeaderNt iHeaderNt;
     HeaderNts iHeaderNts;
@@ -41,6 +50,8 @@ private:
     HttpHeaderTransferEncoding iHeaderTransferEncoding;
     const HttpStatus* iErrorStatus;
     Semaphore iShutdownSem;
+    XmlParserSax iXmlParser;
+    IEventProcessor* iEventProcessor;
 };
 
 class EventServerUpnp
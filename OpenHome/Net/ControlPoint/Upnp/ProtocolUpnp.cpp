@@ -17,15 +17,38 @@ using namespace OpenHome::Net;
 InvocationUpnp::InvocationUpnp(CpStack& aCpStack, Invocation& aInvocation)
     : iCpStack(aCpStack)
     , iInvocation(aInvocation)
-    , iReadBuffer(iSocket)
+    , iLock("INVU")
+    , iSocket(NULL)
+    , iInterrupted(false)
+    , iRequestSent(false)
+    , iReusable(false)
+    , iReadBuffer(*this)
     , iReaderResponse(aCpStack.Env(), iReadBuffer)
+    , iXmlParser(*this)
+    , iInBody(false)
+    , iInResponse(false)
+    , iInFault(false)
+    , iOutputsProcessed(0)
+    , iNextOutput(0)
 {
+    iReaderResponse.AddHeader(iHeaderContentLength);
+    iReaderResponse.AddHeader(iHeaderTransferEncoding);
+    iReaderResponse.AddHeader(iHeaderConnection);
+    // Envelope/Body/<action>Response/<argument>; report any markup inside an argument as is
+    iXmlParser.SetInnerXmlDepth(kOutputArgumentDepth);
 }
 
 InvocationUpnp::~InvocationUpnp()
 {
     iInvocation.SetInterruptHandler(NULL);
-    iSocket.Close();
+    if (iSocket != NULL) {
+        if (iReusable && !iInterrupted) {
+            iCpStack.InvocationConnectionPool().Release(iSocket, iEndpoint);
+        }
+        else {
+            SocketTcpClientPool::Close(iSocket);
+        }
+    }
 }
 
 void InvocationUpnp::Invoke(const Uri& aUri)
@@ -34,36 +57,94 @@ void InvocationUpnp::Invoke(const Uri& aUri)
     LOG(kService, iInvocation.Action().Name());
     LOG(kService, ")\n");
 
-    iSocket.Open(iCpStack.Env());
-    WriteRequest(aUri);
-    iInvocation.SetInterruptHandler(this);
-    ReadResponse();
+    iEndpoint.SetPort(aUri.Port());
+    iEndpoint.SetAddress(aUri.Host());
+    SocketTcpClient* socket = iCpStack.InvocationConnectionPool().Acquire(iEndpoint);
+    TBool invoked = false;
+    if (socket != NULL) {
+        SetSocket(socket);
+        try {
+            Invoke(aUri, true);
+            invoked = true;
+        }
+        catch (NetworkError&) {
+            if (!CanRetry()) {
+                throw;
+            }
+        }
+        catch (WriterError&) {
+            if (!CanRetry()) {
+                throw;
+            }
+        }
+    }
+    if (!invoked) {
+        socket = new SocketTcpClient();
+        socket->Open(iCpStack.Env());
+        SetSocket(socket);
+        Invoke(aUri, false);
+    }
 
     LOG(kService, "< InvocationUpnp::Invoke (%p, action ", &iInvocation);
     LOG(kService, iInvocation.Action().Name());
     LOG(kService, ")\n");
 }
 
+void InvocationUpnp::Invoke(const Uri& aUri, TBool aPooled)
+{
+    iRequestSent = false;
+    iReusable = false;
+    iReadBuffer.ReadFlush();
+    WriteRequest(aUri, aPooled);
+    iInvocation.SetInterruptHandler(this);
+    ReadResponse();
+}
+
+TBool InvocationUpnp::CanRetry()
+{
+    /* A pooled connection may have been closed by the device since it was last used.
+       Retry on a new connection, but only if the request wasn't completely sent.  A
+       device which received the whole request may have run the action already. */
+    if (iRequestSent || iInterrupted) {
+        return false;
+    }
+    LOG(kService, "InvocationUpnp::Invoke pooled connection failed, reconnecting\n");
+    iInvocation.SetInterruptHandler(NULL);
+    return true;
+}
+
+void InvocationUpnp::SetSocket(SocketTcpClient* aSocket)
+{
+    iLock.Wait();
+    SocketTcpClient* old = iSocket;
+    iSocket = aSocket;
+    iLock.Signal();
+    if (old != NULL) {
+        SocketTcpClientPool::Close(old);
+    }
+}
+
 void InvocationUpnp::WriteServiceType(IWriterAscii& aWriter, const Invocation& aInvocation)
 {
     const ServiceType& serviceType = aInvocation.ServiceType();
     aWriter.Write(serviceType.FullName());
 }
 
-void InvocationUpnp::WriteRequest(const Uri& aUri)
+void InvocationUpnp::WriteRequest(const Uri& aUri, TBool aPooled)
 {
-    Sws<1024> writeBuffer(iSocket);
+    Sws<1024> writeBuffer(*iSocket);
     WriterHttpRequest writerRequest(writeBuffer);
     Bwh body;
 
-    try {
-        Endpoint endpoint(aUri.Port(), aUri.Host());
-        TUint timeout = iCpStack.Env().InitParams().TcpConnectTimeoutMs();
-        iSocket.Connect(endpoint, timeout);
-    }
-    catch (NetworkTimeout&) {
-        iInvocation.SetError(Error::eSocket, Error::eCodeTimeout, Error::kDescriptionSocketTimeout);
-        THROW(NetworkTimeout);
+    if (!aPooled) {
+        try {
+            TUint timeout = iCpStack.Env().InitParams().TcpConnectTimeoutMs();
+            iSocket->Connect(iEndpoint, timeout);
+        }
+        catch (NetworkTimeout&) {
+            iInvocation.SetError(Error::eSocket, Error::eCodeTimeout, Error::kDescriptionSocketTimeout);
+            THROW(NetworkTimeout);
+        }
     }
 
     try {
@@ -71,22 +152,21 @@ void InvocationUpnp::WriteRequest(const Uri& aUri)
         WriteHeaders(writerRequest, aUri, body.Bytes());
         writeBuffer.Write(body);
         writeBuffer.WriteFlush();
+        iRequestSent = true;
     }
     catch (WriterError) {
-        iInvocation.SetError(Error::eHttp, Error::kCodeUnknown, Error::kDescriptionUnknown);
+        if (!aPooled) { // pooled connections are retried so leave reporting the error to the retry
+            iInvocation.SetError(Error::eHttp, Error::kCodeUnknown, Error::kDescriptionUnknown);
+        }
         THROW(WriterError);
     }
 }
 
 void InvocationUpnp::ReadResponse()
 {
-    OutputProcessorUpnp outputProcessor;
-    HttpHeaderContentLength headerContentLength;
-    HttpHeaderTransferEncoding headerTransferEncoding;
-    Bwh entity;
+    HttpHeaderContentLength& headerContentLength = iHeaderContentLength;
+    HttpHeaderTransferEncoding& headerTransferEncoding = iHeaderTransferEncoding;
 
-    iReaderResponse.AddHeader(headerContentLength);
-    iReaderResponse.AddHeader(headerTransferEncoding);
     iReaderResponse.Read(kResponseTimeoutMs);
     const HttpStatus& status = iReaderResponse.Status();
     if (status != HttpStatus::kOk) {
@@ -99,64 +179,124 @@ void InvocationUpnp::ReadResponse()
         }
     }
 
+    const Brn responseTagTrailer("Response");
+    const Brx& actionName = iInvocation.Action().Name();
+    iResponseTag.Grow(actionName.Bytes() + responseTagTrailer.Bytes());
+    iResponseTag.Replace(actionName);
+    iResponseTag.Append(responseTagTrailer);
+    iInBody = iInResponse = iInFault = false;
+    iOutputsProcessed = 0;
+    iNextOutput = 0;
+    iFaultCode.SetBytes(0);
+    iFaultDescription.SetBytes(0);
+    iXmlParser.Reset();
+
+    // the body is parsed as it is read, without being buffered
+    TBool reusable = (iCpStack.InvocationConnectionPool().Enabled() &&
+                      iReaderResponse.Version() == Http::eHttp11 && !iHeaderConnection.Close());
     if (headerTransferEncoding.IsChunked()) {
         ReaderHttpChunked dechunker(iReadBuffer);
-        dechunker.Read();
-        dechunker.TransferTo(entity);
+        dechunker.Read(iXmlParser);
+        if (reusable) {
+            // consume any trailers so the connection is left at the start of the next response
+            for (;;) {
+                Brn trailer = Ascii::Trim(iReadBuffer.ReadUntil(Ascii::kLf));
+                if (trailer.Bytes() == 0) {
+                    break;
+                }
+            }
+        }
     }
     else {
         TUint length = headerContentLength.ContentLength();
-        if (length != 0) {
-            Bwh buf(length);
-            while (length > 0) {
-                TUint readBytes = (length<kMaxReadBytes? length : kMaxReadBytes);
-                buf.Append(iReadBuffer.Read(readBytes));
-                length -= readBytes;
-            }
-            buf.TransferTo(entity);
+        if (length == 0 && headerContentLength.Received()) {
+            // explicitly empty body
+        }
+        else if (length != 0) {
+            iXmlParser.Parse(iReadBuffer, length);
         }
         else { // no content length - read until connection closed by server
             try {
                 for (;;) {
-                    Brn buf = iReadBuffer.Read(kMaxReadBytes);
-                    entity.Grow(entity.Bytes() + kMaxReadBytes);
-                    entity.Append(buf);
+                    iXmlParser.Parse(iReadBuffer.Read(kMaxReadBytes));
                 }
             }
             catch (ReaderError&) {
-                Brn snaffle = iReadBuffer.Snaffle();
-                entity.Grow(entity.Bytes() + snaffle.Bytes());
-                entity.Append(snaffle);
+                iXmlParser.Parse(iReadBuffer.Snaffle());
             }
+            reusable = false;
         }
     }
+    iXmlParser.End();
+    iReusable = (reusable && iReadBuffer.Buffered() == 0);
 
     if (status == HttpStatus::kInternalServerError) {
-        Brn envelope = XmlParserBasic::Find("Envelope", entity);
-        Brn body = XmlParserBasic::Find("Body", envelope);
-        Brn fault = XmlParserBasic::Find("Fault", body);
-        Brn detail = XmlParserBasic::Find("detail", fault);
-        Brn code = XmlParserBasic::Find("errorCode", detail);
-        Brn description = XmlParserBasic::Find("errorDescription", detail);
-        iInvocation.SetError(Error::eUpnp, Ascii::Uint(code), description);
+        if (iFaultCode.Bytes() == 0) {
+            THROW(XmlError);
+        }
+        iInvocation.SetError(Error::eUpnp, Ascii::Uint(iFaultCode), iFaultDescription);
         THROW(HttpError);
     }
+    if (iOutputsProcessed != iInvocation.OutputArguments().size()) {
+        THROW(XmlError);
+    }
+}
 
-    const Invocation::VectorArguments& outArgs = iInvocation.OutputArguments();
-    const TUint count = (TUint)outArgs.size();
-    Brn envelope = XmlParserBasic::Find("Envelope", entity);
-    Brn body = XmlParserBasic::Find("Body", envelope);
-    const Brn responseTagTrailer("Response");
-    const Brx& actionName = iInvocation.Action().Name();
-    TUint len = actionName.Bytes() + responseTagTrailer.Bytes();
-    Bwh responseTag(len);
-    responseTag.Append(actionName);
-    responseTag.Append(responseTagTrailer);
-    Brn response = XmlParserBasic::Find(responseTag, body);
-    for (TUint i=0; i<count; i++) {
-        const Brx& name = outArgs[i]->Parameter().Name();
-        Brn value = XmlParserBasic::Find(name, response);
-        outArgs[i]->ProcessOutput(outputProcessor, value);
+void InvocationUpnp::XmlElementStart(const Brx& aName, const Brx& /*aAttributes*/)
+{
+    switch (iXmlParser.Depth())
+    {
+    case 1:
+        if (!Ascii::CaseInsensitiveEquals(aName, Brn("Envelope"))) {
+            THROW(XmlError);
+        }
+        break;
+    case 2:
+        iInBody = Ascii::CaseInsensitiveEquals(aName, Brn("Body"));
+        break;
+    case 3:
+        if (iInBody) {
+            iInResponse = Ascii::CaseInsensitiveEquals(aName, iResponseTag);
+            iInFault = Ascii::CaseInsensitiveEquals(aName, Brn("Fault"));
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void InvocationUpnp::XmlElementEnd(const Brx& aName, const Brx& aValue)
+{
+    const TUint depth = iXmlParser.Depth();
+    if (depth == kOutputArgumentDepth && iInResponse) {
+        // output arguments are normally returned in the order they were declared
+        const Invocation::VectorArguments& outArgs = iInvocation.OutputArguments();
+        const TUint count = (TUint)outArgs.size();
+        for (TUint i=0; i<count; i++) {
+            const TUint index = (iNextOutput + i) % count;
+            if (Ascii::CaseInsensitiveEquals(outArgs[index]->Parameter().Name(), aName)) {
+                OutputProcessorUpnp outputProcessor;
+                outArgs[index]->ProcessOutput(outputProcessor, aValue);
+                iNextOutput = index + 1;
+                iOutputsProcessed++;
+                break;
+            }
+        }
+    }
+    else if (depth > 3 && iInFault) {
+        if (Ascii::CaseInsensitiveEquals(aName, Brn("errorCode"))) {
+            iFaultCode.Replace(aValue.Split(0, aValue.Bytes() < kMaxErrorCodeBytes? aValue.Bytes() : kMaxErrorCodeBytes));
+        }
+        else if (Ascii::CaseInsensitiveEquals(aName, Brn("errorDescription"))) {
+            iFaultDescription.Grow(aValue.Bytes());
+            iFaultDescription.Replace(aValue);
+        }
+    }
+    else if (depth == 3) {
+        iInResponse = iInFault = false;
+    }
+    else if (depth == 2) {
+        iInBody = false;
     }
 }
 
@@ -165,7 +305,8 @@ void InvocationUpnp::WriteHeaders(WriterHttpRequest& aWriterRequest, const Uri&
     const Brn kContentType("text/xml; charset=\"utf-8\"");
     const Brn kSoapAction("SOAPACTION");
 
-    aWriterRequest.WriteMethod(Http::kMethodPost, aUri.PathAndQuery(), Http::eHttp10);
+    const Http::EVersion version = (iCpStack.InvocationConnectionPool().Enabled()? Http::eHttp11 : Http::eHttp10);
+    aWriterRequest.WriteMethod(Http::kMethodPost, aUri.PathAndQuery(), version);
 
     Http::WriteHeaderHostAndPort(aWriterRequest, aUri);
     Http::WriteHeaderContentLength(aWriterRequest, aBodyBytes);
@@ -186,7 +327,32 @@ void InvocationUpnp::Interrupt()
 {
     /* Assumes that interrupting the socket is always safe, regardless of whether we're
        using it or one of its stream/http wrappers */
-    iSocket.Interrupt(true);
+    iLock.Wait();
+    iInterrupted = true;
+    if (iSocket != NULL) {
+        iSocket->Interrupt(true);
+    }
+    iLock.Signal();
+}
+
+void InvocationUpnp::Read(Bwx& aBuffer)
+{
+    iSocket->Read(aBuffer);
+}
+
+void InvocationUpnp::Read(Bwx& aBuffer, TUint aBytes)
+{
+    iSocket->Read(aBuffer, aBytes);
+}
+
+void InvocationUpnp::ReadFlush()
+{
+    iSocket->ReadFlush();
+}
+
+void InvocationUpnp::ReadInterrupt()
+{
+    iSocket->ReadInterrupt();
 }
 
 
@@ -13,6 +13,7 @@
 #include <OpenHome/Private/Http.h>
 #include <OpenHome/Private/Ascii.h>
 #include <OpenHome/Private/Stream.h>
+#include <OpenHome/Net/Private/XmlParser.h>
 
 namespace OpenHome {
 namespace Net {
@@ -20,7 +21,7 @@ namespace Net {
 class CpStack;
 class CpiSubscription;
 
-class InvocationUpnp : private IInterruptHandler
+class InvocationUpnp : private IInterruptHandler, private IReaderSource, private IXmlSaxHandler
 {
 public:
     InvocationUpnp(CpStack& aCpStack, Invocation& aInvocation);
@@ -28,19 +29,49 @@ public:
     void Invoke(const Uri& aUri);
     static void WriteServiceType(IWriterAscii& aWriter, const Invocation& aInvocation);
 private:
-    void WriteRequest(const Uri& aUri);
+    void Invoke(const Uri& aUri, TBool aPooled);
+    void WriteRequest(const Uri& aUri, TBool aPooled);
     void ReadResponse();
     void WriteHeaders(WriterHttpRequest& aWriterRequest, const Uri& aUri, TUint aBodyBytes);
+    TBool CanRetry();
+    void SetSocket(SocketTcpClient* aSocket);
     // IInterruptHandler
     void Interrupt();
+    // IReaderSource
+    void Read(Bwx& aBuffer);
+    void Read(Bwx& aBuffer, TUint aBytes);
+    void ReadFlush();
+    void ReadInterrupt();
+    // IXmlSaxHandler
+    void XmlElementStart(const Brx& aName, const Brx& aAttributes);
+    void XmlElementEnd(const Brx& aName, const Brx& aValue);
 private:
     static const TUint kMaxReadBytes = 16 * 1024;
+    static const TUint kMaxErrorCodeBytes = 16;
     static const TUint kResponseTimeoutMs = 60 * 1000;
+    static const TUint kOutputArgumentDepth = 4;
     CpStack& iCpStack;
     Invocation& iInvocation;
-    OpenHome::SocketTcpClient iSocket;
+    Mutex iLock;
+    OpenHome::SocketTcpClient* iSocket;
+    Endpoint iEndpoint;
+    TBool iInterrupted;
+    TBool iRequestSent;
+    TBool iReusable;
     Srs<kMaxReadBytes> iReadBuffer;
     ReaderHttpResponse iReaderResponse;
+    HttpHeaderContentLength iHeaderContentLength;
+    HttpHeaderTransferEncoding iHeaderTransferEncoding;
+    HttpHeaderConnection iHeaderConnection;
+    XmlParserSax iXmlParser;
+    Bwh iResponseTag;
+    TBool iInBody;
+    TBool iInResponse;
+    TBool iInFault;
+    TUint iOutputsProcessed;
+    TUint iNextOutput;
+    Bws<kMaxErrorCodeBytes> iFaultCode;
+    Bwh iFaultDescription;
 };
 
 /**
@@ -5,6 +5,8 @@
 #include <OpenHome/Private/Http.h>
 #include <OpenHome/Exception.h>
 #include <OpenHome/Private/Debug.h>
+#include <OpenHome/Private/Network.h>
+#include <OpenHome/Private/Ascii.h>
 
 #include <stdlib.h>
 
@@ -20,6 +22,12 @@ void XmlFetch::Set(OpenHome::Uri* aUri, FunctorAsync& aFunctor)
     iSequenceNumber = iCpStack.Env().SequenceNumber();
 }
 
+void XmlFetch::SetValidators(const Brx& aETag, const Brx& aLastModified)
+{
+    iRequestETag.Set(aETag);
+    iRequestLastModified.Set(aLastModified);
+}
+
 XmlFetch::~XmlFetch()
 {
     delete iUri;
@@ -67,44 +75,91 @@ void XmlFetch::Fetch()
     LOG(kXmlFetch, "> XmlFetch::Fetch for ");
     LOG(kXmlFetch, iUri->AbsoluteUri());
     LOG(kXmlFetch, "\n");
-    
-    OpenHome::SocketTcpClient socket;
-    socket.Open(iCpStack.Env());
-    AutoSocket a(socket);
+
+    Endpoint endpoint(iUri->Port(), iUri->Host());
+    SocketTcpClientPool& pool = iCpStack.InvocationConnectionPool();
+    SocketTcpClient* socket = pool.Acquire(endpoint);
+    TBool fetched = false;
+    if (socket != NULL) {
+        fetched = Fetch(socket, endpoint, true);
+    }
+    if (!fetched) {
+        socket = new SocketTcpClient();
+        socket->Open(iCpStack.Env());
+        (void)Fetch(socket, endpoint, false);
+    }
+
+    LOG(kXmlFetch, "< XmlFetch::Fetch for ");
+    LOG(kXmlFetch, iUri->AbsoluteUri());
+    LOG(kXmlFetch, "\n");
+}
+
+TBool XmlFetch::Fetch(SocketTcpClient* aSocket, const Endpoint& aEndpoint, TBool aPooled)
+{
+    // returns false if a pooled connection failed in a way that is worth retrying on a new one
     iLock.Wait();
     if (iInterrupted) {
         SetError(Error::eAsync, Error::eCodeInterrupted, Error::kDescriptionAsyncInterrupted);
         iLock.Signal();
+        SocketTcpClientPool::Close(aSocket);
         THROW(ReaderError);
     }
-    iSocket = &socket;
+    iSocket = aSocket;
     iLock.Signal();
+    iHeadersRead = false;
+    iReusable = false;
+    TBool retry = false;
     try {
-        Endpoint endpoint(iUri->Port(), iUri->Host());
-        TUint timeout = iCpStack.Env().InitParams().TcpConnectTimeoutMs();
-        socket.Connect(endpoint, timeout);
-        WriteRequest(socket);
-        Read(socket);
+        if (!aPooled) {
+            TUint timeout = iCpStack.Env().InitParams().TcpConnectTimeoutMs();
+            aSocket->Connect(aEndpoint, timeout);
+        }
+        WriteRequest(*aSocket);
+        Read(*aSocket);
     }
     catch (NetworkTimeout&) {
         SetError(Error::eSocket, Error::eCodeTimeout, Error::kDescriptionSocketTimeout);
     }
+    catch (NetworkError&) {
+        SetError(Error::eSocket, Error::kCodeUnknown, Error::kDescriptionUnknown);
+    }
     catch (HttpError&) {
         SetError(Error::eHttp, Error::kCodeUnknown, Error::kDescriptionUnknown);
     }
     catch (WriterError&) {
-        SetError(Error::eSocket, Error::kCodeUnknown, Error::kDescriptionUnknown);
+        retry = CanRetry(aPooled);
+        if (!retry) {
+            SetError(Error::eSocket, Error::kCodeUnknown, Error::kDescriptionUnknown);
+        }
     }
     catch (ReaderError&) {
-        SetError(Error::eSocket, Error::kCodeUnknown, Error::kDescriptionUnknown);
+        retry = CanRetry(aPooled);
+        if (!retry) {
+            SetError(Error::eSocket, Error::kCodeUnknown, Error::kDescriptionUnknown);
+        }
     }
     iLock.Wait();
     iSocket = NULL;
+    const TBool reusable = (iReusable && !iInterrupted);
     iLock.Signal();
+    if (reusable) {
+        iCpStack.InvocationConnectionPool().Release(aSocket, aEndpoint);
+    }
+    else {
+        SocketTcpClientPool::Close(aSocket);
+    }
+    if (retry) {
+        LOG(kXmlFetch, "XmlFetch::Fetch pooled connection failed, reconnecting\n");
+        iXml.SetBytes(0);
+    }
+    return !retry;
+}
 
-    LOG(kXmlFetch, "< XmlFetch::Fetch for ");
-    LOG(kXmlFetch, iUri->AbsoluteUri());
-    LOG(kXmlFetch, "\n");
+TBool XmlFetch::CanRetry(TBool aPooled) const
+{
+    /* A pooled connection may have been closed by the device since it was last used.
+       Retry on a new connection unless we got as far as reading a response. */
+    return (aPooled && !iHeadersRead && !Interrupted());
 }
 
 void XmlFetch::Interrupt()
@@ -127,13 +182,33 @@ TBool XmlFetch::Interrupted() const
 }
 
 Bwh& XmlFetch::Xml(IAsync& aAsync)
+{
+    return FromAsync(aAsync).iXml;
+}
+
+TBool XmlFetch::NotModified(IAsync& aAsync)
+{
+    return FromAsync(aAsync).iNotModified;
+}
+
+const Brx& XmlFetch::ETag(IAsync& aAsync)
+{
+    return FromAsync(aAsync).iETag;
+}
+
+const Brx& XmlFetch::LastModified(IAsync& aAsync)
+{
+    return FromAsync(aAsync).iLastModified;
+}
+
+XmlFetch& XmlFetch::FromAsync(IAsync& aAsync)
 {
     ASSERT(((Async&)aAsync).Type() == Async::eXmlFetch);
     XmlFetch& self = (XmlFetch&)aAsync;
     if (self.Error()) {
         THROW(XmlFetchError);
     }
-    return self.iXml;
+    return self;
 }
 
 XmlFetch::XmlFetch(CpStack& aCpStack)
@@ -143,6 +218,9 @@ XmlFetch::XmlFetch(CpStack& aCpStack)
     , iLock("XMLM")
     , iInterrupted(false)
     , iSocket(NULL)
+    , iNotModified(false)
+    , iHeadersRead(false)
+    , iReusable(false)
 {
 }
 
@@ -154,7 +232,15 @@ void XmlFetch::WriteRequest(SocketTcpClient& aSocket)
     writerRequest.WriteMethod(Http::kMethodGet, iUri->PathAndQuery(), Http::eHttp11);
     Http::WriteHeaderHost(writerRequest, *iUri);
     Http::WriteHeaderContentLength(writerRequest, 0);
-    Http::WriteHeaderConnectionClose(writerRequest);
+    if (iRequestETag.Bytes() > 0) {
+        writerRequest.WriteHeader(Http::kHeaderIfNoneMatch, iRequestETag);
+    }
+    if (iRequestLastModified.Bytes() > 0) {
+        writerRequest.WriteHeader(Http::kHeaderIfModifiedSince, iRequestLastModified);
+    }
+    if (!iCpStack.InvocationConnectionPool().Enabled()) {
+        Http::WriteHeaderConnectionClose(writerRequest);
+    }
     writerRequest.WriteFlush();
 }
 
@@ -164,50 +250,91 @@ void XmlFetch::Read(SocketTcpClient& aSocket)
     ReaderHttpResponse readerResponse(iCpStack.Env(), readBuffer);
     HttpHeaderContentLength headerContentLength;
     HttpHeaderTransferEncoding headerTransferEncoding;
+    HttpHeaderConnection headerConnection;
+    HttpHeaderETag headerETag;
+    HttpHeaderLastModified headerLastModified;
 
     readerResponse.AddHeader(headerContentLength);
     readerResponse.AddHeader(headerTransferEncoding);
+    readerResponse.AddHeader(headerConnection);
+    readerResponse.AddHeader(headerETag);
+    readerResponse.AddHeader(headerLastModified);
     readerResponse.Read(kResponseTimeoutMs);
+    iHeadersRead = true;
     const HttpStatus& status = readerResponse.Status();
-    if (status != HttpStatus::kOk) {
+    iNotModified = (status == HttpStatus::kNotModified &&
+                    (iRequestETag.Bytes() > 0 || iRequestLastModified.Bytes() > 0));
+    if (status != HttpStatus::kOk && !iNotModified) {
         LOG2(kXmlFetch, kError, "XmlFetch::Read, http error %u ", status.Code());
         LOG2(kXmlFetch, kError, status.Reason());
         LOG2(kXmlFetch, kError, "\n");
         SetError(Error::eHttp, status.Code(), status.Reason());
         THROW(HttpError);
     }
+    if (headerETag.Received()) {
+        iETag.Set(headerETag.ETag());
+    }
+    if (headerLastModified.Received()) {
+        iLastModified.Set(headerLastModified.LastModified());
+    }
 
-    if (headerTransferEncoding.IsChunked()) {
+    TBool reusable = (iCpStack.InvocationConnectionPool().Enabled() &&
+                      readerResponse.Version() == Http::eHttp11 && !headerConnection.Close());
+    if (iNotModified) {
+        // 304 responses never have a body
+    }
+    else if (headerTransferEncoding.IsChunked()) {
         ReaderHttpChunked dechunker(readBuffer);
         dechunker.Read();
         dechunker.TransferTo(iXml);
+        if (reusable) {
+            // consume any trailers so the connection is left at the start of the next response
+            for (;;) {
+                Brn trailer = Ascii::Trim(readBuffer.ReadUntil(Ascii::kLf));
+                if (trailer.Bytes() == 0) {
+                    break;
+                }
+            }
+        }
     }
     else {
         TUint remaining = headerContentLength.ContentLength();
-        if (remaining == 0) { // no content length - read until connection closed by server
+        if (remaining == 0 && headerContentLength.Received()) {
+            // explicitly empty body
+        }
+        else if (remaining == 0) { // no content length - read until connection closed by server
+            reusable = false;
             try {
                 for (;;) {
-                    Brn buf = readBuffer.Read(kRwBufferLength);
-                    iXml.Grow(iXml.Bytes() + kRwBufferLength);
-                    iXml.Append(buf);
+                    Append(readBuffer.Read(kRwBufferLength));
                 }
             }
             catch (ReaderError&) {
-                Brn snaffle = readBuffer.Snaffle();
-                iXml.Grow(iXml.Bytes() + snaffle.Bytes());
-                iXml.Append(snaffle);
+                Append(readBuffer.Snaffle());
             }
         }
         else {
+            iXml.Grow(iXml.Bytes() + remaining);
             while (remaining > 0) {
-                TInt readBytes = (remaining > kRwBufferLength ? kRwBufferLength : remaining);
+                TUint readBytes = (remaining > kRwBufferLength ? kRwBufferLength : remaining);
                 Brn buf = readBuffer.Read(readBytes);
-                iXml.Grow(iXml.Bytes() + readBytes);
                 iXml.Append(buf);
-                remaining -= readBytes;
+                remaining -= buf.Bytes();
             }
         }
     }
+    iReusable = (reusable && readBuffer.Buffered() == 0);
+}
+
+void XmlFetch::Append(const Brx& aData)
+{
+    const TUint bytes = iXml.Bytes() + aData.Bytes();
+    if (bytes > iXml.MaxBytes()) {
+        // grow geometrically so that large documents of unknown length aren't copied repeatedly
+        const TUint doubled = 2 * iXml.MaxBytes();
+        iXml.Grow(bytes > doubled? bytes : doubled);
+    }
+    iXml.Append(aData);
 }
 
 void XmlFetch::Output(IAsyncOutput& aConsole)
@@ -310,7 +437,7 @@ XmlFetchManager::XmlFetchManager(CpStack& aCpStack)
     : Thread("FETM")
     , iCpStack(aCpStack)
     , iLock("FETL")
-    , iFree(iCpStack.Env().InitParams().NumXmlFetcherThreads())
+    , iFree(iCpStack.Env().InitParams().NumXmlFetcherThreads(), EFifoSignalOnDemand)
 {
     const TUint numThreads = iCpStack.Env().InitParams().NumXmlFetcherThreads();
     iFetchers = (XmlFetcher**)malloc(sizeof(*iFetchers) * numThreads);
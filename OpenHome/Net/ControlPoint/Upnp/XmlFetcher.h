@@ -19,27 +19,44 @@ EXCEPTION(XmlFetchError);
 
 namespace OpenHome {
 class SocketTcpClient;
+class Endpoint;
 namespace Net {
 
 class CpStack;
 
+/**
+ * Fetches a single document using HTTP GET.
+ *
+ * Connections are taken from (and, if the server allows, returned to) the control
+ * point's connection pool.  If SetValidators() is called, the request is conditional;
+ * NotModified() then reports whether the server confirmed that the caller's copy is
+ * still current (in which case Xml() is empty).
+ */
 class XmlFetch : public Async
 {
 public:
     void Set(OpenHome::Uri* aUri, FunctorAsync& aFunctor);
+    void SetValidators(const Brx& aETag, const Brx& aLastModified); // either may be empty
     ~XmlFetch();
     const OpenHome::Uri& Uri() const;
     void SignalCompleted();
     void SetError(Error::ELevel aLevel, TUint aCode, const Brx& aDescription);
     static Bwh& Xml(IAsync& aAsync);
+    static TBool NotModified(IAsync& aAsync);
+    static const Brx& ETag(IAsync& aAsync);         // empty if the server didn't send one
+    static const Brx& LastModified(IAsync& aAsync); // empty if the server didn't send one
     void Fetch();
     void Interrupt();
     TBool Interrupted() const;
 private:
     XmlFetch(CpStack& aCpStack);
+    static XmlFetch& FromAsync(IAsync& aAsync);
     TBool Error() const;
+    TBool Fetch(SocketTcpClient* aSocket, const Endpoint& aEndpoint, TBool aPooled);
+    TBool CanRetry(TBool aPooled) const;
     void WriteRequest(SocketTcpClient& aSocket);
     void Read(SocketTcpClient& aSocket);
+    void Append(const Brx& aData);
     virtual void Output(IAsyncOutput& aConsole);
     virtual TUint Type() const;
 private:
@@ -54,6 +71,13 @@ private:
     mutable OpenHome::Mutex iLock;
     TBool iInterrupted;
     OpenHome::SocketTcpClient* iSocket;
+    Brh iRequestETag;
+    Brh iRequestLastModified;
+    Brh iETag;
+    Brh iLastModified;
+    TBool iNotModified;
+    TBool iHeadersRead;
+    TBool iReusable;
 
     friend class XmlFetchManager;
 };
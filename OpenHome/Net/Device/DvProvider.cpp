@@ -32,6 +32,16 @@ void DvProvider::PropertiesUnlock()
     }
 }
 
+void DvProvider::SetEventModerationMs(TUint aIntervalMs)
+{
+    iService->SetModerationMs(aIntervalMs);
+}
+
+void DvProvider::SetEventModerationMs(const TChar* aPropertyName, TUint aIntervalMs)
+{
+    iService->SetPropertyModerationMs(Brn(aPropertyName), aIntervalMs);
+}
+
 DvProvider::DvProvider(DviDevice& aDevice, const TChar* aDomain, const TChar* aType, TUint aVersion)
     : iDvStack(aDevice.GetDvStack())
     , iDelayPropertyUpdates(false)
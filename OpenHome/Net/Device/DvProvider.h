@@ -44,6 +44,27 @@ public:
      * This must only be called following a call to PropertiesLock().
      */
     void PropertiesUnlock();
+    /**
+     * Set the minimum interval between notifications of changes to this provider's properties.
+     *
+     * Changes made within aIntervalMs of the previous notification are coalesced and
+     * published together once the interval has elapsed.  Subscribers always see the latest
+     * value of each property; intermediate values may not be reported.
+     * Overrides any default set by InitialisationParams::SetDvEventModeration().
+     *
+     * @param[in] aIntervalMs    Minimum interval between notifications.  0 publishes changes immediately.
+     */
+    DllExport void SetEventModerationMs(TUint aIntervalMs);
+    /**
+     * Set the minimum interval between notifications of changes to a single property.
+     *
+     * Overrides the interval for the provider as a whole (see above) for aPropertyName only.
+     * Where several changed properties have different intervals, the shortest applies.
+     *
+     * @param[in] aPropertyName  Name of a property previously added to this provider
+     * @param[in] aIntervalMs    Minimum interval between notifications.  0 publishes changes immediately.
+     */
+    DllExport void SetEventModerationMs(const TChar* aPropertyName, TUint aIntervalMs);
 protected:
     DllExport DvProvider(DviDevice& aDevice, const TChar* aDomain, const TChar* aType, TUint aVersion);
     DllExport virtual ~DvProvider();
@@ -38,6 +38,19 @@ public:
      * values in the WriteResource callbacks does not match aTotalBytes.
      */
     virtual void WriteResourceEnd() = 0;
+    /**
+     * Optional.  May be called after WriteResourceBegin by resource managers which can seek
+     * within a resource, to find which bytes the writer actually needs.
+     *
+     * If this is called, the following WriteResource callbacks need only pass the bytes of the
+     * resource starting at aOffset, up to a total of aBytes.  aBytes is 0 if no file data is
+     * needed (e.g. to answer an HTTP HEAD request) and 0xffffffff if the rest of the resource
+     * from aOffset is needed.  If this isn't called, the whole resource must be written.
+     *
+     * @param[out] aOffset     Offset (from the start of the resource) of the first byte needed
+     * @param[out] aBytes      Number of bytes needed
+     */
+    virtual void GetRequiredRange(uint32_t& aOffset, uint32_t& aBytes) { aOffset = 0; aBytes = 0xffffffff; }
 
     virtual ~IResourceWriter() {}
 };
@@ -4,6 +4,7 @@
 #include <OpenHome/Exception.h>
 #include <OpenHome/Private/Parser.h>
 #include <OpenHome/Private/Printer.h>
+#include <OpenHome/Private/Ascii.h>
 #include <OpenHome/Net/Private/DviProtocolUpnp.h> // for DviProtocolUpnp ctor only
 #include <OpenHome/Net/Private/DviStack.h>
 #include <OpenHome/Net/Private/DviProviderSubscriptionLongPoll.h>
@@ -87,6 +88,7 @@ void DviDevice::Destroy()
     iServices.clear();
     iServiceLock.Signal();
     delete iProviderSubscriptionLongPoll;
+    iDvStack.ResourceCache().Remove(iUdn);
     RemoveWeakRef();
 }
 
@@ -138,6 +140,7 @@ void DviDevice::SetEnabled()
     iConfigUpdated = false;
     iShutdownSem.Clear();
     iLock.Signal();
+    iDvStack.ResourceCache().Remove(iUdn);
     TUint i;
     for (i=0; i<(TUint)iProtocols.size(); i++) {
         iProtocols[i]->Enable();
@@ -286,6 +289,31 @@ void DviDevice::WriteResource(const Brx& aUriTail, TIpAddress aInterface, std::v
     }
 }
 
+void DviDevice::WriteResource(const Brx& aUriTail, TIpAddress aInterface, std::vector<char*>& aLanguageList, IResourceWriterHttp& aResourceWriter)
+{
+    Parser parser(aUriTail);
+    Brn dir = parser.Next('/');
+    DviResourceCache& cache = iDvStack.ResourceCache();
+    if (dir == kResourceDir) {
+        if (iResourceManager != NULL && cache.Enabled()) {
+            cache.WriteResource(iUdn, *iResourceManager, parser.Remaining(), aInterface, aLanguageList, aResourceWriter);
+            return;
+        }
+    }
+    else {
+        for (TUint i=0; i<(TUint)iProtocols.size(); i++) {
+            IDvProtocol* protocol = iProtocols[i];
+            if (protocol->ProtocolName() == dir) {
+                if (protocol->WriteValidatedResource(parser.Remaining(), aInterface, aResourceWriter)) {
+                    return;
+                }
+                break;
+            }
+        }
+    }
+    WriteResource(aUriTail, aInterface, aLanguageList, static_cast<IResourceWriter&>(aResourceWriter));
+}
+
 void DviDevice::GetUriBase(Bwx& aUriBase, TIpAddress aInterface, TUint aPort, IDvProtocol& aProtocol)
 {
     const Brx& name = aProtocol.ProtocolName();
@@ -611,6 +639,25 @@ DviDevice* DviDeviceMap::Find(const Brx& aUdn)
 
 void DviDeviceMap::WriteResource(const Brx& aUriTail, TIpAddress aInterface, std::vector<char*>& aLanguageList, IResourceWriter& aResourceWriter)
 {
+    Brn tail;
+    DviDevice* device = FindForResource(aUriTail, tail);
+    if (device != NULL) {
+        device->WriteResource(tail, aInterface, aLanguageList, aResourceWriter);
+    }
+}
+
+void DviDeviceMap::WriteResource(const Brx& aUriTail, TIpAddress aInterface, std::vector<char*>& aLanguageList, IResourceWriterHttp& aResourceWriter)
+{
+    Brn tail;
+    DviDevice* device = FindForResource(aUriTail, tail);
+    if (device != NULL) {
+        device->WriteResource(tail, aInterface, aLanguageList, aResourceWriter);
+    }
+}
+
+DviDevice* DviDeviceMap::FindForResource(const Brx& aUriTail, Brn& aTail)
+{
+    DviDevice* device = NULL;
     iLock.Wait();
     Parser parser(aUriTail);
     (void)parser.Next('/'); // skip leading slash
@@ -618,11 +665,407 @@ void DviDeviceMap::WriteResource(const Brx& aUriTail, TIpAddress aInterface, std
     if (dir.Bytes() > 0) {
         Map::iterator it = iMap.find(dir);
         if (it != iMap.end()) {
-            DviDevice* device = it->second;
-            iLock.Signal();
-            device->WriteResource(parser.Remaining(), aInterface, aLanguageList, aResourceWriter);
+            device = it->second;
+            aTail.Set(parser.Remaining());
+        }
+    }
+    iLock.Signal();
+    return device;
+}
+
+
+// DviResourceCache
+
+DviResourceCache::DviResourceCache(Environment& aEnv, TUint aMaxBytes)
+    : iEnv(aEnv)
+    , iLock("DRCL")
+    , iMaxBytes(aMaxBytes)
+    , iMaxEntryBytes(aMaxBytes / 4)
+    , iBytes(0)
+    , iSequence(0)
+{
+}
+
+DviResourceCache::~DviResourceCache()
+{
+    Map::iterator it = iMap.begin();
+    while (it != iMap.end()) {
+        it->second->RemoveRef();
+        it++;
+    }
+}
+
+TBool DviResourceCache::Enabled() const
+{
+    return (iMaxBytes > 0);
+}
+
+void DviResourceCache::WriteResource(const Brx& aUdn, IResourceManager& aResourceManager, const Brx& aUriTail, TIpAddress aInterface,
+                                     std::vector<char*>& aLanguageList, IResourceWriterHttp& aResourceWriter)
+{
+    static const Brn kGzipExtension(".gz");
+    Bwh key;
+    MakeKey(key, aUdn, aUriTail, aInterface, aLanguageList);
+    // only look for a compressed copy on behalf of a client that could use it
+    const TBool isGzip = (aUriTail.Bytes() >= kGzipExtension.Bytes() &&
+                          Ascii::CaseInsensitiveEquals(aUriTail.Split(aUriTail.Bytes() - kGzipExtension.Bytes()), kGzipExtension));
+    const TBool probeGzip = (aResourceWriter.AcceptsGzip() && !isGzip);
+    Entry* entry = Find(key);
+    if (entry != NULL && probeGzip && !entry->GzipProbed()) {
+        // cached for clients which couldn't use gzip; fetch again, this time with any compressed copy
+        entry->RemoveRef();
+        entry = NULL;
+    }
+    if (entry == NULL) {
+        Capture capture(&aResourceWriter, iMaxEntryBytes);
+        aResourceManager.WriteResource(aUriTail, aInterface, aLanguageList, capture);
+        if (capture.Forwarded()) {
+            // uncacheable and (at least partly) written already; a second attempt would corrupt the response
             return;
         }
+        if (capture.Failed()) {
+            // manager wrote fewer/more bytes than it claimed; give up on caching and let it write directly
+            aResourceManager.WriteResource(aUriTail, aInterface, aLanguageList, aResourceWriter);
+            return;
+        }
+        if (!capture.Captured()) {
+            // not found
+            return;
+        }
+        Bwh gzipData;
+        if (probeGzip) {
+            Bwh gzipUri(aUriTail.Bytes() + kGzipExtension.Bytes());
+            gzipUri.Append(aUriTail);
+            gzipUri.Append(kGzipExtension);
+            Capture gzip(NULL, iMaxEntryBytes);
+            aResourceManager.WriteResource(gzipUri, aInterface, aLanguageList, gzip);
+            if (gzip.Captured()) {
+                gzip.Data().TransferTo(gzipData);
+            }
+        }
+        entry = new Entry(iEnv, key, capture.Data(), capture.MimeType(), gzipData, probeGzip);
+        Add(entry);
+    }
+    try {
+        Write(*entry, aResourceWriter);
+    }
+    catch (...) {
+        entry->RemoveRef();
+        throw;
+    }
+    entry->RemoveRef();
+}
+
+void DviResourceCache::Remove(const Brx& aUdn)
+{
+    if (!Enabled()) {
+        return;
+    }
+    iLock.Wait();
+    Map::iterator it = iMap.begin();
+    while (it != iMap.end()) {
+        const Brx& key = it->first;
+        if (key.Bytes() > aUdn.Bytes() && key[aUdn.Bytes()] == '/' && key.Split(0, aUdn.Bytes()) == aUdn) {
+            Entry* entry = it->second;
+            iBytes -= entry->Bytes();
+            iMap.erase(it++);
+            (void)iLru.erase(entry->LastUsed());
+            entry->RemoveRef();
+        }
+        else {
+            it++;
+        }
+    }
+    iLock.Signal();
+}
+
+void DviResourceCache::SetETag(const Brx& aContent, Bwx& aETag)
+{
+    // FNV-1a hash of the content plus its length.  Collisions would only cause a client
+    // to re-use a stale copy; including the length makes even that vanishingly unlikely.
+    TUint hash = 2166136261u;
+    const TByte* ptr = aContent.Ptr();
+    const TUint bytes = aContent.Bytes();
+    for (TUint i=0; i<bytes; i++) {
+        hash ^= ptr[i];
+        hash *= 16777619u;
+    }
+    aETag.SetBytes(0);
+    aETag.Append('"');
+    (void)Ascii::AppendHex(aETag, hash);
+    aETag.Append('-');
+    (void)Ascii::AppendHex(aETag, bytes);
+    aETag.Append('"');
+}
+
+void DviResourceCache::MakeKey(Bwh& aKey, const Brx& aUdn, const Brx& aUriTail, TIpAddress aInterface, std::vector<char*>& aLanguageList)
+{ // udn/uri|interface|languages - resource managers may write different content for each
+    TUint bytes = aUdn.Bytes() + 1 + aUriTail.Bytes() + 2 + 8;
+    for (TUint i=0; i<(TUint)aLanguageList.size(); i++) {
+        bytes += (TUint)strlen(aLanguageList[i]) + 1;
+    }
+    aKey.Grow(bytes);
+    aKey.Append(aUdn);
+    aKey.Append('/');
+    aKey.Append(aUriTail);
+    aKey.Append('|');
+    (void)Ascii::AppendHex(aKey, aInterface);
+    aKey.Append('|');
+    for (TUint i=0; i<(TUint)aLanguageList.size(); i++) {
+        aKey.Append(aLanguageList[i]);
+        aKey.Append(',');
+    }
+}
+
+DviResourceCache::Entry* DviResourceCache::Find(const Brx& aKey)
+{
+    Entry* entry = NULL;
+    iLock.Wait();
+    Brn key(aKey);
+    Map::iterator it = iMap.find(key);
+    if (it != iMap.end()) {
+        entry = it->second;
+        (void)iLru.erase(entry->LastUsed());
+        entry->SetLastUsed(++iSequence);
+        iLru.insert(std::pair<TUint,Entry*>(entry->LastUsed(), entry));
+        entry->AddRef();
+    }
+    iLock.Signal();
+    return entry;
+}
+
+void DviResourceCache::Add(Entry* aEntry)
+{ // on return, aEntry holds one reference for the caller (which it was created with) and another for the cache
+    iLock.Wait();
+    Brn key(aEntry->Key());
+    Map::iterator it = iMap.find(key);
+    if (it != iMap.end()) {
+        // another session fetched the same resource concurrently or a compressed copy has
+        // since been looked for; replace the old copy
+        RemoveLocked(it->second);
     }
+    EvictLocked(aEntry->Bytes());
+    aEntry->SetLastUsed(++iSequence);
+    aEntry->AddRef();
+    iMap.insert(std::pair<Brn,Entry*>(key, aEntry));
+    iLru.insert(std::pair<TUint,Entry*>(aEntry->LastUsed(), aEntry));
+    iBytes += aEntry->Bytes();
     iLock.Signal();
 }
+
+void DviResourceCache::RemoveLocked(Entry* aEntry)
+{
+    Brn key(aEntry->Key());
+    (void)iMap.erase(key);
+    (void)iLru.erase(aEntry->LastUsed());
+    iBytes -= aEntry->Bytes();
+    aEntry->RemoveRef();
+}
+
+void DviResourceCache::EvictLocked(TUint aBytes)
+{ // evict least recently used entries until aBytes more will fit
+    while (iBytes + aBytes > iMaxBytes && iLru.size() > 0) {
+        RemoveLocked(iLru.begin()->second);
+    }
+}
+
+void DviResourceCache::Write(Entry& aEntry, IResourceWriterHttp& aResourceWriter)
+{
+    const TBool gzip = (aEntry.HasGzip() && aResourceWriter.AcceptsGzip());
+    const Brx& etag = aEntry.ETag(gzip);
+    if (aResourceWriter.WriteNotModified(etag, aEntry.HasGzip())) {
+        return;
+    }
+    aResourceWriter.SetResourceHeaders(etag, gzip, aEntry.HasGzip());
+    const Brx& data = aEntry.Data(gzip);
+    aResourceWriter.WriteResourceBegin(data.Bytes(), aEntry.MimeType());
+    TUint offset, bytes;
+    aResourceWriter.GetRequiredRange(offset, bytes);
+    if (offset < data.Bytes() && bytes > 0) {
+        const TUint remaining = data.Bytes() - offset;
+        aResourceWriter.WriteResource(data.Ptr() + offset, (bytes < remaining? bytes : remaining));
+    }
+    aResourceWriter.WriteResourceEnd();
+}
+
+
+// DviResourceCache::Entry
+
+DviResourceCache::Entry::Entry(Environment& aEnv, Bwh& aKey, Bwh& aData, const Brx& aMimeType, Bwh& aGzip, TBool aGzipProbed)
+    : iEnv(aEnv)
+    , iRefCount(1)
+    , iMimeType(aMimeType)
+    , iGzipProbed(aGzipProbed)
+    , iLastUsed(0)
+{
+    aKey.TransferTo(iKey);
+    aData.TransferTo(iData);
+    aGzip.TransferTo(iGzip);
+    DviResourceCache::SetETag(iData, iETag);
+    if (iGzip.Bytes() > 0) {
+        DviResourceCache::SetETag(iGzip, iETagGzip);
+    }
+}
+
+DviResourceCache::Entry::~Entry()
+{
+}
+
+void DviResourceCache::Entry::AddRef()
+{
+    iEnv.Mutex().Wait();
+    iRefCount++;
+    iEnv.Mutex().Signal();
+}
+
+void DviResourceCache::Entry::RemoveRef()
+{
+    iEnv.Mutex().Wait();
+    TBool dead = (--iRefCount == 0);
+    iEnv.Mutex().Signal();
+    if (dead) {
+        delete this;
+    }
+}
+
+const Brx& DviResourceCache::Entry::Key() const
+{
+    return iKey;
+}
+
+TUint DviResourceCache::Entry::Bytes() const
+{
+    return iKey.Bytes() + iData.Bytes() + iGzip.Bytes();
+}
+
+TBool DviResourceCache::Entry::HasGzip() const
+{
+    return (iGzip.Bytes() > 0);
+}
+
+TBool DviResourceCache::Entry::GzipProbed() const
+{
+    return iGzipProbed;
+}
+
+const Brx& DviResourceCache::Entry::Data(TBool aGzip) const
+{
+    return (aGzip? iGzip : iData);
+}
+
+const Brx& DviResourceCache::Entry::ETag(TBool aGzip) const
+{
+    return (aGzip? iETagGzip : iETag);
+}
+
+const TChar* DviResourceCache::Entry::MimeType() const
+{
+    return (iMimeType.Bytes() == 0? NULL : iMimeType.CString());
+}
+
+TUint DviResourceCache::Entry::LastUsed() const
+{
+    return iLastUsed;
+}
+
+void DviResourceCache::Entry::SetLastUsed(TUint aLastUsed)
+{
+    iLastUsed = aLastUsed;
+}
+
+
+// DviResourceCache::Capture
+
+DviResourceCache::Capture::Capture(IResourceWriter* aPassThrough, TUint aMaxBytes)
+    : iPassThrough(aPassThrough)
+    , iMaxBytes(aMaxBytes)
+    , iTotalBytes(0)
+    , iState(eEmpty)
+    , iForwarded(false)
+{
+}
+
+TBool DviResourceCache::Capture::Forwarded() const
+{
+    return iForwarded;
+}
+
+TBool DviResourceCache::Capture::Captured() const
+{
+    return (iState == eCaptured);
+}
+
+TBool DviResourceCache::Capture::Failed() const
+{
+    return (iState == eFailed || iState == eCapturing);
+}
+
+Bwh& DviResourceCache::Capture::Data()
+{
+    return iData;
+}
+
+const Brx& DviResourceCache::Capture::MimeType() const
+{
+    return iMimeType;
+}
+
+void DviResourceCache::Capture::WriteResourceBegin(TUint aTotalBytes, const TChar* aMimeType)
+{
+    if (iState != eEmpty) {
+        iState = eFailed;
+        return;
+    }
+    if (aTotalBytes == 0 || aTotalBytes > iMaxBytes) {
+        if (iPassThrough == NULL) {
+            iState = eFailed;
+        }
+        else {
+            iState = eForwarding;
+            iForwarded = true;
+            iPassThrough->WriteResourceBegin(aTotalBytes, aMimeType);
+        }
+        return;
+    }
+    iState = eCapturing;
+    iTotalBytes = aTotalBytes;
+    iData.Grow(aTotalBytes);
+    if (aMimeType != NULL) {
+        iMimeType.Set(aMimeType);
+    }
+}
+
+void DviResourceCache::Capture::WriteResource(const TByte* aData, TUint aBytes)
+{
+    if (iState == eForwarding) {
+        iPassThrough->WriteResource(aData, aBytes);
+    }
+    else if (iState == eCapturing) {
+        if (iData.Bytes() + aBytes > iTotalBytes) {
+            iState = eFailed;
+        }
+        else {
+            iData.Append(aData, aBytes);
+        }
+    }
+}
+
+void DviResourceCache::Capture::GetRequiredRange(TUint& aOffset, TUint& aBytes)
+{
+    if (iState == eForwarding) {
+        iPassThrough->GetRequiredRange(aOffset, aBytes);
+    }
+    else {
+        IResourceWriter::GetRequiredRange(aOffset, aBytes);
+    }
+}
+
+void DviResourceCache::Capture::WriteResourceEnd()
+{
+    if (iState == eForwarding) {
+        iPassThrough->WriteResourceEnd();
+    }
+    else if (iState == eCapturing) {
+        iState = (iData.Bytes() == iTotalBytes? eCaptured : eFailed);
+    }
+}
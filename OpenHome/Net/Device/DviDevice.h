@@ -15,6 +15,8 @@
 namespace OpenHome {
 namespace Net {
 
+class IResourceWriterHttp;
+
 class IDvProtocol : public IResourceManager
 {
 public:
@@ -25,6 +27,33 @@ public:
     virtual void SetAttribute(const TChar* aKey, const TChar* aValue) = 0;
     virtual void SetCustomData(const TChar* aTag, void* aData) = 0;
     virtual void GetResourceManagerUri(const NetworkAdapter& aAdapter, Brh& aUri) = 0;
+    /**
+     * Returns false, having written nothing, if the resource isn't one the protocol can validate.
+     * Otherwise writes the resource, tagged with its current entity tag, or a 304 response if
+     * the client already holds that version, and returns true.
+     */
+    virtual TBool WriteValidatedResource(const Brx& aUriTail, TIpAddress aInterface, IResourceWriterHttp& aResourceWriter) = 0;
+};
+
+/**
+ * Extension of IResourceWriter for writers which can pass validators and content
+ * codings on to an HTTP client.  Used when serving resources from DviResourceCache.
+ */
+class IResourceWriterHttp : public IResourceWriter
+{
+public:
+    virtual TBool AcceptsGzip() const = 0;
+    /**
+     * Returns true, having written a complete response, if the client already holds the
+     * version of the resource identified by aETag.  Returns false otherwise.
+     * aVaryEncoding is as for SetResourceHeaders.
+     */
+    virtual TBool WriteNotModified(const Brx& aETag, TBool aVaryEncoding) = 0;
+    /**
+     * Headers to be added by the next call to WriteResourceBegin.
+     * aVaryEncoding is true if other requests could see a different Content-Encoding.
+     */
+    virtual void SetResourceHeaders(const Brx& aETag, TBool aGzipped, TBool aVaryEncoding) = 0;
 };
 
 class DviSubscription;
@@ -56,6 +85,7 @@ public:
     TBool IsRoot() const;
     DviDevice* Root() const;
     void WriteResource(const Brx& aUriTail, TIpAddress aInterface, std::vector<char*>& aLanguageList, IResourceWriter& aResourceWriter);
+    void WriteResource(const Brx& aUriTail, TIpAddress aInterface, std::vector<char*>& aLanguageList, IResourceWriterHttp& aResourceWriter);
     void GetUriBase(Bwx& aUriBase, TIpAddress aInterface, TUint aPort, IDvProtocol& aProtocol);
     TUint ConfigId();
     void CreateSid(Brh& aSid);
@@ -150,12 +180,117 @@ public:
     void Remove(DviDevice& aDevice);
     DviDevice* Find(const Brx& aUdn);
     void WriteResource(const Brx& aUriTail, TIpAddress aInterface, std::vector<char*>& aLanguageList, IResourceWriter& aResourceWriter);
+    void WriteResource(const Brx& aUriTail, TIpAddress aInterface, std::vector<char*>& aLanguageList, IResourceWriterHttp& aResourceWriter);
+private:
+    DviDevice* FindForResource(const Brx& aUriTail, Brn& aTail);
 private:
     typedef std::map<Brn,DviDevice*,BufferCmp> Map;
     Mutex iLock;
     Map iMap;
 };
 
+/**
+ * In-memory cache of resources written by devices' IResourceManagers.
+ *
+ * Only resources whose size is reported to WriteResourceBegin are cached.  If a resource
+ * manager also provides a gzip compressed copy of a resource at [uri].gz, this is served
+ * to clients which accept gzip content coding.  Cached resources are assumed static for
+ * as long as their device is enabled.
+ */
+class DviResourceCache : private INonCopyable
+{
+public:
+    static const TUint kMaxETagBytes = 20;
+public:
+    DviResourceCache(Environment& aEnv, TUint aMaxBytes);
+    ~DviResourceCache();
+    TBool Enabled() const;
+    void WriteResource(const Brx& aUdn, IResourceManager& aResourceManager, const Brx& aUriTail, TIpAddress aInterface,
+                       std::vector<char*>& aLanguageList, IResourceWriterHttp& aResourceWriter);
+    void Remove(const Brx& aUdn);
+    static void SetETag(const Brx& aContent, Bwx& aETag);
+private:
+    class Entry : private INonCopyable
+    {
+    public:
+        Entry(Environment& aEnv, Bwh& aKey, Bwh& aData, const Brx& aMimeType, Bwh& aGzip, TBool aGzipProbed);
+        void AddRef();
+        void RemoveRef();
+        const Brx& Key() const;
+        TUint Bytes() const;
+        TBool HasGzip() const;
+        TBool GzipProbed() const;
+        const Brx& Data(TBool aGzip) const;
+        const Brx& ETag(TBool aGzip) const;
+        const TChar* MimeType() const;
+        TUint LastUsed() const;
+        void SetLastUsed(TUint aLastUsed);
+    private:
+        ~Entry();
+    private:
+        Environment& iEnv;
+        TUint iRefCount;
+        Brh iKey;
+        Brh iData;
+        Brh iGzip;
+        Brhz iMimeType;
+        Bws<kMaxETagBytes> iETag;
+        Bws<kMaxETagBytes> iETagGzip;
+        TBool iGzipProbed; // false if nobody has yet looked for a compressed copy
+        TUint iLastUsed;
+    };
+    class Capture : public IResourceWriter, private INonCopyable
+    {
+    public:
+        Capture(IResourceWriter* aPassThrough, TUint aMaxBytes);
+        TBool Forwarded() const; // true if anything has been passed through, even if Failed()
+        TBool Captured() const;
+        TBool Failed() const;
+        Bwh& Data();
+        const Brx& MimeType() const;
+    private: // from IResourceWriter
+        void WriteResourceBegin(TUint aTotalBytes, const TChar* aMimeType);
+        void WriteResource(const TByte* aData, TUint aBytes);
+        void WriteResourceEnd();
+        void GetRequiredRange(TUint& aOffset, TUint& aBytes);
+    private:
+        enum EState
+        {
+            eEmpty
+           ,eCapturing
+           ,eCaptured
+           ,eForwarding
+           ,eFailed
+        };
+    private:
+        IResourceWriter* iPassThrough;
+        TUint iMaxBytes;
+        TUint iTotalBytes;
+        EState iState;
+        TBool iForwarded;
+        Bwh iData;
+        Brhz iMimeType;
+    };
+private:
+    void MakeKey(Bwh& aKey, const Brx& aUdn, const Brx& aUriTail, TIpAddress aInterface, std::vector<char*>& aLanguageList);
+    Entry* Find(const Brx& aKey);
+    void Add(Entry* aEntry);
+    void RemoveLocked(Entry* aEntry);
+    void EvictLocked(TUint aBytes);
+    void Write(Entry& aEntry, IResourceWriterHttp& aResourceWriter);
+private:
+    typedef std::map<Brn,Entry*,BufferCmp> Map;
+    typedef std::map<TUint,Entry*> LruMap; // keyed on Entry::LastUsed(), oldest first
+    Environment& iEnv;
+    Mutex iLock;
+    const TUint iMaxBytes;
+    const TUint iMaxEntryBytes;
+    TUint iBytes;
+    TUint iSequence;
+    Map iMap;
+    LruMap iLru;
+};
+
 } // namespace Net
 } // namespace OpenHome
 
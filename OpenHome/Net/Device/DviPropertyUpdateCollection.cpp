@@ -174,7 +174,8 @@ void PropertyWriter2::PropertyWriteBool(const Brx& aName, TBool aValue)
 
 void PropertyWriter2::PropertyWriteBinary(const Brx& aName, const Brx& aValue)
 {
-    WriterBwh writer(1024);
+    const TUint encodedBytes = Converter::Base64EncodedBytes(aValue.Bytes());
+    WriterBwh writer(encodedBytes > 0? encodedBytes : 1); // sized to avoid regrowing as aValue is encoded
     Converter::ToBase64(writer, aValue);
     iPropertyUpdate->Add(aName, writer);
 }
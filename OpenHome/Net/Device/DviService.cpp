@@ -66,6 +66,8 @@ FunctorDviInvocation DvAction::Functor() const
 
 // DviService
 
+const TUint DviService::kModerationInherit;
+
 DviService::DviService(DvStack& aDvStack, const TChar* aDomain, const TChar* aName, TUint aVersion)
     : Service(aDvStack.Env(), aDomain, aName, aVersion)
     , iDvStack(aDvStack)
@@ -75,13 +77,20 @@ DviService::DviService(DvStack& aDvStack, const TChar* aDomain, const TChar* aNa
     , iDisabled(true)
     , iCurrentInvocationCount(0)
     , iDisabledSem("DVSS", 0)
+    , iModerationMs(aDvStack.Env().InitParams().DvEventModerationMs())
+    , iModerationPending(false)
+    , iPublished(false)
+    , iLastPublishTime(0)
 {
+    iModerated = (iModerationMs != 0);
+    iModerationTimer = new Timer(iDvStack.Env(), MakeFunctor(*this, &DviService::ModerationTimerExpired));
     iDisabledSem.Signal();
     iDvStack.Env().AddObject(this);
 }
 
 DviService::~DviService()
 {
+    delete iModerationTimer;
     StopSubscriptions();
     iLock.Wait();
     TUint i=0;
@@ -217,6 +226,8 @@ void DviService::PropertiesUnlock()
 void DviService::AddProperty(Property* aProperty)
 {
     iProperties.push_back(aProperty);
+    iPropertyModerationMs.push_back(kModerationInherit);
+    iPublishedSequenceNumbers.push_back(0);
 }
 
 const std::vector<Property*>& DviService::Properties() const
@@ -227,9 +238,52 @@ const std::vector<Property*>& DviService::Properties() const
 void DviService::PublishPropertyUpdates()
 {
     iLock.Wait();
-    for (TUint i=0; i<iSubscriptions.size(); i++) {
-        ASSERT(PropertiesInitialised());
-        iDvStack.SubscriptionManager().QueueUpdate(*(iSubscriptions[i]));
+    if (!iModerated) {
+        for (TUint i=0; i<iSubscriptions.size(); i++) {
+            ASSERT(PropertiesInitialised());
+            iDvStack.SubscriptionManager().QueueUpdate(*(iSubscriptions[i]));
+        }
+    }
+    else if (!iModerationPending) {
+        // changes made within the moderation window of the last publication are held back
+        // until the window expires, then published together
+        TUint interval = 0;
+        (void)ModerationWindowLocked(interval);
+        if (interval == 0 || !iPublished || Time::IsInPastOrNow(iDvStack.Env(), iLastPublishTime + interval)) {
+            PublishLocked();
+        }
+        else {
+            iModerationPending = true;
+            iModerationTimer->FireAt(iLastPublishTime + interval);
+        }
+    }
+    // else; these changes will be included in the already scheduled publication
+    iLock.Signal();
+}
+
+void DviService::SetModerationMs(TUint aIntervalMs)
+{
+    iLock.Wait();
+    iModerationMs = aIntervalMs;
+    if (aIntervalMs != 0) {
+        iModerated = true;
+    }
+    iLock.Signal();
+}
+
+void DviService::SetPropertyModerationMs(const Brx& aPropertyName, TUint aIntervalMs)
+{
+    iLock.Wait();
+    TUint i;
+    for (i=0; i<iProperties.size(); i++) {
+        if (iProperties[i]->Parameter().Name() == aPropertyName) {
+            iPropertyModerationMs[i] = aIntervalMs;
+            break;
+        }
+    }
+    ASSERT(i < iProperties.size());
+    if (aIntervalMs != 0) {
+        iModerated = true;
     }
     iLock.Signal();
 }
@@ -270,6 +324,62 @@ TBool DviService::PropertiesInitialised() const
     return true;
 }
 
+TBool DviService::ModerationWindowLocked(TUint& aIntervalMs) const
+{
+    // the window is the shortest of those configured for the properties changed since the last publication
+    TBool changed = false;
+    iPropertiesLock.Wait(); // sequence numbers are updated by property setters
+    for (TUint i=0; i<iProperties.size(); i++) {
+        if (iProperties[i]->SequenceNumber() != iPublishedSequenceNumbers[i]) {
+            TUint interval = iPropertyModerationMs[i];
+            if (interval == kModerationInherit) {
+                interval = iModerationMs;
+            }
+            if (!changed || interval < aIntervalMs) {
+                aIntervalMs = interval;
+            }
+            changed = true;
+        }
+    }
+    iPropertiesLock.Signal();
+    return changed;
+}
+
+void DviService::PublishLocked()
+{
+    // note sequence numbers before queueing so that any later change is seen as unpublished
+    TBool changed = false;
+    iPropertiesLock.Wait();
+    for (TUint i=0; i<iProperties.size(); i++) {
+        const TUint seq = iProperties[i]->SequenceNumber();
+        if (seq != iPublishedSequenceNumbers[i]) {
+            iPublishedSequenceNumbers[i] = seq;
+            changed = true;
+        }
+    }
+    iPropertiesLock.Signal();
+    for (TUint i=0; i<iSubscriptions.size(); i++) {
+        ASSERT(PropertiesInitialised());
+        iDvStack.SubscriptionManager().QueueUpdate(*(iSubscriptions[i]));
+    }
+    if (changed) {
+        // publications with nothing new to report (e.g. on device enable) don't open a window
+        iPublished = true;
+        iLastPublishTime = Time::Now(iDvStack.Env());
+    }
+}
+
+void DviService::ModerationTimerExpired()
+{
+    iLock.Wait();
+    iModerationPending = false;
+    TUint interval;
+    if (ModerationWindowLocked(interval)) {
+        PublishLocked();
+    }
+    iLock.Signal();
+}
+
 void DviService::ListObjectDetails() const
 {
     Log::Print("  DviService: addr=%p, serviceType=", this);
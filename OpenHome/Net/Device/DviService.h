@@ -12,6 +12,7 @@
 #include <OpenHome/Private/Thread.h>
 #include <OpenHome/Net/Core/DvInvocationResponse.h>
 #include <OpenHome/Net/Core/OhNet.h>
+#include <OpenHome/Private/Timer.h>
 
 #include <vector>
 
@@ -74,6 +75,7 @@ class DvStack;
 
 class DviService : public Service, private IStackObject
 {
+    static const TUint kModerationInherit = 0xffffffff;
 public:
     DviService(DvStack& aDvStack, const TChar* aDomain, const TChar* aName, TUint aVersion);
     void AddRef();
@@ -91,6 +93,8 @@ public:
     DllExport void AddProperty(Property* aProperty);
     const std::vector<Property*>& Properties() const;
     void PublishPropertyUpdates();
+    void SetModerationMs(TUint aIntervalMs);
+    void SetPropertyModerationMs(const Brx& aPropertyName, TUint aIntervalMs);
 
     void AddSubscription(DviSubscription* aSubscription);
     void RemoveSubscription(const Brx& aSid);
@@ -98,19 +102,30 @@ private:
     ~DviService();
     void InvocationCompleted();
     TBool PropertiesInitialised() const;
+    TBool ModerationWindowLocked(TUint& aIntervalMs) const;
+    void PublishLocked();
+    void ModerationTimerExpired();
 private: // from IStackObject
     void ListObjectDetails() const;
 private:
     DvStack& iDvStack;
     Mutex iLock;
     TUint iRefCount;
-    Mutex iPropertiesLock;
+    mutable Mutex iPropertiesLock; // may be claimed while iLock is held; never the other way round
     std::vector<DvAction> iDvActions;
     std::vector<Property*> iProperties;
     std::vector<DviSubscription*> iSubscriptions;
     TBool iDisabled;
     TUint iCurrentInvocationCount;
     Semaphore iDisabledSem;
+    Timer* iModerationTimer;
+    TUint iModerationMs;
+    TBool iModerated;
+    std::vector<TUint> iPropertyModerationMs;
+    std::vector<TUint> iPublishedSequenceNumbers;
+    TBool iModerationPending;
+    TBool iPublished;
+    TUint iLastPublishTime;
 };
 
 class DllExportClass DviInvocation : public IDvInvocation, private INonCopyable
@@ -21,11 +21,14 @@ DvStack::DvStack(OpenHome::Environment& aEnv)
     , iMdns(NULL)
 {
     iEnv.SetDvStack(this);
+    const TUint eventKeepAliveMs = iEnv.InitParams().DvEventKeepAliveIdleTimeoutMs();
+    iEventConnectionPool = new SocketTcpClientPool(iEnv, (eventKeepAliveMs==0? 0 : 1), eventKeepAliveMs);
     iSsdpNotifierManager = new DviSsdpNotifierManager(*this);
     iPropertyUpdateCollection = new DviPropertyUpdateCollection(*this);
     TUint port = iEnv.InitParams().DvUpnpServerPort();
     iDviServerUpnp = new DviServerUpnp(*this, port);
     iDviDeviceMap = new DviDeviceMap;
+    iResourceCache = new DviResourceCache(iEnv, iEnv.InitParams().DvResourceCacheBytes());
     iSubscriptionManager = new DviSubscriptionManager(*this);
     iDviServerWebSocket = new DviServerWebSocket(*this);
     if (iEnv.InitParams().DvIsBonjourEnabled()) {
@@ -39,9 +42,11 @@ DvStack::~DvStack()
     delete iDviServerWebSocket;
     delete iDviServerUpnp;
     delete iDviDeviceMap;
+    delete iResourceCache;
     delete iSubscriptionManager;
     delete iPropertyUpdateCollection;
     delete iSsdpNotifierManager;
+    delete iEventConnectionPool;
 }
 
 TUint DvStack::BootId()
@@ -81,6 +86,11 @@ DviDeviceMap& DvStack::DeviceMap()
     return *iDviDeviceMap;
 }
 
+DviResourceCache& DvStack::ResourceCache()
+{
+    return *iResourceCache;
+}
+
 DviSubscriptionManager& DvStack::SubscriptionManager()
 {
     return *iSubscriptionManager;
@@ -100,3 +110,8 @@ DviSsdpNotifierManager& DvStack::SsdpNotifierManager()
 {
     return *iSsdpNotifierManager;
 }
+
+SocketTcpClientPool& DvStack::EventConnectionPool()
+{
+    return *iEventConnectionPool;
+}
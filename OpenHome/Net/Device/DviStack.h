@@ -34,10 +34,12 @@ public:
     void UpdateBootId();
     DviServerUpnp& ServerUpnp();
     DviDeviceMap& DeviceMap();
+    DviResourceCache& ResourceCache();
     DviSubscriptionManager& SubscriptionManager();
     IMdnsProvider* MdnsProvider();
     DviPropertyUpdateCollection& PropertyUpdateCollection();
     DviSsdpNotifierManager& SsdpNotifierManager();
+    SocketTcpClientPool& EventConnectionPool();
 private:
     ~DvStack();
 private:
@@ -46,11 +48,13 @@ private:
     TUint iNextBootId;
     DviServerUpnp* iDviServerUpnp;
     DviDeviceMap* iDviDeviceMap;
+    DviResourceCache* iResourceCache;
     DviSubscriptionManager* iSubscriptionManager;
     DviServerWebSocket* iDviServerWebSocket;
     IMdnsProvider* iMdns;
     DviPropertyUpdateCollection* iPropertyUpdateCollection;
     DviSsdpNotifierManager* iSsdpNotifierManager;
+    SocketTcpClientPool* iEventConnectionPool;
 };
 
 } // namespace Net
@@ -44,6 +44,7 @@ DviSubscription::DviSubscription(DvStack& aDvStack, DviDevice& aDevice, IPropert
                                  IDviSubscriptionUserData* aUserData, Brh& aSid, TUint& aDurationSecs)
     : iDvStack(aDvStack)
     , iLock("MDSB")
+    , iWriteLock("MDSW")
     , iRefCount(1)
     , iDevice(aDevice)
     , iWriterFactory(aWriterFactory)
@@ -153,13 +154,20 @@ void DviSubscription::DoRenew(TUint& aSeconds)
 
 void DviSubscription::WriteChanges()
 {
+    // iWriteLock fully serialises updates to a single subscriber, keeping them in SEQ order.
+    // iLock is only held while changes are gathered, not while we connect to (and wait
+    // on) the subscriber, so a slow subscriber doesn't block Stop(), Renew() etc.
+    AutoMutex w(iWriteLock);
     IPropertyWriter* writer = NULL;
     try {
-        AutoMutex a(iLock); // claim lock here to fully serialise updates to a single subscriber
-        writer = CreateWriter();
+        {
+            AutoMutex a(iLock);
+            writer = CreateWriter();
+        }
         if (writer != NULL) {
             writer->PropertyWriteEnd();
             delete writer;
+            writer = NULL;
         }
     }
     catch(NetworkTimeout&) {
@@ -172,6 +180,7 @@ void DviSubscription::WriteChanges()
     catch(HttpError&) {}
     catch(WriterError&) {}
     catch(ReaderError&) {}
+    delete writer; // only non-NULL if PropertyWriteEnd() threw
 }
 
 IPropertyWriter* DviSubscription::CreateWriter()
@@ -318,7 +327,8 @@ void PropertyWriter::PropertyWriteBool(const Brx& aName, TBool aValue)
 
 void PropertyWriter::PropertyWriteBinary(const Brx& aName, const Brx& aValue)
 {
-    WriterBwh writer(1024);
+    const TUint encodedBytes = Converter::Base64EncodedBytes(aValue.Bytes());
+    WriterBwh writer(encodedBytes > 0? encodedBytes : 1); // sized to avoid regrowing as aValue is encoded
     Converter::ToBase64(writer, aValue);
     Brh buf;
     writer.TransferTo(buf);
@@ -398,7 +408,7 @@ DviSubscriptionManager::DviSubscriptionManager(DvStack& aDvStack)
     : Thread("DVSM")
     , iDvStack(aDvStack)
     , iLock("DSBM")
-    , iFree(aDvStack.Env().InitParams().DvNumPublisherThreads())
+    , iFree(aDvStack.Env().InitParams().DvNumPublisherThreads(), EFifoSignalOnDemand)
 {
     const TUint numPublisherThreads = iDvStack.Env().InitParams().DvNumPublisherThreads();
     LOG(kDvEvent, "> DviSubscriptionManager: creating %u publisher threads\n", numPublisherThreads);
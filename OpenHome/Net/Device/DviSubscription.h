@@ -67,6 +67,7 @@ private:
 private:
     DvStack& iDvStack;
     mutable Mutex iLock;
+    Mutex iWriteLock;
     TUint iRefCount;
     DviDevice& iDevice;
     IPropertyWriterFactory& iWriterFactory;
@@ -232,3 +232,8 @@ const Brx& DeviceBasic::Udn() const
 {
     return iDevice->Udn();
 }
+
+void DeviceBasic::SetEventModerationMs(TUint aIntervalMs)
+{
+    iTestBasic->SetEventModerationMs(aIntervalMs);
+}
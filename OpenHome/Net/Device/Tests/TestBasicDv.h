@@ -41,6 +41,7 @@ public:
     DeviceBasic(DvStack& aDvStack);
     ~DeviceBasic();
     const Brx& Udn() const;
+    void SetEventModerationMs(TUint aIntervalMs);
 private:
     DvDeviceStandard* iDevice;
     ProviderTestBasic* iTestBasic;
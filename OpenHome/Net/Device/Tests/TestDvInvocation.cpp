@@ -11,6 +11,11 @@
 #include <OpenHome/Private/Ascii.h>
 #include <OpenHome/Private/Env.h>
 #include <OpenHome/Net/Private/DviStack.h>
+#include <OpenHome/Private/Network.h>
+#include <OpenHome/Private/Http.h>
+#include <OpenHome/Private/Stream.h>
+#include <OpenHome/Private/Uri.h>
+#include <OpenHome/Private/Converter.h>
 
 #include <vector>
 
@@ -28,6 +33,7 @@ public:
     CpDevices(Semaphore& aAddedSem, const Brx& aTargetUdn);
     ~CpDevices();
     void Test();
+    void GetLocation(Brh& aLocation);
     void Added(CpDevice& aDevice);
     void Removed(CpDevice& aDevice);
 private:
@@ -37,6 +43,39 @@ private:
     const Brx& iTargetUdn;
 };
 
+/**
+ * Sends hand written SOAP requests over a single connection, allowing tests of the
+ * device server's handling of persistent connections and of chunked request bodies.
+ * A new connection is opened if the previous response closed the last one.
+ */
+class SoapConnection : private INonCopyable
+{
+public:
+    SoapConnection(Environment& aEnv, const Brx& aLocation, const Brx& aUdn);
+    ~SoapConnection();
+    TUint Increment(TUint aValue, TBool aChunked);
+    void EchoString(const Brx& aValue, TBool aChunked, Bwh& aResult);
+    TBool KeptAlive() const; // the last response left the connection open
+    void Invoke(const Brx& aAction, const Brx& aArgs, TBool aChunked);
+    Brn Output(const Brx& aName) const; // value of an output argument, still escaped
+private:
+    void Connect();
+private:
+    static const TUint kReadBufferBytes = 4 * 1024;
+    static const TUint kReadTimeoutMs = 5 * 1000;
+    Environment& iEnv;
+    Uri iUri;
+    Bwh iPath;
+    SocketTcpClient iSocket;
+    Srs<kReadBufferBytes> iReadBuffer;
+    ReaderHttpResponse iReaderResponse;
+    HttpHeaderContentLength iHeaderContentLength;
+    HttpHeaderTransferEncoding iHeaderTransferEncoding;
+    HttpHeaderConnection iHeaderConnection;
+    Bwh iResponse;
+    TBool iKeptAlive;
+};
+
 } // namespace TestDvInvocation
 } // namespace OpenHome
 
@@ -118,6 +157,12 @@ void CpDevices::Test()
     delete proxy;
 }
 
+void CpDevices::GetLocation(Brh& aLocation)
+{
+    ASSERT(iList.size() != 0);
+    ASSERT(iList[0]->GetAttribute("Upnp.Location", aLocation));
+}
+
 void CpDevices::Added(CpDevice& aDevice)
 {
     iLock.Wait();
@@ -134,6 +179,262 @@ void CpDevices::Removed(CpDevice& /*aDevice*/)
 }
 
 
+SoapConnection::SoapConnection(Environment& aEnv, const Brx& aLocation, const Brx& aUdn)
+    : iEnv(aEnv)
+    , iUri(aLocation)
+    , iReadBuffer(iSocket)
+    , iReaderResponse(aEnv, iReadBuffer)
+    , iKeptAlive(true)
+{
+    const Brn kControlPath("/openhome.org-TestBasic-1/control");
+    iPath.Grow(1 + aUdn.Bytes() + kControlPath.Bytes());
+    iPath.Append('/');
+    iPath.Append(aUdn);
+    iPath.Append(kControlPath);
+    iReaderResponse.AddHeader(iHeaderContentLength);
+    iReaderResponse.AddHeader(iHeaderTransferEncoding);
+    iReaderResponse.AddHeader(iHeaderConnection);
+    Connect();
+}
+
+SoapConnection::~SoapConnection()
+{
+    try {
+        iSocket.Close();
+    }
+    catch (NetworkError&) {}
+}
+
+TUint SoapConnection::Increment(TUint aValue, TBool aChunked)
+{
+    Bws<32> args("<Value>");
+    Ascii::AppendDec(args, aValue);
+    args.Append("</Value>");
+    Invoke(Brn("Increment"), args, aChunked);
+    return Ascii::Uint(Output(Brn("Result")));
+}
+
+void SoapConnection::EchoString(const Brx& aValue, TBool aChunked, Bwh& aResult)
+{
+    // aValue is assumed not to need escaping
+    Bwh args(aValue.Bytes() + 32);
+    args.Append("<Value>");
+    args.Append(aValue);
+    args.Append("</Value>");
+    Invoke(Brn("EchoString"), args, aChunked);
+    Brn result = Output(Brn("Result"));
+    aResult.Grow(result.Bytes());
+    aResult.Replace(result);
+}
+
+TBool SoapConnection::KeptAlive() const
+{
+    return iKeptAlive;
+}
+
+void SoapConnection::Invoke(const Brx& aAction, const Brx& aArgs, TBool aChunked)
+{
+    if (!iKeptAlive) {
+        iSocket.Close();
+        iReadBuffer.ReadFlush();
+        Connect();
+    }
+    const Brn kServiceType("urn:openhome-org:service:TestBasic:1");
+    Bwh body(1024 + aArgs.Bytes());
+    body.Append("<?xml version=\"1.0\"?><s:Envelope xmlns:s=\"http://schemas.xmlsoap.org/soap/envelope/\" s:encodingStyle=\"http://schemas.xmlsoap.org/soap/encoding/\"><s:Body><u:");
+    body.Append(aAction);
+    body.Append(" xmlns:u=\"");
+    body.Append(kServiceType);
+    body.Append("\">");
+    body.Append(aArgs);
+    body.Append("</u:");
+    body.Append(aAction);
+    body.Append("></s:Body></s:Envelope>");
+
+    Sws<1024> writeBuffer(iSocket);
+    WriterHttpRequest writerRequest(writeBuffer);
+    writerRequest.WriteMethod(Http::kMethodPost, iPath, Http::eHttp11);
+    Http::WriteHeaderHostAndPort(writerRequest, iUri);
+    Http::WriteHeaderContentType(writerRequest, Brn("text/xml; charset=\"utf-8\""));
+    if (aChunked) {
+        writerRequest.WriteHeader(Http::kHeaderTransferEncoding, Http::kTransferEncodingChunked);
+    }
+    else {
+        Http::WriteHeaderContentLength(writerRequest, body.Bytes());
+    }
+    IWriterAscii& writerField = writerRequest.WriteHeaderField(Brn("SOAPACTION"));
+    writerField.Write('\"');
+    writerField.Write(kServiceType);
+    writerField.Write('#');
+    writerField.Write(aAction);
+    writerField.Write('\"');
+    writerField.WriteNewline();
+    writerField.WriteNewline();
+    if (aChunked) {
+        // split the body over several chunks
+        const TUint kChunkBytes = 1000;
+        for (TUint offset=0; offset<body.Bytes(); offset+=kChunkBytes) {
+            const TUint remaining = body.Bytes() - offset;
+            const TUint bytes = (remaining<kChunkBytes? remaining : kChunkBytes);
+            Bws<Ascii::kMaxUintStringBytes> chunkSize;
+            (void)Ascii::AppendHexTrim(chunkSize, bytes);
+            writeBuffer.Write(chunkSize);
+            writeBuffer.Write(Http::kHeaderTerminator);
+            writeBuffer.Write(body.Split(offset, bytes));
+            writeBuffer.Write(Http::kHeaderTerminator);
+        }
+        writeBuffer.Write('0');
+        writeBuffer.Write(Http::kHeaderTerminator);
+        writeBuffer.Write(Http::kHeaderTerminator);
+        writeBuffer.WriteFlush();
+    }
+    else {
+        writeBuffer.Write(body);
+        writeBuffer.WriteFlush();
+    }
+
+    iReaderResponse.Read(kReadTimeoutMs);
+    ASSERT(iReaderResponse.Status() == HttpStatus::kOk);
+    iKeptAlive = (iReaderResponse.Version() == Http::eHttp11 && !iHeaderConnection.Close());
+    iResponse.SetBytes(0);
+    if (iHeaderTransferEncoding.IsChunked()) {
+        ReaderHttpChunked dechunker(iReadBuffer);
+        dechunker.Read();
+        dechunker.TransferTo(iResponse);
+        for (;;) { // consume any trailers so the next response can be read
+            if (Ascii::Trim(iReadBuffer.ReadUntil(Ascii::kLf)).Bytes() == 0) {
+                break;
+            }
+        }
+    }
+    else {
+        TUint remaining = iHeaderContentLength.ContentLength();
+        iResponse.Grow(remaining);
+        while (remaining > 0) {
+            const TUint bytes = (remaining<kReadBufferBytes? remaining : kReadBufferBytes);
+            iResponse.Append(iReadBuffer.Read(bytes));
+            remaining -= bytes;
+        }
+    }
+}
+
+void SoapConnection::Connect()
+{
+    Endpoint endpoint(iUri.Port(), iUri.Host());
+    iSocket.Open(iEnv);
+    iSocket.Connect(endpoint, iEnv.InitParams().TcpConnectTimeoutMs());
+}
+
+Brn SoapConnection::Output(const Brx& aName) const
+{
+    Bwh tag(aName.Bytes() + 3);
+    tag.Append('<');
+    tag.Append(aName);
+    tag.Append('>');
+    TUint start = 0;
+    while (iResponse.Split(start, tag.Bytes()) != tag) {
+        ASSERT(++start + tag.Bytes() <= iResponse.Bytes());
+    }
+    start += tag.Bytes();
+    TUint end = start;
+    while (iResponse[end] != '<') {
+        ASSERT(++end < iResponse.Bytes());
+    }
+    return iResponse.Split(start, end - start);
+}
+
+static void TestArguments(DvStack& aDvStack, const Brx& aLocation, const Brx& aUdn)
+{
+    Print("Argument order and escaping...\n");
+    SoapConnection* conn = new SoapConnection(aDvStack.Env(), aLocation, aUdn);
+    // arguments may arrive in any order, separated by whitespace
+    conn->Invoke(Brn("SetMultiple"), Brn("\r\n  <ValueBool>1</ValueBool>\n  <ValueInt>-12</ValueInt> <ValueUint>34</ValueUint>\r\n"), false);
+    conn->Invoke(Brn("GetUint"), Brx::Empty(), false);
+    ASSERT(conn->Output(Brn("ValueUint")) == Brn("34"));
+    conn->Invoke(Brn("GetInt"), Brx::Empty(), false);
+    ASSERT(conn->Output(Brn("ValueInt")) == Brn("-12"));
+    conn->Invoke(Brn("GetBool"), Brx::Empty(), false);
+    ASSERT(conn->Output(Brn("ValueBool")) == Brn("true"));
+    conn->Invoke(Brn("SetMultiple"), Brn("<ValueInt>5</ValueInt><ValueUint>6</ValueUint><ValueBool>0</ValueBool>"), true);
+    conn->Invoke(Brn("GetUint"), Brx::Empty(), false);
+    ASSERT(conn->Output(Brn("ValueUint")) == Brn("6"));
+    conn->Invoke(Brn("GetInt"), Brx::Empty(), false);
+    ASSERT(conn->Output(Brn("ValueInt")) == Brn("5"));
+
+    /* the device stores the unescaped value then escapes it again for the response;
+       a value stored without unescaping would come back double escaped */
+    const Brn kEscaped("a &lt;b&gt; &amp; &quot;c&quot;");
+    Bws<64> args("<ValueStr>");
+    args.Append(kEscaped);
+    args.Append("</ValueStr>");
+    conn->Invoke(Brn("SetString"), args, false);
+    conn->Invoke(Brn("GetString"), Brx::Empty(), false);
+    Brn result = conn->Output(Brn("ValueStr"));
+    Bwh unescaped(result);
+    Converter::FromXmlEscaped(unescaped);
+    ASSERT(unescaped == Brn("a <b> & \"c\""));
+    delete conn;
+}
+
+static void TestLargeBodies(DvStack& aDvStack, const Brx& aLocation, const Brx& aUdn)
+{
+    Print("Large request bodies...\n");
+    // larger than the initial read buffer used with adaptive session buffers
+    const TUint kLargeBytes = 20 * 1024;
+    Bwh large(kLargeBytes);
+    for (TUint i=0; i<kLargeBytes; i++) {
+        large.Append((TByte)('a' + i%26));
+    }
+    SoapConnection* conn = new SoapConnection(aDvStack.Env(), aLocation, aUdn);
+    Bwh result;
+    for (TUint i=0; i<2; i++) {
+        conn->EchoString(large, false, result);
+        ASSERT(result == large);
+        conn->EchoString(large, true, result);
+        ASSERT(result == large);
+        // enough small requests for an adaptive buffer to shrink again before the next large ones
+        for (TUint j=0; j<20; j++) {
+            ASSERT(conn->Increment(j, (j%2 == 1)) == j+1);
+        }
+    }
+    delete conn;
+}
+
+static void TestPersistentConnections(DvStack& aDvStack, const Brx& aLocation, const Brx& aUdn)
+{
+    InitialisationParams& initParams = aDvStack.Env().InitParams();
+    Print("Persistent connections...\n");
+    SoapConnection* conn = new SoapConnection(aDvStack.Env(), aLocation, aUdn);
+    TUint val = 7;
+    for (TUint i=0; i<6; i++) {
+        // alternate between Content-Length and chunked request bodies
+        const TUint result = conn->Increment(val, (i%2 == 1));
+        ASSERT(result == val+1);
+        ASSERT(conn->KeptAlive());
+        val = result;
+    }
+    delete conn;
+
+    if (!initParams.UseEventDrivenTcpServers()) {
+        return;
+    }
+    /* Idle connections are parked with the server so many more connections than
+       server threads can be kept open.  If any were left holding a session, later
+       requests would only be served once an earlier connection timed out. */
+    Print("Parked connections...\n");
+    std::vector<SoapConnection*> conns;
+    const TUint count = initParams.DvNumServerThreads() + 2;
+    for (TUint i=0; i<count; i++) {
+        conns.push_back(new SoapConnection(aDvStack.Env(), aLocation, aUdn));
+        ASSERT(conns[i]->Increment(i, true) == i+1);
+        ASSERT(conns[i]->KeptAlive());
+    }
+    for (TUint i=0; i<count; i++) {
+        ASSERT(conns[i]->Increment(i, false) == i+1);
+        delete conns[i];
+    }
+}
+
 void TestDvInvocation(CpStack& aCpStack, DvStack& aDvStack)
 {
     InitialisationParams& initParams = aDvStack.Env().InitParams();
@@ -152,9 +453,16 @@ void TestDvInvocation(CpStack& aCpStack, DvStack& aDvStack)
     CpDeviceListUpnpServiceType* list =
                 new CpDeviceListUpnpServiceType(aCpStack, domainName, serviceType, ver, added, removed);
     sem->Wait(30*1000); // allow up to 30 seconds to find our one device
-    delete sem;
     deviceList->Test();
+    Brh location;
+    deviceList->GetLocation(location);
+    TestArguments(aDvStack, location, device->Udn());
+    TestLargeBodies(aDvStack, location, device->Udn());
+    if (initParams.DvKeepAliveIdleTimeoutMs() > 0) {
+        TestPersistentConnections(aDvStack, location, device->Udn());
+    }
     delete list;
+    delete sem; // list may report the device again (e.g. after a byebye/alive) until it is deleted
     delete deviceList;
     delete device;
 
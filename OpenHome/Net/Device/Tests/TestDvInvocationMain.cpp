@@ -15,12 +15,24 @@ void OpenHome::TestFramework::Runner::Main(TInt aArgc, TChar* aArgv[], Net::Init
     OptionParser parser;
     OptionBool loopback("-l", "--loopback", "Use the loopback adapter only");
     parser.AddOption(&loopback);
+    OptionBool keepAlive("-k", "--keepalive", "Use persistent and pooled connections with event driven servers");
+    parser.AddOption(&keepAlive);
+    OptionBool adaptive("-a", "--adaptive", "Start session read buffers small, growing them for larger requests");
+    parser.AddOption(&adaptive);
     if (!parser.Parse(aArgc, aArgv) || parser.HelpDisplayed()) {
         return;
     }
     if (loopback.Value()) {
         aInitParams->SetUseLoopbackNetworkAdapter();
     }
+    if (keepAlive.Value()) {
+        aInitParams->SetEventDrivenTcpServers();
+        aInitParams->SetDvKeepAlive(30*1000, 100);
+        aInitParams->SetCpConnectionPool(2, 10*1000);
+    }
+    if (adaptive.Value()) {
+        aInitParams->SetAdaptiveSessionBuffers();
+    }
     aInitParams->SetDvUpnpServerPort(0);
     Library* lib = new Library(aInitParams);
     std::vector<NetworkAdapter*>* subnetList = lib->CreateSubnetList();
@@ -0,0 +1,671 @@
+#include <OpenHome/Private/TestFramework.h>
+#include <OpenHome/OhNetTypes.h>
+#include <OpenHome/Net/Core/OhNet.h>
+#include <OpenHome/Net/Private/DviDevice.h>
+#include <OpenHome/Net/Private/DviService.h>
+#include <OpenHome/Net/Private/DviStack.h>
+#include <OpenHome/Net/Private/DviServerUpnp.h>
+#include <OpenHome/Private/Env.h>
+#include <OpenHome/Private/Network.h>
+#include <OpenHome/Private/NetworkAdapterList.h>
+#include <OpenHome/Private/Http.h>
+#include <OpenHome/Private/Stream.h>
+#include <OpenHome/Private/Ascii.h>
+#include <OpenHome/Private/Thread.h>
+
+using namespace OpenHome;
+using namespace OpenHome::Net;
+using namespace OpenHome::TestFramework;
+
+static const TChar* kAdapterCookie = "TestDvResources";
+
+/**
+ * Records the value of a single header
+ */
+class HttpHeaderValue : public HttpHeader
+{
+public:
+    HttpHeaderValue(const Brx& aField);
+    const Brx& Value() const;
+private:
+    TBool Recognise(const Brx& aHeader);
+    void Process(const Brx& aValue);
+private:
+    Brn iField;
+    Bws<64> iValue;
+};
+
+/**
+ * Issues GET requests to the device server, one per connection.
+ */
+class HttpGetter : private INonCopyable
+{
+public:
+    HttpGetter(DvStack& aDvStack);
+    // returns the response status code
+    TUint Get(const Brx& aPath, const Brx& aIfNoneMatch = Brx::Empty(), const Brx& aAcceptEncoding = Brx::Empty());
+    const Brx& ETag() const { return (iHeaderETag.Received()? iHeaderETag.ETag() : Brx::Empty()); }
+    const Brx& ContentEncoding() const { return iHeaderContentEncoding.Value(); }
+    const Brx& Vary() const { return iHeaderVary.Value(); }
+    const Brx& Body() const { return iBody; }
+private:
+    static const TUint kReadBufferBytes = 4 * 1024;
+    static const TUint kReadTimeoutMs = 5 * 1000;
+    Environment& iEnv;
+    Endpoint iEndpoint;
+    HttpHeaderContentLength iHeaderContentLength;
+    HttpHeaderTransferEncoding iHeaderTransferEncoding;
+    HttpHeaderETag iHeaderETag;
+    HttpHeaderValue iHeaderContentEncoding;
+    HttpHeaderValue iHeaderVary;
+    Bwh iBody;
+};
+
+class SuiteDeviceXml : public Suite, private INonCopyable
+{
+public:
+    SuiteDeviceXml(DvStack& aDvStack);
+    ~SuiteDeviceXml();
+    void Test();
+private:
+    static void AddService(DviDevice* aDevice, DviService* aService);
+    static void Path(const Brx& aUdn, const Brx& aTail, Bwh& aPath);
+    void Disabled();
+private:
+    DvStack& iDvStack;
+    Semaphore iSem;
+    Bwh iNameRoot;
+    Bwh iNameEmbedded;
+    DviDevice* iRoot;
+    DviDevice* iEmbedded;
+};
+
+/**
+ * Serves a fixed set of resources, counting requests for each.
+ */
+class ResourceManager : public IResourceManager, private INonCopyable
+{
+public:
+    enum EResource
+    {
+        eSmall
+       ,eSmallGzip
+       ,eLarge      // too large to cache
+       ,eBeginTwice // too large to cache and (wrongly) written twice
+       ,eOverrun    // writes more than it claims
+       ,eEvict0
+       ,eEvict1
+       ,eEvict2
+       ,eEvict3
+       ,eEvict4
+       ,eNumResources
+    };
+public:
+    ResourceManager(TUint aCacheBytes);
+    static const Brx& UriTail(EResource aResource);
+    void Content(EResource aResource, Bwh& aContent) const;
+    TUint Requests(EResource aResource);
+private: // from IResourceManager
+    void WriteResource(const Brx& aUriTail, TIpAddress aInterface, std::vector<char*>& aLanguageList, IResourceWriter& aResourceWriter);
+private:
+    static const TChar* kMimeType;
+    static const Brn kUriTails[eNumResources];
+    Mutex iLock;
+    const TUint iLargeBytes;
+    const TUint iEvictBytes;
+    TUint iRequests[eNumResources];
+};
+
+class SuiteResourceCache : public Suite, private INonCopyable
+{
+public:
+    SuiteResourceCache(DvStack& aDvStack);
+    ~SuiteResourceCache();
+    void Test();
+private:
+    void Path(ResourceManager::EResource aResource, Bwh& aPath);
+    void TestCapture();
+    void TestGzip();
+    void TestEviction();
+private:
+    DvStack& iDvStack;
+    HttpGetter iGetter;
+    ResourceManager iResourceManager;
+    Bwh iUdn;
+    DviDevice* iDevice;
+};
+
+class SuiteAcceptEncoding : public Suite
+{
+public:
+    SuiteAcceptEncoding();
+    void Test();
+private:
+    static TBool Gzip(const TChar* aValue);
+};
+
+
+// HttpHeaderValue
+
+HttpHeaderValue::HttpHeaderValue(const Brx& aField)
+    : iField(aField)
+{
+}
+
+const Brx& HttpHeaderValue::Value() const
+{
+    if (!Received()) {
+        return Brx::Empty();
+    }
+    return iValue;
+}
+
+TBool HttpHeaderValue::Recognise(const Brx& aHeader)
+{
+    return Ascii::CaseInsensitiveEquals(aHeader, iField);
+}
+
+void HttpHeaderValue::Process(const Brx& aValue)
+{
+    iValue.Replace(aValue.Split(0, (aValue.Bytes() < iValue.MaxBytes()? aValue.Bytes() : iValue.MaxBytes())));
+    SetReceived();
+}
+
+
+// HttpGetter
+
+HttpGetter::HttpGetter(DvStack& aDvStack)
+    : iEnv(aDvStack.Env())
+    , iHeaderContentEncoding(Http::kHeaderContentEncoding)
+    , iHeaderVary(Http::kHeaderVary)
+{
+    NetworkAdapter* nif = iEnv.NetworkAdapterList().CurrentAdapter(kAdapterCookie);
+    const TIpAddress addr = nif->Address();
+    nif->RemoveRef(kAdapterCookie);
+    iEndpoint.SetAddress(addr);
+    iEndpoint.SetPort(aDvStack.ServerUpnp().Port(addr));
+}
+
+TUint HttpGetter::Get(const Brx& aPath, const Brx& aIfNoneMatch, const Brx& aAcceptEncoding)
+{
+    SocketTcpClient socket;
+    socket.Open(iEnv);
+    socket.Connect(iEndpoint, iEnv.InitParams().TcpConnectTimeoutMs());
+
+    Sws<1024> writeBuffer(socket);
+    WriterHttpRequest writerRequest(writeBuffer);
+    writerRequest.WriteMethod(Http::kMethodGet, aPath, Http::eHttp11);
+    Bws<Endpoint::kMaxEndpointBytes> host;
+    iEndpoint.AppendEndpoint(host);
+    writerRequest.WriteHeader(Http::kHeaderHost, host);
+    writerRequest.WriteHeader(Http::kHeaderConnection, Http::kConnectionClose);
+    if (aIfNoneMatch.Bytes() > 0) {
+        writerRequest.WriteHeader(Http::kHeaderIfNoneMatch, aIfNoneMatch);
+    }
+    if (aAcceptEncoding.Bytes() > 0) {
+        writerRequest.WriteHeader(Http::kHeaderAcceptEncoding, aAcceptEncoding);
+    }
+    writerRequest.WriteFlush();
+
+    Srs<kReadBufferBytes> readBuffer(socket);
+    ReaderHttpResponse readerResponse(iEnv, readBuffer);
+    readerResponse.AddHeader(iHeaderContentLength);
+    readerResponse.AddHeader(iHeaderTransferEncoding);
+    readerResponse.AddHeader(iHeaderETag);
+    readerResponse.AddHeader(iHeaderContentEncoding);
+    readerResponse.AddHeader(iHeaderVary);
+    readerResponse.Read(kReadTimeoutMs);
+    const TUint code = readerResponse.Status().Code();
+    iBody.SetBytes(0);
+    if (iHeaderTransferEncoding.IsChunked()) {
+        ReaderHttpChunked dechunker(readBuffer);
+        dechunker.Read();
+        dechunker.TransferTo(iBody);
+    }
+    else {
+        TUint remaining = iHeaderContentLength.ContentLength();
+        iBody.Grow(remaining);
+        while (remaining > 0) {
+            const TUint bytes = (remaining<kReadBufferBytes? remaining : kReadBufferBytes);
+            iBody.Append(readBuffer.Read(bytes));
+            remaining -= bytes;
+        }
+    }
+    socket.Close();
+    return code;
+}
+
+
+// SuiteDeviceXml
+
+SuiteDeviceXml::SuiteDeviceXml(DvStack& aDvStack)
+    : Suite("Device and service xml validation")
+    , iDvStack(aDvStack)
+    , iSem("SDXM", 0)
+    , iNameRoot("TestDvResourcesRoot")
+    , iNameEmbedded("TestDvResourcesEmbedded")
+{
+    RandomiseUdn(iDvStack.Env(), iNameRoot);
+    RandomiseUdn(iDvStack.Env(), iNameEmbedded);
+
+    iRoot = new DviDeviceStandard(iDvStack, iNameRoot);
+    iRoot->SetAttribute("Upnp.Domain", "openhome.org");
+    iRoot->SetAttribute("Upnp.Type", "TestRoot");
+    iRoot->SetAttribute("Upnp.Version", "1");
+    iRoot->SetAttribute("Upnp.FriendlyName", "Root");
+    AddService(iRoot, new DviService(iDvStack, "openhome.org", "TestService", 1));
+
+    iEmbedded = new DviDeviceStandard(iDvStack, iNameEmbedded);
+    iRoot->AddDevice(iEmbedded);
+    iEmbedded->SetAttribute("Upnp.Domain", "openhome.org");
+    iEmbedded->SetAttribute("Upnp.Type", "TestEmbedded");
+    iEmbedded->SetAttribute("Upnp.Version", "1");
+    iEmbedded->SetAttribute("Upnp.FriendlyName", "Embedded");
+    AddService(iEmbedded, new DviService(iDvStack, "openhome.org", "TestEmbeddedService", 1));
+    iRoot->SetEnabled();
+    iEmbedded->SetEnabled();
+}
+
+SuiteDeviceXml::~SuiteDeviceXml()
+{
+    iRoot->Destroy();
+}
+
+void SuiteDeviceXml::AddService(DviDevice* aDevice, DviService* aService)
+{
+    aDevice->AddService(aService);
+    aService->RemoveRef();
+}
+
+void SuiteDeviceXml::Path(const Brx& aUdn, const Brx& aTail, Bwh& aPath)
+{
+    aPath.Grow(aUdn.Bytes() + aTail.Bytes() + 8);
+    aPath.Replace("/");
+    aPath.Append(aUdn);
+    aPath.Append("/Upnp/");
+    aPath.Append(aTail);
+}
+
+void SuiteDeviceXml::Disabled()
+{
+    iSem.Signal();
+}
+
+void SuiteDeviceXml::Test()
+{
+    HttpGetter getter(iDvStack);
+    Bwh path;
+    Bws<256> etag;
+
+    // device.xml is tagged and a matching If-None-Match is answered with 304
+    Path(iNameRoot, Brn("device.xml"), path);
+    TEST(getter.Get(path) == HttpStatus::kOk.Code());
+    TEST(getter.ETag().Bytes() > 0);
+    TEST(Ascii::Contains(getter.Body(), Brn("<friendlyName>Embedded</friendlyName>")));
+    etag.Replace(getter.ETag());
+    TEST(getter.Get(path) == HttpStatus::kOk.Code());
+    TEST(getter.ETag() == etag);
+    TEST(getter.Get(path, etag) == HttpStatus::kNotModified.Code());
+    TEST(getter.ETag() == etag);
+    TEST(getter.Body().Bytes() == 0);
+    TEST(getter.Get(path, Brn("\"0-0\", *")) == HttpStatus::kNotModified.Code());
+    TEST(getter.Get(path, Brn("\"0-0\"")) == HttpStatus::kOk.Code());
+    TEST(getter.ETag() == etag);
+
+    // as are service descriptions
+    Path(iNameRoot, Brn("openhome.org-TestService-1/service.xml"), path);
+    TEST(getter.Get(path) == HttpStatus::kOk.Code());
+    TEST(getter.ETag().Bytes() > 0);
+    TEST(getter.ETag() != etag);
+    Bws<256> serviceETag(getter.ETag());
+    TEST(getter.Get(path, serviceETag) == HttpStatus::kNotModified.Code());
+
+    // and embedded devices' descriptions
+    Path(iNameEmbedded, Brn("device.xml"), path);
+    TEST(getter.Get(path) == HttpStatus::kOk.Code());
+    Bws<256> embeddedETag(getter.ETag());
+    TEST(embeddedETag.Bytes() > 0);
+    TEST(getter.Get(path, embeddedETag) == HttpStatus::kNotModified.Code());
+
+    // a change to an embedded device is reflected in its root's description
+    Functor disabled = MakeFunctor(*this, &SuiteDeviceXml::Disabled);
+    iEmbedded->SetDisabled(disabled);
+    iSem.Wait();
+    iEmbedded->SetAttribute("Upnp.FriendlyName", "Embedded2");
+    iEmbedded->SetEnabled();
+    TEST(getter.Get(path, embeddedETag) == HttpStatus::kOk.Code());
+    TEST(getter.ETag() != embeddedETag);
+    TEST(Ascii::Contains(getter.Body(), Brn("<friendlyName>Embedded2</friendlyName>")));
+    Path(iNameRoot, Brn("device.xml"), path);
+    TEST(getter.Get(path, etag) == HttpStatus::kOk.Code());
+    TEST(getter.ETag() != etag);
+    TEST(Ascii::Contains(getter.Body(), Brn("<friendlyName>Embedded2</friendlyName>")));
+}
+
+
+// ResourceManager
+
+const TChar* ResourceManager::kMimeType = "text/plain";
+
+const Brn ResourceManager::kUriTails[eNumResources] = {
+    Brn("small.txt")
+   ,Brn("small.txt.gz")
+   ,Brn("large.txt")
+   ,Brn("twice.txt")
+   ,Brn("overrun.txt")
+   ,Brn("evict0.txt")
+   ,Brn("evict1.txt")
+   ,Brn("evict2.txt")
+   ,Brn("evict3.txt")
+   ,Brn("evict4.txt")
+};
+
+ResourceManager::ResourceManager(TUint aCacheBytes)
+    : iLock("RMGR")
+    , iLargeBytes((aCacheBytes / 4) + 1)
+    , iEvictBytes((aCacheBytes * 7) / 32) // four fit in the cache, five don't
+{
+    for (TUint i=0; i<eNumResources; i++) {
+        iRequests[i] = 0;
+    }
+}
+
+const Brx& ResourceManager::UriTail(EResource aResource)
+{
+    return kUriTails[aResource];
+}
+
+void ResourceManager::Content(EResource aResource, Bwh& aContent) const
+{
+    switch (aResource)
+    {
+    case eSmall:
+        aContent.Grow(64);
+        aContent.Replace("uncompressed content");
+        break;
+    case eSmallGzip:
+        aContent.Grow(64);
+        aContent.Replace("content compressed with gzip");
+        break;
+    case eOverrun:
+        aContent.Grow(64);
+        aContent.Replace("overrun");
+        break;
+    default:
+    {
+        const TUint bytes = ((aResource == eLarge || aResource == eBeginTwice)? iLargeBytes : iEvictBytes);
+        aContent.Grow(bytes);
+        aContent.SetBytes(0);
+        for (TUint i=0; i<bytes; i++) {
+            aContent.Append((TByte)('a' + aResource));
+        }
+    }
+        break;
+    }
+}
+
+TUint ResourceManager::Requests(EResource aResource)
+{
+    AutoMutex a(iLock);
+    return iRequests[aResource];
+}
+
+void ResourceManager::WriteResource(const Brx& aUriTail, TIpAddress /*aInterface*/, std::vector<char*>& /*aLanguageList*/, IResourceWriter& aResourceWriter)
+{
+    TUint index = 0;
+    while (index < eNumResources && kUriTails[index] != aUriTail) {
+        index++;
+    }
+    if (index == eNumResources) {
+        return;
+    }
+    const EResource resource = (EResource)index;
+    iLock.Wait();
+    iRequests[resource]++;
+    iLock.Signal();
+    Bwh content;
+    Content(resource, content);
+    const TUint claimed = (resource == eOverrun? content.Bytes() - 3 : content.Bytes());
+    const TUint writes = (resource == eBeginTwice? 2 : 1);
+    for (TUint i=0; i<writes; i++) {
+        aResourceWriter.WriteResourceBegin(claimed, kMimeType);
+        aResourceWriter.WriteResource(content.Ptr(), content.Bytes());
+        aResourceWriter.WriteResourceEnd();
+    }
+}
+
+
+// SuiteResourceCache
+
+SuiteResourceCache::SuiteResourceCache(DvStack& aDvStack)
+    : Suite("Resource cache")
+    , iDvStack(aDvStack)
+    , iGetter(aDvStack)
+    , iResourceManager(aDvStack.Env().InitParams().DvResourceCacheBytes())
+    , iUdn("TestDvResourcesCache")
+{
+    RandomiseUdn(iDvStack.Env(), iUdn);
+    iDevice = new DviDeviceStandard(iDvStack, iUdn, iResourceManager);
+    iDevice->SetAttribute("Upnp.Domain", "openhome.org");
+    iDevice->SetAttribute("Upnp.Type", "TestResources");
+    iDevice->SetAttribute("Upnp.Version", "1");
+    iDevice->SetAttribute("Upnp.FriendlyName", "Resources");
+    iDevice->SetEnabled();
+}
+
+SuiteResourceCache::~SuiteResourceCache()
+{
+    iDevice->Destroy();
+}
+
+void SuiteResourceCache::Path(ResourceManager::EResource aResource, Bwh& aPath)
+{
+    const Brx& tail = ResourceManager::UriTail(aResource);
+    aPath.Grow(iUdn.Bytes() + DviDevice::kResourceDir.Bytes() + tail.Bytes() + 3);
+    aPath.Replace("/");
+    aPath.Append(iUdn);
+    aPath.Append('/');
+    aPath.Append(DviDevice::kResourceDir);
+    aPath.Append('/');
+    aPath.Append(tail);
+}
+
+void SuiteResourceCache::Test()
+{
+    TestCapture();
+    TestGzip();
+    TestEviction();
+}
+
+void SuiteResourceCache::TestCapture()
+{
+    Bwh path;
+    Bwh content;
+
+    // small resources are fetched once then served from the cache
+    Path(ResourceManager::eSmall, path);
+    iResourceManager.Content(ResourceManager::eSmall, content);
+    TEST(iGetter.Get(path) == HttpStatus::kOk.Code());
+    TEST(iGetter.Body() == content);
+    TEST(iGetter.ETag().Bytes() > 0);
+    Bws<DviResourceCache::kMaxETagBytes> etag(iGetter.ETag());
+    TEST(iGetter.Get(path) == HttpStatus::kOk.Code());
+    TEST(iGetter.Body() == content);
+    TEST(iGetter.ETag() == etag);
+    TEST(iGetter.Get(path, etag) == HttpStatus::kNotModified.Code());
+    TEST(iGetter.Body().Bytes() == 0);
+    TEST(iResourceManager.Requests(ResourceManager::eSmall) == 1);
+    // a client that can't use a compressed copy doesn't cause one to be looked for
+    TEST(iResourceManager.Requests(ResourceManager::eSmallGzip) == 0);
+    TEST(iGetter.ContentEncoding().Bytes() == 0);
+
+    // large resources are passed straight through, every time
+    Path(ResourceManager::eLarge, path);
+    iResourceManager.Content(ResourceManager::eLarge, content);
+    TEST(iGetter.Get(path) == HttpStatus::kOk.Code());
+    TEST(iGetter.Body() == content);
+    TEST(iGetter.ETag().Bytes() == 0);
+    TEST(iGetter.Get(path) == HttpStatus::kOk.Code());
+    TEST(iGetter.Body() == content);
+    TEST(iResourceManager.Requests(ResourceManager::eLarge) == 2);
+
+    // a manager that restarts a resource it has already passed through isn't asked to write it again
+    Path(ResourceManager::eBeginTwice, path);
+    iResourceManager.Content(ResourceManager::eBeginTwice, content);
+    TEST(iGetter.Get(path) == HttpStatus::kOk.Code());
+    TEST(iGetter.Body() == content);
+    TEST(iResourceManager.Requests(ResourceManager::eBeginTwice) == 1);
+
+    // a manager that writes more than it claims is asked to write directly instead
+    Path(ResourceManager::eOverrun, path);
+    TEST(iGetter.Get(path) == HttpStatus::kOk.Code());
+    TEST(iGetter.Body() == Brn("over"));
+    TEST(iResourceManager.Requests(ResourceManager::eOverrun) == 2);
+    TEST(iGetter.Get(path) == HttpStatus::kOk.Code());
+    TEST(iResourceManager.Requests(ResourceManager::eOverrun) == 4);
+}
+
+void SuiteResourceCache::TestGzip()
+{
+    Bwh path;
+    Bwh content;
+    Bwh contentGzip;
+    Path(ResourceManager::eSmall, path);
+    iResourceManager.Content(ResourceManager::eSmall, content);
+    iResourceManager.Content(ResourceManager::eSmallGzip, contentGzip);
+    const Brn kGzip("gzip");
+    TEST(iGetter.Get(path) == HttpStatus::kOk.Code());
+    Bws<DviResourceCache::kMaxETagBytes> etag(iGetter.ETag());
+    const TUint requests = iResourceManager.Requests(ResourceManager::eSmall);
+
+    // the first client able to accept gzip causes the compressed copy to be fetched
+    TEST(iGetter.Get(path, Brx::Empty(), Brn("deflate, gzip")) == HttpStatus::kOk.Code());
+    TEST(iGetter.Body() == contentGzip);
+    TEST(iGetter.ContentEncoding() == kGzip);
+    TEST(Ascii::CaseInsensitiveEquals(iGetter.Vary(), Http::kHeaderAcceptEncoding));
+    TEST(iGetter.ETag().Bytes() > 0);
+    TEST(iGetter.ETag() != etag);
+    Bws<DviResourceCache::kMaxETagBytes> etagGzip(iGetter.ETag());
+    TEST(iResourceManager.Requests(ResourceManager::eSmall) == requests + 1);
+    TEST(iResourceManager.Requests(ResourceManager::eSmallGzip) == 1);
+
+    // both copies are then served from the cache, each with Vary
+    TEST(iGetter.Get(path, Brx::Empty(), kGzip) == HttpStatus::kOk.Code());
+    TEST(iGetter.Body() == contentGzip);
+    TEST(iGetter.ETag() == etagGzip);
+    TEST(iGetter.Get(path) == HttpStatus::kOk.Code());
+    TEST(iGetter.Body() == content);
+    TEST(iGetter.ETag() == etag);
+    TEST(iGetter.ContentEncoding().Bytes() == 0);
+    TEST(Ascii::CaseInsensitiveEquals(iGetter.Vary(), Http::kHeaderAcceptEncoding));
+    TEST(iGetter.Get(path, Brx::Empty(), Brn("gzip;q=0")) == HttpStatus::kOk.Code());
+    TEST(iGetter.Body() == content);
+    TEST(iGetter.ContentEncoding().Bytes() == 0);
+
+    // 304 responses carry the same Vary header as the full responses they stand in for
+    TEST(iGetter.Get(path, etagGzip, kGzip) == HttpStatus::kNotModified.Code());
+    TEST(iGetter.ETag() == etagGzip);
+    TEST(Ascii::CaseInsensitiveEquals(iGetter.Vary(), Http::kHeaderAcceptEncoding));
+    TEST(iGetter.Get(path, etag) == HttpStatus::kNotModified.Code());
+    TEST(Ascii::CaseInsensitiveEquals(iGetter.Vary(), Http::kHeaderAcceptEncoding));
+    // the identity copy's tag doesn't validate the compressed one
+    TEST(iGetter.Get(path, etag, kGzip) == HttpStatus::kOk.Code());
+    TEST(iGetter.Body() == contentGzip);
+
+    TEST(iResourceManager.Requests(ResourceManager::eSmall) == requests + 1);
+    TEST(iResourceManager.Requests(ResourceManager::eSmallGzip) == 1);
+}
+
+void SuiteResourceCache::TestEviction()
+{
+    static const ResourceManager::EResource kResources[] = {
+        ResourceManager::eEvict0, ResourceManager::eEvict1, ResourceManager::eEvict2,
+        ResourceManager::eEvict3, ResourceManager::eEvict4 };
+    Bwh path[5];
+    Bwh content;
+    for (TUint i=0; i<5; i++) {
+        Path(kResources[i], path[i]);
+    }
+    for (TUint i=0; i<4; i++) {
+        TEST(iGetter.Get(path[i]) == HttpStatus::kOk.Code());
+        iResourceManager.Content(kResources[i], content);
+        TEST(iGetter.Body() == content);
+    }
+    // use evict0 again, leaving evict1 least recently used
+    TEST(iGetter.Get(path[0]) == HttpStatus::kOk.Code());
+    for (TUint i=0; i<4; i++) {
+        TEST(iResourceManager.Requests(kResources[i]) == 1);
+    }
+
+    // adding evict4 pushes out evict1 only
+    TEST(iGetter.Get(path[4]) == HttpStatus::kOk.Code());
+    TEST(iGetter.Get(path[0]) == HttpStatus::kOk.Code());
+    TEST(iGetter.Get(path[2]) == HttpStatus::kOk.Code());
+    TEST(iGetter.Get(path[3]) == HttpStatus::kOk.Code());
+    TEST(iGetter.Get(path[4]) == HttpStatus::kOk.Code());
+    TEST(iResourceManager.Requests(ResourceManager::eEvict0) == 1);
+    TEST(iResourceManager.Requests(ResourceManager::eEvict2) == 1);
+    TEST(iResourceManager.Requests(ResourceManager::eEvict3) == 1);
+    TEST(iResourceManager.Requests(ResourceManager::eEvict4) == 1);
+    TEST(iResourceManager.Requests(ResourceManager::eEvict1) == 1);
+    TEST(iGetter.Get(path[1]) == HttpStatus::kOk.Code());
+    iResourceManager.Content(ResourceManager::eEvict1, content);
+    TEST(iGetter.Body() == content);
+    TEST(iResourceManager.Requests(ResourceManager::eEvict1) == 2);
+
+    // ...which in turn pushed out evict0, now the least recently used
+    TEST(iGetter.Get(path[4]) == HttpStatus::kOk.Code());
+    TEST(iResourceManager.Requests(ResourceManager::eEvict4) == 1);
+    TEST(iGetter.Get(path[0]) == HttpStatus::kOk.Code());
+    TEST(iResourceManager.Requests(ResourceManager::eEvict0) == 2);
+}
+
+
+// SuiteAcceptEncoding
+
+SuiteAcceptEncoding::SuiteAcceptEncoding()
+    : Suite("Accept-Encoding parsing")
+{
+}
+
+TBool SuiteAcceptEncoding::Gzip(const TChar* aValue)
+{
+    HeaderAcceptEncoding header;
+    IHttpHeader& h = header;
+    h.Reset();
+    h.Process(Brn(aValue));
+    return header.Gzip();
+}
+
+void SuiteAcceptEncoding::Test()
+{
+    HeaderAcceptEncoding header;
+    static_cast<IHttpHeader&>(header).Reset();
+    TEST(!header.Gzip());
+
+    TEST(Gzip("gzip"));
+    TEST(Gzip("GZip"));
+    TEST(Gzip("x-gzip"));
+    TEST(Gzip("deflate, gzip"));
+    TEST(Gzip("deflate , gzip ; q=0.5"));
+    TEST(Gzip("gzip;q=1"));
+    TEST(Gzip("gzip;q=0.001"));
+    TEST(!Gzip("identity"));
+    TEST(!Gzip("deflate"));
+    TEST(!Gzip(""));
+    TEST(!Gzip("gzip;q=0"));
+    TEST(!Gzip("gzip; q=0.000"));
+    TEST(!Gzip("gzip;q=0."));
+    TEST(!Gzip("deflate, gzip;q=0, identity"));
+    TEST(!Gzip("gzip, x-gzip;q=0"));
+}
+
+
+void TestDvResources(DvStack& aDvStack)
+{
+    Runner runner("Device resources\n");
+    runner.Add(new SuiteDeviceXml(aDvStack));
+    runner.Add(new SuiteResourceCache(aDvStack));
+    runner.Add(new SuiteAcceptEncoding());
+    runner.Run();
+}
@@ -0,0 +1,38 @@
+#include <OpenHome/OhNetTypes.h>
+#include <OpenHome/Private/TestFramework.h>
+#include <OpenHome/Private/OptionParser.h>
+#include <OpenHome/Net/Core/OhNet.h>
+
+#include <vector>
+
+using namespace OpenHome;
+using namespace OpenHome::Net;
+
+extern void TestDvResources(DvStack& aDvStack);
+
+static const TUint kResourceCacheBytes = 64 * 1024;
+
+void OpenHome::TestFramework::Runner::Main(TInt aArgc, TChar* aArgv[], Net::InitialisationParams* aInitParams)
+{
+    OptionParser parser;
+    OptionBool loopback("-l", "--loopback", "Use the loopback adapter only");
+    parser.AddOption(&loopback);
+    if (!parser.Parse(aArgc, aArgv) || parser.HelpDisplayed()) {
+        return;
+    }
+    if (loopback.Value()) {
+        aInitParams->SetUseLoopbackNetworkAdapter();
+    }
+    aInitParams->SetDvUpnpServerPort(0);
+    aInitParams->SetDvResourceCacheBytes(kResourceCacheBytes);
+    Library* lib = new Library(aInitParams);
+    std::vector<NetworkAdapter*>* subnetList = lib->CreateSubnetList();
+    TIpAddress subnet = (*subnetList)[0]->Subnet();
+    Library::DestroySubnetList(subnetList);
+    lib->SetCurrentSubnet(subnet);
+    DvStack* dvStack = lib->StartDv();
+
+    TestDvResources(*dvStack);
+
+    delete lib;
+}
@@ -26,17 +26,21 @@ class CpDevices
 public:
     CpDevices(Semaphore& aAddedSem, const Brx& aTargetUdn);
     ~CpDevices();
-    void Test();
+    void Test(DeviceBasic& aDevice);
     void Added(CpDevice& aDevice);
     void Removed(CpDevice& aDevice);
 private:
     void UpdatesComplete();
+    TUint UpdateCount();
+private:
+    static const TUint kModerationMs = 1000;
 private:
     Mutex iLock;
     std::vector<CpDevice*> iList;
     Semaphore& iAddedSem;
     Semaphore iUpdatesComplete;
     const Brx& iTargetUdn;
+    TUint iUpdateCount;
 };
 
 } // namespace TestDvSubscription
@@ -49,6 +53,7 @@ CpDevices::CpDevices(Semaphore& aAddedSem, const Brx& aTargetUdn)
     , iAddedSem(aAddedSem)
     , iUpdatesComplete("DSB2", 0)
     , iTargetUdn(aTargetUdn)
+    , iUpdateCount(0)
 {
 }
 
@@ -61,7 +66,7 @@ CpDevices::~CpDevices()
     iList.clear();
 }
 
-void CpDevices::Test()
+void CpDevices::Test(DeviceBasic& aDevice)
 {
     ASSERT(iList.size() == 1);
     CpProxyOpenhomeOrgTestBasic1* proxy = new CpProxyOpenhomeOrgTestBasic1(*(iList[0]));
@@ -159,6 +164,26 @@ void CpDevices::Test()
     proxy->SyncGetBool(valBool);
     ASSERT(!valBool);
 
+    Print("Moderation...\n");
+    aDevice.SetEventModerationMs(kModerationMs);
+    // the first change after a quiet period is published immediately...
+    TUint updates = UpdateCount();
+    proxy->SyncSetUint(100);
+    iUpdatesComplete.Wait();
+    ASSERT(UpdateCount() == updates + 1);
+    // ...changes within the following window are published together when it expires
+    proxy->SyncSetUint(101);
+    proxy->SyncSetInt(-101);
+    proxy->SyncSetUint(102);
+    iUpdatesComplete.Wait();
+    Thread::Sleep(kModerationMs);
+    ASSERT(UpdateCount() == updates + 2);
+    proxy->PropertyVarUint(propUint);
+    ASSERT(propUint == 102);
+    proxy->PropertyVarInt(propInt);
+    ASSERT(propInt == -101);
+    aDevice.SetEventModerationMs(0);
+
     delete proxy; // automatically unsubscribes
 }
 
@@ -179,9 +204,20 @@ void CpDevices::Removed(CpDevice& /*aDevice*/)
 
 void CpDevices::UpdatesComplete()
 {
+    iLock.Wait();
+    iUpdateCount++;
+    iLock.Signal();
     iUpdatesComplete.Signal();
 }
 
+TUint CpDevices::UpdateCount()
+{
+    iLock.Wait();
+    TUint count = iUpdateCount;
+    iLock.Signal();
+    return count;
+}
+
 
 void TestDvSubscription(CpStack& aCpStack, DvStack& aDvStack)
 {
@@ -202,9 +238,9 @@ void TestDvSubscription(CpStack& aCpStack, DvStack& aDvStack)
     CpDeviceListUpnpServiceType* list =
                 new CpDeviceListUpnpServiceType(aCpStack, domainName, serviceType, ver, added, removed);
     sem->Wait(30*1000); // allow up to 30 seconds to issue the msearch and receive a response
-    delete sem;
-    deviceList->Test();
+    deviceList->Test(*device);
     delete list;
+    delete sem; // list may report the device again (e.g. after a byebye/alive) until it is deleted
     delete deviceList;
     delete device;
 
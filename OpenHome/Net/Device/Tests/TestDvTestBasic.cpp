@@ -97,14 +97,26 @@ void DeviceTestBasic::WriteResource(const Brx& aUriTail, TIpAddress /*aInterface
         }
     }
     aResourceWriter.WriteResourceBegin(bytes, mime);
-    do {
+    TUint offset, required;
+    aResourceWriter.GetRequiredRange(offset, required);
+    if (offset >= bytes) {
+        bytes = 0;
+    }
+    else {
+        bytes -= offset;
+        if (required < bytes) {
+            bytes = required;
+        }
+        filePtr->Seek(offset);
+    }
+    while (bytes > 0) {
         Bws<kMaxReadSize> buf;
         TUint size = (bytes<kMaxReadSize? bytes : kMaxReadSize);
         filePtr->Read(buf, size);
         ASSERT(buf.Bytes() == size);
         aResourceWriter.WriteResource(buf.Ptr(), buf.Bytes());
         bytes -= size;
-    } while (bytes > 0);
+    }
     aResourceWriter.WriteResourceEnd();
     delete filePtr;
 }
@@ -7,6 +7,8 @@
 #include <OpenHome/Net/Private/DviService.h>
 #include <OpenHome/Private/Env.h>
 #include <OpenHome/Net/Private/DviStack.h>
+#include <OpenHome/Net/Private/DviSsdpNotifier.h>
+#include <OpenHome/Net/Private/Ssdp.h>
 #include <OpenHome/Private/NetworkAdapterList.h>
 #include <OpenHome/Private/Standard.h>
 
@@ -117,6 +119,7 @@ private:
     void TestMsearchUuid();
     void TestMsearchDeviceType();
     void TestMsearchServiceType();
+    void TestMsearchRepeated();
 private:
     DvStack& iDvStack;
     DviDevice* iDevices[2];
@@ -125,6 +128,40 @@ private:
     SsdpListenerUnicast* iListenerUnicast;
 };
 
+class AnnouncementData : public IUpnpAnnouncementData, private INonCopyable
+{
+public:
+    AnnouncementData(DvStack& aDvStack);
+    ~AnnouncementData();
+private: // from IUpnpAnnouncementData
+    const Brx& Udn() const;
+    TBool IsRoot() const;
+    TUint ServiceCount() const;
+    DviService& Service(TUint aIndex);
+    Brn Domain() const;
+    Brn Type() const;
+    TUint Version() const;
+    DviSsdpPacketCache& SsdpPackets();
+private:
+    Bwh iUdn;
+    DviService* iService;
+    DviSsdpPacketCache* iPackets;
+};
+
+class SuiteSsdpPacketCache : public Suite, private INonCopyable
+{
+public:
+    SuiteSsdpPacketCache(DvStack& aDvStack);
+    void Test();
+private:
+    void SendMsearchResponse(TIpAddress aAdapter);
+private:
+    DvStack& iDvStack;
+    AnnouncementData iData;
+    SsdpMsearchResponder iResponder;
+    Endpoint iRemote;
+};
+
 Bwh SuiteAlive::gNameDevice1("TestAlive");
 Bwh SuiteMsearch::gNameDevice1("TestDevice1");
 Bwh SuiteMsearch::gNameDevice2("TestDevice2");
@@ -559,6 +596,7 @@ void SuiteMsearch::Test()
     TestMsearchUuid();
     TestMsearchDeviceType();*/
     TestMsearchServiceType();
+    TestMsearchRepeated();
 }
 
 void SuiteMsearch::Wait()
@@ -728,6 +766,150 @@ void SuiteMsearch::TestMsearchServiceType()
     TEST(0 == strcmp(iListener->Services()[0], "openhome.org:service5:1"));
 }
 
+void SuiteMsearch::TestMsearchRepeated()
+{
+    // repeats of a search while responses to it are queued are answered once
+    iListener->Reset();
+    iListenerUnicast->MsearchServiceType(Brn("upnp.org"), Brn("service1"), 1);
+    iListenerUnicast->MsearchServiceType(Brn("upnp.org"), Brn("service1"), 1);
+    iListenerUnicast->MsearchServiceType(Brn("upnp.org"), Brn("service1"), 1);
+    Wait();
+    TEST(iListener->ServiceCount() == 2);
+    TEST(iListener->Udns() == 5);
+    TEST(iListener->TotalMessages() == 2);
+
+    // different searches from the same control point are batched but each is answered
+    iListener->Reset();
+    iListenerUnicast->MsearchServiceType(Brn("upnp.org"), Brn("service1"), 1);
+    iListenerUnicast->MsearchServiceType(Brn("openhome.org"), Brn("service2"), 3);
+    iListenerUnicast->MsearchServiceType(Brn("openhome.org"), Brn("service5"), 1);
+    Wait();
+    TEST(iListener->ServiceCount() == 5);
+    TEST(iListener->Udns() == 7);
+    TEST(iListener->TotalMessages() == 5);
+
+    // once all responses have been sent, a repeated search is answered again
+    iListener->Reset();
+    iListenerUnicast->MsearchServiceType(Brn("openhome.org"), Brn("service5"), 1);
+    Wait();
+    TEST(iListener->ServiceCount() == 1);
+    TEST(iListener->Udns() == 2);
+    TEST(iListener->TotalMessages() == 1);
+}
+
+
+// AnnouncementData
+
+AnnouncementData::AnnouncementData(DvStack& aDvStack)
+    : iUdn("TestPacketCache")
+{
+    RandomiseUdn(aDvStack.Env(), iUdn);
+    iService = new DviService(aDvStack, "openhome.org", "TestPacketCache", 1);
+    iPackets = new DviSsdpPacketCache(aDvStack, *this);
+}
+
+AnnouncementData::~AnnouncementData()
+{
+    delete iPackets;
+    iService->RemoveRef();
+}
+
+const Brx& AnnouncementData::Udn() const
+{
+    return iUdn;
+}
+
+TBool AnnouncementData::IsRoot() const
+{
+    return true;
+}
+
+TUint AnnouncementData::ServiceCount() const
+{
+    return 1;
+}
+
+DviService& AnnouncementData::Service(TUint /*aIndex*/)
+{
+    return *iService;
+}
+
+Brn AnnouncementData::Domain() const
+{
+    return Brn("openhome.org");
+}
+
+Brn AnnouncementData::Type() const
+{
+    return Brn("TestPacketCache");
+}
+
+TUint AnnouncementData::Version() const
+{
+    return 1;
+}
+
+DviSsdpPacketCache& AnnouncementData::SsdpPackets()
+{
+    return *iPackets;
+}
+
+
+// SuiteSsdpPacketCache
+
+SuiteSsdpPacketCache::SuiteSsdpPacketCache(DvStack& aDvStack)
+    : Suite("Ssdp packet cache")
+    , iDvStack(aDvStack)
+    , iData(aDvStack)
+    , iResponder(aDvStack)
+{
+    NetworkAdapter* nif = iDvStack.Env().NetworkAdapterList().CurrentAdapter(kAdapterCookie);
+    iRemote.SetAddress(nif->Address());
+    nif->RemoveRef(kAdapterCookie);
+    iRemote.SetPort(9); // discard
+}
+
+void SuiteSsdpPacketCache::SendMsearchResponse(TIpAddress aAdapter)
+{
+    static const Brn kUri("http://127.0.0.1:1234/TestPacketCache/device.xml");
+    iResponder.SetRemote(iRemote, 1, aAdapter);
+    try {
+        // packets are rendered (and cached) before sending, which fails for the made up adapters below
+        static_cast<IUpnpAnnouncementData&>(iData).SsdpPackets().SendMsearchResponse(iResponder, aAdapter, kUri, 1, 0);
+    }
+    catch (NetworkError&) {}
+}
+
+void SuiteSsdpPacketCache::Test()
+{
+    DviSsdpPacketCache& cache = static_cast<IUpnpAnnouncementData&>(iData).SsdpPackets();
+    const TIpAddress adapter = iRemote.Address();
+    const TIpAddress vanished1 = Endpoint(0, Brn("10.254.254.1")).Address();
+    const TIpAddress vanished2 = Endpoint(0, Brn("10.254.254.2")).Address();
+    TEST(cache.AdapterCount() == 0);
+    SendMsearchResponse(adapter);
+    SendMsearchResponse(vanished1);
+    SendMsearchResponse(vanished2);
+    TEST(cache.AdapterCount() == 3);
+    SendMsearchResponse(vanished2);
+    TEST(cache.AdapterCount() == 3);
+
+    // packets for adapters that have gone are discarded
+    cache.RemoveAdapter(vanished1);
+    TEST(cache.AdapterCount() == 2);
+    cache.RemoveAdapter(vanished1);
+    TEST(cache.AdapterCount() == 2);
+    cache.RemoveAdapter(vanished2);
+    TEST(cache.AdapterCount() == 1);
+
+    // ...and re-rendered if the adapter reappears
+    SendMsearchResponse(vanished1);
+    TEST(cache.AdapterCount() == 2);
+
+    cache.Clear();
+    TEST(cache.AdapterCount() == 0);
+}
+
 
 void TestDviDiscovery(DvStack& aDvStack)
 {
@@ -739,6 +921,7 @@ void TestDviDiscovery(DvStack& aDvStack)
     Runner runner("SSDP discovery\n");
     runner.Add(new SuiteAlive(aDvStack));
     runner.Add(new SuiteMsearch(aDvStack));
+    runner.Add(new SuiteSsdpPacketCache(aDvStack));
     runner.Run();
 
     initParams.SetMsearchTime(oldMsearchTime);
@@ -10,6 +10,20 @@ using namespace OpenHome::Net;
 
 extern void TestDviDiscovery(DvStack& aDvStack);
 
+static void RunTests(InitialisationParams* aInitParams)
+{
+    Library* lib = new Library(aInitParams);
+    std::vector<NetworkAdapter*>* subnetList = lib->CreateSubnetList();
+    TIpAddress subnet = (*subnetList)[0]->Subnet();
+    Library::DestroySubnetList(subnetList);
+    lib->SetCurrentSubnet(subnet);
+    DvStack* dvStack = lib->StartDv();
+
+    TestDviDiscovery(*dvStack);
+
+    delete lib;
+}
+
 void OpenHome::TestFramework::Runner::Main(TInt aArgc, TChar* aArgv[], Net::InitialisationParams* aInitParams)
 {
     OptionParser parser;
@@ -22,14 +36,14 @@ void OpenHome::TestFramework::Runner::Main(TInt aArgc, TChar* aArgv[], Net::Init
         aInitParams->SetUseLoopbackNetworkAdapter();
     }
     aInitParams->SetDvUpnpServerPort(0);
-    Library* lib = new Library(aInitParams);
-    std::vector<NetworkAdapter*>* subnetList = lib->CreateSubnetList();
-    TIpAddress subnet = (*subnetList)[0]->Subnet();
-    Library::DestroySubnetList(subnetList);
-    lib->SetCurrentSubnet(subnet);
-    DvStack* dvStack = lib->StartDv();
-
-    TestDviDiscovery(*dvStack);
+    RunTests(aInitParams);
 
-    delete lib;
+    // repeat, handling ssdp messages on a pool of threads rather than the listener's own
+    InitialisationParams* initParams = InitialisationParams::Create();
+    if (loopback.Value()) {
+        initParams->SetUseLoopbackNetworkAdapter();
+    }
+    initParams->SetDvUpnpServerPort(0);
+    initParams->SetNumSsdpThreads(2);
+    RunTests(initParams);
 }
@@ -11,6 +11,7 @@
 #include <OpenHome/Private/Ascii.h>
 #include <OpenHome/Net/Private/DviServerUpnp.h>
 #include <OpenHome/Net/Private/Ssdp.h>
+#include <OpenHome/Net/Private/DviSsdpNotifier.h>
 #include <OpenHome/Private/Converter.h>
 #include <OpenHome/Private/Parser.h>
 #include <OpenHome/Private/Debug.h>
@@ -19,6 +20,54 @@
 using namespace OpenHome;
 using namespace OpenHome::Net;
 
+// DviProtocolUpnpCachedXml
+
+DviProtocolUpnpCachedXml::DviProtocolUpnpCachedXml(Environment& aEnv, Brh& aXml, TUint aVersion)
+    : iEnv(aEnv)
+    , iRefCount(1)
+    , iVersion(aVersion)
+{
+    aXml.TransferTo(iXml);
+    DviResourceCache::SetETag(iXml, iETag);
+}
+
+DviProtocolUpnpCachedXml::~DviProtocolUpnpCachedXml()
+{
+}
+
+void DviProtocolUpnpCachedXml::AddRef()
+{
+    iEnv.Mutex().Wait();
+    iRefCount++;
+    iEnv.Mutex().Signal();
+}
+
+void DviProtocolUpnpCachedXml::RemoveRef()
+{
+    iEnv.Mutex().Wait();
+    TBool dead = (--iRefCount == 0);
+    iEnv.Mutex().Signal();
+    if (dead) {
+        delete this;
+    }
+}
+
+const Brx& DviProtocolUpnpCachedXml::Xml() const
+{
+    return iXml;
+}
+
+const Brx& DviProtocolUpnpCachedXml::ETag() const
+{
+    return iETag;
+}
+
+TUint DviProtocolUpnpCachedXml::Version() const
+{
+    return iVersion;
+}
+
+
 // DviProtocolUpnp
 
 const Brn DviProtocolUpnp::kProtocolName("Upnp");
@@ -36,6 +85,7 @@ DviProtocolUpnp::DviProtocolUpnp(DviDevice& aDevice)
     , iUpdateCount(0)
     , iSuppressScheduledEvents(false)
 {
+    iSsdpPackets = new DviSsdpPacketCache(iDvStack, *this);
     SetAttribute(kAttributeKeyVersionMajor, "1");
     SetAttribute(kAttributeKeyVersionMinor, "1");
     iLock.Wait();
@@ -81,9 +131,11 @@ DviProtocolUpnp::~DviProtocolUpnp()
     for (TUint i=0; i<iAdapters.size(); i++) {
         iAdapters[i]->Destroy();
     }
+    ClearServiceXml();
     iSuppressScheduledEvents = true;
     iLock.Signal();
     iDvStack.SsdpNotifierManager().Stop(iDevice.Udn());
+    delete iSsdpPackets;
 }
 
 const Brx& DviProtocolUpnp::Udn() const
@@ -130,6 +182,11 @@ TUint DviProtocolUpnp::Version() const
     return Ascii::Uint(verBuf);
 }
 
+DviSsdpPacketCache& DviProtocolUpnp::SsdpPackets()
+{
+    return *iSsdpPackets;
+}
+
 DviProtocolUpnpAdapterSpecificData* DviProtocolUpnp::AddInterface(const NetworkAdapter& aAdapter)
 {
     TIpAddress addr = aAdapter.Address();
@@ -207,6 +264,7 @@ void DviProtocolUpnp::HandleInterfaceChange()
     }
 
     for (TUint i=0; i<pendingDelete.size(); i++) {
+        iSsdpPackets->RemoveAdapter(pendingDelete[i]->Interface());
         pendingDelete[i]->Destroy();
     }
 
@@ -247,37 +305,11 @@ TInt DviProtocolUpnp::FindListenerForInterface(TIpAddress aAdapter)
 
 void DviProtocolUpnp::WriteResource(const Brx& aUriTail, TIpAddress aAdapter, std::vector<char*>& aLanguageList, IResourceWriter& aResourceWriter)
 {
-    if (aUriTail == kDeviceXmlName) {
-        Brh xml;
-        Brn xmlBuf;
-        iLock.Wait();
-        const TInt index = FindListenerForInterface(aAdapter);
-        if (index == -1) {
-	        iLock.Signal();
+    DviProtocolUpnpCachedXml* xml = CachedXml(aUriTail, aAdapter);
+    if (xml == NULL) {
+        if (aUriTail == kDeviceXmlName) {
             return;
         }
-        if (iDevice.IsRoot()) {
-            const Brx& cachedXml = iAdapters[index]->DeviceXml();
-            if (cachedXml.Bytes() > 0) {
-                xmlBuf.Set(cachedXml);
-            }
-        }
-        if (xmlBuf.Bytes() == 0) {
-            GetDeviceXml(xml, aAdapter);
-            if (iDevice.IsRoot()) {
-                iAdapters[index]->SetDeviceXml(xml);
-                xmlBuf.Set(iAdapters[index]->DeviceXml());
-            }
-            else {
-                xmlBuf.Set(xml);
-            }
-        }
-        iLock.Signal();
-        aResourceWriter.WriteResourceBegin(xmlBuf.Bytes(), kOhNetMimeTypeXml);
-        aResourceWriter.WriteResource(xmlBuf.Ptr(), xmlBuf.Bytes());
-        aResourceWriter.WriteResourceEnd();
-    }
-    else {
         Parser parser(aUriTail);
         Brn buf = parser.Next('/');
         Brn rem = parser.Remaining();
@@ -286,25 +318,142 @@ void DviProtocolUpnp::WriteResource(const Brx& aUriTail, TIpAddress aAdapter, st
             if (resMgr != NULL) {
                 resMgr->WriteResource(rem, aAdapter, aLanguageList, aResourceWriter);
             }
+            return;
         }
-        else if (rem == kServiceXmlName) {
-            iLock.Wait();
-            DviService* service = 0;
-            const TUint count = iDevice.ServiceCount();
-            for (TUint i=0; i<count; i++) {
-                DviService& s = iDevice.Service(i);
-                if (s.ServiceType().PathUpnp() == buf) {
-                    service = &s;
-                    break;
-                }
-            }
-            iLock.Signal();
-            if (service == 0) {
-                THROW(ReaderError);
-            }
-            DviProtocolUpnpServiceXmlWriter::Write(*service, *this, aResourceWriter);
+        if (rem != kServiceXmlName) {
+            return;
+        }
+        THROW(ReaderError);
+    }
+    try {
+        WriteXml(*xml, aResourceWriter);
+    }
+    catch (...) {
+        xml->RemoveRef();
+        throw;
+    }
+    xml->RemoveRef();
+}
+
+TBool DviProtocolUpnp::WriteValidatedResource(const Brx& aUriTail, TIpAddress aInterface, IResourceWriterHttp& aResourceWriter)
+{
+    // the entity tag and the body both come from the same cached description
+    DviProtocolUpnpCachedXml* xml = CachedXml(aUriTail, aInterface);
+    if (xml == NULL) {
+        return false;
+    }
+    try {
+        const Brx& etag = xml->ETag();
+        if (!aResourceWriter.WriteNotModified(etag, false)) {
+            aResourceWriter.SetResourceHeaders(etag, false, false);
+            WriteXml(*xml, aResourceWriter);
+        }
+    }
+    catch (...) {
+        xml->RemoveRef();
+        throw;
+    }
+    xml->RemoveRef();
+    return true;
+}
+
+void DviProtocolUpnp::WriteXml(const DviProtocolUpnpCachedXml& aXml, IResourceWriter& aResourceWriter)
+{
+    const Brx& xmlBuf = aXml.Xml();
+    aResourceWriter.WriteResourceBegin(xmlBuf.Bytes(), kOhNetMimeTypeXml);
+    aResourceWriter.WriteResource(xmlBuf.Ptr(), xmlBuf.Bytes());
+    aResourceWriter.WriteResourceEnd();
+}
+
+DviProtocolUpnpCachedXml* DviProtocolUpnp::CachedXml(const Brx& aUriTail, TIpAddress aAdapter)
+{ // returns NULL if aUriTail isn't a known device or service description
+  // returned object has a reference claimed for the caller
+    AutoMutex a(iLock);
+    if (aUriTail == kDeviceXmlName) {
+        return CachedDeviceXml(aAdapter);
+    }
+    Parser parser(aUriTail);
+    Brn buf = parser.Next('/');
+    if (parser.Remaining() != kServiceXmlName) {
+        return NULL;
+    }
+    return CachedServiceXml(buf);
+}
+
+DviProtocolUpnpCachedXml* DviProtocolUpnp::CachedDeviceXml(TIpAddress aAdapter)
+{ // called with iLock held; returned object has a reference claimed for the caller
+    const TInt index = FindListenerForInterface(aAdapter);
+    if (index == -1) {
+        return NULL;
+    }
+    // embedded devices are described within their parent's xml so the cached copy
+    // depends on the configuration of all devices below this one
+    const TUint version = DeviceXmlVersion(iDevice);
+    DviProtocolUpnpCachedXml* xml = iAdapters[index]->DeviceXml();
+    if (xml != NULL && xml->Version() != version) {
+        iAdapters[index]->ClearDeviceXml();
+        xml = NULL;
+    }
+    if (xml == NULL) {
+        Brh buf;
+        GetDeviceXml(buf, aAdapter);
+        xml = new DviProtocolUpnpCachedXml(iDvStack.Env(), buf, version);
+        iAdapters[index]->SetDeviceXml(xml);
+    }
+    xml->AddRef();
+    return xml;
+}
+
+TUint DviProtocolUpnp::DeviceXmlVersion(DviDevice& aDevice) const
+{
+    // config ids only increase so their sum changes whenever any of them does
+    TUint version = aDevice.ConfigId();
+    const TUint count = aDevice.DeviceCount();
+    for (TUint i=0; i<count; i++) {
+        version += DeviceXmlVersion(aDevice.Device(i));
+    }
+    return version;
+}
+
+DviProtocolUpnpCachedXml* DviProtocolUpnp::CachedServiceXml(const Brx& aServicePath)
+{ // called with iLock held; returned object has a reference claimed for the caller
+    const TUint count = iDevice.ServiceCount();
+    TUint index = 0;
+    for (; index<count; index++) {
+        if (iDevice.Service(index).ServiceType().PathUpnp() == aServicePath) {
+            break;
+        }
+    }
+    if (index == count) {
+        return NULL;
+    }
+    if (iServiceXml.size() != count) {
+        ClearServiceXml();
+        iServiceXml.resize(count, NULL);
+    }
+    const TUint configId = iDevice.ConfigId();
+    DviProtocolUpnpCachedXml* xml = iServiceXml[index];
+    if (xml != NULL && xml->Version() != configId) {
+        xml->RemoveRef();
+        xml = iServiceXml[index] = NULL;
+    }
+    if (xml == NULL) {
+        Brh buf;
+        DviProtocolUpnpServiceXmlWriter::Write(iDevice.Service(index), *this, buf);
+        xml = iServiceXml[index] = new DviProtocolUpnpCachedXml(iDvStack.Env(), buf, configId);
+    }
+    xml->AddRef();
+    return xml;
+}
+
+void DviProtocolUpnp::ClearServiceXml()
+{
+    for (TUint i=0; i<iServiceXml.size(); i++) {
+        if (iServiceXml[i] != NULL) {
+            iServiceXml[i]->RemoveRef();
         }
     }
+    iServiceXml.clear();
 }
 
 const Brx& DviProtocolUpnp::ProtocolName() const
@@ -321,6 +470,8 @@ void DviProtocolUpnp::Enable()
     ASSERT(Type().Bytes() > 0);
     ASSERT(Version() > 0);
     
+    ClearServiceXml();
+    iSsdpPackets->Clear();
     for (TUint i=0; i<iAdapters.size(); i++) {
         DviProtocolUpnpAdapterSpecificData* adapter = iAdapters[i];
         Bws<Uri::kMaxUriBytes> uriBase;
@@ -657,6 +808,7 @@ DviProtocolUpnpAdapterSpecificData::DviProtocolUpnpAdapterSpecificData(DvStack&
     , iAdapter(aAdapter.Address())
     , iUriBase(aUriBase)
     , iServerPort(aServerPort)
+    , iDeviceXml(NULL)
     , iBonjourWebPage(0)
     , iDevice(NULL)
 {
@@ -675,6 +827,7 @@ void DviProtocolUpnpAdapterSpecificData::Destroy()
 
 DviProtocolUpnpAdapterSpecificData::~DviProtocolUpnpAdapterSpecificData()
 {
+    ClearDeviceXml();
     if (iBonjourWebPage != NULL) {
         iBonjourWebPage->SetDisabled();
         delete iBonjourWebPage;
@@ -714,20 +867,23 @@ TUint DviProtocolUpnpAdapterSpecificData::ServerPort() const
     return iServerPort;
 }
 
-const Brx& DviProtocolUpnpAdapterSpecificData::DeviceXml() const
+DviProtocolUpnpCachedXml* DviProtocolUpnpAdapterSpecificData::DeviceXml() const
 {
     return iDeviceXml;
 }
 
-void DviProtocolUpnpAdapterSpecificData::SetDeviceXml(Brh& aXml)
+void DviProtocolUpnpAdapterSpecificData::SetDeviceXml(DviProtocolUpnpCachedXml* aXml)
 {
-    aXml.TransferTo(iDeviceXml);
+    ClearDeviceXml();
+    iDeviceXml = aXml;
 }
 
 void DviProtocolUpnpAdapterSpecificData::ClearDeviceXml()
 {
-    Brh tmp;
-    iDeviceXml.TransferTo(tmp);
+    if (iDeviceXml != NULL) {
+        iDeviceXml->RemoveRef();
+        iDeviceXml = NULL;
+    }
 }
 
 void DviProtocolUpnpAdapterSpecificData::SetPendingDelete()
@@ -1070,15 +1226,11 @@ void DviProtocolUpnpDeviceXmlWriter::WriteResourceEnd()
 
 // DviProtocolUpnpServiceXmlWriter
 
-void DviProtocolUpnpServiceXmlWriter::Write(const DviService& aService, const DviProtocolUpnp& aDevice, IResourceWriter& aResourceWriter)
+void DviProtocolUpnpServiceXmlWriter::Write(const DviService& aService, const DviProtocolUpnp& aDevice, Brh& aXml)
 {
     WriterBwh writer(1024);
     WriteServiceXml(writer, aService, aDevice);
-    Brh xml;
-    writer.TransferTo(xml);
-    aResourceWriter.WriteResourceBegin(xml.Bytes(), kOhNetMimeTypeXml);
-    aResourceWriter.WriteResource(xml.Ptr(), xml.Bytes());
-    aResourceWriter.WriteResourceEnd();
+    writer.TransferTo(aXml);
 }
 
 void DviProtocolUpnpServiceXmlWriter::WriteServiceXml(WriterBwh& aWriter, const DviService& aService, const DviProtocolUpnp& aDevice)
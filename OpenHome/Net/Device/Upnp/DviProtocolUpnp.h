@@ -23,6 +23,7 @@ class DviMsgScheduler;
 class DviProtocolUpnpDeviceXmlWriter;
 class BonjourWebPage;
 class DviProtocolUpnpAdapterSpecificData;
+class DviSsdpPacketCache;
 class DvStack;
 
 class IUpnpMsearchHandler
@@ -45,6 +46,33 @@ public:
     virtual Brn Domain() const = 0;
     virtual Brn Type() const = 0;
     virtual TUint Version() const = 0;
+    virtual DviSsdpPacketCache& SsdpPackets() = 0;
+};
+
+/**
+ * Reference counted copy of a device or service description.
+ *
+ * Descriptions are only regenerated when the configuration they describe changes (see
+ * Version()) so the entity tag, derived from the content, is stable across restarts of
+ * the device.
+ */
+class DviProtocolUpnpCachedXml : private INonCopyable
+{
+public:
+    DviProtocolUpnpCachedXml(Environment& aEnv, Brh& aXml, TUint aVersion);
+    void AddRef();
+    void RemoveRef();
+    const Brx& Xml() const;
+    const Brx& ETag() const;
+    TUint Version() const; // ConfigId of the device(s) described when the xml was generated
+private:
+    ~DviProtocolUpnpCachedXml();
+private:
+    Environment& iEnv;
+    TUint iRefCount;
+    Brh iXml;
+    Bws<DviResourceCache::kMaxETagBytes> iETag;
+    TUint iVersion;
 };
 
 class DviProtocolUpnp : public IDvProtocol, private IUpnpMsearchHandler, private IUpnpAnnouncementData
@@ -68,6 +96,7 @@ public: // from IUpnpAnnouncementData
     Brn Domain() const;
     Brn Type() const;
     TUint Version() const;
+    DviSsdpPacketCache& SsdpPackets();
     void SendByeByes(TIpAddress aAdapter, const Brx& aUriBase, Functor aCompleted);
     void SendAlives(TIpAddress aAdapter, const Brx& aUriBase);
 private:
@@ -83,6 +112,12 @@ private:
     void SendUpdateNotifications();
     void GetUriDeviceXml(Bwx& aUri, const Brx& aUriBase);
     void GetDeviceXml(Brh& aXml, TIpAddress aAdapter);
+    DviProtocolUpnpCachedXml* CachedXml(const Brx& aUriTail, TIpAddress aAdapter);
+    DviProtocolUpnpCachedXml* CachedDeviceXml(TIpAddress aAdapter);
+    TUint DeviceXmlVersion(DviDevice& aDevice) const;
+    static void WriteXml(const DviProtocolUpnpCachedXml& aXml, IResourceWriter& aResourceWriter);
+    DviProtocolUpnpCachedXml* CachedServiceXml(const Brx& aServicePath);
+    void ClearServiceXml();
     void LogMulticastNotification(const char* aType);
     void LogUnicastNotification(const char* aType);
 public: // from IDvProtocol
@@ -94,6 +129,7 @@ public: // from IDvProtocol
     void SetAttribute(const TChar* aKey, const TChar* aValue);
     void SetCustomData(const TChar* aTag, void* aData);
     void GetResourceManagerUri(const NetworkAdapter& aAdapter, Brh& aUri);
+    TBool WriteValidatedResource(const Brx& aUriTail, TIpAddress aInterface, IResourceWriterHttp& aResourceWriter);
 private: // from IUpnpMsearchHandler
     void SsdpSearchAll(const Endpoint& aEndpoint, TUint aMx, TIpAddress aAdapter);
     void SsdpSearchRoot(const Endpoint& aEndpoint, TUint aMx, TIpAddress aAdapter);
@@ -106,6 +142,7 @@ private:
     AttributeMap iAttributeMap;
     Mutex iLock;
     std::vector<DviProtocolUpnpAdapterSpecificData*> iAdapters;
+    std::vector<DviProtocolUpnpCachedXml*> iServiceXml; // indexed as iDevice.Service()
     TInt iCurrentAdapterChangeListenerId;
     TInt iSubnetListChangeListenerId;
     std::vector<DviMsgScheduler*> iMsgSchedulers;
@@ -115,6 +152,7 @@ private:
     TUint iUpdateCount;
     TBool iSuppressScheduledEvents;
     DviServerUpnp* iServer;
+    DviSsdpPacketCache* iSsdpPackets;
 };
 
 class DviProtocolUpnpAdapterSpecificData : public ISsdpMsearchHandler, public INonCopyable
@@ -129,8 +167,8 @@ public:
     void UpdateServerPort(DviServerUpnp& aServer);
     void UpdateUriBase(Bwx& aUriBase);
     TUint ServerPort() const;
-    const Brx& DeviceXml() const;
-    void SetDeviceXml(Brh& aXml);
+    DviProtocolUpnpCachedXml* DeviceXml() const;
+    void SetDeviceXml(DviProtocolUpnpCachedXml* aXml);
     void ClearDeviceXml();
     void SetPendingDelete();
     void BonjourRegister(const TChar* aName, const Brx& aUdn, const Brx& aProtocol, const Brx& aResourceDir);
@@ -156,7 +194,7 @@ private:
     TIpAddress iAdapter;
     Bws<Uri::kMaxUriBytes> iUriBase;
     TUint iServerPort;
-    Brh iDeviceXml;
+    DviProtocolUpnpCachedXml* iDeviceXml;
     BonjourWebPage* iBonjourWebPage;
     DviProtocolUpnp* iDevice;
 };
@@ -193,7 +231,7 @@ private:
 class DviProtocolUpnpServiceXmlWriter
 {
 public:
-    static void Write(const DviService& aService, const DviProtocolUpnp& aDevice, IResourceWriter& aResourceWriter);
+    static void Write(const DviService& aService, const DviProtocolUpnp& aDevice, Brh& aXml);
 private:
     static void WriteServiceXml(WriterBwh& aWriter, const DviService& aService, const DviProtocolUpnp& aDevice);
     static void WriteServiceActionParams(WriterBwh& aWriter, const Action& aAction, TBool aIn);
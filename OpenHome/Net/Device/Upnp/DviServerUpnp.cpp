@@ -13,6 +13,7 @@
 #include <OpenHome/Net/Private/XmlParser.h>
 #include <OpenHome/Private/Converter.h>
 #include <OpenHome/Private/Stream.h>
+#include <OpenHome/Private/Timer.h>
 #include <OpenHome/Net/Core/OhNet.h>
 #include <OpenHome/Private/Debug.h>
 #include <OpenHome/Net/Private/Error.h>
@@ -270,6 +271,42 @@ void HeaderAcceptLanguage::AddPrioritisedLanguage(std::vector<PrioritisedLanguag
 }
 
 
+// HeaderAcceptEncoding
+
+TBool HeaderAcceptEncoding::Gzip() const
+{
+    return (Received() && iGzip);
+}
+
+TBool HeaderAcceptEncoding::Recognise(const Brx& aHeader)
+{
+    return Ascii::CaseInsensitiveEquals(aHeader, Http::kHeaderAcceptEncoding);
+}
+
+void HeaderAcceptEncoding::Process(const Brx& aValue)
+{
+    static const Brn kGzip("gzip");
+    static const Brn kGzipLegacy("x-gzip");
+    SetReceived();
+    iGzip = false;
+    Parser parser(aValue);
+    while (parser.Remaining().Bytes() > 0) {
+        Brn coding = parser.Next(',');
+        Parser parser2(coding);
+        Brn name = Ascii::Trim(parser2.Next(';'));
+        if (Ascii::CaseInsensitiveEquals(name, kGzip) || Ascii::CaseInsensitiveEquals(name, kGzipLegacy)) {
+            // "q=0" (with any number of trailing zeroes) means gzip is not acceptable
+            Brn quality = Ascii::Trim(parser2.Remaining());
+            TBool refused = (quality.Bytes() >= 3 && quality[0] == 'q' && quality[1] == '=' && quality[2] == '0');
+            for (TUint i=3; refused && i<quality.Bytes(); i++) {
+                refused = (quality[i] == '.' || quality[i] == '0');
+            }
+            iGzip = !refused;
+        }
+    }
+}
+
+
 // SubscriptionDataUpnp
 
 SubscriptionDataUpnp::SubscriptionDataUpnp(const Endpoint& aSubscriber, const Brx& aSubscriberPath, const Http::EVersion aHttpVersion)
@@ -310,105 +347,168 @@ void SubscriptionDataUpnp::Release()
 PropertyWriterUpnp* PropertyWriterUpnp::Create(DvStack& aDvStack, const Endpoint& aPublisher, const Endpoint& aSubscriber,
                                                const Brx& aSubscriberPath, const Http::EVersion aHttpVersion, const Brx& aSid, TUint aSequenceNumber)
 { // static
-    PropertyWriterUpnp* self = new PropertyWriterUpnp(aDvStack);
-    try {
-        self->Connect(aSubscriber);
-        self->WriteHeaders(aPublisher, aSubscriberPath, aHttpVersion, aSid, aSequenceNumber);
-    }
-    catch (NetworkTimeout&) {
-        delete self;
-        throw;
-    }
-    catch (NetworkError&) {
-        delete self;
-        throw;
-    }
-    catch (WriterError&) {
-        delete self;
-        throw;
-    }
-    return self;
+    return new PropertyWriterUpnp(aDvStack, aPublisher, aSubscriber, aSubscriberPath, aHttpVersion, aSid, aSequenceNumber);
 }
 
-PropertyWriterUpnp::PropertyWriterUpnp(DvStack& aDvStack)
+PropertyWriterUpnp::PropertyWriterUpnp(DvStack& aDvStack, const Endpoint& aPublisher, const Endpoint& aSubscriber,
+                                       const Brx& aSubscriberPath, const Http::EVersion aHttpVersion, const Brx& aSid, TUint aSequenceNumber)
     : iDvStack(aDvStack)
-    , iWriteBuffer(NULL)
-    , iWriterEvent(NULL)
-    , iWriterChunked(NULL)
-{
-}
+    , iPublisher(aPublisher)
+    , iSubscriber(aSubscriber)
+    , iSubscriberPath(aSubscriberPath)
+    , iHttpVersion(aHttpVersion)
+    , iSid(aSid)
+    , iSequenceNumber(aSequenceNumber)
+    , iBody(kBodyGranularity)
+    , iSocket(NULL)
+    , iKeepAlive(false)
+    , iRequestSent(false)
+    , iResponseReceived(false)
+    , iReadDeadline(0)
+    , iReusable(false)
+{
+    SetWriter(iBody);
+    iBody.Write(Brn("<?xml version=\"1.0\"?>"));
+    iBody.Write(Brn("<e:propertyset xmlns:e=\"urn:schemas-upnp-org:event-1-0\">"));
+}
+
+void PropertyWriterUpnp::Connect()
+{
+    iSocket = new SocketTcpClient();
+    iSocket->Open(iDvStack.Env());
+    iSocket->Connect(iSubscriber, iDvStack.Env().InitParams().TcpConnectTimeoutMs());
+}
+
+void PropertyWriterUpnp::Notify(const Brx& aBody)
+{
+    iRequestSent = false;
+    iResponseReceived = false;
+    iReusable = false;
+    Swd writeBuffer(iDvStack.Env().InitParams().DvNotifyBufferBytes(), *iSocket);
+    WriterHttpRequest writerEvent(writeBuffer);
+    WriteHeaders(writerEvent, aBody.Bytes());
+    writeBuffer.Write(aBody);
+    writeBuffer.WriteFlush();
+    iRequestSent = true;
+    iReadDeadline = Time::Now(iDvStack.Env()) + kReadTimeoutMs;
+
+    Srs<kMaxResponseBytes> readBuffer(*iSocket);
+    ReaderHttpResponse readerResponse(iDvStack.Env(), readBuffer);
+    HttpHeaderContentLength headerContentLength;
+    HttpHeaderConnection headerConnection;
+    readerResponse.AddHeader(headerContentLength);
+    readerResponse.AddHeader(headerConnection);
+    readerResponse.Read(kReadTimeoutMs);
+    iResponseReceived = true;
+    const HttpStatus& status = readerResponse.Status();
+    if (status != HttpStatus::kOk) {
+        LOG2(kDvEvent, kError, "PropertyWriter, http error %u ", status.Code());
+        LOG2(kDvEvent, kError, status.Reason());
+        LOG2(kDvEvent, kError, "\n");
+    }
 
-void PropertyWriterUpnp::Connect(const Endpoint& aSubscriber)
-{
-    iSocket.Open(iDvStack.Env());
-    iSocket.Connect(aSubscriber, iDvStack.Env().InitParams().TcpConnectTimeoutMs());
+    // only reuse the connection if the subscriber has said where its response ends
+    if (iKeepAlive && readerResponse.Version() == Http::eHttp11 &&
+        !headerConnection.Close() && headerContentLength.Received()) {
+        TUint remaining = headerContentLength.ContentLength();
+        while (remaining > 0) {
+            TUint bytes = (remaining<kMaxResponseBytes? remaining : kMaxResponseBytes);
+            (void)readBuffer.Read(bytes);
+            remaining -= bytes;
+        }
+        iReusable = (readBuffer.Buffered() == 0);
+    }
 }
 
-void PropertyWriterUpnp::WriteHeaders(const Endpoint& aPublisher, const Brx& aSubscriberPath,
-                                      const Http::EVersion aHttpVersion, const Brx& aSid, TUint aSequenceNumber)
+void PropertyWriterUpnp::WriteHeaders(WriterHttpRequest& aWriter, TUint aBodyBytes)
 {
-    iWriterChunked = new WriterHttpChunked(iSocket);
-    iWriteBuffer = new Sws<kMaxRequestBytes>(*iWriterChunked);
-    iWriterEvent = new WriterHttpRequest(*iWriteBuffer);
-    SetWriter(*iWriteBuffer);
-
-    iWriterEvent->WriteMethod(kUpnpMethodNotify, aSubscriberPath, Http::eHttp11);
+    aWriter.WriteMethod(kUpnpMethodNotify, iSubscriberPath, Http::eHttp11);
 
-    IWriterAscii& writer = iWriterEvent->WriteHeaderField(Http::kHeaderHost);
+    IWriterAscii& writer = aWriter.WriteHeaderField(Http::kHeaderHost);
     Endpoint::EndpointBuf buf;
-    aPublisher.AppendEndpoint(buf);
+    iPublisher.AppendEndpoint(buf);
     writer.Write(buf);
     writer.WriteFlush();
 
-    iWriterEvent->WriteHeader(Http::kHeaderContentType, Brn("text/xml; charset=\"utf-8\""));
-    iWriterEvent->WriteHeader(kUpnpHeaderNt, Brn("upnp:event"));
-    iWriterEvent->WriteHeader(kUpnpHeaderNts, Brn("upnp:propchange"));
+    aWriter.WriteHeader(Http::kHeaderContentType, Brn("text/xml; charset=\"utf-8\""));
+    aWriter.WriteHeader(kUpnpHeaderNt, Brn("upnp:event"));
+    aWriter.WriteHeader(kUpnpHeaderNts, Brn("upnp:propchange"));
 
-    writer = iWriterEvent->WriteHeaderField(HeaderSid::kHeaderSid);
+    writer = aWriter.WriteHeaderField(HeaderSid::kHeaderSid);
     writer.Write(HeaderSid::kFieldSidPrefix);
-    writer.Write(aSid);
+    writer.Write(iSid);
     writer.WriteFlush();
 
-    if (aHttpVersion == Http::eHttp11) {
-        iWriterEvent->WriteHeader(Http::kHeaderTransferEncoding, Http::kTransferEncodingChunked);
-    }
-
-    writer = iWriterEvent->WriteHeaderField(kUpnpHeaderSeq);
-    writer.WriteUint(aSequenceNumber);
+    writer = aWriter.WriteHeaderField(kUpnpHeaderSeq);
+    writer.WriteUint(iSequenceNumber);
     writer.WriteFlush();
 
-    iWriterEvent->WriteHeader(Http::kHeaderConnection, Http::kConnectionClose);
-    iWriterEvent->WriteFlush();
-    if (aHttpVersion == Http::eHttp11) {
-        iWriterChunked->SetChunked(true);
+    Http::WriteHeaderContentLength(aWriter, aBodyBytes);
+    if (!iKeepAlive) {
+        Http::WriteHeaderConnectionClose(aWriter);
     }
+    aWriter.WriteHeaderEnd(); // header is sent along with the body when Notify() flushes
+}
 
-    iWriteBuffer->Write(Brn("<?xml version=\"1.0\"?>"));
-    iWriteBuffer->Write(Brn("<e:propertyset xmlns:e=\"urn:schemas-upnp-org:event-1-0\">"));
+TBool PropertyWriterUpnp::CanRetry()
+{
+    /* A pooled connection may have been closed by the subscriber since it was last used.
+       Retry on a new connection if sending the notification failed or if the connection
+       was closed (rather than timed out) before any response arrived.  A subscriber which
+       did process the notification can spot the resend from its repeated SEQ header. */
+    if (iResponseReceived) {
+        return false;
+    }
+    if (iRequestSent && !Time::IsInFuture(iDvStack.Env(), iReadDeadline)) {
+        return false;
+    }
+    LOG(kDvEvent, "PropertyWriter, pooled connection failed, reconnecting\n");
+    SocketTcpClientPool::Close(iSocket);
+    iSocket = NULL;
+    return true;
 }
 
 PropertyWriterUpnp::~PropertyWriterUpnp()
 {
-    delete iWriterEvent;
-    delete iWriteBuffer;
-    delete iWriterChunked;
-    iSocket.Close();
+    if (iSocket != NULL) {
+        if (iReusable) {
+            iDvStack.EventConnectionPool().Release(iSocket, iSubscriber);
+        }
+        else {
+            SocketTcpClientPool::Close(iSocket);
+        }
+    }
 }
 
 void PropertyWriterUpnp::PropertyWriteEnd()
 {
-    iWriteBuffer->Write(Brn("</e:propertyset>"));
-    iWriteBuffer->WriteFlush();
-
-    Srs<kMaxResponseBytes> readBuffer(iSocket);
-    ReaderHttpResponse readerResponse(iDvStack.Env(), readBuffer);
-    readerResponse.Read(kReadTimeoutMs);
-    const HttpStatus& status = readerResponse.Status();
-    if (status != HttpStatus::kOk) {
-        LOG2(kDvEvent, kError, "PropertyWriter, http error %u ", status.Code());
-        LOG2(kDvEvent, kError, status.Reason());
-        LOG2(kDvEvent, kError, "\n");
+    iBody.Write(Brn("</e:propertyset>"));
+    Bwh body;
+    iBody.TransferTo(body);
+
+    SocketTcpClientPool& pool = iDvStack.EventConnectionPool();
+    iKeepAlive = (pool.Enabled() && iHttpVersion == Http::eHttp11);
+    if (iKeepAlive) {
+        iSocket = pool.Acquire(iSubscriber);
+        if (iSocket != NULL) {
+            try {
+                Notify(body);
+                return;
+            }
+            catch (NetworkError&) {
+                if (!CanRetry()) {
+                    throw;
+                }
+            }
+            catch (WriterError&) {
+                if (!CanRetry()) {
+                    throw;
+                }
+            }
+        }
     }
+    Connect();
+    Notify(body);
 }
 
 
@@ -519,6 +619,16 @@ void PropertyWriterFactory::RemoveRef()
 }
 
 
+// DviSessionUpnp::SoapArgument
+
+DviSessionUpnp::SoapArgument::SoapArgument(const Brx& aName, const Brx& aValue)
+    : iName(aName)
+    , iValue(aValue)
+    , iConverted(false)
+{
+}
+
+
 // DviSessionUpnp
 
 DviSessionUpnp::DviSessionUpnp(DvStack& aDvStack, TIpAddress aInterface, TUint aPort, IRedirector& aRedirector)
@@ -526,12 +636,23 @@ DviSessionUpnp::DviSessionUpnp(DvStack& aDvStack, TIpAddress aInterface, TUint a
     , iInterface(aInterface)
     , iPort(aPort)
     , iRedirector(aRedirector)
+    , iSoapArgNext(0)
     , iShutdownSem("DSUS", 1)
 {
-    iReadBuffer = new Srs<kMaxRequestBytes>(*this);
+    iSoapArgs.reserve(kMaxArgsReserved);
+    iKeepAliveIdleMs = aDvStack.Env().InitParams().DvKeepAliveIdleTimeoutMs();
+    iKeepAliveMaxRequests = aDvStack.Env().InitParams().DvKeepAliveMaxRequests();
+    iMaxRequestBytes = aDvStack.Env().InitParams().DvMaxRequestBytes();
+    iAdaptiveBuffers = aDvStack.Env().InitParams().UseAdaptiveSessionBuffers();
+    iReadBufferInitialBytes = iMaxRequestBytes;
+    if (iAdaptiveBuffers && iReadBufferInitialBytes > kAdaptiveReadBytes) {
+        iReadBufferInitialBytes = kAdaptiveReadBytes;
+    }
+    iRequestsSinceGrown = 0;
+    iReadBuffer = new Srd(iReadBufferInitialBytes, *this);
     iReaderRequest = new ReaderHttpRequest(aDvStack.Env(), *iReadBuffer);
     iWriterChunked = new WriterHttpChunked(*this);
-    iWriterBuffer = new Sws<kMaxResponseBytes>(*iWriterChunked);
+    iWriterBuffer = new Swd(aDvStack.Env().InitParams().DvResponseBufferBytes(), *iWriterChunked);
     iWriterResponse = new WriterHttpResponse(*iWriterBuffer);
 
     iReaderRequest->AddMethod(Http::kMethodGet);
@@ -551,6 +672,9 @@ DviSessionUpnp::DviSessionUpnp(DvStack& aDvStack, TIpAddress aInterface, TUint a
     iReaderRequest->AddHeader(iHeaderNt);
     iReaderRequest->AddHeader(iHeaderCallback);
     iReaderRequest->AddHeader(iHeaderAcceptLanguage);
+    iReaderRequest->AddHeader(iHeaderIfNoneMatch);
+    iReaderRequest->AddHeader(iHeaderAcceptEncoding);
+    iReaderRequest->AddHeader(iHeaderRange);
 
     iPropertyWriterFactory = new PropertyWriterFactory(iDvStack, aInterface, aPort);
 }
@@ -570,19 +694,90 @@ DviSessionUpnp::~DviSessionUpnp()
 void DviSessionUpnp::Run()
 {
     iShutdownSem.Wait();
-    iErrorStatus = &HttpStatus::kOk;
     iReaderRequest->Flush();
+    TUint requestCount = UseCount();
+    TUint readTimeoutMs = kReadTimeoutMs;
+    for (;;) {
+        requestCount++;
+        if (!HandleRequest(requestCount, readTimeoutMs)) {
+            break;
+        }
+        if (iReadBuffer->Buffered() == 0) {
+            iReaderRequest->Flush();
+            if (CanPark()) {
+                // no pipelined request waiting; free this session until the client sends more data
+                ShrinkReadBuffer();
+                Park(iKeepAliveIdleMs, requestCount);
+                break;
+            }
+            if (++iRequestsSinceGrown >= kAdaptiveShrinkRequests) {
+                ShrinkReadBuffer();
+            }
+        }
+        readTimeoutMs = iKeepAliveIdleMs;
+    }
+    ShrinkReadBuffer();
+    iShutdownSem.Signal();
+}
+
+void DviSessionUpnp::ReserveReadBytes(TUint aBytes)
+{
+    // grow an adaptive read buffer so that a request body of aBytes can be read in one go
+    if (!iAdaptiveBuffers || aBytes <= iReadBufferInitialBytes) {
+        return;
+    }
+    iRequestsSinceGrown = 0;
+    const TUint maxBytes = iReadBuffer->MaxBytes();
+    if (aBytes <= maxBytes || maxBytes >= iMaxRequestBytes) {
+        return;
+    }
+    TUint bytes = maxBytes * 2;
+    if (bytes < aBytes) {
+        bytes = aBytes;
+    }
+    if (bytes > iMaxRequestBytes) {
+        bytes = iMaxRequestBytes;
+    }
+    iReadBuffer->Resize(bytes);
+}
+
+void DviSessionUpnp::ShrinkReadBuffer()
+{
+    iRequestsSinceGrown = 0;
+    if (iAdaptiveBuffers && iReadBuffer->Buffered() == 0 && iReadBuffer->MaxBytes() > iReadBufferInitialBytes) {
+        iReadBuffer->Resize(iReadBufferInitialBytes);
+    }
+}
+
+// Returns true if the connection can be used for another request
+TBool DviSessionUpnp::HandleRequest(TUint aRequestCount, TUint aReadTimeoutMs)
+{
+    iErrorStatus = &HttpStatus::kOk;
     iWriterChunked->SetChunked(false);
     iInvocationService = NULL;
     iResourceWriterHeadersOnly = false;
+    iResourceETag.SetBytes(0);
+    iResourceGzipped = false;
+    iResourceVaryEncoding = false;
+    iResourceRanged = false;
+    iKeepAlive = false;
+    iResponseStarted = false;
+    iResponseEnded = false;
     // check headers
     try {
         try {
-            iReaderRequest->Read(kReadTimeoutMs);
+            iReaderRequest->Read(aReadTimeoutMs);
         }
         catch (HttpError&) {
             Error(HttpStatus::kBadRequest);
         }
+        catch (ReaderError&) {
+            if (aRequestCount > 1) {
+                // client closed (or didn't reuse) a persistent connection; nothing to respond to
+                return false;
+            }
+            throw;
+        }
         if (iReaderRequest->MethodNotAllowed()) {
             Error(HttpStatus::kMethodNotAllowed);
         }
@@ -598,8 +793,14 @@ void DviSessionUpnp::Run()
         LOG(kDvDevice, "\n");
         lock.Signal();
 
-        iResponseStarted = false;
-        iResponseEnded = false;
+        iKeepAlive = (iKeepAliveIdleMs > 0 &&
+                      aRequestCount < iKeepAliveMaxRequests &&
+                      iReaderRequest->Version() == Http::eHttp11 &&
+                      !iHeaderConnection.Close());
+        if (method != Http::kMethodPost &&
+            (iHeaderContentLength.ContentLength() > 0 || iHeaderTransferEncoding.IsChunked())) {
+            iKeepAlive = false; // we'd have to skip an entity body we don't expect
+        }
         if (method == Http::kMethodGet) {
             Get();
         }
@@ -618,16 +819,19 @@ void DviSessionUpnp::Run()
         }
     }
     catch (HttpError&) {
+        iKeepAlive = false;
         if (iErrorStatus == &HttpStatus::kOk) {
             iErrorStatus = &HttpStatus::kBadRequest;
         }
     }
     catch (ReaderError&) {
+        iKeepAlive = false;
         if (iErrorStatus == &HttpStatus::kOk) {
             iErrorStatus = &HttpStatus::kBadRequest;
         }
     }
     catch (WriterError&) {
+        iKeepAlive = false;
     }
     try {
         if (!iResponseStarted) {
@@ -635,15 +839,19 @@ void DviSessionUpnp::Run()
                 iErrorStatus = &HttpStatus::kNotFound;
             }
             iWriterResponse->WriteStatus(*iErrorStatus, Http::eHttp11);
-            Http::WriteHeaderConnectionClose(*iWriterResponse);
+            Http::WriteHeaderContentLength(*iWriterResponse, 0);
+            WriteConnectionHeader();
             iWriterResponse->WriteFlush();
         }
         else if (!iResponseEnded) {
+            iKeepAlive = false;
             iWriterResponse->WriteFlush();
         }
     }
-    catch (WriterError&) {}
-    iShutdownSem.Signal();
+    catch (WriterError&) {
+        iKeepAlive = false;
+    }
+    return iKeepAlive;
 }
 
 void DviSessionUpnp::Error(const HttpStatus& aStatus)
@@ -652,6 +860,21 @@ void DviSessionUpnp::Error(const HttpStatus& aStatus)
     THROW(HttpError);
 }
 
+void DviSessionUpnp::WriteConnectionHeader()
+{
+    if (!iKeepAlive) {
+        Http::WriteHeaderConnectionClose(*iWriterResponse);
+    }
+}
+
+void DviSessionUpnp::WriteHeaderEnd()
+{
+    /* Pass the header through iWriterChunked before any chunking is enabled but leave
+       it buffered there so that it is sent along with the start of the body. */
+    iWriterResponse->WriteHeaderEnd();
+    iWriterBuffer->WriteDrain();
+}
+
 void DviSessionUpnp::Get()
 {
     if (iReaderRequest->Version() == Http::eHttp11) {
@@ -675,6 +898,8 @@ void DviSessionUpnp::Get()
         writerLocation.Write(endptBuf);
         writerLocation.Write(redirectTo);
         writerLocation.WriteFlush();
+        Http::WriteHeaderContentLength(*iWriterResponse, 0);
+        WriteConnectionHeader();
         iWriterResponse->WriteFlush();
         iResponseEnded = true;
     }
@@ -703,6 +928,7 @@ void DviSessionUpnp::Post()
                 iWriterResponse->WriteFlush();
             }
             if (iHeaderContentLength.ContentLength() != 0) {
+                ReserveReadBytes(iHeaderContentLength.ContentLength());
                 iSoapRequest.Set(iReadBuffer->Read(iHeaderContentLength.ContentLength()));
             }
             else if (!iHeaderTransferEncoding.IsChunked()) {
@@ -711,8 +937,9 @@ void DviSessionUpnp::Post()
             }
             else {
                 /* Dechunk into iReadBuffer's buffer
-                   This is a bit nasty.  It relies on Srs filling its buffer before resetting its iOffset member
-                   ...and relies on us reading a maximum kMaxRequestBytes chunked bytes */
+                   This is a bit nasty.  It relies on Srd filling its buffer before resetting its iOffset member
+                   ...and relies on us reading a maximum iMaxRequestBytes chunked bytes */
+                ReserveReadBytes(iMaxRequestBytes);
                 TUint len = 0, bytes = 0;
                 TByte *ptr = NULL, *dechunked = NULL;
                 for (;;) {
@@ -722,7 +949,7 @@ void DviSessionUpnp::Post()
                         dechunked = ptr;
                     }
                     bytes += chunkSizeBuf.Bytes() + 1; // include LF separator
-                    if (bytes > kMaxRequestBytes) {
+                    if (bytes > iMaxRequestBytes) {
                         iErrorStatus = &HttpStatus::kRequestEntityTooLarge;
                         THROW(ReaderError);
                     }
@@ -740,11 +967,23 @@ void DviSessionUpnp::Post()
                         THROW(ReaderError);
                     }
                     if (chunkSize == 0) {
+                        // consume any trailers so a persistent connection is left at the start of the next request
+                        for (;;) {
+                            Brn trailer = iReadBuffer->ReadUntil(Ascii::kLf);
+                            bytes += trailer.Bytes() + 1;
+                            if (bytes > iMaxRequestBytes) {
+                                iErrorStatus = &HttpStatus::kRequestEntityTooLarge;
+                                THROW(ReaderError);
+                            }
+                            if (Ascii::Trim(trailer).Bytes() == 0) {
+                                break;
+                            }
+                        }
                         break;
                     }
                     len += chunkSize;
                     bytes += chunkSize;
-                    if (bytes > kMaxRequestBytes) {
+                    if (bytes > iMaxRequestBytes) {
                         iErrorStatus = &HttpStatus::kRequestEntityTooLarge;
                         THROW(ReaderError);
                     }
@@ -763,6 +1002,7 @@ void DviSessionUpnp::Post()
         }
     }
     else {
+        iKeepAlive = false; // request body hasn't been read
         const HttpStatus* err = &HttpStatus::kNotFound;
         InvocationReportErrorNoThrow(err->Code(), err->Reason());
     }
@@ -818,7 +1058,8 @@ void DviSessionUpnp::Subscribe()
     writerTimeout.Write(HeaderTimeout::kFieldTimeoutPrefix);
     writerTimeout.WriteUint(duration);
     writerTimeout.WriteFlush();
-    iWriterResponse->WriteHeader(Http::kHeaderConnection, Http::kConnectionClose);
+    Http::WriteHeaderContentLength(*iWriterResponse, 0);
+    WriteConnectionHeader();
     iWriterResponse->WriteFlush();
     iResponseEnded = true;
 
@@ -865,7 +1106,8 @@ void DviSessionUpnp::Unsubscribe()
     }
     iResponseStarted = true;
     iWriterResponse->WriteStatus(HttpStatus::kOk, Http::eHttp11);
-    iWriterResponse->WriteHeader(Http::kHeaderConnection, Http::kConnectionClose);
+    Http::WriteHeaderContentLength(*iWriterResponse, 0);
+    WriteConnectionHeader();
     iWriterResponse->WriteFlush();
     iResponseEnded = true;
 
@@ -909,7 +1151,8 @@ void DviSessionUpnp::Renew()
     writerTimeout.Write(HeaderTimeout::kFieldTimeoutPrefix);
     writerTimeout.WriteUint(duration);
     writerTimeout.WriteFlush();
-    iWriterResponse->WriteHeader(Http::kHeaderConnection, Http::kConnectionClose);
+    Http::WriteHeaderContentLength(*iWriterResponse, 0);
+    WriteConnectionHeader();
     iWriterResponse->WriteFlush();
     iResponseEnded = true;
 
@@ -969,9 +1212,32 @@ void DviSessionUpnp::WriteResourceBegin(TUint aTotalBytes, const TChar* aMimeTyp
         iWriterResponse->WriteStatus(HttpStatus::kContinue, Http::eHttp11);
         iWriterResponse->WriteFlush();
     }
-    iWriterResponse->WriteStatus(HttpStatus::kOk, Http::eHttp11);
+    iResourceRanged = (aTotalBytes > 0 && iHeaderRange.Resolve(aTotalBytes, iResourceRangeOffset, iResourceRangeBytes));
+    iResourcePosition = 0;
+    if (!iResourceRanged) {
+        iWriterResponse->WriteStatus(HttpStatus::kOk, Http::eHttp11);
+    }
+    else if (iResourceRangeBytes > 0) {
+        iWriterResponse->WriteStatus(HttpStatus::kPartialContent, Http::eHttp11);
+        IWriterAscii& writer = iWriterResponse->WriteHeaderField(Http::kHeaderContentRange);
+        writer.Write(Brn("bytes "));
+        writer.WriteUint(iResourceRangeOffset);
+        writer.Write('-');
+        writer.WriteUint(iResourceRangeOffset + iResourceRangeBytes - 1);
+        writer.Write('/');
+        writer.WriteUint(aTotalBytes);
+        writer.WriteFlush();
+    }
+    else {
+        iWriterResponse->WriteStatus(HttpStatus::kRequestedRangeNotSatisfiable, Http::eHttp11);
+        IWriterAscii& writer = iWriterResponse->WriteHeaderField(Http::kHeaderContentRange);
+        writer.Write(Brn("bytes */"));
+        writer.WriteUint(aTotalBytes);
+        writer.WriteFlush();
+    }
     if (aTotalBytes > 0) {
-        Http::WriteHeaderContentLength(*iWriterResponse, aTotalBytes);
+        Http::WriteHeaderContentLength(*iWriterResponse, (iResourceRanged? iResourceRangeBytes : aTotalBytes));
+        iWriterResponse->WriteHeader(Http::kHeaderAcceptRanges, Brn("bytes"));
     }
     else {
         if (iReaderRequest->Version() == Http::eHttp11) { 
@@ -984,8 +1250,20 @@ void DviSessionUpnp::WriteResourceBegin(TUint aTotalBytes, const TChar* aMimeTyp
         writer.Write(Brn("; charset=\"utf-8\""));
         writer.WriteFlush();
     }
-    Http::WriteHeaderConnectionClose(*iWriterResponse);
-    iWriterResponse->WriteFlush();
+    if (iResourceETag.Bytes() > 0) {
+        iWriterResponse->WriteHeader(Http::kHeaderETag, iResourceETag);
+    }
+    if (iResourceGzipped) {
+        iWriterResponse->WriteHeader(Http::kHeaderContentEncoding, Brn("gzip"));
+    }
+    if (iResourceVaryEncoding) {
+        iWriterResponse->WriteHeader(Http::kHeaderVary, Http::kHeaderAcceptEncoding);
+    }
+    if (aTotalBytes == 0 && iResourceWriterHeadersOnly) {
+        iKeepAlive = false; // can't reliably delimit a chunked response with no body
+    }
+    WriteConnectionHeader();
+    WriteHeaderEnd();
     if (aTotalBytes == 0) {
         if (iReaderRequest->Version() == Http::eHttp11) { 
             iWriterChunked->SetChunked(true);
@@ -1000,6 +1278,18 @@ void DviSessionUpnp::WriteResource(const TByte* aData, TUint aBytes)
         return;
     }
     Brn buf(aData, aBytes);
+    if (iResourceRanged) {
+        // clip to the requested range; resource managers that don't call GetRequiredRange write everything
+        const TUint start = iResourcePosition;
+        iResourcePosition += aBytes;
+        const TUint rangeEnd = iResourceRangeOffset + iResourceRangeBytes;
+        if (iResourcePosition <= iResourceRangeOffset || start >= rangeEnd) {
+            return;
+        }
+        const TUint skip = (start < iResourceRangeOffset? iResourceRangeOffset - start : 0);
+        const TUint end = (iResourcePosition > rangeEnd? rangeEnd : iResourcePosition);
+        buf.Set(aData + skip, end - start - skip);
+    }
 #if 0
     Log::Print("Writing resource...\n");
     Log::Print(buf);
@@ -1014,6 +1304,49 @@ void DviSessionUpnp::WriteResourceEnd()
     iWriterBuffer->WriteFlush();
 }
 
+void DviSessionUpnp::GetRequiredRange(TUint& aOffset, TUint& aBytes)
+{
+    aOffset = 0;
+    aBytes = 0xffffffff;
+    if (iResourceWriterHeadersOnly) {
+        aBytes = 0;
+    }
+    else if (iResourceRanged) {
+        aOffset = iResourceRangeOffset;
+        aBytes = iResourceRangeBytes;
+    }
+    iResourcePosition = aOffset;
+}
+
+TBool DviSessionUpnp::AcceptsGzip() const
+{
+    return iHeaderAcceptEncoding.Gzip();
+}
+
+TBool DviSessionUpnp::WriteNotModified(const Brx& aETag, TBool aVaryEncoding)
+{
+    if (!iHeaderIfNoneMatch.Matches(aETag)) {
+        return false;
+    }
+    iResponseStarted = true;
+    iWriterResponse->WriteStatus(HttpStatus::kNotModified, Http::eHttp11);
+    iWriterResponse->WriteHeader(Http::kHeaderETag, aETag);
+    if (aVaryEncoding) {
+        iWriterResponse->WriteHeader(Http::kHeaderVary, Http::kHeaderAcceptEncoding);
+    }
+    WriteConnectionHeader();
+    iWriterResponse->WriteFlush();
+    iResponseEnded = true;
+    return true;
+}
+
+void DviSessionUpnp::SetResourceHeaders(const Brx& aETag, TBool aGzipped, TBool aVaryEncoding)
+{
+    iResourceETag.Replace(aETag);
+    iResourceGzipped = aGzipped;
+    iResourceVaryEncoding = aVaryEncoding;
+}
+
 void DviSessionUpnp::Invoke()
 {
     try {
@@ -1056,6 +1389,53 @@ Endpoint DviSessionUpnp::ClientEndpoint() const
     return ep;
 }
 
+void DviSessionUpnp::IndexArguments(const Brx& aArgs)
+{
+    iSoapArgs.clear();
+    iSoapArgNext = 0;
+    Brn remaining(Ascii::Trim(aArgs));
+    while (remaining.Bytes() > 0) {
+        Brn name;
+        Brn value = XmlParserBasic::Next(remaining, name, remaining);
+        iSoapArgs.push_back(SoapArgument(name, value));
+        remaining.Set(Ascii::Trim(remaining));
+    }
+}
+
+Brn DviSessionUpnp::ArgumentValue(const TChar* aName)
+{
+    return ArgumentValueUnescaped(aName, false);
+}
+
+Brn DviSessionUpnp::ArgumentValueUnescaped(const TChar* aName, TBool aBase64)
+{
+    /* Values are converted in place.  This relies on iSoapRequest pointing into
+       iReadBuffer's buffer, which isn't touched again until the next request */
+    Brn name(aName);
+    const TUint count = (TUint)iSoapArgs.size();
+    for (TUint i=0; i<count; i++) {
+        const TUint index = (iSoapArgNext + i) % count;
+        SoapArgument& arg = iSoapArgs[index];
+        if (Ascii::CaseInsensitiveEquals(arg.iName, name)) {
+            iSoapArgNext = index + 1;
+            if (aBase64 && !arg.iConverted && arg.iValue.Bytes() > 0) {
+                Bwn writable(arg.iValue.Ptr(), arg.iValue.Bytes(), arg.iValue.Bytes());
+                Converter::FromBase64(writable);
+                arg.iValue.Set(writable);
+                arg.iConverted = true;
+            }
+            else if (!aBase64 && !arg.iConverted && Ascii::Contains(arg.iValue, '&')) {
+                Bwn writable(arg.iValue.Ptr(), arg.iValue.Bytes(), arg.iValue.Bytes());
+                Converter::FromXmlEscaped(writable);
+                arg.iValue.Set(writable);
+                arg.iConverted = true;
+            }
+            return arg.iValue;
+        }
+    }
+    THROW(XmlError);
+}
+
 void DviSessionUpnp::InvocationReadStart()
 {
     try {
@@ -1063,6 +1443,7 @@ void DviSessionUpnp::InvocationReadStart()
         Brn body = XmlParserBasic::Find("Body", envelope);
         Brn args = XmlParserBasic::Find(iHeaderSoapAction.Action(), body);
         iSoapRequest.Set(args);
+        IndexArguments(args);
     }
     catch (XmlError&) {
         InvocationReportError(501, Brn("Invalid XML"));
@@ -1072,7 +1453,7 @@ void DviSessionUpnp::InvocationReadStart()
 TBool DviSessionUpnp::InvocationReadBool(const TChar* aName)
 {
     try {
-        Brn value = XmlParserBasic::Find(aName, iSoapRequest);
+        Brn value = ArgumentValue(aName);
         try {
             TUint num = Ascii::Uint(value);
             return (num != 0);
@@ -1096,14 +1477,8 @@ TBool DviSessionUpnp::InvocationReadBool(const TChar* aName)
 void DviSessionUpnp::InvocationReadString(const TChar* aName, Brhz& aString)
 {
     try {
-        Brn value = XmlParserBasic::Find(aName, iSoapRequest);
-        Bwh writable(value.Bytes()+1);
-        if (value.Bytes()) {
-            writable.Append(value);
-            Converter::FromXmlEscaped(writable);
-        }
-        writable.PtrZ();
-        writable.TransferTo(aString);
+        Brn value = ArgumentValueUnescaped(aName, false);
+        aString.Set(value);
     }
     catch (XmlError&) {
         InvocationReportError(501, Brn("Invalid XML"));
@@ -1113,7 +1488,7 @@ void DviSessionUpnp::InvocationReadString(const TChar* aName, Brhz& aString)
 TInt DviSessionUpnp::InvocationReadInt(const TChar* aName)
 {
     try {
-        Brn value = XmlParserBasic::Find(aName, iSoapRequest);
+        Brn value = ArgumentValue(aName);
         TInt num = Ascii::Int(value);
         return num;
     }
@@ -1129,7 +1504,7 @@ TInt DviSessionUpnp::InvocationReadInt(const TChar* aName)
 TUint DviSessionUpnp::InvocationReadUint(const TChar* aName)
 {
     try {
-        Brn value = XmlParserBasic::Find(aName, iSoapRequest);
+        Brn value = ArgumentValue(aName);
         TUint num = Ascii::Uint(value);
         return num;
     }
@@ -1145,12 +1520,9 @@ TUint DviSessionUpnp::InvocationReadUint(const TChar* aName)
 void DviSessionUpnp::InvocationReadBinary(const TChar* aName, Brh& aData)
 {
     try {
-        Brn value = XmlParserBasic::Find(aName, iSoapRequest);
+        Brn value = ArgumentValueUnescaped(aName, true);
         if (value.Bytes()) {
-            Bwh writable(value.Bytes()+1);
-            writable.Append(value);
-            Converter::FromBase64(writable);
-            writable.TransferTo(aData);
+            aData.Set(value);
         }
     }
     catch (XmlError&) {
@@ -1161,6 +1533,7 @@ void DviSessionUpnp::InvocationReadBinary(const TChar* aName, Brh& aData)
 void DviSessionUpnp::InvocationReadEnd()
 {
     iSoapRequest.Set(Brx::Empty());
+    iSoapArgs.clear();
 }
 
 void DviSessionUpnp::InvocationReportErrorNoThrow(TUint aCode, const Brx& aDescription)
@@ -1185,8 +1558,11 @@ void DviSessionUpnp::InvocationReportErrorNoThrow(TUint aCode, const Brx& aDescr
     if (iReaderRequest->Version() == Http::eHttp11) { 
         iWriterResponse->WriteHeader(Http::kHeaderTransferEncoding, Http::kTransferEncodingChunked);
     }
-    iWriterResponse->WriteHeader(Http::kHeaderConnection, Http::kConnectionClose);
-    iWriterResponse->WriteFlush();
+    else {
+        iKeepAlive = false;
+    }
+    WriteConnectionHeader();
+    WriteHeaderEnd();
 
     if (iReaderRequest->Version() == Http::eHttp11) { 
         iWriterChunked->SetChunked(true);
@@ -1222,8 +1598,11 @@ void DviSessionUpnp::InvocationWriteStart()
     if (iReaderRequest->Version() == Http::eHttp11) { 
         iWriterResponse->WriteHeader(Http::kHeaderTransferEncoding, Http::kTransferEncodingChunked);
     }
-    iWriterResponse->WriteHeader(Http::kHeaderConnection, Http::kConnectionClose);
-    iWriterResponse->WriteFlush();
+    else {
+        iKeepAlive = false;
+    }
+    WriteConnectionHeader();
+    WriteHeaderEnd();
 
     if (iReaderRequest->Version() == Http::eHttp11) { 
         iWriterChunked->SetChunked(true);
@@ -1367,7 +1746,9 @@ void DviServerUpnp::Redirect(const Brx& aUriRequested, const Brx& aUriRedirected
 
 SocketTcpServer* DviServerUpnp::CreateServer(const NetworkAdapter& aNif)
 {
-    SocketTcpServer* server = new SocketTcpServer(iDvStack.Env(), "DSVU", iPort, aNif.Address());
+    const TBool eventDriven = iDvStack.Env().InitParams().UseEventDrivenTcpServers();
+    SocketTcpServer* server = new SocketTcpServer(iDvStack.Env(), "DSVU", iPort, aNif.Address(),
+                                                  kPriorityHigh, Thread::kDefaultStackBytes, 128, eventDriven);
     TChar thName[5];
     const TUint numWsThreads = iDvStack.Env().InitParams().DvNumServerThreads();
     for (TUint i=0; i<numWsThreads; i++) {
@@ -83,6 +83,17 @@ private:
     std::vector<char*> iLanguageList;
 };
 
+class HeaderAcceptEncoding : public HttpHeader
+{
+public:
+    TBool Gzip() const;
+private:
+    TBool Recognise(const Brx& aHeader);
+    void Process(const Brx& aValue);
+private:
+    TBool iGzip;
+};
+
 class SubscriptionDataUpnp : public IDviSubscriptionUserData
 {
 public:
@@ -100,28 +111,47 @@ private:
     Http::EVersion iHttpVersion;
 };
 
+/**
+ * Writes a GENA NOTIFY for a single subscription.
+ *
+ * Property values are buffered so that no network activity happens until PropertyWriteEnd(),
+ * after the service's properties have been unlocked.  If DvStack::EventConnectionPool() is
+ * enabled, a connection to a subscriber is kept open after a notification and reused for
+ * later notifications to any of that subscriber's subscriptions.
+ */
 class PropertyWriterUpnp : public PropertyWriter
 {
 public:
     static PropertyWriterUpnp* Create(DvStack& aDvStack, const Endpoint& aPublisher, const Endpoint& aSubscriber,
                                       const Brx& aSubscriberPath, const Http::EVersion aHttpVersion, const Brx& aSid, TUint aSequenceNumber);
 private:
-    PropertyWriterUpnp(DvStack& aDvStack);
-    void Connect(const Endpoint& aSubscriber);
-    void WriteHeaders(const Endpoint& aPublisher, const Brx& aSubscriberPath,
-                      const Http::EVersion aHttpVersion, const Brx& aSid, TUint aSequenceNumber);
+    PropertyWriterUpnp(DvStack& aDvStack, const Endpoint& aPublisher, const Endpoint& aSubscriber,
+                       const Brx& aSubscriberPath, const Http::EVersion aHttpVersion, const Brx& aSid, TUint aSequenceNumber);
+    void Connect();
+    void Notify(const Brx& aBody);
+    void WriteHeaders(WriterHttpRequest& aWriter, TUint aBodyBytes);
+    TBool CanRetry();
 private: // IPropertyWriter
     ~PropertyWriterUpnp();
     void PropertyWriteEnd();
 private:
-    static const TUint kMaxRequestBytes = 12*1024;
     static const TUint kMaxResponseBytes = 128;
     static const TUint kReadTimeoutMs = 5 * 1000;
+    static const TUint kBodyGranularity = 1024;
     DvStack& iDvStack;
-    SocketTcpClient iSocket;
-    Sws<kMaxRequestBytes>* iWriteBuffer;
-    WriterHttpRequest* iWriterEvent;
-    WriterHttpChunked* iWriterChunked;
+    Endpoint iPublisher;
+    Endpoint iSubscriber;
+    Brh iSubscriberPath;
+    Http::EVersion iHttpVersion;
+    Brh iSid;
+    TUint iSequenceNumber;
+    WriterBwh iBody;
+    SocketTcpClient* iSocket;
+    TBool iKeepAlive;
+    TBool iRequestSent;
+    TBool iResponseReceived;
+    TUint iReadDeadline;
+    TBool iReusable;
 };
 
 class DvStack;
@@ -153,14 +183,17 @@ private:
 };
 
 
-class DviSessionUpnp : public SocketTcpSession, private IResourceWriter, private IDviInvocation
+class DviSessionUpnp : public SocketTcpSession, private IResourceWriterHttp, private IDviInvocation
 {
 public:
     DviSessionUpnp(DvStack& aDvStack, TIpAddress aInterface, TUint aPort, IRedirector& aRedirector);
     ~DviSessionUpnp();
 private:
     void Run();
+    TBool HandleRequest(TUint aRequestCount, TUint aReadTimeoutMs);
     void Error(const HttpStatus& aStatus);
+    void WriteConnectionHeader();
+    void WriteHeaderEnd();
     void Get();
     void Post();
     void Subscribe();
@@ -169,10 +202,18 @@ private:
     void ParseRequestUri(const Brx& aUrlTail, DviDevice** aDevice, DviService** aService);
     void WriteServerHeader(IWriterHttpHeader& aWriter);
     void InvocationReportErrorNoThrow(TUint aCode, const Brx& aDescription);
+    void IndexArguments(const Brx& aArgs);
+    Brn ArgumentValue(const TChar* aName);
+    Brn ArgumentValueUnescaped(const TChar* aName, TBool aBase64);
 private: // IResourceWriter
     void WriteResourceBegin(TUint aTotalBytes, const TChar* aMimeType);
     void WriteResource(const TByte* aData, TUint aBytes);
     void WriteResourceEnd();
+    void GetRequiredRange(TUint& aOffset, TUint& aBytes);
+private: // IResourceWriterHttp
+    TBool AcceptsGzip() const;
+    TBool WriteNotModified(const Brx& aETag, TBool aVaryEncoding);
+    void SetResourceHeaders(const Brx& aETag, TBool aGzipped, TBool aVaryEncoding);
 private: // IDviInvocation
     void Invoke();
     TUint Version() const;
@@ -201,18 +242,36 @@ private: // IDviInvocation
     void InvocationWriteStringEnd(const TChar* aName);
     void InvocationWriteEnd();
 private:
-    static const TUint kMaxRequestBytes = 64*1024;
-    static const TUint kMaxResponseBytes = 4*1024;
+    void ReserveReadBytes(TUint aBytes);
+    void ShrinkReadBuffer();
+private:
+    static const TUint kAdaptiveReadBytes = 8*1024; // initial read buffer size when InitParams().UseAdaptiveSessionBuffers()
+    static const TUint kAdaptiveShrinkRequests = 16; // release a grown read buffer after this many requests that didn't need it
     static const TUint kReadTimeoutMs = 5 * 1000;
+    static const TUint kMaxArgsReserved = 16;
+private:
+    class SoapArgument
+    {
+    public:
+        SoapArgument(const Brx& aName, const Brx& aValue);
+    public:
+        Brn iName;
+        Brn iValue;
+        TBool iConverted; // iValue has been unescaped/decoded in place
+    };
 private:
     DvStack& iDvStack;
     TIpAddress iInterface;
     TUint iPort;
     IRedirector& iRedirector;
-    Srs<kMaxRequestBytes>* iReadBuffer;
+    TUint iMaxRequestBytes;
+    TUint iReadBufferInitialBytes;
+    TBool iAdaptiveBuffers;
+    TUint iRequestsSinceGrown;
+    Srd* iReadBuffer;
     ReaderHttpRequest* iReaderRequest;
     WriterHttpChunked* iWriterChunked;
-    Sws<kMaxResponseBytes>* iWriterBuffer;
+    Swd* iWriterBuffer;
     WriterHttpResponse* iWriterResponse;
     HttpHeaderHost iHeaderHost;
     HttpHeaderContentLength iHeaderContentLength;
@@ -225,10 +284,25 @@ private:
     HeaderNt iHeaderNt;
     HeaderCallback iHeaderCallback;
     HeaderAcceptLanguage iHeaderAcceptLanguage;
+    HttpHeaderIfNoneMatch iHeaderIfNoneMatch;
+    HeaderAcceptEncoding iHeaderAcceptEncoding;
+    HttpHeaderRange iHeaderRange;
+    Bws<DviResourceCache::kMaxETagBytes> iResourceETag;
+    TBool iResourceGzipped;
+    TBool iResourceVaryEncoding;
+    TBool iResourceRanged;
+    TUint iResourceRangeOffset;
+    TUint iResourceRangeBytes;
+    TUint iResourcePosition; // offset within the whole resource of the next byte passed to WriteResource
     const HttpStatus* iErrorStatus;
+    TUint iKeepAliveIdleMs;
+    TUint iKeepAliveMaxRequests;
+    TBool iKeepAlive;
     TBool iResponseStarted;
     TBool iResponseEnded;
     Brn iSoapRequest;
+    std::vector<SoapArgument> iSoapArgs;
+    TUint iSoapArgNext; // arguments are usually read in document order; start searching here
     DviDevice* iInvocationDevice;
     DviService* iInvocationService;
     mutable Bws<128> iResourceUriPrefix;
@@ -15,6 +15,171 @@ using namespace OpenHome::Net;
 
 #undef NOTIFIER_LOG_ENABLE
 
+#define NEXT_MSG_ROOT         (0)
+#define NEXT_MSG_UUID         (1)
+#define NEXT_MSG_DEVICE_TYPE  (2)
+#define NEXT_MSG_SERVICE_TYPE (3)
+
+static void NotifyMsg(ISsdpNotify& aNotifier, IUpnpAnnouncementData& aAnnouncementData, const Brx& aUri, TUint aMsgIndex)
+{
+    switch (aMsgIndex)
+    {
+    case NEXT_MSG_ROOT:
+        aNotifier.SsdpNotifyRoot(aAnnouncementData.Udn(), aUri);
+        break;
+    case NEXT_MSG_UUID:
+        aNotifier.SsdpNotifyUuid(aAnnouncementData.Udn(), aUri);
+        break;
+    case NEXT_MSG_DEVICE_TYPE:
+        aNotifier.SsdpNotifyDeviceType(aAnnouncementData.Domain(), aAnnouncementData.Type(), aAnnouncementData.Version(), aAnnouncementData.Udn(), aUri);
+        break;
+    default:
+        DviService& service = aAnnouncementData.Service(aMsgIndex - NEXT_MSG_SERVICE_TYPE);
+        const OpenHome::Net::ServiceType& serviceType = service.ServiceType();
+        aNotifier.SsdpNotifyServiceType(serviceType.Domain(), serviceType.Name(), serviceType.Version(), aAnnouncementData.Udn(), aUri);
+        break;
+    }
+}
+
+
+// DviSsdpPacketCache
+
+DviSsdpPacketCache::DviSsdpPacketCache(DvStack& aDvStack, IUpnpAnnouncementData& aAnnouncementData)
+    : iDvStack(aDvStack)
+    , iAnnouncementData(aAnnouncementData)
+    , iLock("SSPC")
+    , iRenderer(aDvStack)
+{
+}
+
+DviSsdpPacketCache::~DviSsdpPacketCache()
+{
+    Clear();
+}
+
+void DviSsdpPacketCache::SendAlive(SsdpNotifier& aNotifier, TIpAddress aAdapter, const Brx& aUri, TUint aConfigId, TUint aFirstMsgIndex, TUint aMsgCount)
+{
+    ASSERT(aMsgCount <= kMaxAliveBatch);
+    const Brx* packets[kMaxAliveBatch];
+    AutoMutex a(iLock);
+    for (TUint i=0; i<aMsgCount; i++) {
+        packets[i] = &Packet(SsdpPacketRenderer::eAlive, aAdapter, aUri, aConfigId, aFirstMsgIndex + i);
+    }
+    aNotifier.Send(packets, aMsgCount);
+}
+
+void DviSsdpPacketCache::SendMsearchResponse(SsdpMsearchResponder& aResponder, TIpAddress aAdapter, const Brx& aUri, TUint aConfigId, TUint aMsgIndex)
+{
+    AutoMutex a(iLock);
+    aResponder.Send(Packet(SsdpPacketRenderer::eMsearchResponse, aAdapter, aUri, aConfigId, aMsgIndex));
+}
+
+void DviSsdpPacketCache::Clear()
+{
+    AutoMutex a(iLock);
+    for (TUint i=0; i<iPackets.size(); i++) {
+        delete iPackets[i];
+    }
+    iPackets.clear();
+}
+
+void DviSsdpPacketCache::RemoveAdapter(TIpAddress aAdapter)
+{
+    AutoMutex a(iLock);
+    for (TUint i=0; i<iPackets.size(); i++) {
+        if (iPackets[i]->Adapter() == aAdapter) {
+            delete iPackets[i];
+            iPackets.erase(iPackets.begin() + i);
+            break;
+        }
+    }
+}
+
+TUint DviSsdpPacketCache::AdapterCount()
+{
+    AutoMutex a(iLock);
+    return (TUint)iPackets.size();
+}
+
+const Brx& DviSsdpPacketCache::Packet(SsdpPacketRenderer::EPacket aPacket, TIpAddress aAdapter, const Brx& aUri, TUint aConfigId, TUint aMsgIndex)
+{
+    Packets* packets = NULL;
+    for (TUint i=0; i<iPackets.size(); i++) {
+        if (iPackets[i]->Adapter() == aAdapter) {
+            packets = iPackets[i];
+            break;
+        }
+    }
+    if (packets == NULL) {
+        packets = new Packets(aAdapter);
+        iPackets.push_back(packets);
+    }
+    const TUint bootId = iDvStack.BootId();
+    if (!packets->IsCurrent(aUri, aConfigId, bootId)) {
+        packets->Reset(aUri, aConfigId, bootId);
+    }
+    Brh*& packet = packets->Packet(aPacket, aMsgIndex);
+    if (packet == NULL) {
+        iRenderer.Start(aPacket, aConfigId);
+        NotifyMsg(iRenderer, iAnnouncementData, aUri, aMsgIndex);
+        packet = new Brh(iRenderer.Packet());
+    }
+    return *packet;
+}
+
+
+// DviSsdpPacketCache::Packets
+
+DviSsdpPacketCache::Packets::Packets(TIpAddress aAdapter)
+    : iAdapter(aAdapter)
+    , iConfigId(0)
+    , iBootId(0)
+{
+}
+
+DviSsdpPacketCache::Packets::~Packets()
+{
+    Clear(iAlive);
+    Clear(iResponse);
+}
+
+TIpAddress DviSsdpPacketCache::Packets::Adapter() const
+{
+    return iAdapter;
+}
+
+TBool DviSsdpPacketCache::Packets::IsCurrent(const Brx& aUri, TUint aConfigId, TUint aBootId) const
+{
+    return (iConfigId == aConfigId && iBootId == aBootId && iUri == aUri);
+}
+
+void DviSsdpPacketCache::Packets::Reset(const Brx& aUri, TUint aConfigId, TUint aBootId)
+{
+    Clear(iAlive);
+    Clear(iResponse);
+    iUri.Replace(aUri);
+    iConfigId = aConfigId;
+    iBootId = aBootId;
+}
+
+Brh*& DviSsdpPacketCache::Packets::Packet(SsdpPacketRenderer::EPacket aPacket, TUint aMsgIndex)
+{
+    std::vector<Brh*>& packets = (aPacket == SsdpPacketRenderer::eAlive? iAlive : iResponse);
+    if (aMsgIndex >= packets.size()) {
+        packets.resize(aMsgIndex + 1, NULL);
+    }
+    return packets[aMsgIndex];
+}
+
+void DviSsdpPacketCache::Packets::Clear(std::vector<Brh*>& aPackets)
+{
+    for (TUint i=0; i<aPackets.size(); i++) {
+        delete aPackets[i];
+    }
+    aPackets.clear();
+}
+
+
 // SsdpNotifierScheduler
 
 SsdpNotifierScheduler::~SsdpNotifierScheduler()
@@ -38,6 +203,13 @@ void SsdpNotifierScheduler::Start(TUint aDuration, TUint aMsgCount)
     ScheduleNextTimer(aMsgCount);
 }
 
+void SsdpNotifierScheduler::StartDeferred(TUint aDuration, TUint aDelayMs)
+{
+    iStop = false;
+    iEndTimeMs = Os::TimeInMs(iDvStack.Env().OsCtx()) + aDuration;
+    iTimer->FireIn(aDelayMs);
+}
+
 void SsdpNotifierScheduler::Stop()
 {
     iStop = true;
@@ -106,56 +278,66 @@ void SsdpNotifierScheduler::LogNotifierStart(const TChar* aType)
 
 // MsearchResponse
 
-#define NEXT_MSG_ROOT         (0)
-#define NEXT_MSG_UUID         (1)
-#define NEXT_MSG_DEVICE_TYPE  (2)
-#define NEXT_MSG_SERVICE_TYPE (3)
-
-MsearchResponse::MsearchResponse(DvStack& aDvStack, ISsdpNotifyListener& aListener)
+MsearchResponse::MsearchResponse(DvStack& aDvStack, ISsdpNotifyListener& aListener, Mutex& aLock)
     : SsdpNotifierScheduler(aDvStack, aListener)
-    , iAnnouncementData(NULL)
+    , iLock(aLock)
+    , iSendLock("MSRS")
+    , iAdapter(0)
+    , iOpen(false)
 {
     iNotifier = new SsdpMsearchResponder(aDvStack);
 }
 
 MsearchResponse::~MsearchResponse()
 {
+    Clear();
     delete iNotifier;
 }
 
-void MsearchResponse::StartAll(IUpnpAnnouncementData& aAnnouncementData, const Endpoint& aRemote, TUint aMx, const Brx& aUri, TUint aConfigId, TIpAddress aAdapter)
+void MsearchResponse::Start(const Endpoint& aRemote, TIpAddress aAdapter, TUint aMx)
 {
-    LogNotifierStart("StartAll");
-    TUint nextMsgIndex = NEXT_MSG_ROOT;
+    LogNotifierStart("Msearch");
+    Clear();
+    iRemote.Replace(aRemote);
+    iAdapter = aAdapter;
+    iOpen = true;
+    const TUint duration = aMx * 1000;
+    SsdpNotifierScheduler::StartDeferred(duration, (duration < kBatchDelayMs? 0 : kBatchDelayMs));
+}
+
+TBool MsearchResponse::IsOpenFor(const Endpoint& aRemote, TIpAddress aAdapter) const
+{
+    return (iOpen && iAdapter == aAdapter && iRemote.Equals(aRemote));
+}
+
+void MsearchResponse::QueueAll(IUpnpAnnouncementData& aAnnouncementData, const Brx& aUri, TUint aConfigId)
+{
+    TUint firstMsgIndex = NEXT_MSG_ROOT;
     TUint msgCount = 3 + aAnnouncementData.ServiceCount();
     if (!aAnnouncementData.IsRoot()) {
         msgCount--;
-        nextMsgIndex = NEXT_MSG_UUID;
+        firstMsgIndex = NEXT_MSG_UUID;
     }
-    Start(aAnnouncementData, msgCount, nextMsgIndex, aRemote, aMx, aUri, aConfigId, aAdapter);
+    Queue(aAnnouncementData, aUri, aConfigId, firstMsgIndex, msgCount);
 }
 
-void MsearchResponse::StartRoot(IUpnpAnnouncementData& aAnnouncementData, const Endpoint& aRemote, TUint aMx, const Brx& aUri, TUint aConfigId, TIpAddress aAdapter)
+void MsearchResponse::QueueRoot(IUpnpAnnouncementData& aAnnouncementData, const Brx& aUri, TUint aConfigId)
 {
-    LogNotifierStart("StartRoot");
-    Start(aAnnouncementData, 1, NEXT_MSG_ROOT, aRemote, aMx, aUri, aConfigId, aAdapter);
+    Queue(aAnnouncementData, aUri, aConfigId, NEXT_MSG_ROOT, 1);
 }
 
-void MsearchResponse::StartUuid(IUpnpAnnouncementData& aAnnouncementData, const Endpoint& aRemote, TUint aMx, const Brx& aUri, TUint aConfigId, TIpAddress aAdapter)
+void MsearchResponse::QueueUuid(IUpnpAnnouncementData& aAnnouncementData, const Brx& aUri, TUint aConfigId)
 {
-    LogNotifierStart("StartUuid");
-    Start(aAnnouncementData, 1, NEXT_MSG_UUID, aRemote, aMx, aUri, aConfigId, aAdapter);
+    Queue(aAnnouncementData, aUri, aConfigId, NEXT_MSG_UUID, 1);
 }
 
-void MsearchResponse::StartDeviceType(IUpnpAnnouncementData& aAnnouncementData, const Endpoint& aRemote, TUint aMx, const Brx& aUri, TUint aConfigId, TIpAddress aAdapter)
+void MsearchResponse::QueueDeviceType(IUpnpAnnouncementData& aAnnouncementData, const Brx& aUri, TUint aConfigId)
 {
-    LogNotifierStart("StartDeviceType");
-    Start(aAnnouncementData, 1, NEXT_MSG_DEVICE_TYPE, aRemote, aMx, aUri, aConfigId, aAdapter);
+    Queue(aAnnouncementData, aUri, aConfigId, NEXT_MSG_DEVICE_TYPE, 1);
 }
 
-void MsearchResponse::StartServiceType(IUpnpAnnouncementData& aAnnouncementData, const Endpoint& aRemote, TUint aMx, const OpenHome::Net::ServiceType& aServiceType, const Brx& aUri, TUint aConfigId, TIpAddress aAdapter)
+void MsearchResponse::QueueServiceType(IUpnpAnnouncementData& aAnnouncementData, const OpenHome::Net::ServiceType& aServiceType, const Brx& aUri, TUint aConfigId)
 {
-    LogNotifierStart("StartServiceType");
     TUint index = 0;
     for (;;) {
         const OpenHome::Net::ServiceType& st = aAnnouncementData.Service(index).ServiceType();
@@ -164,40 +346,158 @@ void MsearchResponse::StartServiceType(IUpnpAnnouncementData& aAnnouncementData,
         }
         index++;
     }
-    Start(aAnnouncementData, 1, NEXT_MSG_SERVICE_TYPE + index, aRemote, aMx, aUri, aConfigId, aAdapter);
+    Queue(aAnnouncementData, aUri, aConfigId, NEXT_MSG_SERVICE_TYPE + index, 1);
 }
 
-void MsearchResponse::Start(IUpnpAnnouncementData& aAnnouncementData, TUint aTotalMsgs, TUint aNextMsgIndex, const Endpoint& aRemote, TUint aMx, const Brx& aUri, TUint aConfigId, TIpAddress aAdapter)
+void MsearchResponse::Remove(const Brx& aUdn)
 {
-    iAnnouncementData = &aAnnouncementData;
-    iNextMsgIndex = aNextMsgIndex;
-    iRemainingMsgs = aTotalMsgs;
-    static_cast<SsdpMsearchResponder*>(iNotifier)->SetRemote(aRemote, aConfigId, aAdapter);
-    iUri.Replace(aUri);
-    SsdpNotifierScheduler::Start(aMx * 1000, iRemainingMsgs);
+    DeviceMap::iterator it = iDevices.begin();
+    while (it != iDevices.end()) {
+        if (it->first->Udn() == aUdn) {
+            break;
+        }
+        it++;
+    }
+    if (it == iDevices.end()) {
+        return;
+    }
+    Device* device = it->second;
+    std::list<Msg>::iterator msg = iPending.begin();
+    while (msg != iPending.end()) {
+        if (msg->iDevice == device) {
+            msg = iPending.erase(msg);
+        }
+        else {
+            msg++;
+        }
+    }
+    iDevices.erase(it);
+    delete device;
+}
+
+void MsearchResponse::WaitForSend()
+{
+    iSendLock.Wait();
+    iSendLock.Signal();
+}
+
+void MsearchResponse::Queue(IUpnpAnnouncementData& aAnnouncementData, const Brx& aUri, TUint aConfigId, TUint aFirstMsgIndex, TUint aMsgCount)
+{
+    Device* device;
+    DeviceMap::iterator it = iDevices.find(&aAnnouncementData);
+    if (it == iDevices.end()) {
+        device = new Device(aAnnouncementData);
+        iDevices.insert(std::pair<IUpnpAnnouncementData*, Device*>(&aAnnouncementData, device));
+    }
+    else {
+        device = it->second;
+    }
+    device->Set(aUri, aConfigId);
+    const TUint end = aFirstMsgIndex + aMsgCount;
+    for (TUint i=aFirstMsgIndex; i<end; i++) {
+        if (device->TryQueue(i)) {
+            iPending.push_back(Msg(device, i));
+        }
+    }
+}
+
+void MsearchResponse::Clear()
+{
+    iOpen = false;
+    iPending.clear();
+    DeviceMap::iterator it = iDevices.begin();
+    while (it != iDevices.end()) {
+        delete it->second;
+        it++;
+    }
+    iDevices.clear();
 }
 
 TUint MsearchResponse::NextMsg()
 {
-    switch (iNextMsgIndex)
-    {
-    case 0:
-        iNotifier->SsdpNotifyRoot(iAnnouncementData->Udn(), iUri);
-        break;
-    case 1:
-        iNotifier->SsdpNotifyUuid(iAnnouncementData->Udn(), iUri);
-        break;
-    case 2:
-        iNotifier->SsdpNotifyDeviceType(iAnnouncementData->Domain(), iAnnouncementData->Type(), iAnnouncementData->Version(), iAnnouncementData->Udn(), iUri);
-        break;
-    default:
-        DviService& service = iAnnouncementData->Service(iNextMsgIndex - 3);
-        const OpenHome::Net::ServiceType& serviceType = service.ServiceType();
-        iNotifier->SsdpNotifyServiceType(serviceType.Domain(), serviceType.Name(), serviceType.Version(), iAnnouncementData->Udn(), iUri);
-        break;
+    /* Copy the next message out then send it without iLock held so that devices can
+       continue to queue responses (and other responders can run) during the send.
+       iSendLock is held throughout so that WaitForSend() can be used to ensure a device
+       which has just been Remove()d is no longer in use. */
+    AutoMutex _(iSendLock);
+    iLock.Wait();
+    if (iPending.size() == 0) {
+        iOpen = false;
+        iLock.Signal();
+        return 0;
+    }
+    Msg msg = iPending.front();
+    iPending.pop_front();
+    Device& device = *msg.iDevice;
+    IUpnpAnnouncementData& data = device.AnnouncementData();
+    Bws<kMaxUriBytes> uri(device.Uri());
+    const TUint configId = device.ConfigId();
+    Endpoint remote(iRemote);
+    const TIpAddress adapter = iAdapter;
+    iLock.Signal();
+
+    iNotifier->SetRemote(remote, configId, adapter);
+    try {
+        data.SsdpPackets().SendMsearchResponse(*iNotifier, adapter, uri, configId, msg.iIndex);
+    }
+    catch (WriterError&) {}
+    catch (NetworkError&) {}
+
+    AutoMutex a(iLock);
+    const TUint remaining = (TUint)iPending.size();
+    if (remaining == 0) {
+        iOpen = false;
+    }
+    return remaining;
+}
+
+
+// MsearchResponse::Device
+
+MsearchResponse::Device::Device(IUpnpAnnouncementData& aAnnouncementData)
+    : iAnnouncementData(aAnnouncementData)
+    , iConfigId(0)
+    , iQueued(NEXT_MSG_SERVICE_TYPE + aAnnouncementData.ServiceCount(), false)
+{
+}
+
+IUpnpAnnouncementData& MsearchResponse::Device::AnnouncementData()
+{
+    return iAnnouncementData;
+}
+
+const Brx& MsearchResponse::Device::Uri() const
+{
+    return iUri;
+}
+
+TUint MsearchResponse::Device::ConfigId() const
+{
+    return iConfigId;
+}
+
+void MsearchResponse::Device::Set(const Brx& aUri, TUint aConfigId)
+{
+    iUri.Replace(aUri);
+    iConfigId = aConfigId;
+}
+
+TBool MsearchResponse::Device::TryQueue(TUint aMsgIndex)
+{
+    if (aMsgIndex >= iQueued.size() || iQueued[aMsgIndex]) {
+        return false;
     }
-    iNextMsgIndex++;
-    return --iRemainingMsgs;
+    iQueued[aMsgIndex] = true;
+    return true;
+}
+
+
+// MsearchResponse::Msg
+
+MsearchResponse::Msg::Msg(Device* aDevice, TUint aIndex)
+    : iDevice(aDevice)
+    , iIndex(aIndex)
+{
 }
 
 
@@ -209,6 +509,8 @@ DeviceAnnouncement::DeviceAnnouncement(DvStack& aDvStack, ISsdpNotifyListener& a
     , iNotifierAlive(iSsdpNotifier)
     , iNotifierByeBye(iSsdpNotifier)
     , iNotifierUpdate(iSsdpNotifier)
+    , iAdapter(0)
+    , iConfigId(0)
     , iCurrentNotifier(NULL)
 {
 }
@@ -241,30 +543,26 @@ void DeviceAnnouncement::Start(ISsdpNotify& aNotifier, IUpnpAnnouncementData& aA
     iNextMsgIndex = (iAnnouncementData->IsRoot()? 0 : 1);
     iTotalMsgs = 3 + iAnnouncementData->ServiceCount();
     iUri.Replace(aUri);
+    iAdapter = aAdapter;
+    iConfigId = aConfigId;
     iSsdpNotifier.Start(aAdapter, aConfigId);
     SsdpNotifierScheduler::Start(aMsgInterval * iTotalMsgs, iTotalMsgs);
 }
 
 TUint DeviceAnnouncement::NextMsg()
 {
-    switch (iNextMsgIndex)
-    {
-    case 0:
-        iCurrentNotifier->SsdpNotifyRoot(iAnnouncementData->Udn(), iUri);
-        break;
-    case 1:
-        iCurrentNotifier->SsdpNotifyUuid(iAnnouncementData->Udn(), iUri);
-        break;
-    case 2:
-        iCurrentNotifier->SsdpNotifyDeviceType(iAnnouncementData->Domain(), iAnnouncementData->Type(), iAnnouncementData->Version(), iAnnouncementData->Udn(), iUri);
-        break;
-    default:
-        DviService& service = iAnnouncementData->Service(iNextMsgIndex - 3);
-        const OpenHome::Net::ServiceType& serviceType = service.ServiceType();
-        iCurrentNotifier->SsdpNotifyServiceType(serviceType.Domain(), serviceType.Name(), serviceType.Version(), iAnnouncementData->Udn(), iUri);
-        break;
+    if (iCurrentNotifier == &iNotifierAlive) {
+        TUint count = iTotalMsgs - iNextMsgIndex;
+        if (count > DviSsdpPacketCache::kMaxAliveBatch) {
+            count = DviSsdpPacketCache::kMaxAliveBatch;
+        }
+        iAnnouncementData->SsdpPackets().SendAlive(iSsdpNotifier, iAdapter, iUri, iConfigId, iNextMsgIndex, count);
+        iNextMsgIndex += count;
+    }
+    else {
+        NotifyMsg(*iCurrentNotifier, *iAnnouncementData, iUri, iNextMsgIndex);
+        iNextMsgIndex++;
     }
-    iNextMsgIndex++;
     return (iTotalMsgs - iNextMsgIndex);
 }
 
@@ -347,44 +645,50 @@ void DviSsdpNotifierManager::AnnouncementUpdate(IUpnpAnnouncementData& aAnnounce
 void DviSsdpNotifierManager::MsearchResponseAll(IUpnpAnnouncementData& aAnnouncementData, const Endpoint& aRemote, TUint aMx, const Brx& aUri, TUint aConfigId, TIpAddress aAdapter)
 {
     AutoMutex a(iLock);
-    Responder* responder = GetResponder(aAnnouncementData);
-    responder->Response().StartAll(aAnnouncementData, aRemote, aMx, aUri, aConfigId, aAdapter);
+    Response(aRemote, aMx, aAdapter).QueueAll(aAnnouncementData, aUri, aConfigId);
 }
 
 void DviSsdpNotifierManager::MsearchResponseRoot(IUpnpAnnouncementData& aAnnouncementData, const Endpoint& aRemote, TUint aMx, const Brx& aUri, TUint aConfigId, TIpAddress aAdapter)
 {
     AutoMutex a(iLock);
-    Responder* responder = GetResponder(aAnnouncementData);
-    responder->Response().StartRoot(aAnnouncementData, aRemote, aMx, aUri, aConfigId, aAdapter);
+    Response(aRemote, aMx, aAdapter).QueueRoot(aAnnouncementData, aUri, aConfigId);
 }
 
 void DviSsdpNotifierManager::MsearchResponseUuid(IUpnpAnnouncementData& aAnnouncementData, const Endpoint& aRemote, TUint aMx, const Brx& aUri, TUint aConfigId, TIpAddress aAdapter)
 {
     AutoMutex a(iLock);
-    Responder* responder = GetResponder(aAnnouncementData);
-    responder->Response().StartUuid(aAnnouncementData, aRemote, aMx, aUri, aConfigId, aAdapter);
+    Response(aRemote, aMx, aAdapter).QueueUuid(aAnnouncementData, aUri, aConfigId);
 }
 
 void DviSsdpNotifierManager::MsearchResponseDeviceType(IUpnpAnnouncementData& aAnnouncementData, const Endpoint& aRemote, TUint aMx, const Brx& aUri, TUint aConfigId, TIpAddress aAdapter)
 {
     AutoMutex a(iLock);
-    Responder* responder = GetResponder(aAnnouncementData);
-    responder->Response().StartDeviceType(aAnnouncementData, aRemote, aMx, aUri, aConfigId, aAdapter);
+    Response(aRemote, aMx, aAdapter).QueueDeviceType(aAnnouncementData, aUri, aConfigId);
 }
 
 void DviSsdpNotifierManager::MsearchResponseServiceType(IUpnpAnnouncementData& aAnnouncementData, const Endpoint& aRemote, TUint aMx, const OpenHome::Net::ServiceType& aServiceType, const Brx& aUri, TUint aConfigId, TIpAddress aAdapter)
 {
     AutoMutex a(iLock);
-    Responder* responder = GetResponder(aAnnouncementData);
-    responder->Response().StartServiceType(aAnnouncementData, aRemote, aMx, aServiceType, aUri, aConfigId, aAdapter);
+    Response(aRemote, aMx, aAdapter).QueueServiceType(aAnnouncementData, aServiceType, aUri, aConfigId);
 }
 
 void DviSsdpNotifierManager::Stop(const Brx& aUdn)
 {
+    std::vector<MsearchResponse*> responses;
     iLock.Wait();
-    Stop(iActiveResponders, aUdn);
+    std::list<Notifier*>::iterator it = iActiveResponders.begin();
+    while (it != iActiveResponders.end()) {
+        MsearchResponse& response = static_cast<DviSsdpNotifierManager::Responder*>(*it)->Response();
+        response.Remove(aUdn);
+        responses.push_back(&response);
+        it++;
+    }
     Stop(iActiveAnnouncers, aUdn);
     iLock.Signal();
+    // responses are sent without iLock held; wait for any already being sent for this device
+    for (TUint i=0; i<(TUint)responses.size(); i++) {
+        responses[i]->WaitForSend();
+    }
 }
 
 void DviSsdpNotifierManager::Stop(std::list<Notifier*>& aList, const Brx& aUdn)
@@ -407,11 +711,26 @@ void DviSsdpNotifierManager::Delete(std::list<Notifier*>& aList)
     }
 }
 
-DviSsdpNotifierManager::Responder* DviSsdpNotifierManager::GetResponder(IUpnpAnnouncementData& aAnnouncementData)
+MsearchResponse& DviSsdpNotifierManager::Response(const Endpoint& aRemote, TUint aMx, TIpAddress aAdapter)
+{
+    std::list<Notifier*>::iterator it = iActiveResponders.begin();
+    while (it != iActiveResponders.end()) {
+        MsearchResponse& response = static_cast<DviSsdpNotifierManager::Responder*>(*it)->Response();
+        if (response.IsOpenFor(aRemote, aAdapter)) {
+            return response;
+        }
+        it++;
+    }
+    MsearchResponse& response = GetResponder()->Response();
+    response.Start(aRemote, aAdapter, aMx);
+    return response;
+}
+
+DviSsdpNotifierManager::Responder* DviSsdpNotifierManager::GetResponder()
 {
     DviSsdpNotifierManager::Responder* responder;
     if (iFreeResponders.size() == 0) {
-        MsearchResponse* msr = new MsearchResponse(iDvStack, *this);
+        MsearchResponse* msr = new MsearchResponse(iDvStack, *this, iLock);
         responder = new Responder(msr);
         iActiveResponders.push_back(responder);
     }
@@ -420,7 +739,6 @@ DviSsdpNotifierManager::Responder* DviSsdpNotifierManager::GetResponder(IUpnpAnn
         iActiveResponders.splice(iActiveResponders.end(), iFreeResponders, iFreeResponders.begin());
     }
     (void)iShutdownSem.Clear();
-    responder->SetActive(aAnnouncementData.Udn());
     return responder;
 }
 
@@ -8,10 +8,61 @@
 #include <OpenHome/Net/Private/Ssdp.h>
 
 #include <vector>
+#include <list>
+#include <map>
 
 namespace OpenHome {
 namespace Net {
 
+/**
+ * Alive notifications and m-search responses for one device, rendered on first use.
+ *
+ * Packets are held per adapter and reused until the device's location, its config id or
+ * the stack's boot id change.  Clear() must be called whenever the device is (re-)enabled
+ * and RemoveAdapter() whenever the device stops using an adapter.
+ */
+class DviSsdpPacketCache : private INonCopyable
+{
+public:
+    static const TUint kMaxAliveBatch = 4; // alive notifications sent per system call
+    DviSsdpPacketCache(DvStack& aDvStack, IUpnpAnnouncementData& aAnnouncementData);
+    ~DviSsdpPacketCache();
+    void SendAlive(SsdpNotifier& aNotifier, TIpAddress aAdapter, const Brx& aUri, TUint aConfigId, TUint aFirstMsgIndex, TUint aMsgCount);
+    void SendMsearchResponse(SsdpMsearchResponder& aResponder, TIpAddress aAdapter, const Brx& aUri, TUint aConfigId, TUint aMsgIndex);
+    void Clear();
+    void RemoveAdapter(TIpAddress aAdapter);
+    TUint AdapterCount(); // number of adapters packets are held for
+private:
+    class Packets : private INonCopyable
+    {
+    public:
+        Packets(TIpAddress aAdapter);
+        ~Packets();
+        TIpAddress Adapter() const;
+        TBool IsCurrent(const Brx& aUri, TUint aConfigId, TUint aBootId) const;
+        void Reset(const Brx& aUri, TUint aConfigId, TUint aBootId);
+        Brh*& Packet(SsdpPacketRenderer::EPacket aPacket, TUint aMsgIndex);
+    private:
+        static void Clear(std::vector<Brh*>& aPackets);
+    private:
+        static const TUint kMaxUriBytes = 256;
+        TIpAddress iAdapter;
+        Bws<kMaxUriBytes> iUri;
+        TUint iConfigId;
+        TUint iBootId;
+        std::vector<Brh*> iAlive;    // indexed by message (root, uuid, device type, services...)
+        std::vector<Brh*> iResponse;
+    };
+private:
+    const Brx& Packet(SsdpPacketRenderer::EPacket aPacket, TIpAddress aAdapter, const Brx& aUri, TUint aConfigId, TUint aMsgIndex);
+private:
+    DvStack& iDvStack;
+    IUpnpAnnouncementData& iAnnouncementData;
+    Mutex iLock;
+    SsdpPacketRenderer iRenderer;
+    std::vector<Packets*> iPackets;
+};
+
 class SsdpNotifierScheduler;
 class ISsdpNotifyListener
 {
@@ -29,6 +80,7 @@ public:
 protected:
     SsdpNotifierScheduler(DvStack& aDvStack, ISsdpNotifyListener& aListener);
     void Start(TUint aDuration, TUint aMsgCount);
+    void StartDeferred(TUint aDuration, TUint aDelayMs);
 private:
     virtual TUint NextMsg() = 0;
     virtual void NotifyComplete();
@@ -46,27 +98,70 @@ private:
 };
 
 
+/**
+ * Unicast responses to all m-searches from a single control point on a single adapter.
+ *
+ * Every device matching a search queues its messages here so a search that matches many
+ * devices is paced by one timer.  Repeated searches from the same endpoint while earlier
+ * responses are still queued only add messages that haven't already been queued.
+ * All methods other than NextMsg() and WaitForSend() must be called with the lock passed
+ * to the c'tor held.  Messages are sent without that lock held.
+ */
 class MsearchResponse : public SsdpNotifierScheduler
 {
+    static const TUint kBatchDelayMs = 20; // allow all devices to queue responses to a search before pacing them
+    static const TUint kMaxUriBytes = 256;
 public:
-    MsearchResponse(DvStack& aDvStack, ISsdpNotifyListener& aListener);
+    MsearchResponse(DvStack& aDvStack, ISsdpNotifyListener& aListener, Mutex& aLock);
     ~MsearchResponse();
-    void StartAll(IUpnpAnnouncementData& aAnnouncementData, const Endpoint& aRemote, TUint aMx, const Brx& aUri, TUint aConfigId, TIpAddress aAdapter);
-    void StartRoot(IUpnpAnnouncementData& aAnnouncementData, const Endpoint& aRemote, TUint aMx, const Brx& aUri, TUint aConfigId, TIpAddress aAdapter);
-    void StartUuid(IUpnpAnnouncementData& aAnnouncementData, const Endpoint& aRemote, TUint aMx, const Brx& aUri, TUint aConfigId, TIpAddress aAdapter);
-    void StartDeviceType(IUpnpAnnouncementData& aAnnouncementData, const Endpoint& aRemote, TUint aMx, const Brx& aUri, TUint aConfigId, TIpAddress aAdapter);
-    void StartServiceType(IUpnpAnnouncementData& aAnnouncementData, const Endpoint& aRemote, TUint aMx, const OpenHome::Net::ServiceType& aServiceType, const Brx& aUri, TUint aConfigId, TIpAddress aAdapter);
+    void Start(const Endpoint& aRemote, TIpAddress aAdapter, TUint aMx);
+    TBool IsOpenFor(const Endpoint& aRemote, TIpAddress aAdapter) const;
+    void QueueAll(IUpnpAnnouncementData& aAnnouncementData, const Brx& aUri, TUint aConfigId);
+    void QueueRoot(IUpnpAnnouncementData& aAnnouncementData, const Brx& aUri, TUint aConfigId);
+    void QueueUuid(IUpnpAnnouncementData& aAnnouncementData, const Brx& aUri, TUint aConfigId);
+    void QueueDeviceType(IUpnpAnnouncementData& aAnnouncementData, const Brx& aUri, TUint aConfigId);
+    void QueueServiceType(IUpnpAnnouncementData& aAnnouncementData, const OpenHome::Net::ServiceType& aServiceType, const Brx& aUri, TUint aConfigId);
+    void Remove(const Brx& aUdn);
+    void WaitForSend(); // returns once any message being sent when it was called has been sent
 private:
-    void Start(IUpnpAnnouncementData& aAnnouncementData, TUint aTotalMsgs, TUint aNextMsgIndex, const Endpoint& aRemote, TUint aMx, const Brx& aUri, TUint aConfigId, TIpAddress aAdapter);
-private: // from DviMsg
+    class Device : private OpenHome::INonCopyable
+    {
+    public:
+        Device(IUpnpAnnouncementData& aAnnouncementData);
+        IUpnpAnnouncementData& AnnouncementData();
+        const Brx& Uri() const;
+        TUint ConfigId() const;
+        void Set(const Brx& aUri, TUint aConfigId);
+        TBool TryQueue(TUint aMsgIndex);
+    private:
+        IUpnpAnnouncementData& iAnnouncementData;
+        Bws<kMaxUriBytes> iUri;
+        TUint iConfigId;
+        std::vector<TBool> iQueued; // indexed by message (root, uuid, device type, services...)
+    };
+    class Msg
+    {
+    public:
+        Msg(Device* aDevice, TUint aIndex);
+    public:
+        Device* iDevice;
+        TUint iIndex;
+    };
+    typedef std::map<IUpnpAnnouncementData*, Device*> DeviceMap;
+private:
+    void Queue(IUpnpAnnouncementData& aAnnouncementData, const Brx& aUri, TUint aConfigId, TUint aFirstMsgIndex, TUint aMsgCount);
+    void Clear();
+private: // from SsdpNotifierScheduler
     TUint NextMsg();
 private:
-    static const TUint kMaxUriBytes = 256;
-    IUpnpAnnouncementData* iAnnouncementData;
-    ISsdpNotify* iNotifier;
-    Bws<kMaxUriBytes> iUri;
-    TUint iRemainingMsgs;
-    TUint iNextMsgIndex;
+    Mutex& iLock;
+    Mutex iSendLock;
+    SsdpMsearchResponder* iNotifier;
+    Endpoint iRemote;
+    TIpAddress iAdapter;
+    TBool iOpen;
+    DeviceMap iDevices;
+    std::list<Msg> iPending;
 };
 
 class DeviceAnnouncement : public SsdpNotifierScheduler
@@ -92,6 +187,8 @@ private:
     SsdpNotifierUpdate iNotifierUpdate;
     IUpnpAnnouncementData* iAnnouncementData;
     Bws<kMaxUriBytes> iUri;
+    TIpAddress iAdapter;
+    TUint iConfigId;
     ISsdpNotify* iCurrentNotifier;
     Functor iCompleted;
     TUint iTotalMsgs;
@@ -143,7 +240,8 @@ private:
 private:
     void Stop(std::list<Notifier*>& aList, const Brx& aUdn);
     void Delete(std::list<Notifier*>& aList);
-    Responder* GetResponder(IUpnpAnnouncementData& aAnnouncementData);
+    MsearchResponse& Response(const Endpoint& aRemote, TUint aMx, TIpAddress aAdapter);
+    Responder* GetResponder();
     Announcer* GetAnnouncer(IUpnpAnnouncementData& aAnnouncementData);
     TBool TryMove(SsdpNotifierScheduler* aScheduler, std::list<Notifier*>& aFrom, std::list<Notifier*>& aTo);
 private: // from ISsdpNotifyListener
@@ -13,7 +13,7 @@ SsdpSocketReader::SsdpSocketReader(Environment& aEnv, TIpAddress aInterface, con
     : SocketUdpMulticast(aEnv, aInterface, aMulticast)
 {
     SetTtl(aEnv.InitParams().MsearchTtl()); 
-    iReader = new UdpReader(*this);
+    iReader = new UdpReader(*this, kMaxDatagrams, kMaxDatagramBytes);
 }
 
 SsdpSocketReader::~SsdpSocketReader()
@@ -41,6 +41,240 @@ void SsdpSocketReader::ReadInterrupt()
     iReader->ReadInterrupt();
 }
 
+// SsdpMessage
+
+SsdpMessage::SsdpMessage()
+    : iKind(eNotifyAlive)
+    , iTarget(eSsdpUnknown)
+    , iVersion(0)
+    , iMaxAge(0)
+    , iMx(0)
+    , iListener(NULL)
+{
+}
+
+void SsdpMessage::SetNotifyAlive(ESsdpTarget aTarget, const Brx& aUuid, const Brx& aDomain, const Brx& aType, TUint aVersion, const Brx& aLocation, TUint aMaxAge)
+{
+    iKind = eNotifyAlive;
+    Set(aTarget, aUuid, aDomain, aType, aVersion);
+    iLocation.Replace(aLocation);
+    iMaxAge = aMaxAge;
+}
+
+void SsdpMessage::SetNotifyByeBye(ESsdpTarget aTarget, const Brx& aUuid, const Brx& aDomain, const Brx& aType, TUint aVersion)
+{
+    iKind = eNotifyByeBye;
+    Set(aTarget, aUuid, aDomain, aType, aVersion);
+}
+
+void SsdpMessage::SetMsearch(ESsdpTarget aTarget, const Endpoint& aSender, TUint aMx, const Brx& aUuid, const Brx& aDomain, const Brx& aType, TUint aVersion)
+{
+    iKind = eMsearch;
+    Set(aTarget, aUuid, aDomain, aType, aVersion);
+    iSender.Replace(aSender);
+    iMx = aMx;
+}
+
+void SsdpMessage::Set(ESsdpTarget aTarget, const Brx& aUuid, const Brx& aDomain, const Brx& aType, TUint aVersion)
+{
+    iTarget = aTarget;
+    iUuid.Replace(aUuid);
+    iDomain.Replace(aDomain);
+    iType.Replace(aType);
+    iVersion = aVersion;
+}
+
+TBool SsdpMessage::IsMsearch() const
+{
+    return (iKind == eMsearch);
+}
+
+TUint SsdpMessage::Key() const
+{
+    if (iKind == eMsearch) {
+        return (iSender.Address() ^ iSender.Port());
+    }
+    TUint key = 0;
+    for (TUint i=0; i<iUuid.Bytes(); i++) {
+        key = (key * 31) + iUuid[i];
+    }
+    return key;
+}
+
+void SsdpMessage::Notify(ISsdpNotifyHandler& aNotifyHandler) const
+{
+    if (iKind == eNotifyAlive) {
+        switch (iTarget) {
+        case eSsdpRoot:
+            LOG(kSsdpMulticast, "SSDP Multicast      Notify Alive Root\n");
+            aNotifyHandler.SsdpNotifyRootAlive(iUuid, iLocation, iMaxAge);
+            break;
+        case eSsdpUuid:
+            LOG(kSsdpMulticast, "SSDP Multicast      Notify Alive Uuid\n");
+            aNotifyHandler.SsdpNotifyUuidAlive(iUuid, iLocation, iMaxAge);
+            break;
+        case eSsdpDeviceType:
+            LOG(kSsdpMulticast, "SSDP Multicast      Notify Alive Device Type\n");
+            aNotifyHandler.SsdpNotifyDeviceTypeAlive(iUuid, iDomain, iType, iVersion, iLocation, iMaxAge);
+            break;
+        case eSsdpServiceType:
+            LOG(kSsdpMulticast, "SSDP Multicast      Notify Alive Service Type\n");
+            aNotifyHandler.SsdpNotifyServiceTypeAlive(iUuid, iDomain, iType, iVersion, iLocation, iMaxAge);
+            break;
+        default:
+            break;
+        }
+    }
+    else if (iKind == eNotifyByeBye) {
+        switch (iTarget) {
+        case eSsdpRoot:
+            LOG(kSsdpMulticast, "SSDP Multicast      Notify ByeBye Root\n");
+            aNotifyHandler.SsdpNotifyRootByeBye(iUuid);
+            break;
+        case eSsdpUuid:
+            LOG(kSsdpMulticast, "SSDP Multicast      Notify ByeBye Uuid\n");
+            aNotifyHandler.SsdpNotifyUuidByeBye(iUuid);
+            break;
+        case eSsdpDeviceType:
+            LOG(kSsdpMulticast, "SSDP Multicast      Notify ByeBye Device Type\n");
+            aNotifyHandler.SsdpNotifyDeviceTypeByeBye(iUuid, iDomain, iType, iVersion);
+            break;
+        case eSsdpServiceType:
+            LOG(kSsdpMulticast, "SSDP Multicast      Notify ByeBye Service Type\n");
+            aNotifyHandler.SsdpNotifyServiceTypeByeBye(iUuid, iDomain, iType, iVersion);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void SsdpMessage::Msearch(ISsdpMsearchHandler& aMsearchHandler) const
+{
+    if (iKind != eMsearch) {
+        return;
+    }
+    switch (iTarget) {
+    case eSsdpRoot:
+        LOG(kSsdpMulticast, "SSDP Multicast      Msearch Root\n");
+        aMsearchHandler.SsdpSearchRoot(iSender, iMx);
+        break;
+    case eSsdpUuid:
+        LOG(kSsdpMulticast, "SSDP Multicast      Msearch Uuid\n");
+        aMsearchHandler.SsdpSearchUuid(iSender, iMx, iUuid);
+        break;
+    case eSsdpDeviceType:
+        LOG(kSsdpMulticast, "SSDP Multicast      Msearch Device Type\n");
+        aMsearchHandler.SsdpSearchDeviceType(iSender, iMx, iDomain, iType, iVersion);
+        break;
+    case eSsdpServiceType:
+        LOG(kSsdpMulticast, "SSDP Multicast      Msearch Service Type\n");
+        aMsearchHandler.SsdpSearchServiceType(iSender, iMx, iDomain, iType, iVersion);
+        break;
+    case eSsdpAll:
+        LOG(kSsdpMulticast, "SSDP Multicast      Msearch All\n");
+        aMsearchHandler.SsdpSearchAll(iSender, iMx);
+        break;
+    default:
+        break;
+    }
+}
+
+void SsdpMessage::SetListener(SsdpListenerMulticast* aListener)
+{
+    iListener = aListener;
+}
+
+SsdpListenerMulticast* SsdpMessage::Listener() const
+{
+    return iListener;
+}
+
+
+// SsdpDispatcher
+
+SsdpDispatcher::SsdpDispatcher(TUint aNumThreads)
+    : iFree(kMaxMessages, EFifoSignalOnDemand)
+{
+    ASSERT(aNumThreads > 0);
+    iMessages = new SsdpMessage[kMaxMessages];
+    for (TUint i=0; i<kMaxMessages; i++) {
+        iFree.Write(&iMessages[i]);
+    }
+    TChar name[5] = "SSW ";
+    for (TUint i=0; i<aNumThreads; i++) {
+        name[3] = (TChar)('0' + i%10);
+        iWorkers.push_back(new Worker(*this, name));
+    }
+}
+
+SsdpDispatcher::~SsdpDispatcher()
+{
+    for (TUint i=0; i<iWorkers.size(); i++) {
+        delete iWorkers[i];
+    }
+    ASSERT(iFree.SlotsUsed() == kMaxMessages);
+    delete[] iMessages;
+}
+
+SsdpMessage& SsdpDispatcher::Claim()
+{
+    return *(iFree.Read());
+}
+
+void SsdpDispatcher::Release(SsdpMessage& aMessage)
+{
+    aMessage.SetListener(NULL);
+    iFree.Write(&aMessage);
+}
+
+void SsdpDispatcher::Queue(SsdpListenerMulticast& aListener, SsdpMessage& aMessage)
+{
+    aMessage.SetListener(&aListener);
+    iWorkers[aMessage.Key() % iWorkers.size()]->Queue(&aMessage);
+}
+
+void SsdpDispatcher::Dispatch(SsdpMessage& aMessage)
+{
+    SsdpListenerMulticast* listener = aMessage.Listener();
+    listener->Dispatch(aMessage);
+    Release(aMessage);
+    listener->DispatchComplete(); // listener may be deleted as soon as this returns
+}
+
+
+// SsdpDispatcher::Worker
+
+SsdpDispatcher::Worker::Worker(SsdpDispatcher& aDispatcher, const TChar* aName)
+    : iDispatcher(aDispatcher)
+    , iQueue(kMaxMessages, EFifoSignalOnDemand) // can hold every message so Queue() never blocks
+{
+    iThread = new ThreadFunctor(aName, MakeFunctor(*this, &SsdpDispatcher::Worker::Run));
+    iThread->Start();
+}
+
+SsdpDispatcher::Worker::~Worker()
+{
+    iQueue.Write(NULL);
+    delete iThread;
+}
+
+void SsdpDispatcher::Worker::Queue(SsdpMessage* aMessage)
+{
+    iQueue.Write(aMessage);
+}
+
+void SsdpDispatcher::Worker::Run()
+{
+    for (;;) {
+        SsdpMessage* msg = iQueue.Read();
+        if (msg == NULL) {
+            break;
+        }
+        iDispatcher.Dispatch(*msg);
+    }
+}
+
 // SsdpListener
 
 SsdpListener::SsdpListener()
@@ -61,6 +295,10 @@ SsdpListenerMulticast::SsdpListenerMulticast(Environment& aEnv, TIpAddress aInte
     , iBuffer(iSocket)
     , iReaderRequest(aEnv, iBuffer)
     , iExiting(false)
+    , iDispatcher(aEnv.SsdpDispatcher())
+    , iDispatchesPending(0)
+    , iWaitingForDispatches(false)
+    , iDispatchesCompleted("SSDD", 0)
 {
     try
     {
@@ -94,32 +332,30 @@ void SsdpListenerMulticast::Run()
             if (iReaderRequest.Version() == Http::eHttp11) {
                 if (iReaderRequest.Uri() == Ssdp::kMethodUri) {
                     const Brx& method = iReaderRequest.Method();
-                    if (method == Ssdp::kMethodNotify) {
-                        LOG(kSsdpMulticast, "SSDP Multicast      Notify\n");
-                        iLock.Wait();
-                        EraseDisabled(iNotifyHandlers);
-                        VectorNotifyHandler callbacks;
-                        TUint count = (TUint)iNotifyHandlers.size();
-                        for (TUint i=0; i<count; i++) {
-                            callbacks.push_back(iNotifyHandlers[i]);
+                    if (method == Ssdp::kMethodNotify || method == Ssdp::kMethodMsearch) {
+                        SsdpMessage& msg = (iDispatcher == NULL? iMessage : iDispatcher->Claim());
+                        TBool valid;
+                        if (method == Ssdp::kMethodNotify) {
+                            LOG(kSsdpMulticast, "SSDP Multicast      Notify\n");
+                            valid = ClassifyNotify(msg);
                         }
-                        iLock.Signal();
-                        for (TUint i = 0; i<count; i++) {
-                            Notify(*(callbacks[i]));
+                        else {
+                            LOG(kSsdpMulticast, "SSDP Multicast      Msearch\n");
+                            valid = ClassifyMsearch(msg);
                         }
-                    }
-                    else if (method == Ssdp::kMethodMsearch) {
-                        LOG(kSsdpMulticast, "SSDP Multicast      Msearch\n");
-                        iLock.Wait();
-                        EraseDisabled(iMsearchHandlers);
-                        VectorMsearchHandler callbacks;
-                        TUint count = (TUint)iMsearchHandlers.size();
-                        for (TUint i=0; i<count; i++) {
-                            callbacks.push_back(iMsearchHandlers[i]);
+                        if (iDispatcher == NULL) {
+                            if (valid) {
+                                Dispatch(msg);
+                            }
+                        }
+                        else if (!valid) {
+                            iDispatcher->Release(msg);
                         }
-                        iLock.Signal();
-                        for (TUint i = 0; i<count; i++) {
-                            Msearch(*(callbacks[i]));
+                        else {
+                            iLock.Wait();
+                            iDispatchesPending++;
+                            iLock.Signal();
+                            iDispatcher->Queue(*this, msg);
                         }
                     }
                 }
@@ -140,157 +376,134 @@ void SsdpListenerMulticast::Run()
     }
 }
 
-void SsdpListenerMulticast::Msearch(MsearchHandler& aHandler)
-{
-    AutoMutex a(aHandler.Mutex());
-    if (!aHandler.IsDisabled()) {
-        Msearch(*(aHandler.Handler()));
-    }
-}
-
-void SsdpListenerMulticast::Msearch(ISsdpMsearchHandler& aMsearchHandler)
+TBool SsdpListenerMulticast::ClassifyMsearch(SsdpMessage& aMessage)
 {
     TUint mx = iHeaderMx.Mx();
-
     if (mx && iHeaderHost.Received() && iHeaderMan.Received() && iHeaderSt.Received()) {
         switch(iHeaderSt.Target()) {
         case eSsdpRoot:
-            LOG(kSsdpMulticast, "SSDP Multicast      Msearch Root\n");
-            aMsearchHandler.SsdpSearchRoot(iSocket.Sender(), mx);
-            return;
         case eSsdpUuid:
-            LOG(kSsdpMulticast, "SSDP Multicast      Msearch Uuid\n");
-            aMsearchHandler.SsdpSearchUuid(iSocket.Sender(), mx, iHeaderSt.Uuid());
-            return;
         case eSsdpDeviceType:
-            LOG(kSsdpMulticast, "SSDP Multicast      Msearch Device Type\n");
-            aMsearchHandler.SsdpSearchDeviceType(iSocket.Sender(), mx, iHeaderSt.Domain(), iHeaderSt.Type(), iHeaderSt.Version());
-            return;
         case eSsdpServiceType:
-            LOG(kSsdpMulticast, "SSDP Multicast      Msearch Service Type\n");
-            aMsearchHandler.SsdpSearchServiceType(iSocket.Sender(), mx, iHeaderSt.Domain(), iHeaderSt.Type(), iHeaderSt.Version());
-            return;
         case eSsdpAll:
-            LOG(kSsdpMulticast, "SSDP Multicast      Msearch All\n");
-            aMsearchHandler.SsdpSearchAll(iSocket.Sender(), mx);
-            return;
+            aMessage.SetMsearch(iHeaderSt.Target(), iSocket.Sender(), mx, iHeaderSt.Uuid(), iHeaderSt.Domain(), iHeaderSt.Type(), iHeaderSt.Version());
+            return true;
         default:
             break;
         }
     }
+    return false;
 }
 
-void SsdpListenerMulticast::Notify(NotifyHandler& aHandler)
+TBool SsdpListenerMulticast::ClassifyNotify(SsdpMessage& aMessage)
 {
-    AutoMutex a(aHandler.Mutex());
-    if (!aHandler.IsDisabled()) {
-        Notify(*(aHandler.Handler()));
+    if (!iHeaderNts.Received()) {
+        return false;
+    }
+    TBool alive = iHeaderNts.Alive();
+    TUint maxage = 0;
+    if (alive) {
+        maxage = iHeaderCacheControl.MaxAge();
+        if (!(maxage && iHeaderHost.Received() && iHeaderLocation.Received() && iHeaderServer.Received() && iHeaderNt.Received() && iHeaderUsn.Received())) {
+            return false;
+        }
+    }
+    else if (!(iHeaderHost.Received() && iHeaderNt.Received() && iHeaderUsn.Received())) {
+        return false;
     }
+
+    ESsdpTarget target = iHeaderNt.Target();
+    if (iHeaderUsn.Target() != target) {
+        return false;
+    }
+    switch (target) {
+    case eSsdpRoot:
+        break;
+    case eSsdpUuid:
+        if (iHeaderNt.Uuid() != iHeaderUsn.Uuid()) {
+            return false;
+        }
+        break;
+    case eSsdpDeviceType:
+    case eSsdpServiceType:
+        if (iHeaderNt.Domain() != iHeaderUsn.Domain() || iHeaderNt.Type() != iHeaderUsn.Type() || iHeaderNt.Version() != iHeaderUsn.Version()) {
+            return false;
+        }
+        break;
+    default:
+        return false;
+    }
+
+    if (alive) {
+        aMessage.SetNotifyAlive(target, iHeaderUsn.Uuid(), iHeaderNt.Domain(), iHeaderNt.Type(), iHeaderNt.Version(), iHeaderLocation.Location(), maxage);
+    }
+    else {
+        aMessage.SetNotifyByeBye(target, iHeaderUsn.Uuid(), iHeaderNt.Domain(), iHeaderNt.Type(), iHeaderNt.Version());
+    }
+    return true;
 }
 
-void SsdpListenerMulticast::Notify(ISsdpNotifyHandler& aNotifyHandler)
+void SsdpListenerMulticast::Dispatch(const SsdpMessage& aMessage)
 {
-    if (iHeaderNts.Received()) {
-        if (iHeaderNts.Alive()) {
-            TUint maxage = iHeaderCacheControl.MaxAge();
-            if (maxage && iHeaderHost.Received() && iHeaderLocation.Received() && iHeaderServer.Received() && iHeaderNt.Received() && iHeaderUsn.Received()) {
-                switch(iHeaderNt.Target()) {
-                case eSsdpRoot:
-                    if (iHeaderUsn.Target() == eSsdpRoot) {
-                        LOG(kSsdpMulticast, "SSDP Multicast      Notify Alive Root\n");
-                        aNotifyHandler.SsdpNotifyRootAlive(iHeaderUsn.Uuid(), iHeaderLocation.Location(), maxage);
-                        return;
-                    }
-                    break;
-                case eSsdpUuid:
-                    if (iHeaderUsn.Target() == eSsdpUuid) {
-                        if (iHeaderNt.Uuid() == iHeaderUsn.Uuid()) {
-                            LOG(kSsdpMulticast, "SSDP Multicast      Notify Alive Uuid\n");
-                            aNotifyHandler.SsdpNotifyUuidAlive(iHeaderUsn.Uuid(), iHeaderLocation.Location(), maxage);
-                            return;
-                        }
-                    }
-                    break;
-                case eSsdpDeviceType:
-                    if (iHeaderUsn.Target() == eSsdpDeviceType) {
-                        if (iHeaderNt.Domain() == iHeaderUsn.Domain()) {
-                            if (iHeaderNt.Type() == iHeaderUsn.Type()) {
-                                if (iHeaderNt.Version() == iHeaderUsn.Version()) {
-                                    LOG(kSsdpMulticast, "SSDP Multicast      Notify Alive Device Type\n");
-                                    aNotifyHandler.SsdpNotifyDeviceTypeAlive(iHeaderUsn.Uuid(), iHeaderNt.Domain(), iHeaderNt.Type(), iHeaderNt.Version(), iHeaderLocation.Location(), maxage);
-                                    return;
-                                }
-                            }
-                        }
-                    }
-                    break;
-                case eSsdpServiceType:
-                    if (iHeaderUsn.Target() == eSsdpServiceType) {
-                        if (iHeaderNt.Domain() == iHeaderUsn.Domain()) {
-                            if (iHeaderNt.Type() == iHeaderUsn.Type()) {
-                                if (iHeaderNt.Version() == iHeaderUsn.Version()) {
-                                    LOG(kSsdpMulticast, "SSDP Multicast      Notify Alive Service Type\n");
-                                    aNotifyHandler.SsdpNotifyServiceTypeAlive(iHeaderUsn.Uuid(), iHeaderNt.Domain(), iHeaderNt.Type(), iHeaderNt.Version(), iHeaderLocation.Location(), maxage);
-                                    return;
-                                }
-                            }
-                        }
-                    }
-                    break;
-                default:
-                    break;
-                }
+    /* Handlers are reference counted so that one removed (and erased by another thread) while
+       we're calling it isn't deleted under us.  Each handler's own lock ensures that it is never
+       called concurrently and that it is never called after RemoveXxxHandler returns. */
+    if (aMessage.IsMsearch()) {
+        iLock.Wait();
+        EraseDisabled(iMsearchHandlers);
+        VectorMsearchHandler callbacks(iMsearchHandlers);
+        for (TUint i=0; i<callbacks.size(); i++) {
+            callbacks[i]->AddRef();
+        }
+        iLock.Signal();
+        for (TUint i=0; i<callbacks.size(); i++) {
+            MsearchHandler* handler = callbacks[i];
+            AutoMutex a(handler->Mutex());
+            if (!handler->IsDisabled()) {
+                aMessage.Msearch(*(handler->Handler()));
             }
         }
-        else {
-            if (iHeaderHost.Received() && iHeaderNt.Received() && iHeaderUsn.Received()) {
-                switch(iHeaderNt.Target()) {
-                case eSsdpRoot:
-                    if (iHeaderUsn.Target() == eSsdpRoot) {
-                        LOG(kSsdpMulticast, "SSDP Multicast      Notify ByeBye Root\n");
-                        aNotifyHandler.SsdpNotifyRootByeBye(iHeaderUsn.Uuid());
-                        return;
-                    }
-                    break;
-                case eSsdpUuid:
-                    if (iHeaderUsn.Target() == eSsdpUuid) {
-                        if (iHeaderNt.Uuid() == iHeaderUsn.Uuid()) {
-                            LOG(kSsdpMulticast, "SSDP Multicast      Notify ByeBye Uuid\n");
-                            aNotifyHandler.SsdpNotifyUuidByeBye(iHeaderUsn.Uuid());
-                            return;
-                        }
-                    }
-                    break;
-                case eSsdpDeviceType:
-                    if (iHeaderUsn.Target() == eSsdpDeviceType) {
-                        if (iHeaderNt.Domain() == iHeaderUsn.Domain()) {
-                            if (iHeaderNt.Type() == iHeaderUsn.Type()) {
-                                if (iHeaderNt.Version() == iHeaderUsn.Version()) {
-                                    LOG(kSsdpMulticast, "SSDP Multicast      Notify ByeBye Device Type\n");
-                                    aNotifyHandler.SsdpNotifyDeviceTypeByeBye(iHeaderUsn.Uuid(), iHeaderNt.Domain(), iHeaderNt.Type(), iHeaderNt.Version());
-                                    return;
-                                }
-                            }
-                        }
-                    }
-                    break;
-                case eSsdpServiceType:
-                    if (iHeaderUsn.Target() == eSsdpServiceType) {
-                        if (iHeaderNt.Domain() == iHeaderUsn.Domain()) {
-                            if (iHeaderNt.Type() == iHeaderUsn.Type()) {
-                                if (iHeaderNt.Version() == iHeaderUsn.Version()) {
-                                    LOG(kSsdpMulticast, "SSDP Multicast      Notify ByeBye Service Type\n");
-                                    aNotifyHandler.SsdpNotifyServiceTypeByeBye(iHeaderUsn.Uuid(), iHeaderNt.Domain(), iHeaderNt.Type(), iHeaderNt.Version());
-                                    return;
-                                }
-                            }
-                        }
-                    }
-                default:
-                    break;
-                }
+        iLock.Wait();
+        for (TUint i=0; i<callbacks.size(); i++) {
+            if (callbacks[i]->RemoveRef()) {
+                delete callbacks[i];
+            }
+        }
+        iLock.Signal();
+    }
+    else {
+        iLock.Wait();
+        EraseDisabled(iNotifyHandlers);
+        VectorNotifyHandler callbacks(iNotifyHandlers);
+        for (TUint i=0; i<callbacks.size(); i++) {
+            callbacks[i]->AddRef();
+        }
+        iLock.Signal();
+        for (TUint i=0; i<callbacks.size(); i++) {
+            NotifyHandler* handler = callbacks[i];
+            AutoMutex a(handler->Mutex());
+            if (!handler->IsDisabled()) {
+                aMessage.Notify(*(handler->Handler()));
             }
         }
+        iLock.Wait();
+        for (TUint i=0; i<callbacks.size(); i++) {
+            if (callbacks[i]->RemoveRef()) {
+                delete callbacks[i];
+            }
+        }
+        iLock.Signal();
+    }
+}
+
+void SsdpListenerMulticast::DispatchComplete()
+{
+    iLock.Wait();
+    ASSERT(iDispatchesPending > 0);
+    const TBool completed = (--iDispatchesPending == 0 && iWaitingForDispatches);
+    iLock.Signal();
+    if (completed) {
+        iDispatchesCompleted.Signal();
     }
 }
 
@@ -300,6 +513,13 @@ SsdpListenerMulticast::~SsdpListenerMulticast()
     iExiting = true;
     iReaderRequest.Interrupt();
     Join();
+    iLock.Wait();
+    iWaitingForDispatches = (iDispatchesPending > 0);
+    const TBool wait = iWaitingForDispatches;
+    iLock.Signal();
+    if (wait) {
+        iDispatchesCompleted.Wait();
+    }
     EraseDisabled(iNotifyHandlers);
     ASSERT(iNotifyHandlers.size() == 0);
     EraseDisabled(iMsearchHandlers);
@@ -375,8 +595,10 @@ void SsdpListenerMulticast::EraseDisabled(VectorNotifyHandler& aVector)
         handler->Lock();
         if (handler->IsDisabled()) {
             handler->Unlock();
-            delete handler;
             it = aVector.erase(it);
+            if (handler->RemoveRef()) {
+                delete handler;
+            }
         }
         else {
             handler->Unlock();
@@ -393,8 +615,10 @@ void SsdpListenerMulticast::EraseDisabled(VectorMsearchHandler& aVector)
         handler->Lock();
         if (handler->IsDisabled()) {
             handler->Unlock();
-            delete handler;
             it = aVector.erase(it);
+            if (handler->RemoveRef()) {
+                delete handler;
+            }
         }
         else {
             handler->Unlock();
@@ -416,7 +640,7 @@ SsdpListenerUnicast::SsdpListenerUnicast(Environment& aEnv, ISsdpNotifyHandler&
     , iNotifyHandler(aNotifyHandler)
     , iSocket(aEnv, 0, aInterface)
     , iSocketWriter(iSocket, Endpoint(Ssdp::kMulticastPort, Ssdp::kMulticastAddress))
-    , iSocketReader(iSocket)
+    , iSocketReader(iSocket, kMaxDatagrams, kMaxBufferBytes)
     , iWriteBuffer(iSocketWriter)
     , iWriter(iWriteBuffer)
     , iReadBuffer(iSocketReader)
@@ -7,6 +7,7 @@
 #include <OpenHome/Net/Private/Ssdp.h>
 #include <OpenHome/Private/Stream.h>
 #include <OpenHome/Private/Network.h>
+#include <OpenHome/Private/Fifo.h>
 
 #include <vector>
 
@@ -44,6 +45,8 @@ public:
 
 class SsdpSocketReader : public SocketUdpMulticast, public IReaderSource
 {
+    static const TUint kMaxDatagrams = 16;      // received per system call
+    static const TUint kMaxDatagramBytes = 1500;
 public:
     SsdpSocketReader(Environment& aEnv, TIpAddress aInterface, const Endpoint& aMulticast);
     ~SsdpSocketReader();
@@ -56,6 +59,85 @@ private:
     UdpReader* iReader;
 };
 
+class SsdpListenerMulticast;
+
+// SsdpMessage - a notification or m-search request, validated and decoded once by SsdpListenerMulticast
+//             - then passed on to each interested ISsdpNotifyHandler or ISsdpMsearchHandler
+class SsdpMessage : private INonCopyable
+{
+    static const TUint kMaxUuidBytes = 64;
+    static const TUint kMaxDomainBytes = 64;
+    static const TUint kMaxTypeBytes = 64;
+    static const TUint kMaxLocationBytes = 1000;
+public:
+    SsdpMessage();
+    void SetNotifyAlive(ESsdpTarget aTarget, const Brx& aUuid, const Brx& aDomain, const Brx& aType, TUint aVersion, const Brx& aLocation, TUint aMaxAge);
+    void SetNotifyByeBye(ESsdpTarget aTarget, const Brx& aUuid, const Brx& aDomain, const Brx& aType, TUint aVersion);
+    void SetMsearch(ESsdpTarget aTarget, const Endpoint& aSender, TUint aMx, const Brx& aUuid, const Brx& aDomain, const Brx& aType, TUint aVersion);
+    TBool IsMsearch() const;
+    TUint Key() const; // messages with the same key (i.e. from the same device or requester) must be handled in order
+    void Notify(ISsdpNotifyHandler& aNotifyHandler) const;
+    void Msearch(ISsdpMsearchHandler& aMsearchHandler) const;
+    void SetListener(SsdpListenerMulticast* aListener);
+    SsdpListenerMulticast* Listener() const;
+private:
+    void Set(ESsdpTarget aTarget, const Brx& aUuid, const Brx& aDomain, const Brx& aType, TUint aVersion);
+private:
+    enum EKind
+    {
+        eNotifyAlive
+       ,eNotifyByeBye
+       ,eMsearch
+    };
+    EKind iKind;
+    ESsdpTarget iTarget;
+    Bws<kMaxUuidBytes> iUuid;
+    Bws<kMaxDomainBytes> iDomain;
+    Bws<kMaxTypeBytes> iType;
+    TUint iVersion;
+    Bws<kMaxLocationBytes> iLocation;
+    TUint iMaxAge;
+    Endpoint iSender;
+    TUint iMx;
+    SsdpListenerMulticast* iListener;
+};
+
+// SsdpDispatcher - pool of threads, shared by all SsdpListenerMulticast instances, which passes received
+//                  messages on to handlers.  This leaves each listener thread free to keep reading while
+//                  handlers run and allows messages about different devices to be handled in parallel.
+//                - messages with the same SsdpMessage::Key() are always handled by the same thread, in the
+//                  order they were received.
+class SsdpDispatcher : private INonCopyable
+{
+    static const TUint kMaxMessages = 64;
+public:
+    SsdpDispatcher(TUint aNumThreads);
+    ~SsdpDispatcher();
+    SsdpMessage& Claim(); // blocks until a message is free
+    void Release(SsdpMessage& aMessage);
+    void Queue(SsdpListenerMulticast& aListener, SsdpMessage& aMessage);
+private:
+    void Dispatch(SsdpMessage& aMessage);
+private:
+    class Worker : private INonCopyable
+    {
+    public:
+        Worker(SsdpDispatcher& aDispatcher, const TChar* aName);
+        ~Worker();
+        void Queue(SsdpMessage* aMessage);
+    private:
+        void Run();
+    private:
+        SsdpDispatcher& iDispatcher;
+        Fifo<SsdpMessage*> iQueue;
+        ThreadFunctor* iThread;
+    };
+private:
+    SsdpMessage* iMessages;
+    Fifo<SsdpMessage*> iFree;
+    std::vector<Worker*> iWorkers;
+};
+
 // SsdpListener - base class for ListenerMulticast and ListenerUnicast
 class SsdpListener : public Thread
 {
@@ -72,8 +154,10 @@ protected:
 
 // SsdpListenerMulticast - listens to the multicast udp endpoint
 //                       - processes received messages and passes them on to either an IMsearchHandler or an INotifyHandler
+//                       - handlers are called by this thread or, if the environment has one, an SsdpDispatcher thread
 class SsdpListenerMulticast : public SsdpListener
 {
+    friend class SsdpDispatcher;
     static const TUint kMaxBufferBytes = 1024;
     static const TUint kRecvBufBytes = 32 * 1024;
     class Handler
@@ -85,12 +169,16 @@ class SsdpListenerMulticast : public SsdpListener
         void Unlock() { iLock.Signal(); }
         void Disable() { iDead = true; }
         TBool IsDisabled() const { return iDead; }
+        void AddRef() { iRefCount++; }                     // called with SsdpListenerMulticast::iLock held
+        TBool RemoveRef() { return (--iRefCount == 0); }   // called with SsdpListenerMulticast::iLock held
+        virtual ~Handler() {}
     protected:
-        Handler(TInt aId) : iDead(false), iId(aId), iLock("SSDM") {}
+        Handler(TInt aId) : iDead(false), iId(aId), iLock("SSDM"), iRefCount(1) {}
     private:
         TBool iDead;
         TInt iId;
         OpenHome::Mutex iLock;
+        TUint iRefCount;
     };
     class NotifyHandler : public Handler
     {
@@ -121,10 +209,10 @@ public:
 private:
     void Run();
     void Terminated();
-    void Notify(NotifyHandler& aHandler);
-    void Notify(ISsdpNotifyHandler& aNotifyHandler);
-    void Msearch(MsearchHandler& aHandler);
-    void Msearch(ISsdpMsearchHandler& aMsearchHandler);
+    TBool ClassifyNotify(SsdpMessage& aMessage);
+    TBool ClassifyMsearch(SsdpMessage& aMessage);
+    void Dispatch(const SsdpMessage& aMessage);
+    void DispatchComplete();
     void EraseDisabled(VectorNotifyHandler& aVector);
     void EraseDisabled(VectorMsearchHandler& aVector);
 private:
@@ -142,6 +230,11 @@ private:
     SsdpHeaderNt iHeaderNt;
     SsdpHeaderNts iHeaderNts;
     TBool iExiting;
+    SsdpDispatcher* iDispatcher;
+    SsdpMessage iMessage;           // only used if there is no iDispatcher
+    TUint iDispatchesPending;       // messages queued with iDispatcher but not yet completed
+    TBool iWaitingForDispatches;
+    Semaphore iDispatchesCompleted;
 };
 
 // SsdpListenerUnicast - sends out an msearch request and listens to the unicast responses
@@ -150,6 +243,7 @@ class SsdpListenerUnicast : public SsdpListener
 {
     static const TUint kMaxBufferBytes = 1024;
     static const TUint kRecvBufBytes = 64 * 1024;
+    static const TUint kMaxDatagrams = 16; // received per system call
 public:
     SsdpListenerUnicast(Environment& aEnv, ISsdpNotifyHandler& aNotifyHandler, TIpAddress aInterface);
     ~SsdpListenerUnicast();
@@ -358,6 +358,74 @@ void InitialisationParams::SetDvEnableBonjour()
     iEnableBonjour = true;
 }
 
+void InitialisationParams::SetEventDrivenTcpServers()
+{
+    iEventDrivenTcpServers = true;
+}
+
+void InitialisationParams::SetDvKeepAlive(uint32_t aIdleTimeoutMs, uint32_t aMaxRequests)
+{
+    ASSERT(aIdleTimeoutMs == 0 || aMaxRequests > 0);
+    iDvKeepAliveIdleTimeoutMs = aIdleTimeoutMs;
+    iDvKeepAliveMaxRequests = aMaxRequests;
+}
+
+void InitialisationParams::SetCpConnectionPool(uint32_t aMaxIdlePerDevice, uint32_t aIdleTimeoutMs)
+{
+    ASSERT(aMaxIdlePerDevice == 0 || aIdleTimeoutMs > 0);
+    iCpConnectionPoolMaxPerDevice = aMaxIdlePerDevice;
+    iCpConnectionPoolIdleTimeoutMs = aIdleTimeoutMs;
+}
+
+void InitialisationParams::SetDvEventKeepAlive(uint32_t aIdleTimeoutMs)
+{
+    iDvEventKeepAliveIdleTimeoutMs = aIdleTimeoutMs;
+}
+
+void InitialisationParams::SetDvEventModeration(uint32_t aIntervalMs)
+{
+    iDvEventModerationMs = aIntervalMs;
+}
+
+void InitialisationParams::SetNumTimerThreads(uint32_t aNumThreads)
+{
+    iNumTimerThreads = aNumThreads;
+}
+
+void InitialisationParams::SetDvResourceCacheBytes(uint32_t aBytes)
+{
+    iDvResourceCacheBytes = aBytes;
+}
+
+void InitialisationParams::SetNumSsdpThreads(uint32_t aNumThreads)
+{
+    iNumSsdpThreads = aNumThreads;
+}
+
+void InitialisationParams::SetCpDeviceXmlCacheDir(const char* aDir)
+{
+    iCpDeviceXmlCacheDir.Set(aDir == NULL? "" : aDir);
+}
+
+void InitialisationParams::SetDvServerBuffers(uint32_t aMaxRequestBytes, uint32_t aResponseBufferBytes, uint32_t aNotifyBufferBytes)
+{
+    ASSERT(aMaxRequestBytes > 0 && aResponseBufferBytes > 0 && aNotifyBufferBytes > 0);
+    iDvMaxRequestBytes = aMaxRequestBytes;
+    iDvResponseBufferBytes = aResponseBufferBytes;
+    iDvNotifyBufferBytes = aNotifyBufferBytes;
+}
+
+void InitialisationParams::SetCpEventSessionReadBufferBytes(uint32_t aBytes)
+{
+    ASSERT(aBytes > 0);
+    iCpEventSessionReadBufferBytes = aBytes;
+}
+
+void InitialisationParams::SetAdaptiveSessionBuffers()
+{
+    iAdaptiveSessionBuffers = true;
+}
+
 FunctorMsg& InitialisationParams::LogOutput()
 {
     return iLogOutput;
@@ -507,6 +575,86 @@ bool InitialisationParams::DvIsBonjourEnabled() const
     return iEnableBonjour;
 }
 
+bool InitialisationParams::UseEventDrivenTcpServers() const
+{
+    return iEventDrivenTcpServers;
+}
+
+uint32_t InitialisationParams::DvKeepAliveIdleTimeoutMs() const
+{
+    return iDvKeepAliveIdleTimeoutMs;
+}
+
+uint32_t InitialisationParams::DvKeepAliveMaxRequests() const
+{
+    return iDvKeepAliveMaxRequests;
+}
+
+uint32_t InitialisationParams::CpConnectionPoolMaxPerDevice() const
+{
+    return iCpConnectionPoolMaxPerDevice;
+}
+
+uint32_t InitialisationParams::CpConnectionPoolIdleTimeoutMs() const
+{
+    return iCpConnectionPoolIdleTimeoutMs;
+}
+
+uint32_t InitialisationParams::DvEventKeepAliveIdleTimeoutMs() const
+{
+    return iDvEventKeepAliveIdleTimeoutMs;
+}
+
+uint32_t InitialisationParams::DvEventModerationMs() const
+{
+    return iDvEventModerationMs;
+}
+
+uint32_t InitialisationParams::NumTimerThreads() const
+{
+    return iNumTimerThreads;
+}
+
+uint32_t InitialisationParams::DvResourceCacheBytes() const
+{
+    return iDvResourceCacheBytes;
+}
+
+uint32_t InitialisationParams::NumSsdpThreads() const
+{
+    return iNumSsdpThreads;
+}
+
+const Brx& InitialisationParams::CpDeviceXmlCacheDir() const
+{
+    return iCpDeviceXmlCacheDir;
+}
+
+uint32_t InitialisationParams::DvMaxRequestBytes() const
+{
+    return iDvMaxRequestBytes;
+}
+
+uint32_t InitialisationParams::DvResponseBufferBytes() const
+{
+    return iDvResponseBufferBytes;
+}
+
+uint32_t InitialisationParams::DvNotifyBufferBytes() const
+{
+    return iDvNotifyBufferBytes;
+}
+
+uint32_t InitialisationParams::CpEventSessionReadBufferBytes() const
+{
+    return iCpEventSessionReadBufferBytes;
+}
+
+bool InitialisationParams::UseAdaptiveSessionBuffers() const
+{
+    return iAdaptiveSessionBuffers;
+}
+
 InitialisationParams::InitialisationParams()
     : iTcpConnectTimeoutMs(3000)
     , iMsearchTimeSecs(3)
@@ -528,6 +676,22 @@ InitialisationParams::InitialisationParams()
     , iDvUpnpWebServerPort(0)
     , iDvWebSocketPort(0)
     , iEnableBonjour(false)
+    , iEventDrivenTcpServers(false)
+    , iDvKeepAliveIdleTimeoutMs(0)
+    , iDvKeepAliveMaxRequests(100)
+    , iCpConnectionPoolMaxPerDevice(0)
+    , iCpConnectionPoolIdleTimeoutMs(10000)
+    , iDvEventKeepAliveIdleTimeoutMs(0)
+    , iDvEventModerationMs(0)
+    , iNumTimerThreads(0)
+    , iDvResourceCacheBytes(0)
+    , iNumSsdpThreads(0)
+    , iCpDeviceXmlCacheDir("")
+    , iDvMaxRequestBytes(64 * 1024)
+    , iDvResponseBufferBytes(4 * 1024)
+    , iDvNotifyBufferBytes(12 * 1024)
+    , iCpEventSessionReadBufferBytes(16 * 1024)
+    , iAdaptiveSessionBuffers(false)
 {
     iDefaultLogger = new DefaultLogger;
     FunctorMsg functor = MakeFunctorMsg(*iDefaultLogger, &OpenHome::Net::DefaultLogger::Log);
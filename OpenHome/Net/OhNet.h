@@ -312,6 +312,112 @@ public:
      * Note that enabling Bonjour will cause the device stack to run a http server on port 80, requiring root privileges on linux.
      */
     void SetDvEnableBonjour();
+    /**
+     * Use event driven (readiness based) tcp servers for the device stack's UPnP
+     * server and the control point stack's UPnP event server.
+     * Server threads (see SetDvNumServerThreads() and SetNumEventSessionThreads())
+     * then form a worker pool which is only used for connections with data
+     * available, allowing many more clients to be connected than there are threads.
+     * Ignored on platforms which don't support this; they continue to use one
+     * thread per connection.
+     */
+    void SetEventDrivenTcpServers();
+    /**
+     * Allow the device stack's UPnP server to keep connections open after a response,
+     * allowing a control point to issue a series of requests over a single connection.
+     * A connection is closed if no further request is received within aIdleTimeoutMs
+     * or after it has served aMaxRequests requests.
+     * An idle timeout of 0 (the default) disables persistent connections.
+     * Unless SetEventDrivenTcpServers() is also used, each idle connection occupies one
+     * of the threads set by SetDvNumServerThreads().
+     */
+    void SetDvKeepAlive(uint32_t aIdleTimeoutMs, uint32_t aMaxRequests);
+    /**
+     * Allow the control point stack to reuse connections for a series of action invocations
+     * on the same device.  Up to aMaxIdlePerDevice idle connections are retained for each
+     * device; an idle connection is closed if it isn't reused within aIdleTimeoutMs.
+     * A value of 0 for aMaxIdlePerDevice (the default) disables connection reuse.
+     * An action whose request was sent on a connection the device had since closed fails
+     * rather than being retried, so aIdleTimeoutMs should be shorter than devices' own
+     * keep-alive timeouts.
+     */
+    void SetCpConnectionPool(uint32_t aMaxIdlePerDevice, uint32_t aIdleTimeoutMs);
+    /**
+     * Allow the device stack to keep a connection to each event subscriber open after
+     * sending it a notification, reusing it for later notifications to any of that
+     * subscriber's subscriptions.  A connection is closed if it isn't reused within
+     * aIdleTimeoutMs.  An idle timeout of 0 (the default) disables connection reuse.
+     */
+    void SetDvEventKeepAlive(uint32_t aIdleTimeoutMs);
+    /**
+     * Set the default moderation interval for property updates published by device services.
+     * Updates made within aIntervalMs of the previous notification are coalesced into a
+     * single notification sent once the interval has elapsed.  Individual providers can
+     * override this using DvProvider::SetEventModerationMs().
+     * An interval of 0 (the default) publishes each update as soon as it is made.
+     */
+    void SetDvEventModeration(uint32_t aIntervalMs);
+    /**
+     * Set the number of threads which run timer callbacks.
+     * By default (0), all callbacks run on the timer manager's own thread so a slow callback
+     * delays every other timer in the process.  Any other value runs callbacks on a pool of
+     * this many threads.  A given timer's callbacks still never run concurrently and
+     * Timer::Cancel() still waits for any running callback for that timer to complete.
+     */
+    void SetNumTimerThreads(uint32_t aNumThreads);
+    /**
+     * Set the maximum number of bytes of device resources (files written by an IResourceManager)
+     * to be cached in memory.
+     * The default (0) disables caching so every request reads from the resource manager.
+     * Only resources whose size is known when they're written, and which are no larger than a
+     * quarter of the cache, are cached.  A resource manager can provide a gzip compressed copy
+     * of any resource at [uri].gz; this will be served to clients which accept gzip encoding.
+     */
+    void SetDvResourceCacheBytes(uint32_t aBytes);
+    /**
+     * Set the number of threads which pass received SSDP multicast messages on to the
+     * control and device stacks.
+     * By default (0), each network interface's listener thread does this itself, handling
+     * each message in turn with every interested device list or device.  Any other value
+     * leaves listener threads free to keep reading while a pool of this many threads,
+     * shared by all interfaces, handles messages.  Messages about a given device are still
+     * handled in the order they were received.
+     */
+    void SetNumSsdpThreads(uint32_t aNumThreads);
+    /**
+     * Set a directory in which control points can keep copies of the device descriptions
+     * they fetch.  The directory must already exist and be writable.
+     * Devices whose description is found there are reported as soon as they're discovered,
+     * with their description being re-fetched in the background; any change is picked up
+     * by devices discovered subsequently.
+     * By default (NULL or an empty string), descriptions are always fetched before devices
+     * are reported.
+     */
+    void SetCpDeviceXmlCacheDir(const char* aDir);
+    /**
+     * Set the sizes of buffers used by the device stack's UPnP server.
+     * aMaxRequestBytes limits the size of a request's headers plus its body; each server
+     * thread allocates a read buffer of this size unless SetAdaptiveSessionBuffers() is used.
+     * aResponseBufferBytes is the size of each server thread's buffer for writing responses.
+     * aNotifyBufferBytes is the size of the buffer used to write each event notification.
+     * Larger responses and notifications are still sent; they just take more writes.
+     * Defaults are 65536, 4096 and 12288 bytes.
+     */
+    void SetDvServerBuffers(uint32_t aMaxRequestBytes, uint32_t aResponseBufferBytes, uint32_t aNotifyBufferBytes);
+    /**
+     * Set the size of the read buffer for each of the control point stack's event sessions.
+     * Notifications with larger bodies are still accepted but are copied out of the buffer
+     * before being processed.  Defaults to 16384 bytes.
+     */
+    void SetCpEventSessionReadBufferBytes(uint32_t aBytes);
+    /**
+     * Start the read buffers for device server threads and control point event sessions
+     * small, growing each as larger requests are received, up to the sizes set by
+     * SetDvServerBuffers() and SetCpEventSessionReadBufferBytes().  A buffer returns to its
+     * initial size once its session is idle or has handled a series of smaller requests.
+     * Headers in any single line of a request must then fit in the initial buffer (8KB).
+     */
+    void SetAdaptiveSessionBuffers();
 
     FunctorMsg& LogOutput();
     FunctorMsg& FatalErrorHandler();
@@ -342,6 +448,22 @@ public:
     uint32_t DvUpnpServerPort() const;
     uint32_t DvWebSocketPort() const;
     bool DvIsBonjourEnabled() const;
+    bool UseEventDrivenTcpServers() const;
+    uint32_t DvKeepAliveIdleTimeoutMs() const;
+    uint32_t DvKeepAliveMaxRequests() const;
+    uint32_t CpConnectionPoolMaxPerDevice() const;
+    uint32_t CpConnectionPoolIdleTimeoutMs() const;
+    uint32_t DvEventKeepAliveIdleTimeoutMs() const;
+    uint32_t DvEventModerationMs() const;
+    uint32_t NumTimerThreads() const;
+    uint32_t DvResourceCacheBytes() const;
+    uint32_t NumSsdpThreads() const;
+    const Brx& CpDeviceXmlCacheDir() const;
+    uint32_t DvMaxRequestBytes() const;
+    uint32_t DvResponseBufferBytes() const;
+    uint32_t DvNotifyBufferBytes() const;
+    uint32_t CpEventSessionReadBufferBytes() const;
+    bool UseAdaptiveSessionBuffers() const;
 private:
     InitialisationParams();
     void FatalErrorHandlerDefault(const char* aMsg);
@@ -377,6 +499,22 @@ private:
     uint32_t iDvUpnpWebServerPort;
     uint32_t iDvWebSocketPort;
     bool iEnableBonjour;
+    bool iEventDrivenTcpServers;
+    uint32_t iDvKeepAliveIdleTimeoutMs;
+    uint32_t iDvKeepAliveMaxRequests;
+    uint32_t iCpConnectionPoolMaxPerDevice;
+    uint32_t iCpConnectionPoolIdleTimeoutMs;
+    uint32_t iDvEventKeepAliveIdleTimeoutMs;
+    uint32_t iDvEventModerationMs;
+    uint32_t iNumTimerThreads;
+    uint32_t iDvResourceCacheBytes;
+    uint32_t iNumSsdpThreads;
+    Brhz iCpDeviceXmlCacheDir;
+    uint32_t iDvMaxRequestBytes;
+    uint32_t iDvResponseBufferBytes;
+    uint32_t iDvNotifyBufferBytes;
+    uint32_t iCpEventSessionReadBufferBytes;
+    bool iAdaptiveSessionBuffers;
 };
 
 class CpStack;
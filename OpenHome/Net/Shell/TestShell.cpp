@@ -21,14 +21,14 @@ static void RunTestThread(CpStack& /*aCpStack*/, DvStack& /*aDvStack*/, const st
 extern void TestException();
 static void RunTestException(CpStack& /*aCpStack*/, DvStack& /*aDvStack*/, const std::vector<Brn>& /*aArgs*/) { TestException(); }
 
-extern void TestFifo();
-static void RunTestFifo(CpStack& /*aCpStack*/, DvStack& /*aDvStack*/, const std::vector<Brn>& /*aArgs*/) { TestFifo(); }
+extern void TestFifo(Environment& aEnv);
+static void RunTestFifo(CpStack& aCpStack, DvStack& /*aDvStack*/, const std::vector<Brn>& /*aArgs*/) { TestFifo(aCpStack.Env()); }
 
 extern void TestQueue();
 static void RunTestQueue(CpStack& /*aCpStack*/, DvStack& /*aDvStack*/, const std::vector<Brn>& /*aArgs*/) { TestQueue(); }
 
-extern void TestTextUtils();
-static void RunTestTextUtils(CpStack& /*aCpStack*/, DvStack& /*aDvStack*/, const std::vector<Brn>& /*aArgs*/) { TestTextUtils(); }
+extern void TestTextUtils(Environment& aEnv);
+static void RunTestTextUtils(CpStack& aCpStack, DvStack& /*aDvStack*/, const std::vector<Brn>& /*aArgs*/) { TestTextUtils(aCpStack.Env()); }
 
 extern void TestNetwork(const std::vector<Brn>& aArgs);
 static void RunTestNetwork(CpStack& /*aCpStack*/, DvStack& /*aDvStack*/, const std::vector<Brn>& aArgs) { TestNetwork(aArgs); }
@@ -66,6 +66,9 @@ static void RunTestDvInvocation(CpStack& aCpStack, DvStack& aDvStack, const std:
 extern void TestDvSubscription(CpStack& aCpStack, DvStack& aDvStack);
 static void RunTestDvSubscription(CpStack& aCpStack, DvStack& aDvStack, const std::vector<Brn>& /*aArgs*/) { TestDvSubscription(aCpStack, aDvStack); }
 
+extern void TestDvResources(DvStack& aDvStack);
+static void RunTestDvResources(CpStack& /*aCpStack*/, DvStack& aDvStack, const std::vector<Brn>& /*aArgs*/) { TestDvResources(aDvStack); }
+
 void OpenHome::TestFramework::Runner::Main(TInt /*aArgc*/, TChar* /*aArgv*/[], Net::InitialisationParams* aInitParams)
 {
     Library* lib = new Library(aInitParams);
@@ -103,6 +106,7 @@ void OpenHome::TestFramework::Runner::Main(TInt /*aArgc*/, TChar* /*aArgv*/[], N
     shellTests.push_back(ShellTest("TestDviDeviceList", RunTestDviDeviceList));
     shellTests.push_back(ShellTest("TestDvInvocation", RunTestDvInvocation));
     shellTests.push_back(ShellTest("TestDvSubscription", RunTestDvSubscription));
+    shellTests.push_back(ShellTest("TestDvResources", RunTestDvResources));
     shellTests.push_back(ShellTest("TestException", RunTestException));
 
     ShellCommandRun* cmdRun = new ShellCommandRun(*cpStack, *dvStack, *shell, shellTests);
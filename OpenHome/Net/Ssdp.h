@@ -268,12 +268,13 @@ public:
     void SsdpNotifyUuid(const Brx& aUuid, const Brx& aUri, ENotificationType aNotificationType);
     void SsdpNotifyDeviceType(const Brx& aDomain, const Brx& aType, TUint aVersion, const Brx& aUuid, const Brx& aUri, ENotificationType aNotificationType);
     void SsdpNotifyServiceType(const Brx& aDomain, const Brx& aType, TUint aVersion, const Brx& aUuid, const Brx& aUri, ENotificationType aNotificationType);
-private:
-    void SsdpNotify(const Brx& aUri, ENotificationType aNotificationType);
+    void Send(const Brx& aPacket);
+    void Send(const Brx** aPackets, TUint aCount);
 private:
     static const TUint kMaxBufferBytes = 1024;
 private:
     DvStack& iDvStack;
+    Endpoint iMulticast;
     SocketUdp iSocket;
     UdpWriter iSocketWriter;
     Sws<kMaxBufferBytes> iBuffer;
@@ -331,26 +332,58 @@ private:
     SsdpNotifier& iNotifier;
 };
 
-class SsdpMsearchResponder : public ISsdpNotify
+/**
+ * Renders alive notifications or m-search responses into a buffer.
+ *
+ * Used to build packets once so they can be sent repeatedly via
+ * SsdpNotifier::Send() or SsdpMsearchResponder::Send().
+ */
+class SsdpPacketRenderer : public ISsdpNotify, private INonCopyable
 {
 public:
-    SsdpMsearchResponder(DvStack& aDvStack);
-    void SetRemote(const Endpoint& aEndpoint, TUint aConfigId, TIpAddress aAdapter);
+    enum EPacket
+    {
+        eAlive
+       ,eMsearchResponse
+    };
+public:
+    SsdpPacketRenderer(DvStack& aDvStack);
+    void Start(EPacket aPacket, TUint aConfigId);
+    const Brx& Packet() const;
     // ISsdpNotify
     void SsdpNotifyRoot(const Brx& aUuid, const Brx& aUri);
     void SsdpNotifyUuid(const Brx& aUuid, const Brx& aUri);
     void SsdpNotifyDeviceType(const Brx& aDomain, const Brx& aType, TUint aVersion, const Brx& aUuid, const Brx& aUri);
     void SsdpNotifyServiceType(const Brx& aDomain, const Brx& aType, TUint aVersion, const Brx& aUuid, const Brx& aUri);
 private:
-    void SsdpNotify(const Brx& aUri);
-    void Flush();
+    IWriterHttpHeader& WriteHeaders(const Brx& aUri);
+    void WriteEnd();
 private:
     static const TUint kMaxBufferBytes = 1024;
 private:
     DvStack& iDvStack;
-    Bws<kMaxBufferBytes> iResponse;
+    Bws<kMaxBufferBytes> iPacket;
     WriterBuffer iBuffer;
-    WriterHttpResponse iWriter;
+    WriterHttpRequest iWriterRequest;
+    WriterHttpResponse iWriterResponse;
+    EPacket iType;
+    TUint iConfigId;
+};
+
+class SsdpMsearchResponder : public ISsdpNotify
+{
+public:
+    SsdpMsearchResponder(DvStack& aDvStack);
+    void SetRemote(const Endpoint& aEndpoint, TUint aConfigId, TIpAddress aAdapter);
+    void Send(const Brx& aPacket);
+    // ISsdpNotify
+    void SsdpNotifyRoot(const Brx& aUuid, const Brx& aUri);
+    void SsdpNotifyUuid(const Brx& aUuid, const Brx& aUri);
+    void SsdpNotifyDeviceType(const Brx& aDomain, const Brx& aType, TUint aVersion, const Brx& aUuid, const Brx& aUri);
+    void SsdpNotifyServiceType(const Brx& aDomain, const Brx& aType, TUint aVersion, const Brx& aUuid, const Brx& aUri);
+private:
+    DvStack& iDvStack;
+    SsdpPacketRenderer iRenderer;
     TUint iConfigId;
     Endpoint iRemote;
     TIpAddress iAdapter;
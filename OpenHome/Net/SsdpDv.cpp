@@ -30,12 +30,50 @@ void Ssdp::WriteNextBootId(DvStack& aDvStack, IWriterHttpHeader& aWriter)
 }
 
 
+static void WriteNotify(DvStack& aDvStack, WriterHttpRequest& aWriter, const Brx& aUri, TUint aConfigId, SsdpNotifier::ENotificationType aNotificationType)
+{
+    Ssdp::WriteMethodNotify(aWriter);
+    Ssdp::WriteHost(aWriter);
+    Ssdp::WriteBootId(aDvStack, aWriter);
+    Ssdp::WriteConfigId(aWriter, aConfigId);
+    switch (aNotificationType)
+    {
+    case SsdpNotifier::EAlive:
+        Ssdp::WriteServer(aDvStack.Env(), aWriter);
+        Ssdp::WriteMaxAge(aDvStack.Env(), aWriter);
+        Ssdp::WriteLocation(aWriter, aUri);
+        Ssdp::WriteSubTypeAlive(aWriter);
+        // !!!! Ssdp::WriteSearchPort(aWriter, ????);
+        break;
+    case SsdpNotifier::EByeBye:
+        Ssdp::WriteSubTypeByeBye(aWriter);
+        break;
+    case SsdpNotifier::EUpdate:
+        Ssdp::WriteNextBootId(aDvStack, aWriter);
+        break;
+    }
+}
+
+static void WriteMsearchResponse(DvStack& aDvStack, WriterHttpResponse& aWriter, const Brx& aUri, TUint aConfigId)
+{
+    Ssdp::WriteStatus(aWriter);
+    Ssdp::WriteServer(aDvStack.Env(), aWriter);
+    Ssdp::WriteMaxAge(aDvStack.Env(), aWriter);
+    Ssdp::WriteExt(aWriter);
+    Ssdp::WriteLocation(aWriter, aUri);
+    Ssdp::WriteBootId(aDvStack, aWriter);
+    Ssdp::WriteConfigId(aWriter, aConfigId);
+    // !!!! Ssdp::WriteSearchPort(aWriter, ????);
+}
+
+
 // SsdpNotifier
 
 SsdpNotifier::SsdpNotifier(DvStack& aDvStack)
     : iDvStack(aDvStack)
+    , iMulticast(Ssdp::kMulticastPort, Ssdp::kMulticastAddress)
     , iSocket(aDvStack.Env())
-    , iSocketWriter(iSocket, Endpoint(Ssdp::kMulticastPort, Ssdp::kMulticastAddress))
+    , iSocketWriter(iSocket, iMulticast)
     , iBuffer(iSocketWriter)
     , iWriter(iBuffer)
     , iInterface(0)
@@ -50,33 +88,9 @@ void SsdpNotifier::Start(TIpAddress aInterface, TUint aConfigId)
     iConfigId = aConfigId;
 }
 
-void SsdpNotifier::SsdpNotify(const Brx& aUri, ENotificationType aNotificationType)
-{
-    Ssdp::WriteMethodNotify(iWriter);
-    Ssdp::WriteHost(iWriter);
-    Ssdp::WriteBootId(iDvStack, iWriter);
-    Ssdp::WriteConfigId(iWriter, iConfigId);
-    switch (aNotificationType)
-    {
-    case EAlive:
-        Ssdp::WriteServer(iDvStack.Env(), iWriter);
-        Ssdp::WriteMaxAge(iDvStack.Env(), iWriter);
-        Ssdp::WriteLocation(iWriter, aUri);
-        Ssdp::WriteSubTypeAlive(iWriter);
-        // !!!! Ssdp::WriteSearchPort(iWriter, ????);
-        break;
-    case EByeBye:
-        Ssdp::WriteSubTypeByeBye(iWriter);
-        break;
-    case EUpdate:
-        Ssdp::WriteNextBootId(iDvStack, iWriter);
-        break;
-    }
-}
-
 void SsdpNotifier::SsdpNotifyRoot(const Brx& aUuid, const Brx& aUri, ENotificationType aNotificationType)
 {
-    SsdpNotify(aUri, aNotificationType);
+    WriteNotify(iDvStack, iWriter, aUri, iConfigId, aNotificationType);
     Ssdp::WriteNotificationTypeRoot(iWriter);
     Ssdp::WriteUsnRoot(iWriter, aUuid);
     iWriter.WriteFlush();
@@ -84,7 +98,7 @@ void SsdpNotifier::SsdpNotifyRoot(const Brx& aUuid, const Brx& aUri, ENotificati
 
 void SsdpNotifier::SsdpNotifyUuid(const Brx& aUuid, const Brx& aUri, ENotificationType aNotificationType)
 {
-    SsdpNotify(aUri, aNotificationType);
+    WriteNotify(iDvStack, iWriter, aUri, iConfigId, aNotificationType);
     Ssdp::WriteNotificationTypeUuid(iWriter, aUuid);
     Ssdp::WriteUsnUuid(iWriter, aUuid);
     iWriter.WriteFlush();
@@ -92,7 +106,7 @@ void SsdpNotifier::SsdpNotifyUuid(const Brx& aUuid, const Brx& aUri, ENotificati
 
 void SsdpNotifier::SsdpNotifyDeviceType(const Brx& aDomain, const Brx& aType, TUint aVersion, const Brx& aUuid, const Brx& aUri, ENotificationType aNotificationType)
 {
-    SsdpNotify(aUri, aNotificationType);
+    WriteNotify(iDvStack, iWriter, aUri, iConfigId, aNotificationType);
     Ssdp::WriteNotificationTypeDeviceType(iWriter, aDomain, aType, aVersion);
     Ssdp::WriteUsnDeviceType(iWriter, aDomain, aType, aVersion, aUuid);
     iWriter.WriteFlush();
@@ -100,12 +114,23 @@ void SsdpNotifier::SsdpNotifyDeviceType(const Brx& aDomain, const Brx& aType, TU
 
 void SsdpNotifier::SsdpNotifyServiceType(const Brx& aDomain, const Brx& aType, TUint aVersion, const Brx& aUuid, const Brx& aUri, ENotificationType aNotificationType)
 {
-    SsdpNotify(aUri, aNotificationType);
+    WriteNotify(iDvStack, iWriter, aUri, iConfigId, aNotificationType);
     Ssdp::WriteNotificationTypeServiceType(iWriter, aDomain, aType, aVersion);
     Ssdp::WriteUsnServiceType(iWriter, aDomain, aType, aVersion, aUuid);
     iWriter.WriteFlush();
 }
 
+void SsdpNotifier::Send(const Brx& aPacket)
+{
+    iBuffer.Write(aPacket);
+    iBuffer.WriteFlush();
+}
+
+void SsdpNotifier::Send(const Brx** aPackets, TUint aCount)
+{
+    iSocket.SendMultiple(aPackets, aCount, iMulticast);
+}
+
 
 // SsdpNotifierAlive
 
@@ -191,12 +216,108 @@ void SsdpNotifierUpdate::SsdpNotifyServiceType(const Brx& aDomain, const Brx& aT
 }
 
 
+// SsdpPacketRenderer
+
+SsdpPacketRenderer::SsdpPacketRenderer(DvStack& aDvStack)
+    : iDvStack(aDvStack)
+    , iBuffer(iPacket)
+    , iWriterRequest(iBuffer)
+    , iWriterResponse(iBuffer)
+    , iType(eAlive)
+    , iConfigId(0)
+{
+}
+
+void SsdpPacketRenderer::Start(EPacket aPacket, TUint aConfigId)
+{
+    iType = aPacket;
+    iConfigId = aConfigId;
+}
+
+const Brx& SsdpPacketRenderer::Packet() const
+{
+    return iPacket;
+}
+
+IWriterHttpHeader& SsdpPacketRenderer::WriteHeaders(const Brx& aUri)
+{
+    iBuffer.Flush();
+    if (iType == eAlive) {
+        WriteNotify(iDvStack, iWriterRequest, aUri, iConfigId, SsdpNotifier::EAlive);
+        return iWriterRequest;
+    }
+    WriteMsearchResponse(iDvStack, iWriterResponse, aUri, iConfigId);
+    return iWriterResponse;
+}
+
+void SsdpPacketRenderer::WriteEnd()
+{
+    if (iType == eAlive) {
+        iWriterRequest.WriteFlush();
+    }
+    else {
+        iWriterResponse.WriteFlush();
+    }
+}
+
+void SsdpPacketRenderer::SsdpNotifyRoot(const Brx& aUuid, const Brx& aUri)
+{
+    IWriterHttpHeader& writer = WriteHeaders(aUri);
+    if (iType == eAlive) {
+        Ssdp::WriteNotificationTypeRoot(writer);
+    }
+    else {
+        Ssdp::WriteSearchTypeRoot(writer);
+    }
+    Ssdp::WriteUsnRoot(writer, aUuid);
+    WriteEnd();
+}
+
+void SsdpPacketRenderer::SsdpNotifyUuid(const Brx& aUuid, const Brx& aUri)
+{
+    IWriterHttpHeader& writer = WriteHeaders(aUri);
+    if (iType == eAlive) {
+        Ssdp::WriteNotificationTypeUuid(writer, aUuid);
+    }
+    else {
+        Ssdp::WriteSearchTypeUuid(writer, aUuid);
+    }
+    Ssdp::WriteUsnUuid(writer, aUuid);
+    WriteEnd();
+}
+
+void SsdpPacketRenderer::SsdpNotifyDeviceType(const Brx& aDomain, const Brx& aType, TUint aVersion, const Brx& aUuid, const Brx& aUri)
+{
+    IWriterHttpHeader& writer = WriteHeaders(aUri);
+    if (iType == eAlive) {
+        Ssdp::WriteNotificationTypeDeviceType(writer, aDomain, aType, aVersion);
+    }
+    else {
+        Ssdp::WriteSearchTypeDeviceType(writer, aDomain, aType, aVersion);
+    }
+    Ssdp::WriteUsnDeviceType(writer, aDomain, aType, aVersion, aUuid);
+    WriteEnd();
+}
+
+void SsdpPacketRenderer::SsdpNotifyServiceType(const Brx& aDomain, const Brx& aType, TUint aVersion, const Brx& aUuid, const Brx& aUri)
+{
+    IWriterHttpHeader& writer = WriteHeaders(aUri);
+    if (iType == eAlive) {
+        Ssdp::WriteNotificationTypeServiceType(writer, aDomain, aType, aVersion);
+    }
+    else {
+        Ssdp::WriteSearchTypeServiceType(writer, aDomain, aType, aVersion);
+    }
+    Ssdp::WriteUsnServiceType(writer, aDomain, aType, aVersion, aUuid);
+    WriteEnd();
+}
+
+
 // SsdpMsearchResponder
 
 SsdpMsearchResponder::SsdpMsearchResponder(DvStack& aDvStack)
     : iDvStack(aDvStack)
-    , iBuffer(iResponse)
-    , iWriter(iBuffer)
+    , iRenderer(aDvStack)
     , iConfigId(0)
 {
 }
@@ -208,55 +329,36 @@ void SsdpMsearchResponder::SetRemote(const Endpoint& aEndpoint, TUint aConfigId,
     iAdapter = aAdapter;
 }
 
-void SsdpMsearchResponder::SsdpNotify(const Brx& aUri)
+void SsdpMsearchResponder::Send(const Brx& aPacket)
 {
-    iBuffer.Flush(); // clear any data left over from a previous failed notification
-    Ssdp::WriteStatus(iWriter);
-    Ssdp::WriteServer(iDvStack.Env(), iWriter);
-    Ssdp::WriteMaxAge(iDvStack.Env(), iWriter);
-    Ssdp::WriteExt(iWriter);
-    Ssdp::WriteLocation(iWriter, aUri);
-    Ssdp::WriteBootId(iDvStack, iWriter);
-    Ssdp::WriteConfigId(iWriter, iConfigId);
-    // !!!! Ssdp::WriteSearchPort(iWriter, ????);
-}
-
-void SsdpMsearchResponder::Flush()
-{
-    iWriter.WriteFlush();
     SocketUdp socket(iDvStack.Env(), 0, iAdapter);
-    socket.Send(iResponse, iRemote);
-    iBuffer.Flush();
+    socket.Send(aPacket, iRemote);
 }
 
 void SsdpMsearchResponder::SsdpNotifyRoot(const Brx& aUuid, const Brx& aUri)
 {
-    SsdpNotify(aUri);
-    Ssdp::WriteSearchTypeRoot(iWriter);
-    Ssdp::WriteUsnRoot(iWriter, aUuid);
-    Flush();
+    iRenderer.Start(SsdpPacketRenderer::eMsearchResponse, iConfigId);
+    iRenderer.SsdpNotifyRoot(aUuid, aUri);
+    Send(iRenderer.Packet());
 }
 
 void SsdpMsearchResponder::SsdpNotifyUuid(const Brx& aUuid, const Brx& aUri)
 {
-    SsdpNotify(aUri);
-    Ssdp::WriteSearchTypeUuid(iWriter, aUuid);
-    Ssdp::WriteUsnUuid(iWriter, aUuid);
-    Flush();
+    iRenderer.Start(SsdpPacketRenderer::eMsearchResponse, iConfigId);
+    iRenderer.SsdpNotifyUuid(aUuid, aUri);
+    Send(iRenderer.Packet());
 }
 
 void SsdpMsearchResponder::SsdpNotifyDeviceType(const Brx& aDomain, const Brx& aType, TUint aVersion, const Brx& aUuid, const Brx& aUri)
 {
-    SsdpNotify(aUri);
-    Ssdp::WriteSearchTypeDeviceType(iWriter, aDomain, aType, aVersion);
-    Ssdp::WriteUsnDeviceType(iWriter, aDomain, aType, aVersion, aUuid);
-    Flush();
+    iRenderer.Start(SsdpPacketRenderer::eMsearchResponse, iConfigId);
+    iRenderer.SsdpNotifyDeviceType(aDomain, aType, aVersion, aUuid, aUri);
+    Send(iRenderer.Packet());
 }
 
 void SsdpMsearchResponder::SsdpNotifyServiceType(const Brx& aDomain, const Brx& aType, TUint aVersion, const Brx& aUuid, const Brx& aUri)
 {
-    SsdpNotify(aUri);
-    Ssdp::WriteSearchTypeServiceType(iWriter, aDomain, aType, aVersion);
-    Ssdp::WriteUsnServiceType(iWriter, aDomain, aType, aVersion, aUuid);
-    Flush();
+    iRenderer.Start(SsdpPacketRenderer::eMsearchResponse, iConfigId);
+    iRenderer.SsdpNotifyServiceType(aDomain, aType, aVersion, aUuid, aUri);
+    Send(iRenderer.Packet());
 }
@@ -79,6 +79,47 @@ Brn XmlParserBasic::Find(const Brx& aTag, const Brx& aDocument, Brn& aRemaining)
     }
 }
 
+Brn XmlParserBasic::Next(const Brx& aDocument, Brn& aName, Brn& aRemaining)
+{
+    Brn name;
+    Brn attributes;
+    Brn ns;
+    TUint index;
+    Brn doc(Ascii::Trim(aDocument));
+    Brn remaining;
+    ETagType tagType;
+    NextTag(doc, name, attributes, ns, index, remaining, tagType);
+    if (tagType == eTagClose) {
+        THROW(XmlError);
+    }
+    aName.Set(name);
+    if (tagType == eTagOpenClose) {
+        aRemaining.Set(remaining);
+        return Brn(Brx::Empty());
+    }
+    const Brn namesp(ns);
+    const TByte* retStart = remaining.Ptr();
+    TUint depth = 0;
+    for (;;) {
+        doc.Set(remaining);
+        NextTag(doc, name, attributes, ns, index, remaining, tagType);
+        if (tagType == eTagOpen) {
+            depth++;
+        }
+        else if (tagType == eTagClose) {
+            if (depth == 0) {
+                if (!Ascii::CaseInsensitiveEquals(name, aName) || namesp != ns) {
+                    THROW(XmlError);
+                }
+                aRemaining.Set(remaining);
+                const TUint retBytes = (TUint)(doc.Ptr() - retStart) + index;
+                return Brn(retStart, retBytes);
+            }
+            depth--;
+        }
+    }
+}
+
 void XmlParserBasic::NextTag(const Brx& aDocument, Brn& aName, Brn& aAttributes, Brn& aNamespace, TUint& aIndex, Brn& aRemaining, ETagType& aType)
 {
     aName.Set(Brx::Empty());
@@ -191,3 +232,370 @@ Brn XmlParserBasic::FindAttribute(const Brx& aTag, const Brx& aAttribute, const
         doc.Set(remaining);
     }
 }
+
+
+// XmlParserSax
+
+static const Brn kCdataStart("![CDATA[");
+
+static void AppendGrow(Bwh& aBuf, const TByte* aPtr, TUint aBytes)
+{
+    const TUint required = aBuf.Bytes() + aBytes;
+    if (required > aBuf.MaxBytes()) {
+        TUint maxBytes = aBuf.MaxBytes();
+        while (maxBytes < required) {
+            maxBytes *= 2;
+        }
+        aBuf.Grow(maxBytes);
+    }
+    if (aBytes > 0) {
+        aBuf.Append(aPtr, aBytes);
+    }
+}
+
+XmlParserSax::XmlParserSax(IXmlSaxHandler& aHandler)
+    : iHandler(aHandler)
+    , iTag(kInitialBufferBytes)
+    , iValueBuf(kInitialBufferBytes)
+    , iOpenNames(kInitialBufferBytes)
+    , iInnerDepth(0)
+    , iInnerBuf(kInitialBufferBytes)
+{
+    Reset();
+}
+
+void XmlParserSax::SetInnerXmlDepth(TUint aDepth)
+{
+    iInnerDepth = aDepth;
+}
+
+void XmlParserSax::Reset()
+{
+    iState = eText;
+    iQuote = 0;
+    iTagFirst = 0;
+    iOffset = 0;
+    iTagOffset = 0;
+    iTagEndOffset = 0;
+    iTagBytes = 0;
+    iRootSeen = false;
+    iInLeaf = false;
+    iTag.SetBytes(0);
+    iValue.Set(Brx::Empty());
+    iValueBuf.SetBytes(0);
+    iValueBuffered = false;
+    iOpenNames.SetBytes(0);
+    iOpenOffsets.clear();
+    iFragment = NULL;
+    iFragmentOffset = 0;
+    iInInner = false;
+    iInnerHasChildren = false;
+    iInnerOffset = 0;
+    iInnerBuf.SetBytes(0);
+}
+
+void XmlParserSax::Parse(const Brx& aData)
+{
+    const TByte* ptr = aData.Ptr();
+    const TUint bytes = aData.Bytes();
+    const TUint base = iOffset;
+    iFragment = ptr;
+    iFragmentOffset = base;
+    TUint i = 0;
+    TUint pending = 0; // start of any tag bytes not yet appended to iTag
+    while (i < bytes) {
+        if (iState == eText) {
+            TUint j = i;
+            while (j < bytes && ptr[j] != '<') {
+                j++;
+            }
+            if (iInLeaf && j > i) {
+                AppendValue(ptr + i, j - i);
+            }
+            if (j == bytes) {
+                break;
+            }
+            iState = eTag;
+            iQuote = 0;
+            iTagBytes = 0;
+            iTagOffset = base + j;
+            i = j + 1;
+            pending = i;
+        }
+        else {
+            for (; i<bytes; i++) {
+                const TByte ch = ptr[i];
+                if (iTagBytes++ == 0) {
+                    iTagFirst = ch;
+                }
+                if (iQuote != 0) {
+                    if (ch == iQuote) {
+                        iQuote = 0;
+                    }
+                }
+                else if (ch == '>') {
+                    Brn tag;
+                    if (iTag.Bytes() == 0) {
+                        tag.Set(ptr + pending, i - pending);
+                    }
+                    else {
+                        AppendTag(ptr + pending, i - pending);
+                        pending = i;
+                        tag.Set(iTag);
+                    }
+                    if (TagComplete(tag)) {
+                        iTagEndOffset = base + i + 1;
+                        iState = eText;
+                        i++;
+                        ProcessTag(tag);
+                        iTag.SetBytes(0);
+                        break;
+                    }
+                }
+                else if ((ch == '\"' || ch == '\'') && iTagFirst != '!' && iTagFirst != '?') {
+                    iQuote = ch;
+                }
+            }
+        }
+    }
+    if (iState == eTag) {
+        AppendTag(ptr + pending, bytes - pending);
+    }
+    if (iInLeaf && !iValueBuffered && iValue.Bytes() > 0) {
+        // value refers to aData which won't be valid for the next fragment
+        AppendValue(NULL, 0);
+    }
+    if (iInInner) {
+        const TUint start = (iInnerOffset > base? iInnerOffset - base : 0);
+        AppendGrow(iInnerBuf, ptr + start, bytes - start);
+    }
+    iOffset += bytes;
+}
+
+void XmlParserSax::Parse(IReader& aReader, TUint aBytes)
+{
+    while (aBytes > 0) {
+        const TUint bytes = (aBytes < kReadBytes? aBytes : kReadBytes);
+        Parse(aReader.Read(bytes));
+        aBytes -= bytes;
+    }
+}
+
+void XmlParserSax::End()
+{
+    if (!iRootSeen || iOpenOffsets.size() != 0 || iState != eText) {
+        THROW(XmlError);
+    }
+}
+
+TUint XmlParserSax::Depth() const
+{
+    return (TUint)iOpenOffsets.size();
+}
+
+TUint XmlParserSax::TagOffset() const
+{
+    return iTagOffset;
+}
+
+TUint XmlParserSax::TagEndOffset() const
+{
+    return iTagEndOffset;
+}
+
+void XmlParserSax::Write(TByte aValue)
+{
+    Brn buf(&aValue, 1);
+    Parse(buf);
+}
+
+void XmlParserSax::Write(const Brx& aBuffer)
+{
+    Parse(aBuffer);
+}
+
+void XmlParserSax::WriteFlush()
+{
+}
+
+void XmlParserSax::AppendTag(const TByte* aPtr, TUint aBytes)
+{
+    AppendGrow(iTag, aPtr, aBytes);
+}
+
+void XmlParserSax::AppendValue(const TByte* aPtr, TUint aBytes)
+{
+    if (!iValueBuffered) {
+        if (iValue.Bytes() == 0 && aBytes > 0) {
+            iValue.Set(aPtr, aBytes);
+            return;
+        }
+        iValueBuf.SetBytes(0);
+        AppendGrow(iValueBuf, iValue.Ptr(), iValue.Bytes());
+        iValueBuffered = true;
+    }
+    AppendGrow(iValueBuf, aPtr, aBytes);
+    iValue.Set(iValueBuf);
+}
+
+void XmlParserSax::AppendCdata(const Brx& aData)
+{
+    // values are reported escaped so escape any markup in the (literal) CDATA content
+    AppendValue(NULL, 0); // always buffer; aData may refer to iTag, which is reused
+    const TByte* ptr = aData.Ptr();
+    const TUint bytes = aData.Bytes();
+    TUint start = 0;
+    for (TUint i=0; i<bytes; i++) {
+        Brn entity;
+        switch (ptr[i])
+        {
+        case '&':
+            entity.Set("&amp;");
+            break;
+        case '<':
+            entity.Set("&lt;");
+            break;
+        case '>':
+            entity.Set("&gt;");
+            break;
+        default:
+            continue;
+        }
+        AppendValue(ptr + start, i - start);
+        AppendValue(entity.Ptr(), entity.Bytes());
+        start = i + 1;
+    }
+    AppendValue(ptr + start, bytes - start);
+}
+
+Brn XmlParserSax::InnerXml()
+{
+    // content runs from the end of the element's start tag to the start of its end tag
+    const TUint bytes = iTagOffset - iInnerOffset;
+    if (iInnerOffset >= iFragmentOffset) {
+        return Brn(iFragment + (iInnerOffset - iFragmentOffset), bytes);
+    }
+    if (iTagOffset > iFragmentOffset) {
+        AppendGrow(iInnerBuf, iFragment, iTagOffset - iFragmentOffset);
+    }
+    return Brn(iInnerBuf.Ptr(), bytes);
+}
+
+TBool XmlParserSax::TagComplete(const Brx& aTag) const
+{
+    // comments and CDATA sections may contain '>' so are only complete once we've seen "-->" or "]]>"
+    const TUint bytes = aTag.Bytes();
+    if (bytes >= 3 && aTag[0] == '!' && aTag[1] == '-' && aTag[2] == '-') {
+        return (bytes >= 5 && aTag[bytes-1] == '-' && aTag[bytes-2] == '-');
+    }
+    if (aTag.BeginsWith(kCdataStart)) {
+        return (bytes >= kCdataStart.Bytes() + 2 && aTag[bytes-1] == ']' && aTag[bytes-2] == ']');
+    }
+    return true;
+}
+
+void XmlParserSax::ProcessTag(const Brx& aTag)
+{
+    const TUint bytes = aTag.Bytes();
+    if (bytes == 0) {
+        THROW(XmlError);
+    }
+    if (aTag.BeginsWith(kCdataStart)) {
+        if (iOpenOffsets.size() == 0) {
+            THROW(XmlError);
+        }
+        if (iInLeaf) {
+            const TUint start = kCdataStart.Bytes();
+            AppendCdata(aTag.Split(start, bytes - start - 2));
+        }
+        return;
+    }
+    if (aTag[0] == '?' || aTag[0] == '!') {
+        // comments, processing instructions and simple DOCTYPEs are skipped
+        // DOCTYPEs with an internal subset aren't supported
+        const Brn kDoctype("!DOCTYPE");
+        if (aTag.BeginsWith(kDoctype) && Ascii::Contains(aTag, '[')) {
+            THROW(XmlError);
+        }
+        return;
+    }
+    if (aTag[0] == '/') {
+        CloseElement(Ascii::Trim(aTag.Split(1)));
+        return;
+    }
+    const TBool empty = (aTag[bytes-1] == '/');
+    Brn tag(aTag.Split(0, empty? bytes-1 : bytes));
+    TUint i = 0;
+    while (i < tag.Bytes() && !Ascii::IsWhitespace(tag[i])) {
+        i++;
+    }
+    OpenElement(tag.Split(0, i), Ascii::Trim(tag.Split(i)), empty);
+}
+
+void XmlParserSax::OpenElement(const Brx& aName, const Brx& aAttributes, TBool aEmpty)
+{
+    if (aName.Bytes() == 0) {
+        THROW(XmlError);
+    }
+    iRootSeen = true;
+    iInLeaf = false;
+    if (iInInner) {
+        iInnerHasChildren = true;
+    }
+    iOpenOffsets.push_back(iOpenNames.Bytes());
+    AppendGrow(iOpenNames, aName.Ptr(), aName.Bytes());
+    Brn name = LocalName(aName);
+    iHandler.XmlElementStart(name, aAttributes);
+    if (aEmpty) {
+        iHandler.XmlElementEnd(name, Brx::Empty());
+        iOpenNames.SetBytes(iOpenOffsets.back());
+        iOpenOffsets.pop_back();
+    }
+    else {
+        iInLeaf = true;
+        iValue.Set(Brx::Empty());
+        iValueBuffered = false;
+        if (iOpenOffsets.size() == iInnerDepth) {
+            iInInner = true;
+            iInnerHasChildren = false;
+            iInnerOffset = iTagEndOffset;
+            iInnerBuf.SetBytes(0);
+        }
+    }
+}
+
+void XmlParserSax::CloseElement(const Brx& aName)
+{
+    if (iOpenOffsets.size() == 0) {
+        THROW(XmlError);
+    }
+    const TUint offset = iOpenOffsets.back();
+    Brn open = iOpenNames.Split(offset);
+    if (!Ascii::CaseInsensitiveEquals(open, aName)) {
+        THROW(XmlError);
+    }
+    Brn value(iInLeaf? iValue : Brx::Empty());
+    if (iInInner && iOpenOffsets.size() == iInnerDepth) {
+        iInInner = false;
+        if (iInnerHasChildren) {
+            value.Set(InnerXml());
+        }
+    }
+    iHandler.XmlElementEnd(LocalName(aName), value);
+    iOpenNames.SetBytes(offset);
+    iOpenOffsets.pop_back();
+    iInLeaf = false;
+    iValue.Set(Brx::Empty());
+    iValueBuffered = false;
+}
+
+Brn XmlParserSax::LocalName(const Brx& aName)
+{
+    const TUint bytes = aName.Bytes();
+    for (TUint i=bytes; i>0; i--) {
+        if (aName[i-1] == ':') {
+            return aName.Split(i);
+        }
+    }
+    return Brn(aName);
+}
@@ -4,6 +4,9 @@
 #include <OpenHome/Buffer.h>
 #include <OpenHome/OhNetTypes.h>
 #include <OpenHome/Exception.h>
+#include <OpenHome/Private/Stream.h>
+
+#include <vector>
 
 EXCEPTION(XmlError);
 
@@ -24,6 +27,12 @@ public:
     static Brn Find(const Brx& aTag, const Brx& aDocument, Brn& aRemaining);
     static Brn FindAttribute(const TChar* aTag, const TChar* aAttribute, const Brx& aDocument);
     static Brn FindAttribute(const Brx& aTag, const Brx& aAttribute, const Brx& aDocument);
+    /**
+     * Returns the content of the first element in aDocument, setting aName to its
+     * (namespace-stripped) name and aRemaining to the data following its closing tag.
+     * Allows the children of an element to be walked in a single pass.
+     */
+    static Brn Next(const Brx& aDocument, Brn& aName, Brn& aRemaining);
     
 private:
     enum ETagType
@@ -41,6 +50,112 @@ private:
     static void NextTag(const Brx& aDocument, Brn& aName, Brn& aAttributes, Brn& aNamespace, TUint& aIndex, Brn& aRemaining, ETagType& aType);
 };
 
+/**
+ * Receives callbacks from XmlParserSax
+ *
+ * Element names have any namespace prefix removed.  Names, attributes and values
+ * are only valid for the duration of the callback.
+ */
+class IXmlSaxHandler
+{
+public:
+    virtual void XmlElementStart(const Brx& aName, const Brx& aAttributes) = 0;
+    /**
+     * aValue is the (still escaped) character data of an element with no children.
+     * The content of any CDATA sections is included, escaped.
+     * It is empty for elements which contain other elements, unless the element is at
+     * the depth passed to XmlParserSax::SetInnerXmlDepth(); aValue is then the element's
+     * unparsed content, child elements included.
+     */
+    virtual void XmlElementEnd(const Brx& aName, const Brx& aValue) = 0;
+    virtual ~IXmlSaxHandler() {}
+};
+
+/**
+ * Incremental, callback driven XML tokenizer
+ *
+ * Documents can be passed in any number of fragments (Parse(const Brx&), or as an
+ * IWriter) or read directly from a stream.  Tokens which lie within a single fragment
+ * are reported without being copied; only tokens which span fragments are buffered.
+ * Processing instructions, comments and DOCTYPEs are skipped.  CDATA sections are
+ * reported as character data.
+ */
+class XmlParserSax : public IWriter, private INonCopyable
+{
+    static const TUint kReadBytes = 4 * 1024;
+    static const TUint kInitialBufferBytes = 64;
+public:
+    XmlParserSax(IXmlSaxHandler& aHandler);
+    /**
+     * Report the unparsed content of elements at aDepth (1 for the root element) which
+     * contain other elements.  This content is buffered if it spans fragments.
+     * 0 (the default) disables this.  Not affected by Reset().
+     */
+    void SetInnerXmlDepth(TUint aDepth);
+    void Reset();
+    void Parse(const Brx& aData);
+    void Parse(IReader& aReader, TUint aBytes);
+    /**
+     * Throws XmlError unless a complete document has been parsed.
+     */
+    void End();
+    /**
+     * Number of elements currently open.  Inside XmlElementStart/End, this includes the
+     * element being reported.
+     */
+    TUint Depth() const;
+    /**
+     * Document offsets of the start (the '<') and end (one past the '>') of the tag
+     * currently being reported.
+     */
+    TUint TagOffset() const;
+    TUint TagEndOffset() const;
+public: // from IWriter
+    void Write(TByte aValue);
+    void Write(const Brx& aBuffer);
+    void WriteFlush();
+private:
+    enum EState
+    {
+        eText
+       ,eTag
+    };
+private:
+    void AppendTag(const TByte* aPtr, TUint aBytes);
+    void AppendValue(const TByte* aPtr, TUint aBytes);
+    void AppendCdata(const Brx& aData);
+    Brn InnerXml();
+    TBool TagComplete(const Brx& aTag) const;
+    void ProcessTag(const Brx& aTag);
+    void OpenElement(const Brx& aName, const Brx& aAttributes, TBool aEmpty);
+    void CloseElement(const Brx& aName);
+    static Brn LocalName(const Brx& aName);
+private:
+    IXmlSaxHandler& iHandler;
+    EState iState;
+    TByte iQuote;
+    TByte iTagFirst;
+    TUint iTagBytes;
+    TUint iOffset;
+    TUint iTagOffset;
+    TUint iTagEndOffset;
+    TBool iRootSeen;
+    TBool iInLeaf;
+    Bwh iTag;
+    Brn iValue;
+    Bwh iValueBuf;
+    TBool iValueBuffered;
+    Bwh iOpenNames;
+    std::vector<TUint> iOpenOffsets;
+    const TByte* iFragment;
+    TUint iFragmentOffset;
+    TUint iInnerDepth;
+    TBool iInInner;
+    TBool iInnerHasChildren;
+    TUint iInnerOffset;
+    Bwh iInnerBuf;
+};
+
 } // namespace Net
 } // namespace OpenHome
 
@@ -6,6 +6,7 @@
 #include <OpenHome/Private/Stream.h>
 #include <OpenHome/Private/Env.h>
 #include <OpenHome/Private/Ascii.h>
+#include <OpenHome/Private/Timer.h>
 
 #include <errno.h>
 
@@ -193,6 +194,14 @@ void Socket::Close()
     }
 }
 
+THandle Socket::ReleaseHandle()
+{
+    AutoMutex a(iLock);
+    THandle handle = iHandle;
+    iHandle = kHandleNull;
+    return handle;
+}
+
 void Socket::SetSendBufBytes(TUint aBytes)
 {
     OpenHome::Os::NetworkSocketSetSendBufBytes(iHandle, aBytes);
@@ -237,6 +246,24 @@ void Socket::Send(const Brx& aBuffer)
     }
 }
 
+void Socket::Send(const Brx** aBuffers, TUint aCount)
+{
+    TUint bytes = 0;
+    for (TUint i=0; i<aCount; i++) {
+        bytes += aBuffers[i]->Bytes();
+    }
+    LOGF(kNetwork, "Socket::Send  H = %d, BC = %d, C = %d\n", iHandle, bytes, aCount);
+    TInt sent = OpenHome::Os::NetworkSendMultiple(iHandle, aBuffers, aCount);
+    if(sent < 0) {
+        LOG2F(kNetwork, kError, "Socket::Send H = %d, RETURN VALUE = %d\n", iHandle, sent);
+        THROW(NetworkError);
+    }
+    if((TUint)sent != bytes) {
+        LOG2F(kNetwork, kError, "Socket::Send H = %d, RETURN VALUE = %d, INCOMPLETE\n", iHandle, sent);
+        THROW(NetworkError);
+    }
+}
+
 void Socket::SendTo(const Brx& aBuffer, const Endpoint& aEndpoint)
 {
     LOGF(kNetwork, "Socket::SendTo  H = %d, BC = %d, E = %x:%d\n", iHandle, aBuffer.Bytes(), aEndpoint.Address(), aEndpoint.Port());
@@ -429,6 +456,17 @@ void SocketTcp::Write(const Brx& aBuffer)
     }
 }
 
+void SocketTcp::WriteGather(const Brx** aBuffers, TUint aCount)
+{
+    LOGF(kNetwork, "SocketTcp::WriteGather\n");
+    try {
+        Send(aBuffers, aCount);
+    }
+    catch(NetworkError&) {
+        THROW(WriterError);
+    }
+}
+
 void SocketTcp::WriteFlush()
 {
     // all writes go directly to the socket so nothing to flush
@@ -505,14 +543,158 @@ void SocketTcpClient::Connect(const Endpoint& aEndpoint, TUint aTimeout)
     OpenHome::Os::NetworkConnect(iHandle, aEndpoint, aTimeout);
 }
 
+TBool SocketTcpClient::Readable()
+{
+    return (OpenHome::Os::NetworkReadable(iHandle) != 0);
+}
+
+// SocketTcpClientPool
+
+SocketTcpClientPool::Connection::Connection(SocketTcpClient* aSocket, const Endpoint& aEndpoint, TUint aExpiry)
+    : iSocket(aSocket)
+    , iEndpoint(aEndpoint)
+    , iExpiry(aExpiry)
+{
+}
+
+SocketTcpClientPool::SocketTcpClientPool(Environment& aEnv, TUint aMaxPerEndpoint, TUint aIdleTimeoutMs)
+    : iEnv(aEnv)
+    , iLock("TCPP")
+    , iMaxPerEndpoint(aMaxPerEndpoint)
+    , iIdleTimeoutMs(aIdleTimeoutMs)
+{
+}
+
+SocketTcpClientPool::~SocketTcpClientPool()
+{
+    Close(iIdle);
+}
+
+TBool SocketTcpClientPool::Enabled() const
+{
+    return (iMaxPerEndpoint > 0);
+}
+
+SocketTcpClient* SocketTcpClientPool::Acquire(const Endpoint& aEndpoint)
+{
+    if (!Enabled()) {
+        return NULL;
+    }
+    SocketTcpClient* socket = NULL;
+    List expired;
+    iLock.Wait();
+    RemoveExpiredLocked(expired);
+    List::reverse_iterator it = iIdle.rbegin();
+    while (it != iIdle.rend()) {
+        if (!(*it)->iEndpoint.Equals(aEndpoint)) {
+            ++it;
+            continue;
+        }
+        Connection* conn = *it;
+        it = List::reverse_iterator(iIdle.erase(--(it.base())));
+        // an idle HTTP connection should have nothing to read; if it does, the
+        // server has closed it (or is misbehaving) and a request sent on it would fail
+        if (conn->iSocket->Readable()) {
+            LOGF(kNetwork, "SocketTcpClientPool: discarding closed connection\n");
+            expired.push_back(conn);
+        }
+        else {
+            socket = conn->iSocket;
+            delete conn;
+            break;
+        }
+    }
+    iLock.Signal();
+    Close(expired);
+    return socket;
+}
+
+void SocketTcpClientPool::Release(SocketTcpClient* aSocket, const Endpoint& aEndpoint)
+{
+    List expired;
+    iLock.Wait();
+    RemoveExpiredLocked(expired);
+    TUint count = 0;
+    for (List::iterator it = iIdle.begin(); it != iIdle.end(); ++it) {
+        if ((*it)->iEndpoint.Equals(aEndpoint)) {
+            count++;
+        }
+    }
+    if (count < iMaxPerEndpoint) {
+        iIdle.push_back(new Connection(aSocket, aEndpoint, Time::Now(iEnv) + iIdleTimeoutMs));
+        aSocket = NULL;
+    }
+    iLock.Signal();
+    Close(expired);
+    if (aSocket != NULL) {
+        Close(aSocket);
+    }
+}
+
+void SocketTcpClientPool::Evict(const Endpoint& aEndpoint)
+{
+    List evicted;
+    iLock.Wait();
+    List::iterator it = iIdle.begin();
+    while (it != iIdle.end()) {
+        if ((*it)->iEndpoint.Equals(aEndpoint)) {
+            evicted.push_back(*it);
+            it = iIdle.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+    iLock.Signal();
+    Close(evicted);
+}
+
+void SocketTcpClientPool::RemoveExpiredLocked(List& aExpired)
+{
+    List::iterator it = iIdle.begin();
+    while (it != iIdle.end()) {
+        if (Time::IsInPastOrNow(iEnv, (*it)->iExpiry)) {
+            aExpired.push_back(*it);
+            it = iIdle.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+void SocketTcpClientPool::Close(SocketTcpClient* aSocket)
+{
+    try {
+        aSocket->Close();
+    }
+    catch (NetworkError&) {}
+    delete aSocket;
+}
+
+void SocketTcpClientPool::Close(List& aList)
+{
+    for (List::iterator it = aList.begin(); it != aList.end(); ++it) {
+        Close((*it)->iSocket);
+        delete *it;
+    }
+    aList.clear();
+}
+
+
 // Tcp Server
 
 SocketTcpServer::SocketTcpServer(Environment& aEnv, const TChar* aName, TUint aPort, TIpAddress aInterface,
-                                 TUint aSessionPriority, TUint aSessionStackBytes, TUint aSlots)
-    : iMutex(aName)
+                                 TUint aSessionPriority, TUint aSessionStackBytes, TUint aSlots, TBool aEventDriven)
+    : iEnv(aEnv)
+    , iMutex(aName)
     , iSessionPriority(aSessionPriority)
     , iSessionStackBytes(aSessionStackBytes)
     , iTerminating(false)
+    , iPoll(kHandleNull)
+    , iPollThread(NULL)
+    , iLockConnections("TCPC")
+    , iSemReady("TCPR", 0)
 {
     LOGF(kNetwork, "SocketTcpServer::SocketTcpServer\n");
     iHandle = SocketCreate(aEnv, eSocketTypeStream);
@@ -522,6 +704,16 @@ SocketTcpServer::SocketTcpServer(Environment& aEnv, const TChar* aName, TUint aP
     Bind(Endpoint(aPort, aInterface));
     GetPort(iPort);
     Listen(aSlots);
+    if (aEventDriven) {
+        iPoll = OpenHome::Os::NetworkPollCreate(aEnv.OsCtx());
+        if (iPoll == kHandleNull) {
+            LOG2F(kNetwork, kError, "SocketTcpServer::SocketTcpServer event driven mode unsupported, using a thread per session\n");
+        }
+        else {
+            iPollThread = new ThreadFunctor(aName, MakeFunctor(*this, &SocketTcpServer::Poll), aSessionPriority);
+            iPollThread->Start();
+        }
+    }
 }
 
 void SocketTcpServer::Add(const TChar* aName, SocketTcpSession* aSession, TInt aPriorityOffset)
@@ -539,9 +731,24 @@ void SocketTcpServer::Add(const TChar* aName, SocketTcpSession* aSession, TInt a
     }
 }
 
-THandle SocketTcpServer::Accept(Endpoint& aClientEndpoint)
+THandle SocketTcpServer::Accept(Endpoint& aClientEndpoint, TUint& aUseCount)
 {
     LOGF(kNetwork, "SocketTcpServer::Accept\n");
+    if (iPoll != kHandleNull) {
+        iSemReady.Wait();                       // wait for the poller to find a connection with data available
+        AutoMutex a(iLockConnections);
+        if (iTerminating || iReady.size() == 0) {
+            THROW(NetworkError);
+        }
+        Connection* conn = iReady.front();
+        iReady.pop_front();
+        THandle handle = conn->iHandle;
+        aClientEndpoint.Replace(conn->iEndpoint);
+        aUseCount = conn->iUseCount;
+        delete conn;
+        return handle;
+    }
+    aUseCount = 0;
     AutoMutex a(iMutex);                        // wait to become the single accepting thread
     if (iTerminating)
         THROW(NetworkError);
@@ -549,24 +756,157 @@ THandle SocketTcpServer::Accept(Endpoint& aClientEndpoint)
     return Socket::Accept(aClientEndpoint);     // accept the connection
 }
 
+TBool SocketTcpServer::EventDriven() const
+{
+    return (iPoll != kHandleNull);
+}
+
 TBool SocketTcpServer::Terminating()
 {
     LOGF(kNetwork, "SocketTcpServer::Terminating %d\n", iTerminating);
     return (iTerminating);
 }
 
+SocketTcpServer::Connection::Connection(THandle aHandle, const Endpoint& aEndpoint, TUint aUseCount)
+    : iHandle(aHandle)
+    , iEndpoint(aEndpoint)
+    , iUseCount(aUseCount)
+    , iExpiry(0)
+{
+}
+
+// Runs in iPollThread.  Accepts new connections and moves those with data available to iReady.
+void SocketTcpServer::Poll()
+{
+    LOGF(kNetwork, ">SocketTcpServer::Poll\n");
+    void* ready[kMaxReadyPerPoll];
+    if (OpenHome::Os::NetworkPollAdd(iPoll, iHandle, this) != 0) { // listening socket is identified by 'this'
+        LOG2F(kNetwork, kError, "SocketTcpServer::Poll unable to poll server socket\n");
+        return;
+    }
+    for (;;) {
+        TInt count = OpenHome::Os::NetworkPollWait(iPoll, ready, kMaxReadyPerPoll, kPollIntervalMs);
+        if (count < 0) {
+            break;
+        }
+        for (TInt i=0; i<count; i++) {
+            if (ready[i] == this) {
+                AcceptConnection();
+            }
+            else {
+                Dispatch((Connection*)ready[i]);
+            }
+        }
+        EvictIdle();
+    }
+    LOGF(kNetwork, "<SocketTcpServer::Poll\n");
+}
+
+void SocketTcpServer::AcceptConnection()
+{
+    Endpoint client;
+    THandle handle = kHandleNull;
+    try {
+        handle = Socket::Accept(client);
+    }
+    catch (NetworkError&) {
+        LOG2F(kNetwork, kError, "SocketTcpServer::AcceptConnection accept failed\n");
+    }
+    if (handle != kHandleNull) {
+        Park(new Connection(handle, client, 0), kAcceptTimeoutMs);
+    }
+    if (!iTerminating) {
+        (void)OpenHome::Os::NetworkPollAdd(iPoll, iHandle, this);
+    }
+}
+
+void SocketTcpServer::Park(Connection* aConnection, TUint aTimeoutMs)
+{
+    iLockConnections.Wait();
+    if (iTerminating) {
+        iLockConnections.Signal();
+        CloseConnection(aConnection);
+        return;
+    }
+    aConnection->iExpiry = Time::Now(iEnv) + aTimeoutMs;
+    aConnection->iIt = iParked.insert(iParked.end(), aConnection);
+    if (OpenHome::Os::NetworkPollAdd(iPoll, aConnection->iHandle, aConnection) != 0) {
+        iParked.erase(aConnection->iIt);
+        iLockConnections.Signal();
+        CloseConnection(aConnection);
+        return;
+    }
+    iLockConnections.Signal();
+}
+
+void SocketTcpServer::Dispatch(Connection* aConnection)
+{
+    iLockConnections.Wait();
+    iParked.erase(aConnection->iIt);
+    iReady.push_back(aConnection);
+    iLockConnections.Signal();
+    iSemReady.Signal();
+}
+
+void SocketTcpServer::EvictIdle()
+{
+    std::list<Connection*> expired;
+    iLockConnections.Wait();
+    std::list<Connection*>::iterator it = iParked.begin();
+    while (it != iParked.end()) {
+        if (Time::IsInPastOrNow(iEnv, (*it)->iExpiry)) {
+            (void)OpenHome::Os::NetworkPollRemove(iPoll, (*it)->iHandle);
+            expired.push_back(*it);
+            it = iParked.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+    iLockConnections.Signal();
+    for (it = expired.begin(); it != expired.end(); ++it) {
+        LOGF(kNetwork, "SocketTcpServer::EvictIdle closing idle connection %d\n", (*it)->iHandle);
+        CloseConnection(*it);
+    }
+}
+
+void SocketTcpServer::CloseConnection(Connection* aConnection)
+{
+    (void)OpenHome::Os::NetworkClose(aConnection->iHandle);
+    delete aConnection;
+}
+
 SocketTcpServer::~SocketTcpServer()
 {
     LOGF(kNetwork, ">SocketTcpServer::~SocketTcpServer\n");
+    iLockConnections.Wait();
     iTerminating = true;            // indicates terminating phase
+    iLockConnections.Signal();
 
     // cause exception in pending AND subsequent accept attempts in session threads.
     Interrupt(true);
     TUint count = (TUint)iVector.size();
+    if (iPoll != kHandleNull) {
+        OpenHome::Os::NetworkPollInterrupt(iPoll);
+        delete iPollThread;
+        for (TUint i = 0; i < count; i++) {         // wake any sessions waiting in Accept()
+            iSemReady.Signal();
+        }
+    }
     for (TUint i = 0; i < count; i++) {             // delete all sessions
         iVector[i]->Terminate();                    // Kill and Join the TcpSession thread
         delete iVector[i];
     }
+    if (iPoll != kHandleNull) {
+        std::list<Connection*>::iterator it;
+        for (it = iParked.begin(); it != iParked.end(); ++it) {
+            CloseConnection(*it);
+        }
+        for (it = iReady.begin(); it != iReady.end(); ++it) {
+            CloseConnection(*it);
+        }
+        OpenHome::Os::NetworkPollDestroy(iPoll);
+    }
 
     Close();
     LOGF(kNetwork, "<SocketTcpServer::~SocketTcpServer\n");
@@ -575,7 +915,7 @@ SocketTcpServer::~SocketTcpServer()
 // Tcp Session
 
 SocketTcpSession::SocketTcpSession()
-    : iMutex("TCPS"), iOpen(false)
+    : iMutex("TCPS"), iOpen(false), iPark(false), iParkTimeoutMs(0), iUseCount(0)
 {
 }
 
@@ -593,7 +933,7 @@ void SocketTcpSession::Start()
     LOGF(kNetwork, ">SocketTcpSession::Start()\n");
     for (;;) {
         try {
-            Open(iServer->Accept(iClientEndpoint));            // accept a connection for this session
+            Open(iServer->Accept(iClientEndpoint, iUseCount)); // accept a connection for this session
         } catch (NetworkError&) {                // server is being destroyed
             LOG2F(kNetwork, kError, "-SocketTcpSession::Start() Network Accept Exception\n");
             break;
@@ -604,9 +944,15 @@ void SocketTcpSession::Start()
         }
         catch (NetworkError&) {                  // session handle has been shutdown or remote client has shutdown
             LOG2F(kNetwork, kError, "-SocketTcpSession::Start() Network Exception\n");
+            iPark = false;
         }
         try {
-            Close();    // session complete, close session handle and continue to accept new connection
+            if (iPark) {
+                ReturnToServer(); // session wants to keep the connection; let the server wait for more data
+            }
+            else {
+                Close();    // session complete, close session handle and continue to accept new connection
+            }
         } catch (NetworkError&) {
             LOG2F(kNetwork, kError, "-SocketTcpSession::Start() Network Close Exception\n");
         }
@@ -635,6 +981,38 @@ Endpoint SocketTcpSession::ClientEndpoint() const
     return iClientEndpoint;
 }
 
+TBool SocketTcpSession::CanPark() const
+{
+    return iServer->EventDriven();
+}
+
+void SocketTcpSession::Park(TUint aIdleTimeoutMs, TUint aUseCount)
+{
+    ASSERT(CanPark());
+    iPark = true;
+    iParkTimeoutMs = aIdleTimeoutMs;
+    iUseCount = aUseCount;
+}
+
+TUint SocketTcpSession::UseCount() const
+{
+    return iUseCount;
+}
+
+void SocketTcpSession::ReturnToServer()
+{
+    LOGF(kNetwork, "SocketTcpSession::ReturnToServer %d\n", iHandle);
+    iMutex.Wait();
+    iPark = false;
+    if (iOpen) {
+        iOpen = false;
+        // another session may close the connection once it is parked so we mustn't retain its handle
+        THandle handle = ReleaseHandle();
+        iServer->Park(new SocketTcpServer::Connection(handle, iClientEndpoint, iUseCount), iParkTimeoutMs);
+    }
+    iMutex.Signal();
+}
+
 void SocketTcpSession::Close()
 {
     LOGF(kNetwork, "SocketTcpSession::Close %d\n", iHandle);
@@ -705,6 +1083,16 @@ void SocketUdpBase::Send(const Brx& aBuffer, const Endpoint& aEndpoint)
     SendTo(aBuffer, aEndpoint);
 }
 
+void SocketUdpBase::SendMultiple(const Brx** aBuffers, TUint aCount, const Endpoint& aEndpoint)
+{
+    LOGF(kNetwork, "> SocketUdpBase::SendMultiple H = %d, C = %d\n", iHandle, aCount);
+    TInt sent = OpenHome::Os::NetworkSendToMultiple(iHandle, aBuffers, aCount, aEndpoint);
+    if ((TUint)sent != aCount) {
+        LOG2F(kNetwork, kError, "SocketUdpBase::SendMultiple H = %d, RETURN VALUE = %d\n", iHandle, sent);
+        THROW(NetworkError);
+    }
+}
+
 Endpoint SocketUdpBase::Receive(Bwx& aBuffer)
 {
     LOGF(kNetwork, "> SocketUdpBase::Receive\n");
@@ -714,6 +1102,18 @@ Endpoint SocketUdpBase::Receive(Bwx& aBuffer)
     return endpoint;
 }
 
+TUint SocketUdpBase::ReceiveMultiple(TByte* aBuffer, TUint aBytesPerDatagram, TUint aCount, TUint* aReceived, Endpoint* aSenders)
+{
+    LOGF(kNetwork, "> SocketUdpBase::ReceiveMultiple H = %d\n", iHandle);
+    TInt received = OpenHome::Os::NetworkReceiveFromMultiple(iHandle, aBuffer, aBytesPerDatagram, aCount, aReceived, aSenders);
+    if (received <= 0) {
+        LOG2F(kNetwork, kError, "SocketUdpBase::ReceiveMultiple H = %d, RETURN VALUE = %d\n", iHandle, received);
+        THROW(NetworkError);
+    }
+    LOGF(kNetwork, "< SocketUdpBase::ReceiveMultiple H = %d, C = %d\n", iHandle, received);
+    return (TUint)received;
+}
+
 void SocketUdpBase::ReCreate()
 {
     Close();
@@ -801,7 +1201,42 @@ SocketUdpMulticast::~SocketUdpMulticast()
 UdpReader::UdpReader(SocketUdpBase& aSocket)
     : iSocket(aSocket)
     , iOpen(true)
+    , iInterrupted(false)
+    , iMaxDatagrams(1)
+    , iMaxDatagramBytes(0)
+    , iDatagrams(NULL)
+    , iDatagramBytes(NULL)
+    , iDatagramSenders(NULL)
+    , iDatagramCount(0)
+    , iDatagramIndex(0)
+{
+}
+
+UdpReader::UdpReader(SocketUdpBase& aSocket, TUint aMaxDatagrams, TUint aMaxDatagramBytes)
+    : iSocket(aSocket)
+    , iOpen(true)
+    , iInterrupted(false)
+    , iMaxDatagrams(aMaxDatagrams)
+    , iMaxDatagramBytes(aMaxDatagramBytes)
+    , iDatagrams(NULL)
+    , iDatagramBytes(NULL)
+    , iDatagramSenders(NULL)
+    , iDatagramCount(0)
+    , iDatagramIndex(0)
+{
+    ASSERT(iMaxDatagrams > 0);
+    if (iMaxDatagrams > 1) {
+        iDatagrams = new TByte[iMaxDatagrams * iMaxDatagramBytes];
+        iDatagramBytes = new TUint[iMaxDatagrams];
+        iDatagramSenders = new Endpoint[iMaxDatagrams];
+    }
+}
+
+UdpReader::~UdpReader()
 {
+    delete[] iDatagrams;
+    delete[] iDatagramBytes;
+    delete[] iDatagramSenders;
 }
 
 Endpoint UdpReader::Sender() const
@@ -811,16 +1246,31 @@ Endpoint UdpReader::Sender() const
 
 void UdpReader::Read(Bwx& aBuffer)
 {
-    if (iOpen) {
-        try {
+    if (!iOpen || iInterrupted) {
+        THROW(ReaderError);
+    }
+    try {
+        if (iDatagrams == NULL) {
             iSender = iSocket.Receive(aBuffer);
-            iOpen = false;
         }
-        catch (NetworkError&) {
-            THROW(ReaderError);
+        else {
+            if (iDatagramIndex == iDatagramCount) {
+                iDatagramIndex = 0;
+                iDatagramCount = 0;
+                iDatagramCount = iSocket.ReceiveMultiple(iDatagrams, iMaxDatagramBytes, iMaxDatagrams, iDatagramBytes, iDatagramSenders);
+            }
+            // as for a single receive, a datagram larger than aBuffer is truncated
+            TUint bytes = iDatagramBytes[iDatagramIndex];
+            if (bytes > aBuffer.MaxBytes()) {
+                bytes = aBuffer.MaxBytes();
+            }
+            aBuffer.Replace(iDatagrams + (iDatagramIndex * iMaxDatagramBytes), bytes);
+            iSender = iDatagramSenders[iDatagramIndex];
+            iDatagramIndex++;
         }
+        iOpen = false;
     }
-    else {
+    catch (NetworkError&) {
         THROW(ReaderError);
     }
 }
@@ -832,6 +1282,7 @@ void UdpReader::ReadFlush()
 
 void UdpReader::ReadInterrupt()
 {
+    iInterrupted = true;
     iSocket.Interrupt(true);
 }
 
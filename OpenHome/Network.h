@@ -8,6 +8,7 @@
 #include <OpenHome/OsTypes.h>
 
 #include <vector>
+#include <list>
 
 EXCEPTION(NetworkError);
 EXCEPTION(NetworkAddressInUse);
@@ -68,7 +69,9 @@ protected:
     Socket();
     virtual ~Socket() {}
     TBool TryClose();
+    THandle ReleaseHandle(); // relinquish ownership of iHandle without closing it
     void Send(const Brx& aBuffer);
+    void Send(const Brx** aBuffers, TUint aCount); // sends each buffer in turn, using a single system call where possible
     void SendTo(const Brx& aBuffer, const Endpoint& aEndpoint);
     void Receive(Bwx& aBuffer);
     void Receive(Bwx& aBuffer, TUint aBytes);
@@ -106,7 +109,7 @@ private:
 };
 
 /// Shared Tcp client / Tcp session base class
-class SocketTcp : public Socket, public IWriter, public IReaderSource
+class SocketTcp : public Socket, public IWriterGather, public IReaderSource
 {
 public:
     /**
@@ -125,6 +128,13 @@ public:
     void Write(const Brx& aBuffer);
     void WriteFlush();
 
+    // IWriterGather
+    /**
+     * Send each buffer in turn, block until all bytes are sent
+     * Throw NetworkError on network error
+     */
+    void WriteGather(const Brx** aBuffers, TUint aCount);
+
     // IReaderSource
     /**
      * Receive between [0, aBuffer.MaxBytes()] bytes, replace buffer
@@ -148,6 +158,62 @@ class SocketTcpClient : public SocketTcp
 public:
     void Open(Environment& aEnv);                              /// Open
     void Connect(const Endpoint& aEndpoint, TUint aTimeout);    /// Connect to a given IP address and port number (timeout in milliseconds)
+    TBool Readable();                                           /// Returns true without blocking if data is waiting or the remote end has closed
+};
+
+/**
+ * Pool of idle, connected SocketTcpClients, keyed on the remote endpoint.
+ *
+ * Allows a client to reuse a persistent (HTTP/1.1 keep-alive) connection for a
+ * series of requests.  Up to aMaxPerEndpoint idle connections are retained for
+ * each endpoint; each is closed if it isn't reused within aIdleTimeoutMs.
+ * A pool with aMaxPerEndpoint of 0 is disabled.
+ *
+ * Acquire() discards any idle connection which the remote server has since closed
+ * (or has unexpectedly sent data on).  A server can still close a connection just
+ * after it is acquired so clients may retry once on a new connection if sending a
+ * request on a pooled connection fails.  A request which was sent in full mustn't
+ * be retried as the server may already have acted on it.
+ */
+class SocketTcpClientPool : public INonCopyable
+{
+public:
+    SocketTcpClientPool(Environment& aEnv, TUint aMaxPerEndpoint, TUint aIdleTimeoutMs);
+    ~SocketTcpClientPool();
+    TBool Enabled() const;
+    /**
+     * Claim an idle connection to aEndpoint.  Returns NULL if none is available.
+     * The caller takes ownership of the returned socket.
+     */
+    SocketTcpClient* Acquire(const Endpoint& aEndpoint);
+    /**
+     * Return a connection which can be used for another request.
+     * The pool takes ownership of aSocket (and may close it immediately).
+     */
+    void Release(SocketTcpClient* aSocket, const Endpoint& aEndpoint);
+    /**
+     * Close all idle connections to aEndpoint.
+     */
+    void Evict(const Endpoint& aEndpoint);
+    static void Close(SocketTcpClient* aSocket); // close and delete aSocket, ignoring any errors
+private:
+    class Connection
+    {
+    public:
+        Connection(SocketTcpClient* aSocket, const Endpoint& aEndpoint, TUint aExpiry);
+        SocketTcpClient* iSocket;
+        Endpoint iEndpoint;
+        TUint iExpiry;
+    };
+    typedef std::list<Connection*> List;
+    void RemoveExpiredLocked(List& aExpired);
+    static void Close(List& aList);
+private:
+    Environment& iEnv;
+    Mutex iLock;
+    TUint iMaxPerEndpoint;
+    TUint iIdleTimeoutMs;
+    List iIdle; // least recently used first
 };
 
 /// Tcp Session
@@ -162,11 +228,22 @@ protected:
     virtual void Run() = 0;
     virtual ~SocketTcpSession();
     Endpoint ClientEndpoint() const;
+    /**
+     * Persistent connection support.  Only available if the owning server is event driven.
+     * Calling Park() from Run() returns the connection to the server when Run() exits rather
+     * than closing it.  The server closes the connection if no data is received within
+     * aIdleTimeoutMs; otherwise it is passed to a session which can retrieve aUseCount
+     * via UseCount().  UseCount() is 0 for a newly accepted connection.
+     */
+    TBool CanPark() const;
+    void Park(TUint aIdleTimeoutMs, TUint aUseCount);
+    TUint UseCount() const;
 private:
     void Add(SocketTcpServer& aServer, const TChar* aName, TUint aPriority, TUint aStackBytes);
     void Start();
     void Open(THandle aHandle);
     void Close();
+    void ReturnToServer();
     void Terminate();   /// Called by owning TcpServer *before* invoking dtor. Waits for TcpSession::Run() to exit.
 private:
     Mutex iMutex;
@@ -174,26 +251,61 @@ private:
     SocketTcpServer* iServer;
     ThreadFunctor* iThread;
     Endpoint iClientEndpoint;
+    TBool iPark;
+    TUint iParkTimeoutMs;
+    TUint iUseCount;
 };
 
 // Tcp Server
 
+/**
+ * By default, each session added to a server owns a thread which blocks accepting,
+ * then reading from, a single connection.
+ *
+ * If aEventDriven is true (and the platform supports OsNetworkPollCreate()), a
+ * single poller thread instead accepts connections and waits for them to become
+ * readable.  Sessions then form a worker pool which is only handed connections
+ * that have data ready.  Idle connections therefore consume no session threads,
+ * allowing a server to support many more connected clients than it has sessions.
+ */
 class SocketTcpServer : public Socket
 {
     friend class SocketTcpSession;
 public:
     SocketTcpServer(Environment& aEnv, const TChar* aName, TUint aPort, TIpAddress aInterface,
                     TUint aSessionPriority = kPriorityHigh, TUint aSessionStackBytes = Thread::kDefaultStackBytes,
-                    TUint aSlots = 128);
+                    TUint aSlots = 128, TBool aEventDriven = false);
     // Add is not thread safe, but why would you want that?
     void Add(const TChar* aName, SocketTcpSession* aSession, TInt aPriorityOffset = 0);
     TUint Port() const { return iPort; }
     TIpAddress Interface() const { return iInterface; }
+    TBool EventDriven() const;
     ~SocketTcpServer(); // Closes the server
 private:
     TBool Terminating();            // indicates server is in process of being destroyed
-    THandle Accept(Endpoint& aClientEndpoint); // accept a connection and return the session handle
+    THandle Accept(Endpoint& aClientEndpoint, TUint& aUseCount); // accept a connection and return the session handle
+    // event driven mode only
+    class Connection
+    {
+    public:
+        Connection(THandle aHandle, const Endpoint& aEndpoint, TUint aUseCount);
+        THandle iHandle;
+        Endpoint iEndpoint;
+        TUint iUseCount;
+        TUint iExpiry;
+        std::list<Connection*>::iterator iIt;
+    };
+    void Poll();
+    void AcceptConnection();
+    void Park(Connection* aConnection, TUint aTimeoutMs);
+    void Dispatch(Connection* aConnection);
+    void EvictIdle();
+    void CloseConnection(Connection* aConnection);
 private:
+    static const TUint kMaxReadyPerPoll = 32;
+    static const TUint kPollIntervalMs = 1000;
+    static const TUint kAcceptTimeoutMs = 5000; // time a new connection can be idle before sending anything
+    Environment& iEnv;
     Mutex iMutex;                   // allows one thread to accept at a time
     TUint iSessionPriority;         // priority given to all session threads
     TUint iSessionStackBytes;       // stack bytes given to all session threads
@@ -202,6 +314,12 @@ private:
     Vector iVector;
     TUint iPort;
     TIpAddress iInterface;
+    THandle iPoll;
+    ThreadFunctor* iPollThread;
+    Mutex iLockConnections;
+    Semaphore iSemReady;
+    std::list<Connection*> iParked; // waiting for data
+    std::list<Connection*> iReady;  // have data, waiting for a session
 };
 
 // general udp socket;
@@ -211,7 +329,9 @@ class SocketUdpBase : public Socket
 public:
     void SetTtl(TUint aTtl);
     void Send(const Brx& aBuffer, const Endpoint& aEndpoint);
+    void SendMultiple(const Brx** aBuffers, TUint aCount, const Endpoint& aEndpoint);
     Endpoint Receive(Bwx& aBuffer);
+    TUint ReceiveMultiple(TByte* aBuffer, TUint aBytesPerDatagram, TUint aCount, TUint* aReceived, Endpoint* aSenders);
     TUint Port() const;
     ~SocketUdpBase();
 protected:
@@ -255,6 +375,8 @@ class UdpReader : public IReaderSource, public INonCopyable
 {
 public:
     UdpReader(SocketUdpBase& aSocket);
+    UdpReader(SocketUdpBase& aSocket, TUint aMaxDatagrams, TUint aMaxDatagramBytes); // receive up to aMaxDatagrams per system call
+    ~UdpReader();
     Endpoint Sender() const; // sender of last completed Read()
     virtual void Read(Bwx& aBuffer);
     virtual void ReadFlush();
@@ -264,6 +386,14 @@ protected:
 private:
     Endpoint iSender;
     TBool iOpen;
+    TBool iInterrupted;
+    TUint iMaxDatagrams;
+    TUint iMaxDatagramBytes;
+    TByte* iDatagrams;
+    TUint* iDatagramBytes;
+    Endpoint* iDatagramSenders;
+    TUint iDatagramCount;
+    TUint iDatagramIndex;
 };
 
 /**
@@ -126,6 +126,11 @@ Brn Srx::Snaffle()
     return rem;
 }
 
+TUint Srx::Buffered() const
+{
+    return iBytes - iOffset;
+}
+
 
 // Srd
 
@@ -145,11 +150,42 @@ Srd::~Srd()
     delete[] iPtr;
 }
 
+TUint Srd::MaxBytes() const
+{
+    return iMaxBytes;
+}
+
+void Srd::Resize(TUint aMaxBytes)
+{
+    const TUint buffered = iBytes - iOffset;
+    ASSERT(aMaxBytes >= buffered);
+    if (aMaxBytes == iMaxBytes) {
+        return;
+    }
+    TByte* ptr = new TByte[aMaxBytes];
+    if (buffered > 0) {
+        (void)memcpy(ptr, iPtr + iOffset, buffered);
+    }
+    delete[] iPtr;
+    iPtr = ptr;
+    iMaxBytes = aMaxBytes;
+    iBytes = buffered;
+    iOffset = 0;
+}
+
 // Swx
 
 Swx::Swx(TUint aMaxBytes, IWriter& aWriter)
     : Sxx(aMaxBytes) 
     , iWriter(aWriter)
+    , iWriterGather(0)
+{
+}
+
+Swx::Swx(TUint aMaxBytes, IWriterGather& aWriter)
+    : Sxx(aMaxBytes)
+    , iWriter(aWriter)
+    , iWriterGather(&aWriter)
 {
 }
 
@@ -177,8 +213,14 @@ void Swx::Write(const Brx& aBuffer)
     
     TUint bytes = aBuffer.Bytes();
     
-    if (iBytes + bytes > iMaxBytes) { // would overflow, drain the buffer
+    if (iBytes + bytes > iMaxBytes) { // would overflow
     
+        if (iWriterGather != 0) { // pass aBuffer on along with the buffered data
+            const Brx* buffers[] = { &aBuffer };
+            WriteGathered(buffers, 1);
+            return;
+        }
+
         WriteDrain();
         
         if (bytes > iMaxBytes) { // would still overflow
@@ -197,6 +239,44 @@ void Swx::Write(const Brx& aBuffer)
     iBytes += bytes;
 }
 
+void Swx::WriteGather(const Brx** aBuffers, TUint aCount)
+{
+    if (iWriterGather != 0 && aCount < kMaxGatherBuffers) {
+        TUint bytes = 0;
+        for (TUint i = 0; i < aCount; i++) {
+            bytes += aBuffers[i]->Bytes();
+        }
+        if (iBytes + bytes > iMaxBytes) {
+            WriteGathered(aBuffers, aCount);
+            return;
+        }
+    }
+    for (TUint i = 0; i < aCount; i++) {
+        Write(*aBuffers[i]);
+    }
+}
+
+void Swx::WriteGathered(const Brx** aBuffers, TUint aCount)
+{
+    ASSERT(aCount < kMaxGatherBuffers);
+    Brn buffered(Ptr(), iBytes);
+    const Brx* buffers[kMaxGatherBuffers];
+    TUint count = 0;
+    if (iBytes > 0) {
+        buffers[count++] = &buffered;
+    }
+    for (TUint i = 0; i < aCount; i++) {
+        buffers[count++] = aBuffers[i];
+    }
+    try {
+        iWriterGather->WriteGather(buffers, count);
+        iBytes = 0;
+    }
+    catch (WriterError&) {
+        Error();
+    }
+}
+
 void Swx::WriteDrain()
 {
     if (iBytes) {
@@ -225,6 +305,12 @@ Swd::Swd(TUint aMaxBytes, IWriter& aWriter)
 {
 }
 
+Swd::Swd(TUint aMaxBytes, IWriterGather& aWriter)
+    : Swx(aMaxBytes, aWriter)
+    , iPtr(new TByte[aMaxBytes])
+{
+}
+
 TByte* Swd::Ptr()
 {
     return (iPtr);
@@ -232,7 +318,7 @@ TByte* Swd::Ptr()
 
 Swd::~Swd()
 {
-    delete (iPtr);
+    delete[] iPtr;
 }
 
 // Swp (Parasite on a host read stream)
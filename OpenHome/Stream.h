@@ -38,6 +38,19 @@ public:
     virtual ~IWriter() {};
 };
 
+class IWriterGather : public IWriter
+{
+public:
+    /**
+     * Equivalent to calling Write() for each of aBuffers in turn
+     *
+     * Allows data held in several buffers to be passed on together rather than
+     * being copied into a single buffer first.
+     */
+    virtual void WriteGather(const Brx** aBuffers, TUint aCount) = 0;
+    virtual ~IWriterGather() {};
+};
+
 class Sxx : public INonCopyable
 {
     friend class Swp;
@@ -61,6 +74,7 @@ public: // from IReader
 public:
     Brn Peek(TUint aBytes); // may return <aBytes at end of stream
     Brn Snaffle();
+    TUint Buffered() const; // bytes read from the source but not yet returned by Read/ReadUntil
 protected:
     Srx(TUint aMaxBytes, IReaderSource& aSource);
 protected:
@@ -83,33 +97,47 @@ class Srd : public Srx
 public:
     Srd(TUint aMaxBytes, IReaderSource& aSource);
     virtual ~Srd();
+    TUint MaxBytes() const;
+    /*
+     * Reallocate the buffer, keeping any data not yet returned by Read/ReadUntil.
+     * aMaxBytes must be at least Buffered().  Invalidates all previously returned buffers.
+     */
+    void Resize(TUint aMaxBytes);
 private:
     virtual TByte* Ptr();
 private:
     TByte* iPtr;
 };
 
-class Swx : public Sxx, public IWriter
+class Swx : public Sxx, public IWriterGather
 {
+    static const TUint kMaxGatherBuffers = 8;
 public: // from IWriter
     void Write(TByte aValue);
     void Write(const Brx& aBuffer);
     void WriteFlush();
-private:
-    void WriteDrain();
+public: // from IWriterGather
+    void WriteGather(const Brx** aBuffers, TUint aCount);
+public:
+    void WriteDrain(); // passes on any buffered data without flushing the underlying writer
 protected:
     Swx(TUint aMaxBytes, IWriter& aWriter);
+    Swx(TUint aMaxBytes, IWriterGather& aWriter); // overflowing writes are passed on with buffered data, uncopied
 private:
+    void WriteGathered(const Brx** aBuffers, TUint aCount);
     void Error();
     virtual TByte* Ptr() = 0;
 protected:
     IWriter& iWriter;
+private:
+    IWriterGather* iWriterGather;
 };
 
 template <TUint S> class Sws : public Swx
 {
 public:
     Sws(IWriter& aWriter) : Swx(S, aWriter) {}
+    Sws(IWriterGather& aWriter) : Swx(S, aWriter) {}
 private:
     virtual TByte* Ptr() { return (iBuf); }
 private:
@@ -120,6 +148,7 @@ class Swd : public Swx
 {
 public:
     Swd(TUint aMaxBytes, IWriter& aWriter);
+    Swd(TUint aMaxBytes, IWriterGather& aWriter);
     virtual ~Swd();
 private:
     virtual TByte* Ptr();
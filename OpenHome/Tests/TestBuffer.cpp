@@ -3,6 +3,7 @@
 #include <OpenHome/Buffer.h>
 #include <OpenHome/Private/TestFramework.h>
 #include <OpenHome/Private/Arch.h>
+#include <OpenHome/Private/Stream.h>
 
 #include <string>
 #include <map>
@@ -767,6 +768,75 @@ void SuiteBufferCmp::Test()
     }
 }
 
+class ReaderSourceBuffer : public IReaderSource
+{
+public:
+    ReaderSourceBuffer(const Brx& aData) : iData(aData), iOffset(0) {}
+private: // from IReaderSource
+    void Read(Bwx& aBuffer);
+    void ReadFlush() {}
+    void ReadInterrupt() {}
+private:
+    Brn iData;
+    TUint iOffset;
+};
+
+void ReaderSourceBuffer::Read(Bwx& aBuffer)
+{
+    TUint bytes = aBuffer.MaxBytes() - aBuffer.Bytes();
+    if (bytes > iData.Bytes() - iOffset) {
+        bytes = iData.Bytes() - iOffset;
+    }
+    ASSERT(bytes > 0); // tests shouldn't read beyond the end of their data
+    aBuffer.Append(iData.Ptr() + iOffset, bytes);
+    iOffset += bytes;
+}
+
+class SuiteSrdResize : public Suite
+{
+public:
+    SuiteSrdResize() : Suite("Srd::Resize") {}
+    void Test();
+};
+
+void SuiteSrdResize::Test()
+{
+    const Brn data("0123456789abcdefghijklmnopqrstuvwxyz");
+
+    // growing keeps data read from the source but not yet returned
+    ReaderSourceBuffer source1(data);
+    Srd reader1(16, source1);
+    TEST(reader1.Read(4) == Brn("0123"));
+    TEST(reader1.Buffered() == 12);
+    reader1.Resize(32);
+    TEST(reader1.MaxBytes() == 32);
+    TEST(reader1.Buffered() == 12);
+    TEST(reader1.Read(12) == Brn("456789abcdef"));
+    TEST(reader1.Read(20) == Brn("ghijklmnopqrstuvwxyz")); // more than the original size
+    TEST(reader1.Buffered() == 0);
+
+    // shrinking is allowed down to (but not below) the pending data
+    ReaderSourceBuffer source2(data);
+    Srd reader2(16, source2);
+    TEST(reader2.Read(4) == Brn("0123"));
+    TEST_THROWS(reader2.Resize(11), AssertionFailed);
+    TEST(reader2.MaxBytes() == 16);
+    reader2.Resize(12);
+    TEST(reader2.MaxBytes() == 12);
+    TEST(reader2.Buffered() == 12);
+    TEST(reader2.ReadUntil('b') == Brn("456789a"));
+    TEST(reader2.Read(4) == Brn("cdef"));
+    TEST(reader2.Buffered() == 0);
+
+    // an empty buffer can shrink to any size
+    reader2.Resize(4);
+    TEST(reader2.MaxBytes() == 4);
+    TEST(reader2.Read(4) == Brn("ghij"));
+    TEST_THROWS(reader2.Read(5), ReaderError);
+    reader2.Resize(4); // no change
+    TEST(reader2.Read(4) == Brn("klmn"));
+}
+
 void TestBuffer()
 {
     Runner runner("Binary Buffer Testing");
@@ -780,5 +850,6 @@ void TestBuffer()
     runner.Add(new SuiteTestBwn());
     runner.Add(new SuiteBrh());
     runner.Add(new SuiteBufferCmp());
+    runner.Add(new SuiteSrdResize());
     runner.Run();
 }
@@ -1,6 +1,8 @@
 #include <OpenHome/Private/TestFramework.h>
 #include <OpenHome/Private/Fifo.h>
 #include <OpenHome/Private/Thread.h>
+#include <OpenHome/Private/Timer.h>
+#include <OpenHome/Private/Env.h>
 
 using namespace OpenHome;
 using namespace OpenHome::TestFramework;
@@ -23,14 +25,16 @@ I i4(4);
 class SuiteFifoBasic : public Suite
 {
 public:
-    SuiteFifoBasic() : Suite("Single threaded basic Fifo testing") {}
+    SuiteFifoBasic(const TChar* aName, EFifoSignalling aSignalling) : Suite(aName), iSignalling(aSignalling) {}
     void Test();
+private:
+    EFifoSignalling iSignalling;
 };
 
 
 void SuiteFifoBasic::Test()
 {
-    Fifo<I*> q(4);
+    Fifo<I*> q(4, iSignalling);
     TEST(q.Slots() == 4);
     TEST(q.SlotsUsed() == 0);
     TEST(q.SlotsFree() == 4);
@@ -79,6 +83,15 @@ void SuiteFifoBasic::Test()
     TEST(q.SlotsUsed() == 0);
     TEST_THROWS(q.Read(50), Timeout);
     TEST(q.SlotsFree() == 4);
+
+    // interrupts
+    q.ReadInterrupt();
+    TEST_THROWS(q.Read(), FifoReadError);
+    q.Write(&i1);
+    q.ReadInterrupt();
+    q.ReadInterrupt(false);
+    TEST(q.Read() == &i1);
+    TEST(q.SlotsUsed() == 0);
 }
 
 typedef Fifo<I*> FifoTest;
@@ -170,11 +183,11 @@ void Writer1::Run()
     iCaller.Signal();
 }
 
-void MultipleWriteTest(Thread& aCurrentThread, TUint aRPriority, TUint aW0Priority, TUint aW1Priority)
+void MultipleWriteTest(Thread& aCurrentThread, EFifoSignalling aSignalling, TUint aRPriority, TUint aW0Priority, TUint aW1Priority)
 {
     const TUint writer0Iters = 300;
     const TUint writer1Iters = 500;
-    FifoTest q(32);
+    FifoTest q(32, aSignalling);
     Writer0 writer0(q, aCurrentThread,  writer0Iters);
     Functor fWriter0 = MakeFunctor(writer0, &Writer0::Run);
     Writer1 writer1(q, aCurrentThread, writer1Iters);
@@ -202,39 +215,42 @@ void MultipleWriteTest(Thread& aCurrentThread, TUint aRPriority, TUint aW0Priori
 class SuiteFifoThreadSafety : public Suite
 {
 public:
-    SuiteFifoThreadSafety() : Suite("Fifo thread safety multiple writers, 1 reader") {}
+    SuiteFifoThreadSafety(const TChar* aName, EFifoSignalling aSignalling) : Suite(aName), iSignalling(aSignalling) {}
     void Test();
+private:
+    EFifoSignalling iSignalling;
 };
 
 class ThreadSafetyTests : public Thread
 {
 public:
-    ThreadSafetyTests(Semaphore& aSem) : Thread("THST"), iSem(aSem) {}
+    ThreadSafetyTests(Semaphore& aSem, EFifoSignalling aSignalling) : Thread("THST"), iSem(aSem), iSignalling(aSignalling) {}
     void Run();
 private:
     Semaphore& iSem;
+    EFifoSignalling iSignalling;
 };
 
 void ThreadSafetyTests::Run()
 {
     Print("\n\nTestA\n\n");
-    MultipleWriteTest(*this, kPriorityNormal, kPriorityNormal, kPriorityNormal);
+    MultipleWriteTest(*this, iSignalling, kPriorityNormal, kPriorityNormal, kPriorityNormal);
     Print("\n\nTestB\n\n");
-    MultipleWriteTest(*this, kPriorityNormal, kPriorityLow, kPriorityHigh);
+    MultipleWriteTest(*this, iSignalling, kPriorityNormal, kPriorityLow, kPriorityHigh);
     Print("\n\nTestC\n\n");
-    MultipleWriteTest(*this, kPriorityNormal, kPriorityHigh, kPriorityLow);
+    MultipleWriteTest(*this, iSignalling, kPriorityNormal, kPriorityHigh, kPriorityLow);
     Print("\n\nTestD\n\n");
-    MultipleWriteTest(*this, kPriorityLow, kPriorityNormal, kPriorityNormal);
+    MultipleWriteTest(*this, iSignalling, kPriorityLow, kPriorityNormal, kPriorityNormal);
     Print("\n\nTestE\n\n");
-    MultipleWriteTest(*this, kPriorityLow, kPriorityNormal, kPriorityHigh);
+    MultipleWriteTest(*this, iSignalling, kPriorityLow, kPriorityNormal, kPriorityHigh);
     Print("\n\nTestF\n\n");
-    MultipleWriteTest(*this, kPriorityLow, kPriorityHigh, kPriorityNormal);
+    MultipleWriteTest(*this, iSignalling, kPriorityLow, kPriorityHigh, kPriorityNormal);
     Print("\n\nTestG\n\n");
-    MultipleWriteTest(*this, kPriorityHigh, kPriorityNormal, kPriorityNormal);
+    MultipleWriteTest(*this, iSignalling, kPriorityHigh, kPriorityNormal, kPriorityNormal);
     Print("\n\nTestH\n\n");
-    MultipleWriteTest(*this, kPriorityHigh, kPriorityLow, kPriorityNormal);
+    MultipleWriteTest(*this, iSignalling, kPriorityHigh, kPriorityLow, kPriorityNormal);
     Print("\n\nTestI\n\n");
-    MultipleWriteTest(*this, kPriorityHigh, kPriorityNormal, kPriorityLow);
+    MultipleWriteTest(*this, iSignalling, kPriorityHigh, kPriorityNormal, kPriorityLow);
 
     iSem.Signal();
 }
@@ -242,7 +258,7 @@ void ThreadSafetyTests::Run()
 void SuiteFifoThreadSafety::Test()
 {
     Semaphore s("SFTS", 0);
-    ThreadSafetyTests* th = new ThreadSafetyTests(s);
+    ThreadSafetyTests* th = new ThreadSafetyTests(s, iSignalling);
     th->Start();
     s.Wait();
     delete th;
@@ -360,13 +376,197 @@ void SuiteFifoLiteBasic::Test()
     TEST(q2.SlotsUsed() == 0);
 }
 
-void TestFifo()
+// Several writers pass entries through a small fifo to several readers, mirroring the
+// free/waiting queues used by the stack's worker pools.  Checks that every entry is
+// delivered exactly once and reports the time taken by each signalling scheme.
+
+class PerformanceWriter : public INonCopyable
+{
+public:
+    PerformanceWriter(Fifo<TUint>& aFifo, Semaphore& aDone, TUint aIter)
+        : iFifo(aFifo), iDone(aDone), iIter(aIter) {}
+    void Run();
+private:
+    Fifo<TUint>& iFifo;
+    Semaphore& iDone;
+    TUint iIter;
+};
+
+void PerformanceWriter::Run()
+{
+    for (TUint i=0; i<iIter; i++) {
+        iFifo.Write(i);
+    }
+    iDone.Signal();
+}
+
+class PerformanceReader : public INonCopyable
+{
+public:
+    PerformanceReader(Fifo<TUint>& aFifo, Semaphore& aDone, TUint aIter)
+        : iFifo(aFifo), iDone(aDone), iIter(aIter), iTotal(0) {}
+    void Run();
+    TUint64 Total() const { return iTotal; }
+private:
+    Fifo<TUint>& iFifo;
+    Semaphore& iDone;
+    TUint iIter;
+    TUint64 iTotal;
+};
+
+void PerformanceReader::Run()
+{
+    for (TUint i=0; i<iIter; i++) {
+        iTotal += iFifo.Read();
+    }
+    iDone.Signal();
+}
+
+class SuiteFifoPerformance : public Suite
+{
+public:
+    SuiteFifoPerformance(Environment& aEnv) : Suite("Fifo multiple writers, multiple readers"), iEnv(aEnv) {}
+    void Test();
+private:
+    TUint Run(EFifoSignalling aSignalling, TUint aThreads, TUint aSlots);
+private:
+    static const TUint kEntriesPerWriter = 100000;
+    static const TUint kMaxThreads = 4;
+    Environment& iEnv;
+};
+
+void SuiteFifoPerformance::Test()
+{
+    static const TUint kThreads[] = { 1, kMaxThreads };
+    static const TUint kSlots[] = { 1, 16 };
+    for (TUint i=0; i<sizeof(kThreads)/sizeof(kThreads[0]); i++) {
+        for (TUint j=0; j<sizeof(kSlots)/sizeof(kSlots[0]); j++) {
+            TUint always = Run(EFifoSignalAlways, kThreads[i], kSlots[j]);
+            TUint onDemand = Run(EFifoSignalOnDemand, kThreads[i], kSlots[j]);
+            Print("%u writer(s)/%u reader(s), %2u slots: SignalAlways %5ums, SignalOnDemand %5ums\n",
+                  kThreads[i], kThreads[i], kSlots[j], always, onDemand);
+        }
+    }
+}
+
+TUint SuiteFifoPerformance::Run(EFifoSignalling aSignalling, TUint aThreads, TUint aSlots)
+{
+    Fifo<TUint> fifo(aSlots, aSignalling);
+    Semaphore done("FPDN", 0);
+    PerformanceWriter* writers[kMaxThreads];
+    PerformanceReader* readers[kMaxThreads];
+    ThreadFunctor* threads[2*kMaxThreads];
+    TUint i;
+    for (i=0; i<aThreads; i++) {
+        writers[i] = new PerformanceWriter(fifo, done, kEntriesPerWriter);
+        readers[i] = new PerformanceReader(fifo, done, kEntriesPerWriter);
+        threads[2*i] = new ThreadFunctor("FPWR", MakeFunctor(*writers[i], &PerformanceWriter::Run));
+        threads[2*i+1] = new ThreadFunctor("FPRD", MakeFunctor(*readers[i], &PerformanceReader::Run));
+    }
+    const TUint start = Time::Now(iEnv);
+    for (i=0; i<2*aThreads; i++) {
+        threads[i]->Start();
+    }
+    for (i=0; i<2*aThreads; i++) {
+        done.Wait();
+    }
+    const TUint elapsed = Time::Now(iEnv) - start;
+    TUint64 total = 0;
+    for (i=0; i<aThreads; i++) {
+        total += readers[i]->Total();
+    }
+    const TUint64 expected = (TUint64)aThreads * kEntriesPerWriter * (kEntriesPerWriter - 1) / 2;
+    TEST(total == expected);
+    for (i=0; i<aThreads; i++) {
+        delete threads[2*i];
+        delete threads[2*i+1];
+        delete writers[i];
+        delete readers[i];
+    }
+    TEST(fifo.SlotsUsed() == 0);
+    return elapsed;
+}
+
+// A timed read must not outlast its timeout when its thread is repeatedly woken without
+// being able to complete.  Raising then immediately clearing an interrupt wakes a parked
+// reader which (usually) finds nothing to do and parks again.
+// Only applies to EFifoSignalOnDemand; EFifoSignalAlways readers don't re-check after waking.
+
+class SuiteFifoTimeout : public Suite, private INonCopyable
+{
+public:
+    SuiteFifoTimeout(Environment& aEnv);
+    void Test();
+private:
+    void Churn();
+    TBool Stopped();
+private:
+    static const TUint kTimeoutMs = 100;
+    static const TUint kSlackMs = 100;
+    static const TUint kChurnIntervalMs = 10;
+    static const TUint kReads = 5;
+    Environment& iEnv;
+    Fifo<TUint> iFifo;
+    Mutex iLock;
+    TBool iStop;
+};
+
+SuiteFifoTimeout::SuiteFifoTimeout(Environment& aEnv)
+    : Suite("Fifo read timeout with spurious wakes (signal on demand)")
+    , iEnv(aEnv)
+    , iFifo(1, EFifoSignalOnDemand)
+    , iLock("SFTO")
+    , iStop(false)
+{
+}
+
+void SuiteFifoTimeout::Test()
+{
+    ThreadFunctor* churn = new ThreadFunctor("FTCH", MakeFunctor(*this, &SuiteFifoTimeout::Churn));
+    churn->Start();
+    for (TUint i=0; i<kReads; i++) {
+        const TUint start = Time::Now(iEnv);
+        try {
+            (void)iFifo.Read(kTimeoutMs);
+        }
+        catch (Timeout&) {}
+        catch (FifoReadError&) {} // woke before the interrupt was cleared
+        TEST(Time::Now(iEnv) - start < kTimeoutMs + kSlackMs);
+    }
+    iLock.Wait();
+    iStop = true;
+    iLock.Signal();
+    delete churn;
+    iFifo.ReadInterrupt(false);
+    TEST(iFifo.SlotsUsed() == 0);
+}
+
+void SuiteFifoTimeout::Churn()
+{
+    while (!Stopped()) {
+        iFifo.ReadInterrupt();
+        iFifo.ReadInterrupt(false);
+        Thread::Sleep(kChurnIntervalMs);
+    }
+}
+
+TBool SuiteFifoTimeout::Stopped()
+{
+    AutoMutex a(iLock);
+    return iStop;
+}
+
+void TestFifo(Environment& aEnv)
 {
     Debug::SetLevel(Debug::kNone);
 
     Runner runner("FifoS testing\n");
-    runner.Add(new SuiteFifoBasic());
-    runner.Add(new SuiteFifoThreadSafety());
+    runner.Add(new SuiteFifoBasic("Single threaded basic Fifo testing", EFifoSignalAlways));
+    runner.Add(new SuiteFifoBasic("Single threaded basic Fifo testing (signal on demand)", EFifoSignalOnDemand));
+    runner.Add(new SuiteFifoThreadSafety("Fifo thread safety multiple writers, 1 reader", EFifoSignalAlways));
+    runner.Add(new SuiteFifoThreadSafety("Fifo thread safety multiple writers, 1 reader (signal on demand)", EFifoSignalOnDemand));
+    runner.Add(new SuiteFifoTimeout(aEnv));
     runner.Add(new SuiteFifoLiteBasic());
+    runner.Add(new SuiteFifoPerformance(aEnv));
     runner.Run();
 }
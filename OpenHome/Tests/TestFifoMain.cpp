@@ -1,11 +1,14 @@
 #include <OpenHome/Private/TestFramework.h>
+#include <OpenHome/Net/Core/OhNet.h>
 
-extern void TestFifo();
+using namespace OpenHome;
+
+extern void TestFifo(Environment& aEnv);
 
 void OpenHome::TestFramework::Runner::Main(TInt /*aArgc*/, TChar* /*aArgv*/[], Net::InitialisationParams* aInitParams)
 {
-    Net::UpnpLibrary::InitialiseMinimal(aInitParams);
-    TestFifo();
+    Environment* env = Net::UpnpLibrary::InitialiseMinimal(aInitParams);
+    TestFifo(*env);
     delete aInitParams;
     Net::UpnpLibrary::Close();
 }
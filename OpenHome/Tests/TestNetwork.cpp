@@ -290,6 +290,20 @@ void SuiteSocketServer::Test()
     client1.Read(largerx, largetx.Bytes());
     TEST(largerx == largetx);
 
+    // Send a message gathered from several buffers
+
+    Brn head("0123456789");
+    const Brx* gathered[] = { &head, &Brx::Empty(), &largetx, &head };
+    Bwh gatheredtx(1020);
+    gatheredtx.Append(head);
+    gatheredtx.Append(largetx);
+    gatheredtx.Append(head);
+    Bwh gatheredrx(1020);
+
+    client1.WriteGather(gathered, 4);
+    client1.Read(gatheredrx, gatheredtx.Bytes());
+    TEST(gatheredrx == gatheredtx);
+
     // Send/receive multiple times
 
     tx.SetBytes(25);
@@ -362,6 +376,202 @@ void SuiteSocketServer::Test()
     Thread::Sleep(20);
 }
 
+// SocketTcpServer (event driven)
+
+class SuiteSocketServerEventDriven : public Suite, public INonCopyable
+{
+public:
+    SuiteSocketServerEventDriven(TIpAddress aInterface) : Suite("ohNet event driven Socket Server Tests"), iInterface(aInterface) {}
+    void Test();
+private:
+    static const TUint kNumClients = 64;
+    TIpAddress iInterface;
+};
+
+void SuiteSocketServerEventDriven::Test()
+{
+    SocketTcpServer* server = new SocketTcpServer(*gEnv, "TSSE", 0, iInterface, kPriorityHigh,
+                                                  Thread::kDefaultStackBytes, 128, true);
+    if (!server->EventDriven()) {
+        Print("Event driven servers not supported on this platform\n");
+        delete server;
+        return;
+    }
+    server->Add("TSE1", new TcpSessionEcho());
+    server->Add("TSE2", new TcpSessionEcho());
+    Endpoint endpoint(server->Port(), iInterface);
+
+    // many more idle clients than sessions
+    SocketTcpClient* clients[kNumClients];
+    for (TUint i=0; i<kNumClients; i++) {
+        clients[i] = new SocketTcpClient();
+        clients[i]->Open(*gEnv);
+        clients[i]->Connect(endpoint, 1000);
+    }
+
+    // clients are serviced in the order they send data, not the order they connected
+    Bws<26> tx("ABCDEFGHIJKLMNOPQRSTUVWXYZ");
+    for (TInt i=kNumClients-1; i>=0; i--) {
+        Bws<26> rx;
+        clients[i]->Write(tx);
+        clients[i]->Receive(rx, 26);
+        TEST(rx == tx);
+        clients[i]->Close();
+        delete clients[i];
+    }
+
+    // server can be deleted with idle connections outstanding
+    SocketTcpClient client;
+    client.Open(*gEnv);
+    client.Connect(endpoint, 1000);
+    Thread::Sleep(50);
+    delete server;
+    client.Close();
+}
+
+// SuiteTcpClientPool
+
+class TcpSessionPing : public SocketTcpSession
+{
+private:
+    virtual void Run();
+};
+
+void TcpSessionPing::Run()
+{
+    // echo until the client closes the connection
+    Bws<64> message;
+    try {
+        for (;;) {
+            Read(message);
+            Write(message);
+        }
+    }
+    catch (ReaderError&) {}
+    catch (WriterError&) {}
+}
+
+class TcpSessionPingOnce : public SocketTcpSession
+{
+private:
+    virtual void Run();
+};
+
+void TcpSessionPingOnce::Run()
+{
+    // echo a single message then close the connection
+    Bws<64> message;
+    Read(message);
+    Write(message);
+}
+
+class SuiteTcpClientPool : public Suite, public INonCopyable
+{
+public:
+    SuiteTcpClientPool(TIpAddress aInterface) : Suite("ohNet Tcp client pool Tests"), iInterface(aInterface) {}
+    void Test();
+private:
+    SocketTcpClient* Connect(const Endpoint& aEndpoint);
+    TBool Echo(SocketTcpClient& aClient);
+private:
+    static const TUint kNumSessions = 4;
+    static const TUint kIdleTimeoutMs = 200;
+    TIpAddress iInterface;
+};
+
+SocketTcpClient* SuiteTcpClientPool::Connect(const Endpoint& aEndpoint)
+{
+    SocketTcpClient* client = new SocketTcpClient();
+    client->Open(*gEnv);
+    client->Connect(aEndpoint, 1000);
+    return client;
+}
+
+TBool SuiteTcpClientPool::Echo(SocketTcpClient& aClient)
+{
+    Bws<4> tx("ping");
+    Bws<4> rx;
+    aClient.Write(tx);
+    aClient.Receive(rx, tx.Bytes());
+    return (rx == tx);
+}
+
+void SuiteTcpClientPool::Test()
+{
+    SocketTcpServer* server = new SocketTcpServer(*gEnv, "TSCP", 0, iInterface);
+    for (TUint i=0; i<kNumSessions; i++) {
+        server->Add("TSCP", new TcpSessionPing());
+    }
+    Endpoint endpoint(server->Port(), iInterface);
+    Endpoint other(server->Port() + 1, iInterface);
+
+    // a pool with no connections per endpoint is disabled
+    SocketTcpClientPool disabled(*gEnv, 0, kIdleTimeoutMs);
+    TEST(!disabled.Enabled());
+    TEST(disabled.Acquire(endpoint) == NULL);
+
+    SocketTcpClientPool pool(*gEnv, 2, kIdleTimeoutMs);
+    TEST(pool.Enabled());
+    TEST(pool.Acquire(endpoint) == NULL);
+
+    // a released connection is handed back, still connected
+    SocketTcpClient* client1 = Connect(endpoint);
+    TEST(Echo(*client1));
+    pool.Release(client1, endpoint);
+    TEST(pool.Acquire(other) == NULL);
+    TEST(pool.Acquire(endpoint) == client1);
+    TEST(pool.Acquire(endpoint) == NULL);
+    TEST(Echo(*client1));
+
+    // at most 2 idle connections per endpoint are kept; the most recently released is reused first
+    SocketTcpClient* client2 = Connect(endpoint);
+    SocketTcpClient* client3 = Connect(endpoint);
+    pool.Release(client1, endpoint);
+    pool.Release(client2, endpoint);
+    pool.Release(client3, endpoint); // closed rather than retained
+    TEST(pool.Acquire(endpoint) == client2);
+    TEST(pool.Acquire(endpoint) == client1);
+    TEST(pool.Acquire(endpoint) == NULL);
+
+    // a client which hits an error evicts (and closes) any other idle connections to that endpoint
+    pool.Release(client1, endpoint);
+    SocketTcpClientPool::Close(client2);
+    pool.Evict(endpoint);
+    TEST(pool.Acquire(endpoint) == NULL);
+    // ...freeing the server sessions they occupied
+    SocketTcpClient* clients[kNumSessions];
+    for (TUint i=0; i<kNumSessions; i++) {
+        clients[i] = Connect(endpoint);
+        TEST(Echo(*clients[i]));
+    }
+
+    // idle connections expire
+    pool.Release(clients[0], endpoint);
+    pool.Release(clients[1], endpoint);
+    Thread::Sleep(kIdleTimeoutMs + 100);
+    TEST(pool.Acquire(endpoint) == NULL);
+
+    // the pool closes any connections it holds when it is destroyed
+    SocketTcpClientPool* pool2 = new SocketTcpClientPool(*gEnv, 2, 60 * 1000);
+    pool2->Release(clients[2], endpoint);
+    pool2->Release(clients[3], endpoint);
+    delete pool2;
+
+    // a connection which the server has since closed is discarded rather than handed back
+    SocketTcpServer* closingServer = new SocketTcpServer(*gEnv, "TSCC", 0, iInterface);
+    closingServer->Add("TSCC", new TcpSessionPingOnce());
+    Endpoint closingEndpoint(closingServer->Port(), iInterface);
+    SocketTcpClient* client4 = Connect(closingEndpoint);
+    TEST(Echo(*client4));
+    Thread::Sleep(50); // allow the server's FIN to arrive
+    TEST(client4->Readable());
+    pool.Release(client4, closingEndpoint);
+    TEST(pool.Acquire(closingEndpoint) == NULL);
+    delete closingServer;
+
+    delete server;
+}
+
 // TcpServerShutdown
 
 class TcpSessionTest : public SocketTcpSession
@@ -705,6 +915,60 @@ void SuiteUnicast::Receiver()
     } while (val != kQuit);
 }
 
+class SuiteUdpBatched : public Suite
+{
+public:
+    SuiteUdpBatched(TIpAddress aInterface);
+private:
+    void Test();
+private:
+    static const TUint kMsgCount = 40;
+    static const TUint kMaxDatagrams = 8;
+    static const TUint kMaxDatagramBytes = 64;
+private:
+    TIpAddress iInterface;
+};
+
+SuiteUdpBatched::SuiteUdpBatched(TIpAddress aInterface)
+    : Suite("Batched UDP send/receive")
+    , iInterface(aInterface)
+{
+}
+
+void SuiteUdpBatched::Test()
+{
+    SocketUdp receiver(*gEnv, 0, iInterface);
+    receiver.SetRecvBufBytes(128 * 1024);
+    SocketUdp sender(*gEnv, 0, iInterface);
+    Bws<kMaxDatagramBytes> msgs[kMsgCount];
+    const Brx* ptrs[kMsgCount];
+    for (TUint i=0; i<kMsgCount; i++) {
+        // vary lengths so that datagram boundaries are checked
+        for (TUint j=0; j<=i; j++) {
+            msgs[i].Append((TByte)i);
+        }
+        ptrs[i] = &msgs[i];
+    }
+    sender.SendMultiple(ptrs, kMsgCount, Endpoint(receiver.Port(), iInterface));
+
+    UdpReader reader(receiver, kMaxDatagrams, kMaxDatagramBytes);
+    Bws<kMaxDatagramBytes> buf;
+    for (TUint i=0; i<kMsgCount; i++) {
+        reader.Read(buf);
+        TEST(buf == msgs[i]);
+        TEST(reader.Sender().Port() == sender.Port());
+        TEST_THROWS(reader.Read(buf), ReaderError);
+        reader.ReadFlush();
+    }
+
+    // datagrams larger than the caller's buffer are truncated, as for a single receive
+    Bws<4> small;
+    sender.Send(msgs[kMsgCount-1], Endpoint(receiver.Port(), iInterface));
+    reader.Read(small);
+    TEST(small == msgs[kMsgCount-1].Split(0, 4));
+    reader.ReadFlush();
+}
+
 class MainNetworkTestThread : public Thread
 {
 public:
@@ -720,8 +984,11 @@ void MainNetworkTestThread::Run()
     Runner runner("Network System");
     runner.Add(new SuiteTcpClient(iInterface));
     runner.Add(new SuiteSocketServer(iInterface));
+    runner.Add(new SuiteSocketServerEventDriven(iInterface));
+    runner.Add(new SuiteTcpClientPool(iInterface));
     runner.Add(new SuiteTcpServerShutdown(iInterface));
     runner.Add(new SuiteEndpoint());
+    runner.Add(new SuiteUdpBatched(iInterface));
     //runner.Add(new SuiteUnicast(iInterface));
     // SuiteMulticast disabled because Linn network setup means that each multicast message is duplicated when
     // running on a core server (used for automated post-commit tests)
@@ -2,9 +2,14 @@
 #include <OpenHome/Private/Ascii.h>
 #include <OpenHome/Private/Parser.h>
 #include <OpenHome/Private/Uri.h>
+#include <OpenHome/Net/Private/XmlParser.h>
+#include <OpenHome/Private/Converter.h>
+#include <OpenHome/Private/Http.h>
+#include <OpenHome/Private/Stream.h>
 
 using namespace OpenHome;
 using namespace OpenHome::TestFramework;
+using namespace OpenHome::Net;
 
 class SuiteAscii : public Suite
 {
@@ -1506,11 +1511,529 @@ void SuiteUri::Test()
 }
 
 
-void TestTextUtils()
+class SuiteXmlParser : public Suite, private IXmlSaxHandler
+{
+public:
+    SuiteXmlParser() : Suite("XmlParser"), iParser(*this) {}
+    void Test();
+private:
+    void ParseFragmented(const Brx& aDoc, TUint aFragmentBytes);
+    void XmlElementStart(const Brx& aName, const Brx& aAttributes);
+    void XmlElementEnd(const Brx& aName, const Brx& aValue);
+private:
+    XmlParserSax iParser;
+    Bwh iLog;
+};
+
+void SuiteXmlParser::ParseFragmented(const Brx& aDoc, TUint aFragmentBytes)
+{
+    iLog.SetBytes(0);
+    iParser.Reset();
+    for (TUint i=0; i<aDoc.Bytes(); i+=aFragmentBytes) {
+        // copy each fragment so the parser can't rely on earlier fragments remaining valid
+        TUint bytes = aDoc.Bytes() - i;
+        if (bytes > aFragmentBytes) {
+            bytes = aFragmentBytes;
+        }
+        Bwh fragment(aDoc.Split(i, bytes));
+        iParser.Parse(fragment);
+        fragment.Fill(0);
+    }
+    iParser.End();
+}
+
+void SuiteXmlParser::XmlElementStart(const Brx& aName, const Brx& aAttributes)
+{
+    iLog.Grow(iLog.Bytes() + aName.Bytes() + aAttributes.Bytes() + 16);
+    iLog.Append('+');
+    iLog.Append(aName);
+    if (aAttributes.Bytes() > 0) {
+        iLog.Append('(');
+        iLog.Append(aAttributes);
+        iLog.Append(')');
+    }
+    iLog.Append(';');
+}
+
+void SuiteXmlParser::XmlElementEnd(const Brx& aName, const Brx& aValue)
+{
+    iLog.Grow(iLog.Bytes() + aName.Bytes() + aValue.Bytes() + 16);
+    iLog.Append('-');
+    iLog.Append(aName);
+    iLog.Append('=');
+    iLog.Append(aValue);
+    iLog.Append(';');
+}
+
+void SuiteXmlParser::Test()
+{
+    Brn doc("<?xml version=\"1.0\"?>\n"
+            "<s:Envelope xmlns:s=\"http://schemas.xmlsoap.org/soap/envelope/\">\n"
+            "  <s:Body>\n"
+            "    <u:ReadResponse xmlns:u=\"urn:x\">\n"
+            "      <Value>a &lt;b&gt; <!-- c > d --> e</Value>\n"
+            "      <Empty/>\n"
+            "      <Attr a=\"x>y\" b='z'>1</Attr>\n"
+            "    </u:ReadResponse>\n"
+            "  </s:Body>\n"
+            "</s:Envelope>\n");
+    Brn expected("+Envelope(xmlns:s=\"http://schemas.xmlsoap.org/soap/envelope/\");+Body;"
+                 "+ReadResponse(xmlns:u=\"urn:x\");+Value;-Value=a &lt;b&gt;  e;+Empty;-Empty=;"
+                 "+Attr(a=\"x>y\" b='z');-Attr=1;-ReadResponse=;-Body=;-Envelope=;");
+    for (TUint i=1; i<=doc.Bytes(); i++) {
+        ParseFragmented(doc, i);
+        TEST(iLog == expected);
+    }
+
+    // offsets allow element content to be located in a document held in memory
+    Brn simple("<a><b> x </b></a>");
+    iParser.Reset();
+    iParser.Parse(simple);
+    iParser.End();
+    TEST(iParser.TagOffset() == 13);
+    TEST(iParser.TagEndOffset() == simple.Bytes());
+
+    TEST_THROWS(ParseFragmented(Brn("<a><b></a></b>"), 3), XmlError);
+    TEST_THROWS(ParseFragmented(Brn("<a><b></b>"), 3), XmlError);
+    TEST_THROWS(ParseFragmented(Brn("<![CDATA[x]]><a/>"), 3), XmlError);
+    TEST_THROWS(ParseFragmented(Brn("<!DOCTYPE a [<!ENTITY b \"c\">]><a/>"), 3), XmlError);
+    ParseFragmented(Brn("<!DOCTYPE a><?pi [x]?><a><!-- [x] --></a>"), 3);
+    TEST(iLog == Brn("+a;-a=;"));
+    TEST_THROWS(ParseFragmented(Brn(""), 3), XmlError);
+
+    // CDATA content is reported, escaped, as part of an element's value
+    Brn cdata("<a><b>1 <![CDATA[<i>&amp;</i> ]>]]> 2</b><c><![CDATA[]]></c><d><![CDATA[x]]><e/></d></a>");
+    Brn cdataExpected("+a;+b;-b=1 &lt;i&gt;&amp;amp;&lt;/i&gt; ]&gt; 2;+c;-c=;+d;+e;-e=;-d=;-a=;");
+    for (TUint i=1; i<=cdata.Bytes(); i++) {
+        ParseFragmented(cdata, i);
+        TEST(iLog == cdataExpected);
+    }
+
+    // elements at the inner xml depth which contain other elements report their unparsed content
+    iParser.SetInnerXmlDepth(2);
+    Brn inner("<a><b>x<c>y</c><d/></b><e>z &amp;</e><f><![CDATA[<g>]]><h>]]&gt;</h> </f><i/></a>");
+    Brn innerExpected("+a;+b;+c;-c=y;+d;-d=;-b=x<c>y</c><d/>;+e;-e=z &amp;;"
+                      "+f;+h;-h=]]&gt;;-f=<![CDATA[<g>]]><h>]]&gt;</h> ;+i;-i=;-a=;");
+    for (TUint i=1; i<=inner.Bytes(); i++) {
+        ParseFragmented(inner, i);
+        TEST(iLog == innerExpected);
+    }
+    iParser.SetInnerXmlDepth(0);
+    ParseFragmented(inner, 4);
+    TEST(iLog == Brn("+a;+b;+c;-c=y;+d;-d=;-b=;+e;-e=z &amp;;+f;+h;-h=]]&gt;;-f=;+i;-i=;-a=;"));
+
+    Brn remaining;
+    Brn name;
+    Brn args("<A>1</A> <B><C/></B><D/>");
+    TEST(XmlParserBasic::Next(args, name, remaining) == Brn("1"));
+    TEST(name == Brn("A"));
+    TEST(XmlParserBasic::Next(remaining, name, remaining) == Brn("<C/>"));
+    TEST(name == Brn("B"));
+    TEST(XmlParserBasic::Next(remaining, name, remaining) == Brn(""));
+    TEST(name == Brn("D"));
+    TEST(remaining.Bytes() == 0);
+}
+
+
+class SuiteConverter : public Suite, private IWriter
+{
+public:
+    SuiteConverter() : Suite("Converter"), iOutput(8 * 1024) {}
+    void Test();
+private:
+    void TestEscape(const Brx& aValue, const Brx& aExpected, TUint aMaxWrites);
+    void TestUnescape(const Brx& aValue, const Brx& aExpected);
+    void TestBase64(const Brx& aValue, const Brx& aExpected);
+    void TestFromBase64(const Brx& aValue, const Brx& aExpected);
+private: // IWriter
+    void Write(TByte aValue);
+    void Write(const Brx& aBuffer);
+    void WriteFlush() {}
+private:
+    Bwh iOutput;
+    TUint iWrites;
+};
+
+void SuiteConverter::Write(TByte aValue)
+{
+    iOutput.Append(aValue);
+    iWrites++;
+}
+
+void SuiteConverter::Write(const Brx& aBuffer)
+{
+    iOutput.Append(aBuffer);
+    iWrites++;
+}
+
+void SuiteConverter::TestEscape(const Brx& aValue, const Brx& aExpected, TUint aMaxWrites)
+{
+    iOutput.SetBytes(0);
+    iWrites = 0;
+    Converter::ToXmlEscaped(*this, aValue);
+    TEST(iOutput == aExpected);
+    TEST(iWrites <= aMaxWrites);
+}
+
+void SuiteConverter::TestUnescape(const Brx& aValue, const Brx& aExpected)
+{
+    Bwh buf(aValue);
+    Converter::FromXmlEscaped(buf);
+    TEST(buf == aExpected);
+}
+
+void SuiteConverter::TestBase64(const Brx& aValue, const Brx& aExpected)
+{
+    iOutput.SetBytes(0);
+    iWrites = 0;
+    Converter::ToBase64(*this, aValue);
+    TEST(iOutput == aExpected);
+    TEST(iOutput.Bytes() == Converter::Base64EncodedBytes(aValue.Bytes()));
+    TEST(iWrites <= 1);
+    TestFromBase64(aExpected, aValue);
+}
+
+void SuiteConverter::TestFromBase64(const Brx& aValue, const Brx& aExpected)
+{
+    Bwh buf(aValue);
+    Converter::FromBase64(buf);
+    TEST(buf == aExpected);
+}
+
+void SuiteConverter::Test()
+{
+    TestEscape(Brn(""), Brn(""), 0);
+    TestEscape(Brn("plain text, written in one go"), Brn("plain text, written in one go"), 1);
+    TestEscape(Brn("<&'tag\">"), Brn("&lt;&amp;&apos;tag&quot;&gt;"), 7);
+    TestEscape(Brn("a<b"), Brn("a&lt;b"), 3);
+    TestEscape(Brn("caf\xc3\xa9 & cr\xc3\xa8me"), Brn("caf\xc3\xa9 &amp; cr\xc3\xa8me"), 3);
+    // bytes within a multi-byte character are never escaped, even if invalid
+    TestEscape(Brn("\xe2<>x"), Brn("\xe2<>x"), 1);
+    TestEscape(Brn("x\xf0<"), Brn("x\xf0<"), 1); // truncated character
+
+    TestUnescape(Brn(""), Brn(""));
+    TestUnescape(Brn("plain"), Brn("plain"));
+    TestUnescape(Brn("&lt;&amp;&apos;tag&quot;&gt;"), Brn("<&'tag\">"));
+    TestUnescape(Brn("a &amp;&amp; b"), Brn("a && b"));
+    TestUnescape(Brn("caf\xc3\xa9 &amp; cr\xc3\xa8me"), Brn("caf\xc3\xa9 & cr\xc3\xa8me"));
+    TestUnescape(Brn("\xe2&lt;x"), Brn("\xe2&lt;x"));
+    // unrecognised references are dropped up to and including the first unexpected character
+    TestUnescape(Brn("a&xb"), Brn("ab"));
+    TestUnescape(Brn("a&apxb"), Brn("ab"));
+    TestUnescape(Brn("a&amp"), Brn("a"));
+    TestUnescape(Brn("a&"), Brn("a"));
+
+    // round trip every byte value
+    Bws<256> all;
+    for (TUint i=0; i<128; i++) {
+        all.Append((TByte)i);
+    }
+    iOutput.SetBytes(0);
+    iWrites = 0;
+    Converter::ToXmlEscaped(*this, all);
+    Bwh escaped(iOutput);
+    Converter::FromXmlEscaped(escaped);
+    TEST(escaped == all);
+
+    TestBase64(Brn(""), Brn(""));
+    TestBase64(Brn("f"), Brn("Zg=="));
+    TestBase64(Brn("fo"), Brn("Zm8="));
+    TestBase64(Brn("foo"), Brn("Zm9v"));
+    TestBase64(Brn("foob"), Brn("Zm9vYg=="));
+    TestBase64(Brn("fooba"), Brn("Zm9vYmE="));
+    TestBase64(Brn("foobar"), Brn("Zm9vYmFy"));
+    TestBase64(Brn((const TByte*)"\x00\xff\xfe", 3), Brn("AP/+"));
+    // whitespace, padding and other invalid characters are skipped, wherever they appear
+    TestFromBase64(Brn("Zm9v\r\nYmFy"), Brn("foobar"));
+    TestFromBase64(Brn(" Z m9vY m Fy "), Brn("foobar"));
+    TestFromBase64(Brn("Zm9vYg"), Brn("foob"));
+
+    // round trip values large enough to need several writes
+    Bwh bin(5000);
+    for (TUint i=0; i<bin.MaxBytes(); i++) {
+        bin.Append((TByte)(i * 7));
+    }
+    for (TUint bytes=bin.Bytes()-3; bytes<=bin.Bytes(); bytes++) {
+        Brn value(bin.Ptr(), bytes);
+        iOutput.SetBytes(0);
+        Converter::ToBase64(*this, value);
+        TEST(iOutput.Bytes() == Converter::Base64EncodedBytes(bytes));
+        Bwh decoded(iOutput);
+        Converter::FromBase64(decoded);
+        TEST(decoded == value);
+    }
+}
+
+
+class SuiteHttpHeaderRange : public Suite
+{
+public:
+    SuiteHttpHeaderRange() : Suite("Http Range header") {}
+    void Test();
+private:
+    // returns the value of HttpHeaderRange::Resolve for a request with aValue
+    static TBool Resolve(const TChar* aValue, TUint aTotalBytes, TUint& aOffset, TUint& aBytes);
+};
+
+TBool SuiteHttpHeaderRange::Resolve(const TChar* aValue, TUint aTotalBytes, TUint& aOffset, TUint& aBytes)
+{
+    HttpHeaderRange header;
+    IHttpHeader& h = header;
+    h.Reset();
+    if (h.Recognise(Brn("Range"))) {
+        h.Process(Brn(aValue));
+    }
+    return header.Resolve(aTotalBytes, aOffset, aBytes);
+}
+
+void SuiteHttpHeaderRange::Test()
+{
+    TUint offset = 0xff;
+    TUint bytes = 0xff;
+
+    // header absent
+    HttpHeaderRange header;
+    static_cast<IHttpHeader&>(header).Reset();
+    TEST(!header.Resolve(100, offset, bytes));
+    TEST(static_cast<IHttpHeader&>(header).Recognise(Brn("range")));
+    TEST(!static_cast<IHttpHeader&>(header).Recognise(Brn("Content-Range")));
+
+    // first-last
+    TEST(Resolve("bytes=0-9", 100, offset, bytes));
+    TEST(offset == 0 && bytes == 10);
+    TEST(Resolve("bytes=10-19", 100, offset, bytes));
+    TEST(offset == 10 && bytes == 10);
+    TEST(Resolve(" bytes= 50 - 50 ", 100, offset, bytes));
+    TEST(offset == 50 && bytes == 1);
+    TEST(Resolve("bytes=99-99", 100, offset, bytes));
+    TEST(offset == 99 && bytes == 1);
+
+    // open-ended
+    TEST(Resolve("bytes=90-", 100, offset, bytes));
+    TEST(offset == 90 && bytes == 10);
+    TEST(Resolve("bytes=0-", 100, offset, bytes));
+    TEST(offset == 0 && bytes == 100);
+
+    // suffix
+    TEST(Resolve("bytes=-10", 100, offset, bytes));
+    TEST(offset == 90 && bytes == 10);
+    TEST(Resolve("bytes=-100", 100, offset, bytes));
+    TEST(offset == 0 && bytes == 100);
+    TEST(Resolve("bytes=-1000", 100, offset, bytes)); // longer than the entity; all of it
+    TEST(offset == 0 && bytes == 100);
+    TEST(Resolve("bytes=-0", 100, offset, bytes));    // unsatisfiable
+    TEST(bytes == 0);
+
+    // beyond the end
+    TEST(Resolve("bytes=50-1000", 100, offset, bytes)); // clipped
+    TEST(offset == 50 && bytes == 50);
+    TEST(Resolve("bytes=100-", 100, offset, bytes));    // unsatisfiable
+    TEST(bytes == 0);
+    TEST(Resolve("bytes=100-200", 100, offset, bytes));
+    TEST(bytes == 0);
+    TEST(Resolve("bytes=1000-2000", 100, offset, bytes));
+    TEST(bytes == 0);
+
+    // multiple ranges are ignored; the whole entity is sent
+    TEST(!Resolve("bytes=0-9,20-29", 100, offset, bytes));
+    TEST(!Resolve("bytes=0-9, -10", 100, offset, bytes));
+
+    // malformed headers are ignored
+    TEST(!Resolve("", 100, offset, bytes));
+    TEST(!Resolve("bytes=", 100, offset, bytes));
+    TEST(!Resolve("bytes=-", 100, offset, bytes));
+    TEST(!Resolve("bytes=10", 100, offset, bytes));
+    TEST(!Resolve("bytes=a-b", 100, offset, bytes));
+    TEST(!Resolve("bytes=1-b", 100, offset, bytes));
+    TEST(!Resolve("bytes=-b", 100, offset, bytes));
+    TEST(!Resolve("bytes=20-10", 100, offset, bytes));
+    TEST(!Resolve("items=0-9", 100, offset, bytes));
+    TEST(!Resolve("0-9", 100, offset, bytes));
+}
+
+
+class HeaderRecorder : public HttpHeader
+{
+public:
+    HeaderRecorder(const TChar* aField);
+    const Brx& Value() const;
+    TUint RecogniseCalls() const;
+private: // from HttpHeader
+    TBool Recognise(const Brx& aHeader);
+    void Process(const Brx& aValue);
+    void Reset();
+private:
+    Brn iField;
+    Bws<64> iValue;
+    TUint iRecogniseCalls;
+};
+
+HeaderRecorder::HeaderRecorder(const TChar* aField)
+    : iField(aField)
+    , iRecogniseCalls(0)
+{
+}
+
+const Brx& HeaderRecorder::Value() const
+{
+    return iValue;
+}
+
+TUint HeaderRecorder::RecogniseCalls() const
+{
+    return iRecogniseCalls;
+}
+
+TBool HeaderRecorder::Recognise(const Brx& aHeader)
+{
+    iRecogniseCalls++;
+    return Ascii::CaseInsensitiveEquals(aHeader, iField);
+}
+
+void HeaderRecorder::Process(const Brx& aValue)
+{
+    iValue.Replace(aValue);
+    SetReceived();
+}
+
+void HeaderRecorder::Reset()
+{
+    iValue.SetBytes(0);
+    HttpHeader::Reset();
+}
+
+class SuiteReaderHttpHeader : public Suite
+{
+public:
+    SuiteReaderHttpHeader(Environment& aEnv);
+    void Test();
+private:
+    void Read(const Brx& aRequest);
+    void TestLookup();
+    void TestCollisions();
+    void TestLongFields();
+    void TestHeaderAddedLater();
+private:
+    Environment& iEnv;
+    ReaderBuffer iReaderBuffer;
+    ReaderHttpRequest* iReader;
+};
+
+SuiteReaderHttpHeader::SuiteReaderHttpHeader(Environment& aEnv)
+    : Suite("ReaderHttpHeader field index")
+    , iEnv(aEnv)
+    , iReader(NULL)
+{
+}
+
+void SuiteReaderHttpHeader::Read(const Brx& aRequest)
+{
+    iReaderBuffer.Set(aRequest);
+    iReader->Read();
+}
+
+void SuiteReaderHttpHeader::Test()
+{
+    TestLookup();
+    TestCollisions();
+    TestLongFields();
+    TestHeaderAddedLater();
+}
+
+void SuiteReaderHttpHeader::TestLookup()
+{
+    iReader = new ReaderHttpRequest(iEnv, iReaderBuffer);
+    iReader->AddMethod(Http::kMethodGet);
+    HeaderRecorder alpha("X-Alpha");
+    HeaderRecorder beta("X-Beta");
+    iReader->AddHeader(alpha);
+    iReader->AddHeader(beta);
+    const Brn request("GET / HTTP/1.1\r\nX-Alpha: 1\r\nx-beta: 2\r\nUser-Agent: test\r\n\r\n");
+    Read(request);
+    TEST(alpha.Received());
+    TEST(alpha.Value() == Brn("1"));
+    TEST(beta.Received());
+    TEST(beta.Value() == Brn("2"));
+    const TUint alphaCalls = alpha.RecogniseCalls();
+    const TUint betaCalls = beta.RecogniseCalls();
+
+    // fields seen before are looked up without asking each header again, ignoring case
+    Read(Brn("GET / HTTP/1.1\r\nX-BETA: 3\r\nUser-Agent: test\r\n\r\n"));
+    TEST(!alpha.Received());
+    TEST(beta.Received());
+    TEST(beta.Value() == Brn("3"));
+    TEST(alpha.RecogniseCalls() == alphaCalls);
+    TEST(beta.RecogniseCalls() == betaCalls);
+    delete iReader;
+}
+
+void SuiteReaderHttpHeader::TestCollisions()
+{
+    iReader = new ReaderHttpRequest(iEnv, iReaderBuffer);
+    iReader->AddMethod(Http::kMethodGet);
+    HeaderRecorder alpha("X-Alpha");
+    iReader->AddHeader(alpha);
+    // far more unrecognised fields than the index holds so that they share slots and fill it
+    Bwh request(4096);
+    request.Append("GET / HTTP/1.1\r\n");
+    for (TUint i=0; i<100; i++) {
+        request.Append("X-Unknown-");
+        Ascii::AppendDec(request, i);
+        request.Append(": x\r\n");
+    }
+    request.Append("X-Alpha: 1\r\n\r\n");
+    for (TUint i=0; i<2; i++) {
+        Read(request);
+        TEST(alpha.Received());
+        TEST(alpha.Value() == Brn("1"));
+    }
+    delete iReader;
+}
+
+void SuiteReaderHttpHeader::TestLongFields()
+{
+    iReader = new ReaderHttpRequest(iEnv, iReaderBuffer);
+    iReader->AddMethod(Http::kMethodGet);
+    HeaderRecorder longField("X-A-Field-Name-Too-Long-To-Index-In-The-Table");
+    iReader->AddHeader(longField);
+    for (TUint i=0; i<2; i++) {
+        Read(Brn("GET / HTTP/1.1\r\nx-a-field-name-too-long-to-index-in-the-table: 1\r\n\r\n"));
+        TEST(longField.Received());
+        TEST(longField.Value() == Brn("1"));
+    }
+    delete iReader;
+}
+
+void SuiteReaderHttpHeader::TestHeaderAddedLater()
+{
+    iReader = new ReaderHttpRequest(iEnv, iReaderBuffer);
+    iReader->AddMethod(Http::kMethodGet);
+    HeaderRecorder alpha("X-Alpha");
+    iReader->AddHeader(alpha);
+    const Brn request("GET / HTTP/1.1\r\nX-Alpha: 1\r\nX-Late: 2\r\n\r\n");
+    Read(request);
+    TEST(alpha.Received());
+
+    // X-Late is now indexed as unrecognised; adding a header for it must take effect
+    HeaderRecorder late("X-Late");
+    iReader->AddHeader(late);
+    Read(request);
+    TEST(alpha.Received());
+    TEST(late.Received());
+    TEST(late.Value() == Brn("2"));
+    delete iReader;
+}
+
+
+void TestTextUtils(Environment& aEnv)
 {
     Runner runner("Ascii System");
     runner.Add(new SuiteAscii()); 
     runner.Add(new SuiteParser()); 
     runner.Add(new SuiteUri()); 
+    runner.Add(new SuiteXmlParser());
+    runner.Add(new SuiteConverter());
+    runner.Add(new SuiteHttpHeaderRange());
+    runner.Add(new SuiteReaderHttpHeader(aEnv));
     runner.Run();
 }
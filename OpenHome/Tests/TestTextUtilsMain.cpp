@@ -1,10 +1,13 @@
 #include <OpenHome/Private/TestFramework.h>
+#include <OpenHome/Net/Core/OhNet.h>
 
-extern void TestTextUtils();
+using namespace OpenHome;
+
+extern void TestTextUtils(Environment& aEnv);
 
 void OpenHome::TestFramework::Runner::Main(TInt /*aArgc*/, TChar* /*aArgv*/[], Net::InitialisationParams* aInitParams)
 {
     Net::Library* lib = new Net::Library(aInitParams);
-    TestTextUtils();
+    TestTextUtils(lib->Env());
     delete lib;
 }
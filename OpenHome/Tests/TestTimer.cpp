@@ -231,34 +231,327 @@ void SuiteTimerThrash::Test()
     }
 }
 
+// Checks that large numbers of timers spread across all levels of the timer wheel
+// each fire exactly once and never early.
+
+class ScaleTimer : public INonCopyable
+{
+public:
+    ScaleTimer(Environment& aEnv);
+    void FireAt(TUint aTime);
+    void Cancel();
+    TUint Count() const { return iCount; }
+    TBool Early() const { return iEarly; }
+    TUint Lateness() const { return iLateness; }
+private:
+    void Expired();
+private:
+    Environment& iEnv;
+    Timer iTimer;
+    TUint iTime;
+    TUint iCount;
+    TBool iEarly;
+    TUint iLateness;
+};
+
+ScaleTimer::ScaleTimer(Environment& aEnv)
+    : iEnv(aEnv)
+    , iTimer(aEnv, MakeFunctor(*this, &ScaleTimer::Expired))
+    , iTime(0)
+    , iCount(0)
+    , iEarly(false)
+    , iLateness(0)
+{
+}
+
+void ScaleTimer::FireAt(TUint aTime)
+{
+    iTime = aTime;
+    iTimer.FireAt(aTime);
+}
+
+void ScaleTimer::Cancel()
+{
+    iTimer.Cancel();
+}
+
+void ScaleTimer::Expired()
+{
+    TUint now = Time::Now(iEnv);
+    if (Time::IsAfter(iTime, now)) {
+        iEarly = true;
+    }
+    else if (now - iTime > iLateness) {
+        iLateness = now - iTime;
+    }
+    iCount++;
+}
+
+class SuiteTimerScale : public Suite, private INonCopyable
+{
+public:
+    SuiteTimerScale(Environment& aEnv) : Suite("Timer scale testing"), iEnv(aEnv) {}
+    void Test();
+private:
+    static const TUint kNumFiring = 20000;
+    static const TUint kNumMoved = 5000;
+    static const TUint kNumCancelled = 20000;
+    static const TUint kPeriodMs = 3000;
+    Environment& iEnv;
+};
+
+void SuiteTimerScale::Test()
+{
+    ScaleTimer** firing = new ScaleTimer*[kNumFiring];
+    ScaleTimer** cancelled = new ScaleTimer*[kNumCancelled];
+    TUint i;
+    for (i=0; i<kNumFiring; i++) {
+        firing[i] = new ScaleTimer(iEnv);
+    }
+    for (i=0; i<kNumCancelled; i++) {
+        cancelled[i] = new ScaleTimer(iEnv);
+    }
+
+    Print("Firing %u timers over %u seconds with %u long timers pending\n", kNumFiring, kPeriodMs/1000, kNumCancelled);
+    TUint start = Time::Now(iEnv);
+    for (i=0; i<kNumCancelled; i++) {
+        // spread across the upper levels of the wheel, from 10 seconds up to ~20 days ahead
+        TUint delay = 10000 + iEnv.Random(20 * 24 * 60 * 60) * (1 + iEnv.Random(1000));
+        cancelled[i]->FireAt(start + delay);
+    }
+    for (i=0; i<kNumFiring; i++) {
+        // timers which will be moved start too late to fire before they are rescheduled
+        TUint delay = (i < kNumMoved? kPeriodMs : 0) + iEnv.Random(kPeriodMs);
+        firing[i]->FireAt(start + delay);
+    }
+    for (i=0; i<kNumMoved; i++) {
+        firing[i]->FireAt(start + iEnv.Random(kPeriodMs));
+    }
+    TUint elapsed = Time::Now(iEnv) - start;
+    Print("Scheduled timers in %ums\n", elapsed);
+
+    Thread::Sleep(kPeriodMs + 1000);
+
+    TUint maxLateness = 0;
+    TBool early = false;
+    TUint notOnce = 0;
+    for (i=0; i<kNumFiring; i++) {
+        if (firing[i]->Count() != 1) {
+            notOnce++;
+        }
+        if (firing[i]->Early()) {
+            early = true;
+        }
+        if (firing[i]->Lateness() > maxLateness) {
+            maxLateness = firing[i]->Lateness();
+        }
+    }
+    TEST(notOnce == 0);
+    TEST(!early);
+    TEST(maxLateness < 1000);
+    Print("Maximum lateness %ums\n", maxLateness);
+
+    TUint premature = 0;
+    start = Time::Now(iEnv);
+    for (i=0; i<kNumCancelled; i++) {
+        premature += cancelled[i]->Count();
+        cancelled[i]->Cancel();
+    }
+    elapsed = Time::Now(iEnv) - start;
+    TEST(premature == 0);
+    Print("Cancelled timers in %ums\n", elapsed);
+
+    for (i=0; i<kNumFiring; i++) {
+        delete firing[i];
+    }
+    for (i=0; i<kNumCancelled; i++) {
+        delete cancelled[i];
+    }
+    delete[] firing;
+    delete[] cancelled;
+}
+
+// Checks callbacks dispatched to worker threads (InitialisationParams::SetNumTimerThreads())
+
+class SuiteTimerWorkers : public Suite, private INonCopyable
+{
+public:
+    SuiteTimerWorkers(Environment& aEnv);
+    void Test();
+private:
+    void SlowExpired();
+    void FastExpired();
+    void RepeatExpired();
+    void CrossExpiredA();
+    void CrossExpiredB();
+private:
+    static const TUint kSlowMs = 1000;
+    static const TUint kRepeats = 50;
+    Environment& iEnv;
+    Mutex iLock;
+    Timer iSlow;
+    Timer iFast;
+    Timer iRepeat;
+    Timer iCrossA;
+    Timer iCrossB;
+    Semaphore iFastSem;
+    Semaphore iRepeatSem;
+    Semaphore iCrossSemA;
+    Semaphore iCrossSemB;
+    Semaphore iCrossDone;
+    TBool iSlowCompleted;
+    TUint iFastTime;
+    TUint iRepeatCount;
+    TUint iRepeatActive;
+    TBool iRepeatOverlapped;
+};
+
+SuiteTimerWorkers::SuiteTimerWorkers(Environment& aEnv)
+    : Suite("Timer worker thread testing")
+    , iEnv(aEnv)
+    , iLock("STWL")
+    , iSlow(aEnv, MakeFunctor(*this, &SuiteTimerWorkers::SlowExpired))
+    , iFast(aEnv, MakeFunctor(*this, &SuiteTimerWorkers::FastExpired))
+    , iRepeat(aEnv, MakeFunctor(*this, &SuiteTimerWorkers::RepeatExpired))
+    , iCrossA(aEnv, MakeFunctor(*this, &SuiteTimerWorkers::CrossExpiredA))
+    , iCrossB(aEnv, MakeFunctor(*this, &SuiteTimerWorkers::CrossExpiredB))
+    , iFastSem("STWF", 0)
+    , iRepeatSem("STWR", 0)
+    , iCrossSemA("STWA", 0)
+    , iCrossSemB("STWB", 0)
+    , iCrossDone("STWD", 0)
+    , iSlowCompleted(false)
+    , iFastTime(0)
+    , iRepeatCount(0)
+    , iRepeatActive(0)
+    , iRepeatOverlapped(false)
+{
+}
+
+void SuiteTimerWorkers::SlowExpired()
+{
+    Thread::Sleep(kSlowMs);
+    iSlowCompleted = true;
+}
+
+void SuiteTimerWorkers::FastExpired()
+{
+    iFastTime = Time::Now(iEnv);
+    iFastSem.Signal();
+}
+
+void SuiteTimerWorkers::RepeatExpired()
+{
+    iLock.Wait();
+    if (++iRepeatActive > 1) {
+        iRepeatOverlapped = true;
+    }
+    iLock.Signal();
+    // re-arm immediately; the next callback mustn't start until this one returns
+    if (++iRepeatCount < kRepeats) {
+        iRepeat.FireIn(0);
+    }
+    Thread::Sleep(5);
+    iLock.Wait();
+    iRepeatActive--;
+    iLock.Signal();
+    if (iRepeatCount == kRepeats) {
+        iRepeatSem.Signal();
+    }
+}
+
+void SuiteTimerWorkers::CrossExpiredA()
+{
+    // wait until B's callback is also running then cancel B
+    iCrossSemA.Signal();
+    iCrossSemB.Wait();
+    iCrossB.Cancel();
+    iCrossDone.Signal();
+}
+
+void SuiteTimerWorkers::CrossExpiredB()
+{
+    iCrossSemB.Signal();
+    iCrossSemA.Wait();
+    iCrossA.Cancel();
+    iCrossDone.Signal();
+}
+
+void SuiteTimerWorkers::Test()
+{
+    Print("Slow callback doesn't delay other timers\n");
+    TUint start = Time::Now(iEnv);
+    iSlow.FireIn(50);
+    iFast.FireIn(100);
+    iFastSem.Wait();
+    TEST(iFastTime - start < kSlowMs);
+    TEST(!iSlowCompleted);
+
+    Print("Cancel waits for a running callback\n");
+    iSlow.Cancel();
+    TEST(iSlowCompleted);
+
+    Print("A timer's callbacks don't overlap\n");
+    iRepeat.FireIn(0);
+    iRepeatSem.Wait();
+    TEST(iRepeatCount == kRepeats);
+    TEST(!iRepeatOverlapped);
+
+    Print("Callbacks can cancel each other's timers\n");
+    iCrossA.FireIn(0);
+    iCrossB.FireIn(0);
+    iCrossDone.Wait();
+    iCrossDone.Wait();
+    TEST(true); // would have deadlocked
+}
+
 class TimerTestThread : public Thread
 {
 public:
-    TimerTestThread(Environment& aEnv);
+    TimerTestThread(Environment& aEnv, TBool aWorkers);
     void Run();
 private:
     Environment& iEnv;
+    TBool iWorkers;
 };
 
-TimerTestThread::TimerTestThread(Environment& aEnv)
+TimerTestThread::TimerTestThread(Environment& aEnv, TBool aWorkers)
     : Thread("MAIN", kPriorityNormal)
     , iEnv(aEnv)
+    , iWorkers(aWorkers)
 {
 }
 
 void TimerTestThread::Run()
 {
     //Debug::SetLevel(Debug::kTimer);
-    Runner runner("Timer testing\n");
-    runner.Add(new SuiteTimerBasic(iEnv));
-    runner.Add(new SuiteTimerThrash(iEnv));
-    runner.Run();
+    if (iWorkers) {
+        Runner runner("Timer testing (worker threads)\n");
+        runner.Add(new SuiteTimerWorkers(iEnv));
+        runner.Add(new SuiteTimerScale(iEnv));
+        runner.Run();
+    }
+    else {
+        Runner runner("Timer testing\n");
+        runner.Add(new SuiteTimerBasic(iEnv));
+        runner.Add(new SuiteTimerThrash(iEnv));
+        runner.Add(new SuiteTimerScale(iEnv));
+        runner.Run();
+    }
     Signal();
 }
 
 void TestTimer(Environment& aEnv)
 {
-    Thread* th = new TimerTestThread(aEnv);
+    Thread* th = new TimerTestThread(aEnv, false);
+    th->Start();
+    th->Wait();
+    delete th;
+}
+
+void TestTimerWorkers(Environment& aEnv)
+{
+    Thread* th = new TimerTestThread(aEnv, true);
     th->Start();
     th->Wait();
     delete th;
@@ -4,10 +4,17 @@
 using namespace OpenHome;
 
 extern void TestTimer(Environment& aEnv);
+extern void TestTimerWorkers(Environment& aEnv);
 
 void OpenHome::TestFramework::Runner::Main(TInt /*aArgc*/, TChar* /*aArgv*/[], Net::InitialisationParams* aInitParams)
 {
     Net::Library* lib = new Net::Library(aInitParams);
     TestTimer(lib->Env());
     delete lib;
+
+    Net::InitialisationParams* initParams = Net::InitialisationParams::Create();
+    initParams->SetNumTimerThreads(4);
+    lib = new Net::Library(initParams);
+    TestTimerWorkers(lib->Env());
+    delete lib;
 }
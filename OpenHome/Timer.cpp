@@ -40,6 +40,16 @@ TInt Time::TimeToWaitFor(Environment& aEnv, TUint aTime)
     return (aTime - Os::TimeInMs(aEnv.OsCtx()));
 }
 
+// TimerWheelEntry
+
+TimerWheelEntry::TimerWheelEntry()
+    : iTime(0)
+    , iNext(NULL)
+    , iPrev(NULL)
+    , iList(0)
+{
+}
+
 // Timer
 
 Timer::Timer(Environment& aEnv, Functor aFunctor)
@@ -58,7 +68,6 @@ void Timer::FireIn(TUint aTime)
 void Timer::FireAt(TUint aTime)
 {
     LOG(kTimer, ">Timer::FireAt(%d)\n", aTime);
-    iMgr.Remove(*this);
     iTime = aTime;
     iMgr.Add(*this);
     LOG(kTimer, "<Timer::FireAt(%d)\n", aTime);
@@ -67,14 +76,7 @@ void Timer::FireAt(TUint aTime)
 void Timer::Cancel()
 {
     LOG(kTimer, ">Timer::Cancel()\n");
-    TBool lock = !IsInManagerThread(iMgr);
-    if (lock) {
-        iMgr.CallbackLock();
-    }
-    iMgr.Remove(*this);
-    if (lock) {
-        iMgr.CallbackUnlock();
-    }
+    iMgr.Cancel(*this, false);
     LOG(kTimer, "<Timer::Cancel()\n");
 }
 
@@ -85,29 +87,71 @@ TBool Timer::IsInManagerThread(OpenHome::Environment& aEnv)
 
 TBool Timer::IsInManagerThread(TimerManager& aMgr)
 { // static
-    return (Thread::Current() == aMgr.MgrThread());
+    return aMgr.IsInCallbackThread();
 }
 
 Timer::~Timer()
 {
-    Cancel();
+    iMgr.Cancel(*this, true);
+}
+
+// TimerManager::Worker
+
+TimerManager::Worker::Worker(TimerManager& aMgr, const TChar* aName)
+    : iMgr(aMgr)
+    , iTimer(NULL)
+    , iDone("TMWD", 0)
+    , iWaiters(0)
+{
+    iThread = new ThreadFunctor(aName, MakeFunctor(*this, &TimerManager::Worker::Run), kPriorityHigh);
+    iThread->Start();
+}
+
+TimerManager::Worker::~Worker()
+{
+    delete iThread;
+}
+
+void TimerManager::Worker::Run()
+{
+    iMgr.RunWorker(*this);
 }
 
 // TimerManager
 
-TimerManager::TimerManager(Environment& aEnv)
+TimerManager::TimerManager(Environment& aEnv, TUint aNumWorkerThreads)
     : iEnv(aEnv)
-    , iMutexNow("NOWM")
-    , iRemoving(false)
     , iSemaphore("TIMM", 0)
     , iMutex("TIMM")
-    , iNextTimer(0)
+    , iNextWake(0)
+    , iWakeScheduled(false)
     , iStop(false)
     , iStopped("MTS2", 0)
     , iCallbackMutex("TMCB")
     , iThreadHandle(NULL)
+    , iWorkSem("TMWS", 0)
 {
     LOG(kTimer, ">TimerManager::TimerManager()\n");
+    // slots are circular lists with the slot itself as sentinel
+    TUint i;
+    for (i=0; i<kLevel0Slots; i++) {
+        iLevel0[i].iNext = iLevel0[i].iPrev = &iLevel0[i];
+    }
+    for (i=0; i<kLevels-1; i++) {
+        for (TUint j=0; j<kLevelNSlots; j++) {
+            iLevelN[i][j].iNext = iLevelN[i][j].iPrev = &iLevelN[i][j];
+        }
+    }
+    iExpired.iNext = iExpired.iPrev = &iExpired;
+    for (i=0; i<kLevels; i++) {
+        iLevelCount[i] = 0;
+    }
+    iCurrent = Time::Now(iEnv);
+    TChar name[5] = "TMW ";
+    for (i=0; i<aNumWorkerThreads; i++) {
+        name[3] = (TChar)('0' + i%10);
+        iWorkers.push_back(new Worker(*this, name));
+    }
     iThread = new ThreadFunctor("TIMM", MakeFunctor(*this, &TimerManager::Run), kPriorityHigh);
     iThread->Start();
     LOG(kTimer, "<TimerManager::TimerManager()\n");
@@ -118,6 +162,12 @@ TimerManager::~TimerManager()
     LOG(kTimer, ">TimerManager::~TimerManager()\n");
     Stop();
     delete iThread;
+    for (TUint i=0; i<iWorkers.size(); i++) {
+        iWorkSem.Signal();
+    }
+    for (TUint i=0; i<iWorkers.size(); i++) {
+        delete iWorkers[i];
+    }
     LOG(kTimer, "<TimerManager::~TimerManager()\n");
 }
 
@@ -152,109 +202,365 @@ void TimerManager::CallbackUnlock()
     iCallbackMutex.Signal();
 }
 
-// Called when the head item in the base timer queue changes
-// Prime the master timer accordingly, unless this change in the head item
-// is due to us removing already expired items
+void TimerManager::Add(Timer& aTimer)
+{
+    iMutex.Wait();
+    RemoveLocked(aTimer);
+    TUint pending = 0;
+    for (TUint i=0; i<kLevels; i++) {
+        pending += iLevelCount[i];
+    }
+    if (pending == 0) {
+        // nothing to cascade so the wheel can safely skip ahead to the current time
+        TUint now = Time::Now(iEnv);
+        if (Time::IsAfter(now, iCurrent)) {
+            iCurrent = now;
+        }
+    }
+    AddLocked(aTimer);
+    TBool wake = (!iWakeScheduled || Time::IsAfter(iNextWake, aTimer.iTime));
+    if (wake) {
+        iNextWake = aTimer.iTime;
+        iWakeScheduled = true;
+    }
+    iMutex.Signal();
+    if (wake) {
+        iSemaphore.Signal();
+    }
+}
 
-void TimerManager::HeadChanged(QueueSortedEntry& aEntry)
+void TimerManager::Remove(Timer& aTimer)
 {
-    LOG(kTimer, ">TimerManager::HeadChanged()\n", iRemoving);
+    iMutex.Wait();
+    RemoveLocked(aTimer);
+    iMutex.Signal();
+}
 
-    if(IsTail(aEntry)) {
-        LOG(kTimer, "<TimerManager::HeadChanged() queue is empty\n");
+void TimerManager::Cancel(Timer& aTimer, TBool aDestroying)
+{
+    if (iWorkers.size() == 0) {
+        TBool lock = !IsInCallbackThread();
+        if (lock) {
+            CallbackLock();
+        }
+        Remove(aTimer);
+        if (lock) {
+            CallbackUnlock();
+        }
         return;
     }
 
-    iMutexNow.Wait();
+    // A callback can't wait for its own completion.  It mustn't wait for another timer's
+    // callback either; two callbacks cancelling each other's timers would deadlock.
+    const TBool inCallback = IsInCallbackThread();
+    iMutex.Wait();
+    RemoveLocked(aTimer);
+    for (;;) {
+        Worker* worker = RunningWorkerLocked(aTimer);
+        if (worker == NULL) {
+            break;
+        }
+        if (inCallback) {
+            if (aDestroying) {
+                worker->iTimer = NULL;
+            }
+            break;
+        }
+        worker->iWaiters++;
+        iMutex.Signal();
+        worker->iDone.Wait();
+        iMutex.Wait();
+    }
+    iMutex.Signal();
+}
 
-    if (!iRemoving) {
-        iMutexNow.Signal();
+TBool TimerManager::IsInCallbackThread() const
+{
+    Thread* current = Thread::Current();
+    if (current == iThreadHandle) {
+        return true;
+    }
+    for (TUint i=0; i<iWorkers.size(); i++) {
+        if (current == iWorkers[i]->iThread) {
+            return true;
+        }
+    }
+    return false;
+}
+
+TimerManager::Worker* TimerManager::RunningWorkerLocked(const Timer& aTimer) const
+{
+    for (TUint i=0; i<iWorkers.size(); i++) {
+        if (iWorkers[i]->iTimer == &aTimer) {
+            return iWorkers[i];
+        }
+    }
+    return NULL;
+}
+
+// Return the first expired timer whose callback isn't already running.
+// Any others are left queued until their earlier callback completes.
+
+Timer* TimerManager::NextDispatchableLocked() const
+{
+    for (TimerWheelEntry* entry = iExpired.iNext; entry != &iExpired; entry = entry->iNext) {
+        Timer* timer = static_cast<Timer*>(entry);
+        if (RunningWorkerLocked(*timer) == NULL) {
+            return timer;
+        }
+    }
+    return NULL;
+}
+
+void TimerManager::RunWorker(Worker& aWorker)
+{
+    iMutex.Wait();
+    for (;;) {
+        iMutex.Signal();
+        iWorkSem.Wait();
         iMutex.Wait();
-        iNextTimer = Entry(aEntry).iTime;
+        if (iStop) {
+            break;
+        }
+        Timer* timer = NextDispatchableLocked();
+        if (timer == NULL) {
+            continue;
+        }
+        RemoveLocked(*timer);
+        aWorker.iTimer = timer;
         iMutex.Signal();
-        iSemaphore.Signal();
-        LOG(kTimer, "<TimerManager::HeadChanged() retrigger timer\n");
-        return;
+        timer->iFunctor(); // run the timer's callback
+        iMutex.Wait();
+        aWorker.iTimer = NULL;
+        while (aWorker.iWaiters > 0) {
+            aWorker.iWaiters--;
+            aWorker.iDone.Signal();
+        }
+        if (iExpired.iNext != &iExpired) {
+            // a callback for another firing of the timer we just ran may have been held back
+            iWorkSem.Signal();
+        }
     }
+    iMutex.Signal();
+}
 
-    if (&aEntry == &iNow) {
-        iRemoving = false;
+void TimerManager::AddLocked(TimerWheelEntry& aEntry)
+{
+    const TUint offset = aEntry.iTime - iCurrent;
+    if ((TInt)offset < 0) {
+        // already expired; fire on the next tick
+        Link(aEntry, 0, iCurrent & (kLevel0Slots - 1));
     }
+    else if (offset < kLevel0Slots) {
+        Link(aEntry, 0, aEntry.iTime & (kLevel0Slots - 1));
+    }
+    else {
+        TUint level = 1;
+        while (level < kLevels-1 && offset >= (1u << (Shift(level) + kLevelNBits))) {
+            level++;
+        }
+        Link(aEntry, level, (aEntry.iTime >> Shift(level)) & (kLevelNSlots - 1));
+    }
+}
 
-    iMutexNow.Signal();
-
-    LOG(kTimer, "<TimerManager::HeadChanged() while removing\n");
+void TimerManager::RemoveLocked(TimerWheelEntry& aEntry)
+{
+    if (aEntry.iNext == NULL) { // ignore if not queued
+        return;
+    }
+    aEntry.iPrev->iNext = aEntry.iNext;
+    aEntry.iNext->iPrev = aEntry.iPrev;
+    aEntry.iNext = aEntry.iPrev = NULL;
+    if (aEntry.iList < kLevels) {
+        iLevelCount[aEntry.iList]--;
+    }
+    aEntry.iList = kListNone;
 }
 
-// Fire expired timers
-//
-// This is achieved by inserting a dummy entry that represents 'now' into the sorted timer queue,
-// then removing head items until we reach this 'now' item. All queue entries removed during this process
-// represent expired timers.
-//
-// Note that during this process any change to the head item in the queue does does not cause the master timer
-// to be retriggered. (See HeadChanged) 
+void TimerManager::Link(TimerWheelEntry& aEntry, TUint aList, TUint aIndex)
+{
+    TimerWheelEntry& list = (aList == kListExpired? iExpired : Slot(aList, aIndex));
+    aEntry.iNext = &list;
+    aEntry.iPrev = list.iPrev;
+    list.iPrev->iNext = &aEntry;
+    list.iPrev = &aEntry;
+    aEntry.iList = aList;
+    if (aList < kLevels) {
+        iLevelCount[aList]++;
+    }
+}
 
-void TimerManager::Fire()
+TimerWheelEntry& TimerManager::Slot(TUint aLevel, TUint aIndex)
 {
-    TUint now = Os::TimeInMs(iEnv.OsCtx());
-    iMutexNow.Wait();
-    iRemoving = true;
-    iNow.iTime = now + 1; // will go after all the entries before or at now
-    iMutexNow.Signal();
+    return (aLevel == 0? iLevel0[aIndex] : iLevelN[aLevel-1][aIndex]);
+}
 
-    // Add an entry for now, then ...
+const TimerWheelEntry& TimerManager::Slot(TUint aLevel, TUint aIndex) const
+{
+    return (aLevel == 0? iLevel0[aIndex] : iLevelN[aLevel-1][aIndex]);
+}
 
-    DoAdd(iNow);
-    
-    LOG(kTimer, "-TimerManager::Fire() - TimerExpired, removing entries before %d\n", iNow.iTime);
+TUint TimerManager::Shift(TUint aLevel)
+{ // static
+    return (aLevel == 0? 0 : kLevel0Bits + (aLevel - 1) * kLevelNBits);
+}
 
-    // remove all the entries before now
-    // See HeadChanged() for how iRemoving gets turned off
-    // Note that it has to be done this way so that the first
-    // item to become the head after the dummy now entry has
-    // been removed gets to prime the timer driver
+// Find the earliest time at which the wheel has work to do: either a level 0 slot
+// with timers to fire or a higher level slot due to be cascaded.  Nothing happens
+// before this time so the wheel can safely advance straight to it.
 
-    CallbackLock();
-    for (;;) {
-        Timer& head = RemoveHead();
-        if(&head == &iNow) {
-            LOG(kTimer, "-TimerManager::Fire() done signalling\n");
-            break;
+TBool TimerManager::NextEventLocked(TUint& aTime) const
+{
+    TBool found = false;
+    TUint best = 0; // offset from iCurrent
+    TUint i;
+    if (iLevelCount[0] > 0) {
+        for (i=0; i<kLevel0Slots; i++) {
+            const TimerWheelEntry& slot = iLevel0[(iCurrent + i) & (kLevel0Slots - 1)];
+            if (slot.iNext != &slot) {
+                best = i;
+                found = true;
+                break;
+            }
+        }
+    }
+    for (TUint level=1; level<kLevels; level++) {
+        if (iLevelCount[level] == 0) {
+            continue;
+        }
+        const TUint shift = Shift(level);
+        const TUint size = 1u << shift;
+        const TUint first = (iCurrent + size - 1) & ~(size - 1);
+        for (i=0; i<kLevelNSlots; i++) {
+            const TUint time = first + i * size;
+            if (found && time - iCurrent >= best) {
+                break;
+            }
+            const TimerWheelEntry& slot = Slot(level, (time >> shift) & (kLevelNSlots - 1));
+            if (slot.iNext != &slot) {
+                best = time - iCurrent;
+                found = true;
+                break;
+            }
         }
-        head.iFunctor(); // run the timer's callback
-        LOG(kTimer, "-TimerManager::Fire() signaling consumer\n");
     }
-    CallbackUnlock();
+    aTime = iCurrent + best;
+    return found;
 }
 
-Thread* TimerManager::MgrThread() const
+void TimerManager::Cascade(TUint aLevel, TUint aIndex)
 {
-    return iThreadHandle;
+    TimerWheelEntry& slot = Slot(aLevel, aIndex);
+    while (slot.iNext != &slot) {
+        TimerWheelEntry& entry = *slot.iNext;
+        RemoveLocked(entry);
+        AddLocked(entry);
+    }
 }
 
-TInt TimerManager::Compare(QueueSortedEntry& aEntry1, QueueSortedEntry& aEntry2)
+// Process the millisecond iCurrent, running the callbacks of all timers due then
+// (or passing them to the worker threads).
+// Called with iMutex held; this is released while each callback runs.
+
+void TimerManager::Tick()
 {
-    return (Entry(aEntry1).iTime - Entry(aEntry2).iTime);
+    const TUint index = iCurrent & (kLevel0Slots - 1);
+    if (index == 0) {
+        for (TUint level=1; level<kLevels; level++) {
+            const TUint levelIndex = (iCurrent >> Shift(level)) & (kLevelNSlots - 1);
+            Cascade(level, levelIndex);
+            if (levelIndex != 0) {
+                break;
+            }
+        }
+    }
+    TimerWheelEntry& slot = iLevel0[index];
+    TUint expired = 0;
+    while (slot.iNext != &slot) {
+        TimerWheelEntry& entry = *slot.iNext;
+        RemoveLocked(entry);
+        Link(entry, kListExpired, 0);
+        expired++;
+    }
+    // advance before running callbacks so that any timers they set for now or
+    // earlier are added to the next tick rather than the one being processed
+    iCurrent++;
+    if (iWorkers.size() > 0) {
+        while (expired-- > 0) {
+            iWorkSem.Signal();
+        }
+        return;
+    }
+    while (iExpired.iNext != &iExpired) {
+        Timer& timer = static_cast<Timer&>(*iExpired.iNext);
+        RemoveLocked(timer);
+        iMutex.Signal();
+        timer.iFunctor(); // run the timer's callback
+        iMutex.Wait();
+    }
+}
+
+// Fire expired timers
+//
+// The wheel is advanced directly from one event to the next until it reaches the current time.
+// Callbacks are run with the callback lock held so that Timer::Cancel() can't complete
+// while its timer's callback is running.
+
+void TimerManager::Fire()
+{
+    const TBool callbacks = (iWorkers.size() == 0);
+    if (callbacks) {
+        CallbackLock();
+    }
+    iMutex.Wait();
+    const TUint now = Time::Now(iEnv);
+    LOG(kTimer, "-TimerManager::Fire() - firing entries up to %d\n", now);
+    for (;;) {
+        TUint next;
+        if (!NextEventLocked(next) || Time::IsAfter(next, now)) {
+            break;
+        }
+        iCurrent = next;
+        Tick();
+    }
+    if (Time::IsAfter(now, iCurrent)) {
+        iCurrent = now;
+    }
+    iMutex.Signal();
+    if (callbacks) {
+        CallbackUnlock();
+    }
 }
 
 void TimerManager::Run()
 {
     iThreadHandle = Thread::Current();
-    iSemaphore.Wait();
     iMutex.Wait();
     while (!iStop) {
-        TInt delay = Time::TimeToWaitFor(iEnv, iNextTimer);
-        iMutex.Signal();
-        if (delay <= 0) { // in the past or now
-            Fire();
+        TUint next;
+        if (!NextEventLocked(next)) {
+            iWakeScheduled = false;
+            iMutex.Signal();
             iSemaphore.Wait();
         }
-        else { // in the future
-            try {
-                iSemaphore.Wait(delay);
+        else {
+            TInt delay = Time::TimeToWaitFor(iEnv, next);
+            if (delay > (TInt)kMaxWaitMs) {
+                delay = kMaxWaitMs;
             }
-            catch (Timeout&) {
+            iNextWake = Time::Now(iEnv) + delay;
+            iWakeScheduled = true;
+            iMutex.Signal();
+            if (delay <= 0) { // in the past or now
+                Fire();
+            }
+            else { // in the future
+                try {
+                    iSemaphore.Wait(delay);
+                }
+                catch (Timeout&) {
+                    Fire();
+                }
             }
         }
         iMutex.Wait();
@@ -262,4 +568,3 @@ void TimerManager::Run()
     iMutex.Signal();
     iStopped.Signal();
 }
-
@@ -3,10 +3,11 @@
 
 #include <OpenHome/Private/Standard.h>
 #include <OpenHome/OhNetTypes.h>
-#include <OpenHome/Private/Queue.h>
 #include <OpenHome/Private/Thread.h>
 #include <OpenHome/Functor.h>
 
+#include <vector>
+
 namespace OpenHome {
 
 class Environment;
@@ -22,16 +23,22 @@ public:
     static TInt TimeToWaitFor(Environment& aEnv, TUint aTime);
 };
 
-class QueueSortedEntryTimer : public QueueSortedEntry
+class TimerWheelEntry : public INonCopyable
 {
     friend class TimerManager;
+protected:
+    TimerWheelEntry();
 protected:
     TUint iTime;  // Absolute (milliseconds from startup)
+private:
+    TimerWheelEntry* iNext;
+    TimerWheelEntry* iPrev;
+    TUint iList;  // index of the TimerManager list this entry is in
 };
 
 class TimerManager;
 
-class Timer : public QueueSortedEntryTimer
+class Timer : public TimerWheelEntry
 {
     friend class TimerManager;
 public:
@@ -48,34 +55,90 @@ private:
     Functor iFunctor;
 };
 
-class TimerManager : public QueueSorted<Timer>
+// TimerManager holds pending timers in a hierarchical timer wheel.
+//
+// Level 0 has one slot per millisecond for the next 256ms.  Each further level has 64 slots,
+// each covering a whole rotation of the level below.  Timers are added to the lowest level
+// whose range covers them and moved down a level (cascaded) as the wheel turns, so adding or
+// cancelling a timer is constant time regardless of the number of timers pending.
+//
+// Expired timers' callbacks are run either by the manager's own thread or, if aNumWorkerThreads
+// is non-zero, by a pool of worker threads.  In the latter case a slow callback only delays
+// other timers once all workers are busy.  Each timer's callbacks are still run in order, one
+// at a time, and Cancel() waits for any callback of that timer (only) which is running.
+// Cancel() doesn't wait when called from a timer callback, so a callback which cancels (or
+// deletes) another timer must not assume that timer's callback has finished.
+
+class TimerManager : public INonCopyable
 {
     friend class Timer;
 public:
-    TimerManager(Environment& aEnv);
+    TimerManager(Environment& aEnv, TUint aNumWorkerThreads);
     void Stop();
     ~TimerManager();
     void CallbackLock();
     void CallbackUnlock();
 private:
+    class Worker : public INonCopyable
+    {
+    public:
+        Worker(TimerManager& aMgr, const TChar* aName);
+        ~Worker();
+    private:
+        void Run();
+    public:
+        TimerManager& iMgr;
+        OpenHome::Thread* iThread;
+        Timer* iTimer;      // timer whose callback is running, NULL if idle
+        Semaphore iDone;    // signalled to each thread waiting for iTimer's callback to complete
+        TUint iWaiters;
+    };
+private:
+    void Add(Timer& aTimer);
+    void Remove(Timer& aTimer);
+    void Cancel(Timer& aTimer, TBool aDestroying);
+    TBool IsInCallbackThread() const;
+    Worker* RunningWorkerLocked(const Timer& aTimer) const;
+    Timer* NextDispatchableLocked() const;
+    void RunWorker(Worker& aWorker);
+    void AddLocked(TimerWheelEntry& aEntry);
+    void RemoveLocked(TimerWheelEntry& aEntry);
+    void Link(TimerWheelEntry& aEntry, TUint aList, TUint aIndex);
+    TimerWheelEntry& Slot(TUint aLevel, TUint aIndex);
+    const TimerWheelEntry& Slot(TUint aLevel, TUint aIndex) const;
+    static TUint Shift(TUint aLevel);
+    TBool NextEventLocked(TUint& aTime) const;
+    void Cascade(TUint aLevel, TUint aIndex);
+    void Tick();
     void Run();
     void Fire();
-    Thread* MgrThread() const;
-    virtual void HeadChanged(QueueSortedEntry& aEntry);
-    virtual TInt Compare(QueueSortedEntry& aEntry1, QueueSortedEntry& aEntry2);
+private:
+    static const TUint kLevels = 5;
+    static const TUint kLevel0Bits = 8;
+    static const TUint kLevel0Slots = 1 << kLevel0Bits;
+    static const TUint kLevelNBits = 6;
+    static const TUint kLevelNSlots = 1 << kLevelNBits;
+    static const TUint kListExpired = kLevels;
+    static const TUint kListNone = kLevels + 1;
+    static const TUint kMaxWaitMs = 10 * 60 * 1000; // bounds how far iCurrent can lag the clock
 private:
     Environment& iEnv;
-    QueueSortedEntryTimer iNow;
-    Mutex iMutexNow;
-    TBool iRemoving;
     ThreadFunctor* iThread;
     Semaphore iSemaphore;
     Mutex iMutex;
-    TUint iNextTimer;
+    TimerWheelEntry iLevel0[kLevel0Slots];
+    TimerWheelEntry iLevelN[kLevels-1][kLevelNSlots];
+    TimerWheelEntry iExpired;
+    TUint iLevelCount[kLevels];
+    TUint iCurrent;     // first millisecond not yet processed
+    TUint iNextWake;
+    TBool iWakeScheduled;
     TBool iStop;
     Semaphore iStopped;
     Mutex iCallbackMutex;
     Thread* iThreadHandle;
+    std::vector<Worker*> iWorkers;
+    Semaphore iWorkSem;
 };
 
 } // namespace OpenHome
@@ -425,6 +425,21 @@ int32_t OsNetworkConnect(THandle aHandle, TIpAddress aAddress, uint16_t aPort, u
  */
 int32_t OsNetworkSend(THandle aHandle, const uint8_t* aBuffer, uint32_t aBytes);
 
+/**
+ * Send data, gathered from a number of buffers, to the endpoint we're OsNetworkConnect()ed to
+ *
+ * This is equivalent to the BSD sendmsg() (or writev()) function.  The buffers are sent
+ * in order, as if each had been passed to OsNetworkSend() in turn.
+ *
+ * @param[in] aHandle      Socket handle returned from OsNetworkCreate()
+ * @param[in] aBuffers     Array of aCount buffers to send
+ * @param[in] aBytes       Array of aCount lengths, one per element of 'aBuffers'
+ * @param[in] aCount       Number of buffers to send
+ *
+ * @return  total number of bytes sent on success; -1 on failure
+ */
+int32_t OsNetworkSendMultiple(THandle aHandle, const uint8_t** aBuffers, const uint32_t* aBytes, uint32_t aCount);
+
 /**
  * Send data to the specified endpoint
  *
@@ -468,6 +483,48 @@ int32_t OsNetworkReceive(THandle aHandle, uint8_t* aBuffer, uint32_t aBytes);
  */
 int32_t OsNetworkReceiveFrom(THandle aHandle, uint8_t* aBuffer, uint32_t aBytes, TIpAddress* aAddress, uint16_t* aPort);
 
+/**
+ * Send a number of datagrams to the same endpoint
+ *
+ * This is equivalent to the Linux sendmmsg() function.  Platforms which do not
+ * support batched sends should send each datagram in turn.
+ *
+ * @param[in] aHandle      Socket handle returned from OsNetworkCreate()
+ * @param[in] aBuffers     Array of aCount datagrams to send
+ * @param[in] aBytes       Array of aCount lengths, one per element of 'aBuffers'
+ * @param[in] aCount       Number of datagrams to send
+ * @param[in] aAddress     IpV4 address (in network byte order) to send to
+ * @param[in] aPort        Port [0..65535] to send to
+ *
+ * @return  number of datagrams sent (0..aCount) on success; -1 if none could be sent
+ */
+int32_t OsNetworkSendToMultiple(THandle aHandle, const uint8_t** aBuffers, const uint32_t* aBytes, uint32_t aCount, TIpAddress aAddress, uint16_t aPort);
+
+/**
+ * Receive 1..aCount datagrams, setting the sender of each
+ *
+ * Blocks until at least one datagram is available then also returns any others
+ * which are already queued, without waiting for them.  This is equivalent to the
+ * Linux recvmmsg() function.  Platforms which do not support batched receives may
+ * return a single datagram.
+ *
+ * @param[in]  aHandle     Socket handle returned from OsNetworkCreate()
+ * @param[out] aBuffer     Buffer of aCount*aBytesPerDatagram bytes.  Datagram i is
+ *                         received into the aBytesPerDatagram bytes at offset
+ *                         i*aBytesPerDatagram.  Must have been allocated by the caller
+ * @param[in]  aBytesPerDatagram  Maximum number of bytes of each datagram
+ * @param[in]  aCount      Maximum number of datagrams to receive
+ * @param[out] aReceived   Array of aCount.  Set to the number of bytes of each datagram
+ * @param[out] aAddresses  Array of aCount.  Set to the IpV4 address (in network byte order)
+ *                         each datagram was received from
+ * @param[out] aPorts      Array of aCount.  Set to the port [0..65535] each datagram was
+ *                         received from
+ *
+ * @return  number of datagrams received (1..aCount) on success; -1 on failure
+ */
+int32_t OsNetworkReceiveFromMultiple(THandle aHandle, uint8_t* aBuffer, uint32_t aBytesPerDatagram, uint32_t aCount,
+                                     uint32_t* aReceived, TIpAddress* aAddresses, uint16_t* aPorts);
+
 /**
  * Stop a socket's send/receive operations, interrupting any pending request.
  *
@@ -521,6 +578,85 @@ int32_t OsNetworkListen(THandle aHandle, uint32_t aSlots);
  */
 THandle OsNetworkAccept(THandle aHandle, TIpAddress* aClientAddress, uint32_t* aClientPort);
 
+/**
+ * Check, without blocking, whether a connected socket has data to read or has been
+ * closed (or reset) by its peer.
+ *
+ * @param[in] aHandle      Socket handle returned from OsNetworkCreate() or OsNetworkAccept()
+ *
+ * @return  1 if the socket is readable or closed; 0 if not; -1 on failure
+ */
+int32_t OsNetworkReadable(THandle aHandle);
+
+/**
+ * Create a readiness poller, allowing a single thread to wait for any of a large
+ * number of sockets to become readable.
+ *
+ * Support for pollers is optional.  Platforms which do not support them should
+ * return kHandleNull; callers are then expected to fall back to blocking
+ * operations on each socket.
+ *
+ * @param[in] aContext     Returned from OsCreate().
+ *
+ * @return  a valid handle on success; kHandleNull if pollers are not supported
+ *          or creation failed.
+ */
+THandle OsNetworkPollCreate(OsContext* aContext);
+
+/**
+ * Destroy a poller.  Sockets registered with the poller are not closed.
+ *
+ * @param[in] aPoll        Handle returned from OsNetworkPollCreate()
+ */
+void OsNetworkPollDestroy(THandle aPoll);
+
+/**
+ * Register interest in a socket becoming readable (or being closed by its peer).
+ *
+ * Registration is one-shot: once OsNetworkPollWait() has reported a socket, it
+ * will not be reported again until this is called again for it.  Calling this for
+ * an already registered socket re-arms it.
+ *
+ * @param[in] aPoll        Handle returned from OsNetworkPollCreate()
+ * @param[in] aSocket      Socket handle returned from OsNetworkCreate() or OsNetworkAccept()
+ * @param[in] aArg         Value reported by OsNetworkPollWait() when aSocket is readable
+ *
+ * @return  0 on success; -1 on failure
+ */
+int32_t OsNetworkPollAdd(THandle aPoll, THandle aSocket, void* aArg);
+
+/**
+ * Remove a socket from a poller.  Must be called before the socket is closed.
+ *
+ * @param[in] aPoll        Handle returned from OsNetworkPollCreate()
+ * @param[in] aSocket      Socket handle previously passed to OsNetworkPollAdd()
+ *
+ * @return  0 on success; -1 on failure
+ */
+int32_t OsNetworkPollRemove(THandle aPoll, THandle aSocket);
+
+/**
+ * Block until at least one registered socket is readable, the timeout expires or
+ * OsNetworkPollInterrupt() is called.
+ *
+ * @param[in]  aPoll       Handle returned from OsNetworkPollCreate()
+ * @param[out] aReady      Array which is filled with the aArg values of ready sockets
+ * @param[in]  aMaxReady   Number of elements in aReady
+ * @param[in]  aTimeoutMs  Maximum time to wait.  0 means wait indefinitely.
+ *
+ * @return  number of ready sockets (0 on timeout) on success; -1 on failure or if
+ *          the poller has been interrupted
+ */
+int32_t OsNetworkPollWait(THandle aPoll, void** aReady, uint32_t aMaxReady, uint32_t aTimeoutMs);
+
+/**
+ * Interrupt a poller.  Any pending and all subsequent calls to OsNetworkPollWait()
+ * will fail.
+ *
+ * @param[in] aPoll        Handle returned from OsNetworkPollCreate()
+ */
+void OsNetworkPollInterrupt(THandle aPoll);
+
 /**
  * Convert a string into a IpV4 address
  *
@@ -106,6 +106,83 @@ TInt OpenHome::Os::NetworkReceiveFrom(THandle aHandle, Bwx& aBuffer, Endpoint& a
     return ret;
 }
 
+static const TUint kMaxBuffersPerSend = 16;
+
+TInt OpenHome::Os::NetworkSendMultiple(THandle aHandle, const Brx** aBuffers, TUint aCount)
+{
+    const uint8_t* ptrs[kMaxBuffersPerSend];
+    uint32_t bytes[kMaxBuffersPerSend];
+    TInt sent = 0;
+    TUint index = 0;
+    while (index < aCount) {
+        TUint count = aCount - index;
+        if (count > kMaxBuffersPerSend) {
+            count = kMaxBuffersPerSend;
+        }
+        TUint expected = 0;
+        for (TUint i=0; i<count; i++) {
+            ptrs[i] = aBuffers[index+i]->Ptr();
+            bytes[i] = aBuffers[index+i]->Bytes();
+            expected += bytes[i];
+        }
+        TInt ret = OsNetworkSendMultiple(aHandle, ptrs, bytes, count);
+        if (ret < 0) {
+            return (sent == 0? -1 : sent);
+        }
+        sent += ret;
+        if ((TUint)ret < expected) {
+            break;
+        }
+        index += count;
+    }
+    return sent;
+}
+
+static const TUint kMaxDatagramsPerCall = 32;
+
+TInt OpenHome::Os::NetworkSendToMultiple(THandle aHandle, const Brx** aBuffers, TUint aCount, const Endpoint& aEndpoint)
+{
+    const uint8_t* ptrs[kMaxDatagramsPerCall];
+    uint32_t bytes[kMaxDatagramsPerCall];
+    TInt sent = 0;
+    while ((TUint)sent < aCount) {
+        TUint count = aCount - sent;
+        if (count > kMaxDatagramsPerCall) {
+            count = kMaxDatagramsPerCall;
+        }
+        for (TUint i=0; i<count; i++) {
+            ptrs[i] = aBuffers[sent+i]->Ptr();
+            bytes[i] = aBuffers[sent+i]->Bytes();
+        }
+        TInt ret = OsNetworkSendToMultiple(aHandle, ptrs, bytes, count, aEndpoint.Address(), aEndpoint.Port());
+        if (ret < 0) {
+            return (sent == 0? -1 : sent);
+        }
+        sent += ret;
+        if ((TUint)ret < count) {
+            break;
+        }
+    }
+    return sent;
+}
+
+TInt OpenHome::Os::NetworkReceiveFromMultiple(THandle aHandle, TByte* aBuffer, TUint aBytesPerDatagram, TUint aCount, TUint* aReceived, Endpoint* aEndpoints)
+{
+    TIpAddress addresses[kMaxDatagramsPerCall];
+    uint16_t ports[kMaxDatagramsPerCall];
+    uint32_t received[kMaxDatagramsPerCall];
+    if (aCount > kMaxDatagramsPerCall) {
+        aCount = kMaxDatagramsPerCall;
+    }
+    TInt ret = OsNetworkReceiveFromMultiple(aHandle, (uint8_t*)aBuffer, aBytesPerDatagram, aCount, received, addresses, ports);
+    for (TInt i=0; i<ret; i++) {
+        aReceived[i] = received[i];
+        aEndpoints[i].SetAddress(addresses[i]);
+        aEndpoints[i].SetPort(ports[i]);
+    }
+    return ret;
+}
+
 void OpenHome::Os::NetworkSocketSetSendBufBytes(THandle aHandle, TUint aBytes)
 {
     int32_t err = OsNetworkSocketSetSendBufBytes(aHandle, aBytes);
@@ -50,13 +50,23 @@ public:
     static TInt NetworkPort(THandle aHandle, TUint& aPort);
     static void NetworkConnect(THandle aHandle, const Endpoint& aEndpoint, TUint aTimeoutMs);
     inline static TInt NetworkSend(THandle aHandle, const Brx& aBuffer);
+    static TInt NetworkSendMultiple(THandle aHandle, const Brx** aBuffers, TUint aCount);
     inline static TInt NetworkSendTo(THandle aHandle, const Brx& aBuffer, const Endpoint& aEndpoint);
     inline static TInt NetworkReceive(THandle aHandle, Bwx& aBuffer);
     static TInt NetworkReceiveFrom(THandle aHandle, Bwx& aBuffer, Endpoint& aEndpoint);
+    static TInt NetworkSendToMultiple(THandle aHandle, const Brx** aBuffers, TUint aCount, const Endpoint& aEndpoint);
+    static TInt NetworkReceiveFromMultiple(THandle aHandle, TByte* aBuffer, TUint aBytesPerDatagram, TUint aCount, TUint* aReceived, Endpoint* aEndpoints);
     inline static TInt NetworkInterrupt(THandle aHandle, TBool aInterrupt);
     inline static TInt NetworkClose(THandle aHandle);
     inline static TInt NetworkListen(THandle aHandle, TUint aSlots);
     static THandle NetworkAccept(THandle aHandle, Endpoint& aClient);
+    inline static TInt NetworkReadable(THandle aHandle);
+    inline static THandle NetworkPollCreate(OsContext* aContext);
+    inline static void NetworkPollDestroy(THandle aPoll);
+    inline static TInt NetworkPollAdd(THandle aPoll, THandle aSocket, void* aArg);
+    inline static TInt NetworkPollRemove(THandle aPoll, THandle aSocket);
+    inline static TInt NetworkPollWait(THandle aPoll, void** aReady, TUint aMaxReady, TUint aTimeoutMs);
+    inline static void NetworkPollInterrupt(THandle aPoll);
     static TIpAddress NetworkGetHostByName(const Brx& aAddress);
     static void NetworkSocketSetSendBufBytes(THandle aHandle, TUint aBytes);
     static void NetworkSocketSetRecvBufBytes(THandle aHandle, TUint aBytes);
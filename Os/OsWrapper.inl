@@ -80,6 +80,20 @@ inline TInt Os::NetworkClose(THandle aHandle)
 { return OsNetworkClose(aHandle); }
 inline TInt Os::NetworkListen(THandle aHandle, TUint aSlots)
 { return OsNetworkListen(aHandle, aSlots); }
+inline TInt Os::NetworkReadable(THandle aHandle)
+{ return OsNetworkReadable(aHandle); }
+inline THandle Os::NetworkPollCreate(OsContext* aContext)
+{ return OsNetworkPollCreate(aContext); }
+inline void Os::NetworkPollDestroy(THandle aPoll)
+{ OsNetworkPollDestroy(aPoll); }
+inline TInt Os::NetworkPollAdd(THandle aPoll, THandle aSocket, void* aArg)
+{ return OsNetworkPollAdd(aPoll, aSocket, aArg); }
+inline TInt Os::NetworkPollRemove(THandle aPoll, THandle aSocket)
+{ return OsNetworkPollRemove(aPoll, aSocket); }
+inline TInt Os::NetworkPollWait(THandle aPoll, void** aReady, TUint aMaxReady, TUint aTimeoutMs)
+{ return OsNetworkPollWait(aPoll, aReady, aMaxReady, aTimeoutMs); }
+inline void Os::NetworkPollInterrupt(THandle aPoll)
+{ OsNetworkPollInterrupt(aPoll); }
 void Os::NetworkSetInterfaceChangedObserver(OsContext* aContext, InterfaceListChanged aCallback, void* aArg)
 { OsNetworkSetInterfaceChangedObserver(aContext, aCallback, aArg); }
 
@@ -20,6 +20,7 @@
 #include <string.h>
 #include <sys/types.h>
 #include <sys/select.h>
+#include <poll.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
 #include <net/if.h>
@@ -39,6 +40,8 @@
 #ifdef PLATFORM_MACOSX_GNU
 #include <SystemConfiguration/SystemConfiguration.h>
 #include <execinfo.h>
+#else
+# include <sys/epoll.h>
 #endif
 
 #include <OpenHome/Os.h>
@@ -53,10 +56,7 @@
 do __result = (long int) (expression); \
 while (__result == -1L && errno == EINTR); \
 __result; }))
-# define MAX_FILE_DESCRIPTOR FD_SETSIZE
 # define MSG_NOSIGNAL 0
-#else
-# define MAX_FILE_DESCRIPTOR __FD_SETSIZE
 #endif
 
 struct OsContext {
@@ -589,6 +589,27 @@ static int nfds(const OsNetworkHandle* aHandle)
     return nfds+1;
 }
 
+/* Block until aHandle's socket is ready for aEvents, the socket's interrupt pipe is
+   written to or aTimeoutMs (-1 for no timeout) expires.
+   Returns 1 if the socket is ready (or has an error pending), 0 otherwise.
+   poll() is used in preference to select() so that descriptors above FD_SETSIZE
+   can be waited on. */
+static int32_t WaitForSocket(const OsNetworkHandle* aHandle, short aEvents, int aTimeoutMs)
+{
+    struct pollfd fds[2];
+    fds[0].fd = aHandle->iSocket;
+    fds[0].events = aEvents;
+    fds[0].revents = 0;
+    fds[1].fd = aHandle->iPipe[0];
+    fds[1].events = POLLIN;
+    fds[1].revents = 0;
+    int32_t ret = TEMP_FAILURE_RETRY(poll(fds, 2, aTimeoutMs));
+    if (ret > 0 && (fds[0].revents & (aEvents | POLLERR | POLLHUP)) != 0) {
+        return 1;
+    }
+    return 0;
+}
+
 static void SetFdBlocking(int32_t aSocket)
 {
     uint32_t state = fcntl(aSocket, F_GETFL, 0);
@@ -636,7 +657,7 @@ static OsNetworkHandle* CreateHandle(OsContext* aContext, int32_t aSocket)
     }
     SetFdNonBlocking(handle->iPipe[0]);
     handle->iSocket = aSocket;
-    assert(aSocket >= 0 && aSocket < MAX_FILE_DESCRIPTOR);
+    assert(aSocket >= 0);
     handle->iInterrupted = 0;
     handle->iCtx = aContext;
 
@@ -706,22 +727,7 @@ int32_t OsNetworkConnect(THandle aHandle, TIpAddress aAddress, uint16_t aPort, u
     /* ignore err as we expect this to fail due to EINPROGRESS */
     (void)connect(handle->iSocket, (struct sockaddr*)&addr, sizeof(addr));
 
-    fd_set read;
-    FD_ZERO(&read);
-    FD_SET(handle->iPipe[0], &read);
-    fd_set write;
-    FD_ZERO(&write);
-    FD_SET(handle->iSocket, &write);
-    fd_set error;
-    FD_ZERO(&error);
-    FD_SET(handle->iSocket, &error);
-
-    struct timeval tv;
-    tv.tv_sec = aTimeoutMs / 1000;
-    tv.tv_usec = (aTimeoutMs % 1000) * 1000;
-
-    int32_t selectErr = TEMP_FAILURE_RETRY(select(nfds(handle), &read, &write, &error, &tv));
-    if (selectErr > 0 && FD_ISSET(handle->iSocket, &write)) {
+    if (WaitForSocket(handle, POLLOUT, (int)aTimeoutMs)) {
         err = 0;
     }
     SetFdBlocking(handle->iSocket);
@@ -746,6 +752,47 @@ int32_t OsNetworkSend(THandle aHandle, const uint8_t* aBuffer, uint32_t aBytes)
     return sent;
 }
 
+#define kMaxBuffersPerSend (16)
+
+int32_t OsNetworkSendMultiple(THandle aHandle, const uint8_t** aBuffers, const uint32_t* aBytes, uint32_t aCount)
+{
+    OsNetworkHandle* handle = (OsNetworkHandle*)aHandle;
+    if (SocketInterrupted(handle)) {
+        return -1;
+    }
+
+    struct iovec iov[kMaxBuffersPerSend];
+    struct msghdr msg;
+    int32_t sent = 0;
+    uint32_t index = 0;  /* first buffer not yet completely sent */
+    uint32_t offset = 0; /* bytes from aBuffers[index] already sent */
+    while (index < aCount) {
+        uint32_t count = 0;
+        while (count < kMaxBuffersPerSend && index+count < aCount) {
+            const uint32_t skip = (count == 0? offset : 0);
+            iov[count].iov_base = (void*)(aBuffers[index+count] + skip);
+            iov[count].iov_len = aBytes[index+count] - skip;
+            count++;
+        }
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+        ssize_t bytes = TEMP_FAILURE_RETRY(sendmsg(handle->iSocket, &msg, MSG_NOSIGNAL));
+        if (bytes == -1) {
+            break;
+        }
+        sent += (int32_t)bytes;
+        /* step over whatever was sent; a partial send leaves us part way through a buffer */
+        while (index < aCount && (size_t)bytes >= aBytes[index] - offset) {
+            bytes -= aBytes[index] - offset;
+            index++;
+            offset = 0;
+        }
+        offset += (uint32_t)bytes;
+    }
+    return sent;
+}
+
 int32_t OsNetworkSendTo(THandle aHandle, const uint8_t* aBuffer, uint32_t aBytes, TIpAddress aAddress, uint16_t aPort)
 {
     OsNetworkHandle* handle = (OsNetworkHandle*)aHandle;
@@ -773,18 +820,9 @@ int32_t OsNetworkReceive(THandle aHandle, uint8_t* aBuffer, uint32_t aBytes)
     }
     SetFdNonBlocking(handle->iSocket);
 
-    fd_set read;
-    FD_ZERO(&read);
-    FD_SET(handle->iPipe[0], &read);
-    FD_SET(handle->iSocket, &read);
-    fd_set error;
-    FD_ZERO(&error);
-    FD_SET(handle->iSocket, &error);
-
     int32_t received = TEMP_FAILURE_RETRY(recv(handle->iSocket, aBuffer, aBytes, MSG_NOSIGNAL));
     if (received==-1 && errno==EWOULDBLOCK) {
-        int32_t selectErr = TEMP_FAILURE_RETRY(select(nfds(handle), &read, NULL, &error, NULL));
-        if (selectErr > 0 && FD_ISSET(handle->iSocket, &read)) {
+        if (WaitForSocket(handle, POLLIN, -1)) {
             received = TEMP_FAILURE_RETRY(recv(handle->iSocket, aBuffer, aBytes, MSG_NOSIGNAL));
         }
     }
@@ -805,18 +843,9 @@ int32_t OsNetworkReceiveFrom(THandle aHandle, uint8_t* aBuffer, uint32_t aBytes,
 
     SetFdNonBlocking(handle->iSocket);
 
-    fd_set read;
-    FD_ZERO(&read);
-    FD_SET(handle->iPipe[0], &read);
-    FD_SET(handle->iSocket, &read);
-    fd_set error;
-    FD_ZERO(&error);
-    FD_SET(handle->iSocket, &error);
-
     int32_t received = TEMP_FAILURE_RETRY(recvfrom(handle->iSocket, aBuffer, aBytes, MSG_NOSIGNAL, (struct sockaddr*)&addr, &addrLen));
     if (received==-1 && errno==EWOULDBLOCK) {
-        int32_t selectErr = TEMP_FAILURE_RETRY(select(nfds(handle), &read, NULL, &error, NULL));
-        if (selectErr > 0 && FD_ISSET(handle->iSocket, &read)) {
+        if (WaitForSocket(handle, POLLIN, -1)) {
             received = TEMP_FAILURE_RETRY(recvfrom(handle->iSocket, aBuffer, aBytes, MSG_NOSIGNAL, (struct sockaddr*)&addr, &addrLen));
         }
     }
@@ -826,6 +855,110 @@ int32_t OsNetworkReceiveFrom(THandle aHandle, uint8_t* aBuffer, uint32_t aBytes,
     return received;
 }
 
+#ifndef PLATFORM_MACOSX_GNU
+#define kMaxDatagramsPerCall (32)
+
+int32_t OsNetworkSendToMultiple(THandle aHandle, const uint8_t** aBuffers, const uint32_t* aBytes, uint32_t aCount, TIpAddress aAddress, uint16_t aPort)
+{
+    OsNetworkHandle* handle = (OsNetworkHandle*)aHandle;
+    if (SocketInterrupted(handle)) {
+        return -1;
+    }
+    struct sockaddr_in addr;
+    sockaddrFromEndpoint(&addr, aAddress, aPort);
+    struct mmsghdr msgs[kMaxDatagramsPerCall];
+    struct iovec iov[kMaxDatagramsPerCall];
+    uint32_t sent = 0;
+    while (sent < aCount) {
+        uint32_t count = aCount - sent;
+        if (count > kMaxDatagramsPerCall) {
+            count = kMaxDatagramsPerCall;
+        }
+        uint32_t i;
+        memset(msgs, 0, sizeof(msgs[0]) * count);
+        for (i=0; i<count; i++) {
+            iov[i].iov_base = (void*)aBuffers[sent+i];
+            iov[i].iov_len = aBytes[sent+i];
+            msgs[i].msg_hdr.msg_name = &addr;
+            msgs[i].msg_hdr.msg_namelen = sizeof(addr);
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        int32_t ret = TEMP_FAILURE_RETRY(sendmmsg(handle->iSocket, msgs, count, MSG_NOSIGNAL));
+        if (ret == -1) {
+            break;
+        }
+        sent += ret;
+        if ((uint32_t)ret < count) {
+            break;
+        }
+    }
+    return (sent == 0 && aCount > 0? -1 : (int32_t)sent);
+}
+
+int32_t OsNetworkReceiveFromMultiple(THandle aHandle, uint8_t* aBuffer, uint32_t aBytesPerDatagram, uint32_t aCount,
+                                     uint32_t* aReceived, TIpAddress* aAddresses, uint16_t* aPorts)
+{
+    OsNetworkHandle* handle = (OsNetworkHandle*)aHandle;
+    if (SocketInterrupted(handle)) {
+        return -1;
+    }
+    struct mmsghdr msgs[kMaxDatagramsPerCall];
+    struct iovec iov[kMaxDatagramsPerCall];
+    struct sockaddr_in addrs[kMaxDatagramsPerCall];
+    if (aCount > kMaxDatagramsPerCall) {
+        aCount = kMaxDatagramsPerCall;
+    }
+    uint32_t i;
+    memset(msgs, 0, sizeof(msgs[0]) * aCount);
+    for (i=0; i<aCount; i++) {
+        sockaddrFromEndpoint(&addrs[i], 0, 0);
+        iov[i].iov_base = aBuffer + (i * aBytesPerDatagram);
+        iov[i].iov_len = aBytesPerDatagram;
+        msgs[i].msg_hdr.msg_name = &addrs[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    /* MSG_DONTWAIT returns whatever is already queued rather than waiting for aCount datagrams */
+    int32_t received = TEMP_FAILURE_RETRY(recvmmsg(handle->iSocket, msgs, aCount, MSG_DONTWAIT, NULL));
+    if (received==-1 && errno==EWOULDBLOCK) {
+        if (WaitForSocket(handle, POLLIN, -1)) {
+            received = TEMP_FAILURE_RETRY(recvmmsg(handle->iSocket, msgs, aCount, MSG_DONTWAIT, NULL));
+        }
+    }
+    for (i=0; (int32_t)i<received; i++) {
+        aReceived[i] = msgs[i].msg_len;
+        aAddresses[i] = addrs[i].sin_addr.s_addr;
+        aPorts[i] = ntohs(addrs[i].sin_port);
+    }
+    return (received == 0? -1 : received);
+}
+#else
+int32_t OsNetworkSendToMultiple(THandle aHandle, const uint8_t** aBuffers, const uint32_t* aBytes, uint32_t aCount, TIpAddress aAddress, uint16_t aPort)
+{
+    uint32_t sent;
+    for (sent=0; sent<aCount; sent++) {
+        if (OsNetworkSendTo(aHandle, aBuffers[sent], aBytes[sent], aAddress, aPort) != (int32_t)aBytes[sent]) {
+            break;
+        }
+    }
+    return (sent == 0 && aCount > 0? -1 : (int32_t)sent);
+}
+
+int32_t OsNetworkReceiveFromMultiple(THandle aHandle, uint8_t* aBuffer, uint32_t aBytesPerDatagram, uint32_t aCount,
+                                     uint32_t* aReceived, TIpAddress* aAddresses, uint16_t* aPorts)
+{
+    int32_t received = OsNetworkReceiveFrom(aHandle, aBuffer, aBytesPerDatagram, &aAddresses[0], &aPorts[0]);
+    if (received < 0) {
+        return -1;
+    }
+    aReceived[0] = (uint32_t)received;
+    return 1;
+}
+#endif /* !PLATFORM_MACOSX_GNU */
+
 int32_t OsNetworkInterrupt(THandle aHandle, int32_t aInterrupt)
 {
     int32_t err = 0;
@@ -885,18 +1018,9 @@ THandle OsNetworkAccept(THandle aHandle, TIpAddress* aClientAddress, uint32_t* a
 
     SetFdNonBlocking(handle->iSocket);
 
-    fd_set read;
-    FD_ZERO(&read);
-    FD_SET(handle->iPipe[0], &read);
-    FD_SET(handle->iSocket, &read);
-    fd_set error;
-    FD_ZERO(&error);
-    FD_SET(handle->iSocket, &error);
-
     int32_t h = TEMP_FAILURE_RETRY(accept(handle->iSocket, (struct sockaddr*)&addr, &len));
     if (h==-1 && errno==EWOULDBLOCK) {
-        int32_t selectErr = TEMP_FAILURE_RETRY(select(nfds(handle), &read, NULL, &error, NULL));
-        if (selectErr > 0 && FD_ISSET(handle->iSocket, &read)) {
+        if (WaitForSocket(handle, POLLIN, -1)) {
             h = TEMP_FAILURE_RETRY(accept(handle->iSocket, (struct sockaddr*)&addr, &len));
         }
     }
@@ -916,6 +1040,159 @@ THandle OsNetworkAccept(THandle aHandle, TIpAddress* aClientAddress, uint32_t* a
     return (THandle)newHandle;
 }
 
+int32_t OsNetworkReadable(THandle aHandle)
+{
+    OsNetworkHandle* handle = (OsNetworkHandle*)aHandle;
+    if (SocketInterrupted(handle)) {
+        return -1;
+    }
+    return WaitForSocket(handle, POLLIN, 0);
+}
+
+#ifndef PLATFORM_MACOSX_GNU
+typedef struct OsNetworkPoll
+{
+    int32_t    iEpoll;
+    int32_t    iPipe[2];
+    int32_t    iInterrupted;
+    OsContext* iCtx;
+}OsNetworkPoll;
+
+THandle OsNetworkPollCreate(OsContext* aContext)
+{
+    OsNetworkPoll* poll = (OsNetworkPoll*)malloc(sizeof(OsNetworkPoll));
+    if (poll == NULL) {
+        return kHandleNull;
+    }
+    poll->iEpoll = epoll_create(64);
+    if (poll->iEpoll == -1) {
+        free(poll);
+        return kHandleNull;
+    }
+    if (pipe(poll->iPipe) == -1) {
+        close(poll->iEpoll);
+        free(poll);
+        return kHandleNull;
+    }
+    SetFdNonBlocking(poll->iPipe[0]);
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    if (epoll_ctl(poll->iEpoll, EPOLL_CTL_ADD, poll->iPipe[0], &ev) == -1) {
+        close(poll->iPipe[0]);
+        close(poll->iPipe[1]);
+        close(poll->iEpoll);
+        free(poll);
+        return kHandleNull;
+    }
+    poll->iInterrupted = 0;
+    poll->iCtx = aContext;
+    return (THandle)poll;
+}
+
+void OsNetworkPollDestroy(THandle aPoll)
+{
+    OsNetworkPoll* poll = (OsNetworkPoll*)aPoll;
+    if (poll != NULL) {
+        close(poll->iEpoll);
+        close(poll->iPipe[0]);
+        close(poll->iPipe[1]);
+        free(poll);
+    }
+}
+
+int32_t OsNetworkPollAdd(THandle aPoll, THandle aSocket, void* aArg)
+{
+    OsNetworkPoll* poll = (OsNetworkPoll*)aPoll;
+    OsNetworkHandle* handle = (OsNetworkHandle*)aSocket;
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+    ev.data.ptr = aArg;
+    int32_t err = epoll_ctl(poll->iEpoll, EPOLL_CTL_MOD, handle->iSocket, &ev);
+    if (err == -1 && errno == ENOENT) {
+        err = epoll_ctl(poll->iEpoll, EPOLL_CTL_ADD, handle->iSocket, &ev);
+    }
+    return err;
+}
+
+int32_t OsNetworkPollRemove(THandle aPoll, THandle aSocket)
+{
+    OsNetworkPoll* poll = (OsNetworkPoll*)aPoll;
+    OsNetworkHandle* handle = (OsNetworkHandle*)aSocket;
+    struct epoll_event ev; /* ignored but must be non-NULL for kernels before 2.6.9 */
+    return epoll_ctl(poll->iEpoll, EPOLL_CTL_DEL, handle->iSocket, &ev);
+}
+
+int32_t OsNetworkPollWait(THandle aPoll, void** aReady, uint32_t aMaxReady, uint32_t aTimeoutMs)
+{
+    OsNetworkPoll* poll = (OsNetworkPoll*)aPoll;
+    struct epoll_event events[32];
+    int32_t maxEvents = (aMaxReady < 32? (int32_t)aMaxReady : 32);
+    int32_t timeout = (aTimeoutMs == 0? -1 : (int32_t)aTimeoutMs);
+    int32_t i;
+    int32_t count = 0;
+    int32_t ret;
+
+    OsMutexLock(poll->iCtx->iMutex);
+    ret = poll->iInterrupted;
+    OsMutexUnlock(poll->iCtx->iMutex);
+    if (ret) {
+        return -1;
+    }
+    ret = TEMP_FAILURE_RETRY(epoll_wait(poll->iEpoll, events, maxEvents, timeout));
+    if (ret == -1) {
+        return -1;
+    }
+    for (i=0; i<ret; i++) {
+        if (events[i].data.ptr == NULL) {
+            return -1; /* interrupted */
+        }
+        aReady[count++] = events[i].data.ptr;
+    }
+    return count;
+}
+
+void OsNetworkPollInterrupt(THandle aPoll)
+{
+    OsNetworkPoll* poll = (OsNetworkPoll*)aPoll;
+    int32_t val = 1;
+    OsMutexLock(poll->iCtx->iMutex);
+    poll->iInterrupted = 1;
+    (void)TEMP_FAILURE_RETRY(write(poll->iPipe[1], &val, sizeof(val)));
+    OsMutexUnlock(poll->iCtx->iMutex);
+}
+#else /* PLATFORM_MACOSX_GNU */
+THandle OsNetworkPollCreate(OsContext* aContext)
+{
+    return kHandleNull;
+}
+
+void OsNetworkPollDestroy(THandle aPoll)
+{
+}
+
+int32_t OsNetworkPollAdd(THandle aPoll, THandle aSocket, void* aArg)
+{
+    return -1;
+}
+
+int32_t OsNetworkPollRemove(THandle aPoll, THandle aSocket)
+{
+    return -1;
+}
+
+int32_t OsNetworkPollWait(THandle aPoll, void** aReady, uint32_t aMaxReady, uint32_t aTimeoutMs)
+{
+    return -1;
+}
+
+void OsNetworkPollInterrupt(THandle aPoll)
+{
+}
+#endif /* !PLATFORM_MACOSX_GNU */
+
 int32_t OsNetworkGetHostByName(const char* aAddress, TIpAddress* aHost)
 {
     int32_t ret = 0;
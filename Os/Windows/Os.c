@@ -595,6 +595,40 @@ int32_t OsNetworkSend(THandle aHandle, const uint8_t* aBuffer, uint32_t aBytes)
     return sent;
 }
 
+#define kMaxBuffersPerSend (16)
+
+int32_t OsNetworkSendMultiple(THandle aHandle, const uint8_t** aBuffers, const uint32_t* aBytes, uint32_t aCount)
+{
+    WSABUF bufs[kMaxBuffersPerSend];
+    int32_t sent = 0;
+    uint32_t i = 0;
+    OsNetworkHandle* handle = (OsNetworkHandle*)aHandle;
+    if (SocketInterrupted(handle)) {
+        return -1;
+    }
+    while (i < aCount) {
+        DWORD count = 0;
+        DWORD expected = 0;
+        DWORD bytes = 0;
+        while (count < kMaxBuffersPerSend && i < aCount) {
+            bufs[count].buf = (char*)aBuffers[i];
+            bufs[count].len = aBytes[i];
+            expected += aBytes[i];
+            count++;
+            i++;
+        }
+        /* blocking sockets only complete a WSASend once all data has been sent */
+        if (0 != WSASend(handle->iSocket, bufs, count, &bytes, 0, NULL, NULL)) {
+            break;
+        }
+        sent += bytes;
+        if (bytes != expected) {
+            break;
+        }
+    }
+    return sent;
+}
+
 int32_t OsNetworkSendTo(THandle aHandle, const uint8_t* aBuffer, uint32_t aBytes, TIpAddress aAddress, uint16_t aPort)
 {
     int32_t sent = 0;
@@ -692,6 +726,29 @@ int32_t OsNetworkReceiveFrom(THandle aHandle, uint8_t* aBuffer, uint32_t aBytes,
     return received;
 }
 
+/* Batched datagram i/o isn't available; send or receive one datagram per system call */
+int32_t OsNetworkSendToMultiple(THandle aHandle, const uint8_t** aBuffers, const uint32_t* aBytes, uint32_t aCount, TIpAddress aAddress, uint16_t aPort)
+{
+    uint32_t sent;
+    for (sent=0; sent<aCount; sent++) {
+        if (OsNetworkSendTo(aHandle, aBuffers[sent], aBytes[sent], aAddress, aPort) != (int32_t)aBytes[sent]) {
+            break;
+        }
+    }
+    return (sent == 0 && aCount > 0? -1 : (int32_t)sent);
+}
+
+int32_t OsNetworkReceiveFromMultiple(THandle aHandle, uint8_t* aBuffer, uint32_t aBytesPerDatagram, uint32_t aCount,
+                                     uint32_t* aReceived, TIpAddress* aAddresses, uint16_t* aPorts)
+{
+    int32_t received = OsNetworkReceiveFrom(aHandle, aBuffer, aBytesPerDatagram, &aAddresses[0], &aPorts[0]);
+    if (received < 0) {
+        return -1;
+    }
+    aReceived[0] = (uint32_t)received;
+    return 1;
+}
+
 int32_t OsNetworkInterrupt(THandle aHandle, int32_t aInterrupt)
 {
     int32_t err = 0;
@@ -781,6 +838,56 @@ THandle OsNetworkAccept(THandle aHandle, TIpAddress* aClientAddress, uint32_t* a
     return (THandle)newHandle;
 }
 
+int32_t OsNetworkReadable(THandle aHandle)
+{
+    OsNetworkHandle* handle = (OsNetworkHandle*)aHandle;
+    fd_set rfds;
+    struct timeval tv;
+    int32_t ret;
+
+    if (SocketInterrupted(handle)) {
+        return -1;
+    }
+    FD_ZERO(&rfds);
+    FD_SET(handle->iSocket, &rfds);
+    tv.tv_sec = 0;
+    tv.tv_usec = 0;
+    ret = select(0, &rfds, NULL, NULL, &tv);
+    if (SOCKET_ERROR == ret) {
+        return -1;
+    }
+    return (ret > 0? 1 : 0);
+}
+
+/* Readiness pollers aren't supported; SocketTcpServer falls back to a thread per session */
+THandle OsNetworkPollCreate(OsContext* aContext)
+{
+    return kHandleNull;
+}
+
+void OsNetworkPollDestroy(THandle aPoll)
+{
+}
+
+int32_t OsNetworkPollAdd(THandle aPoll, THandle aSocket, void* aArg)
+{
+    return -1;
+}
+
+int32_t OsNetworkPollRemove(THandle aPoll, THandle aSocket)
+{
+    return -1;
+}
+
+int32_t OsNetworkPollWait(THandle aPoll, void** aReady, uint32_t aMaxReady, uint32_t aTimeoutMs)
+{
+    return -1;
+}
+
+void OsNetworkPollInterrupt(THandle aPoll)
+{
+}
+
 int32_t OsNetworkGetHostByName(const char* aAddress, TIpAddress* aHost)
 {
     int32_t ret = 0;